@@ -923,30 +923,16 @@ static void emit_insn(int64_t oc, int can_compress, int sz)
     int ndx;
 
     if (pass==3 && can_compress && gCanCompress) {
-       for (ndx = 0; ndx < htblmax; ndx++) {
-         if ((int)oc == hTable[ndx].opcode) {
-           hTable[ndx].count++;
-           return;
-         }
-       }
-       if (htblmax < 100000) {
-          hTable[htblmax].opcode = (int)oc;
-          hTable[htblmax].count = 1;
-          htblmax++;
-          return;  
-       }
-       printf("Too many instructions.\r\n");
+       CountCompressible((int)oc);
        return;
     }
     if (pass > 3) {
      if (can_compress && gCanCompress) {
-       for (ndx = 0; ndx < htblmax; ndx++) {
-         if ((int)oc == hTable[ndx].opcode) {
-           emitCode((ndx << 6)|0x1F);
-		   num_bytes += 2;
-		   num_insns += 1;
-           return;
-         }
+       if ((ndx = FindCompressed((int)oc)) >= 0) {
+         emitCode((ndx << 6)|0x1F);
+		 num_bytes += 2;
+		 num_insns += 1;
+         return;
        }
      }
 	 emitNybble(oc & 15);
@@ -3119,13 +3105,8 @@ void FT64x36_processMaster()
     first_data = 1;
     first_bss = 1;
 	expandedBlock = 1;
-    if (pass<3) {
-    htblmax = 0;
-    for (nn = 0; nn < 100000; nn++) {
-      hTable[nn].count = 0;
-      hTable[nn].opcode = 0;
-    }
-    }
+    if (pass<3)
+      ClearCompressTable();
     for (nn = 0; nn < 12; nn++) {
         sections[nn].index = 0;
         if (nn == 0)
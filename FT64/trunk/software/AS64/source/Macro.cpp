@@ -284,6 +284,7 @@ void Macro::Substitute(char *body, int slen)
    int nn;
    char *p;
 
+   ResetTokenStream();
    mlen = strlen(body);          // macro length
    dif = mlen - slen;
    nchars = inptr-masterFile;         // calculate number of characters that could be remaining
@@ -26,55 +26,111 @@
 #ifndef NAMETABLE_HPP
 #define NAMETABLE_HPP
 
+#include <stdlib.h>
 #include <string.h>
 
+// Names are kept one after another in text, each followed by a null. The
+// index of a name in text is its handle, and stays the same as the text
+// grows. A hash of the names gives the handle of a name already in the
+// table.
+
 class NameTable {
 public:
-    char text[1000000];
+    char *text;
     int length;
+private:
+    int size;           // bytes allocated for text
+    int *hash;          // handles, 0 for an empty slot
+    int hashSize;       // always a power of two
+    int count;          // number of names in the hash
+
+    static unsigned int Hash(char *nm) {
+        unsigned int h;
+
+        for (h = 2166136261u; *nm; nm++)
+            h = (h ^ (unsigned char)*nm) * 16777619u;
+        return h;
+    };
+
+    // Find the slot for the name, either the one holding it or the empty
+    // slot it goes in.
+    int Slot(char *nm, unsigned int h) {
+        int nn;
+
+        for (nn = h & (hashSize-1); hash[nn]; nn = (nn + 1) & (hashSize-1)) {
+            if (strcmp(&text[hash[nn]], nm)==0)
+                break;
+        }
+        return nn;
+    };
+
+    void GrowHash() {
+        int *old;
+        int oldSize, nn;
+
+        old = hash;
+        oldSize = hashSize;
+        hashSize *= 2;
+        hash = (int *)calloc(hashSize, sizeof(int));
+        for (nn = 0; nn < oldSize; nn++) {
+            if (old[nn])
+                hash[Slot(&text[old[nn]], Hash(&text[old[nn]]))] = old[nn];
+        }
+        free(old);
+    };
 
 public:    
     NameTable() {
-        text[0] = 0;
-        text[1] = 0;
-        length = 1;
+        size = 65536;
+        text = (char *)malloc(size);
+        hashSize = 4096;
+        hash = (int *)calloc(hashSize, sizeof(int));
+        Clear();
+    };
+    ~NameTable() {
+        free(text);
+        free(hash);
     };
     void Clear() {
         text[0] = 0;
         text[1] = 0;
         length = 1;
+        memset(hash, 0, hashSize * sizeof(int));
+        count = 0;
     };
     char *GetName(int ndx) {
          return &text[ndx];
     };
     
     int FindName(char *nm) {
-        int nn, mm;
-        
-        for (nn = 1; nn < length; nn++) {
-            if (text[nn] == nm[0]) {
-                for(mm = 1; nm[mm] == text[nn+mm] && nm[mm]; mm++);
-                if (nm[mm]=='\0')
-                   return nn;
-            }
-            else {
-                while(text[nn]!=0 && nn < length) nn++;
-                nn++;
-            }
-        }
-        return -1;
+        int nn;
+
+        if (nm[0]=='\0')
+            return 0;
+        nn = hash[Slot(nm, Hash(nm))];
+        return nn ? nn : -1;
     };
 
     int AddName(char *nm) {
-        int ret;
-        int olen;
-        
-        if ((ret = FindName(nm)) > 0)
-           return ret;
-        olen = length;
-        strcpy_s(&text[length], sizeof(text)-length, nm);
-        length += strlen(nm) + 1;
-        return olen;
+        int nn, len, ret;
+
+        if (nm[0]=='\0')
+            return 0;
+        nn = Slot(nm, Hash(nm));
+        if (hash[nn])
+            return hash[nn];
+        len = strlen(nm) + 1;
+        while (length + len > size) {
+            size *= 2;
+            text = (char *)realloc(text, size);
+        }
+        ret = length;
+        memcpy(&text[length], nm, len);
+        length += len;
+        hash[nn] = ret;
+        if (++count * 2 > hashSize)
+            GrowHash();
+        return ret;
     };
     
     void write(FILE *fp) {
@@ -113,6 +113,9 @@ typedef struct _tagHBLE
 } HTBLE;
 
 extern HTBLE hTable[100000];
+extern void ClearCompressTable();
+extern void CountCompressible(int opcode);
+extern int FindCompressed(int opcode);
 extern int processOpt;
 extern int expandedBlock;
 extern int gCanCompress;
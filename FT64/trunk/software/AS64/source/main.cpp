@@ -134,6 +134,73 @@ int hcmp(const void *a1, const void *b1)
     return (a->count < b->count) ? 1 : (a->count==b->count) ? 0 : -1;
 }
 
+// ----------------------------------------------------------------------------
+// The compression table is indexed by opcode. While opcodes are counted in
+// pass 3 every entry of hTable is indexed, after that only the entries that
+// go in the table output by dh_htbl are.
+// ----------------------------------------------------------------------------
+
+#define HTBL_HASH_SIZE	262144		// power of two, more than twice hTable
+
+static int htblHash[HTBL_HASH_SIZE];	// hTable index + 1, 0 if empty
+
+static int htblSlot(int opcode)
+{
+    int h;
+
+    h = (int)(((unsigned int)opcode * 0x9E3779B9u) >> 14);
+    while (htblHash[h] && hTable[htblHash[h]-1].opcode != opcode)
+        h = (h + 1) & (HTBL_HASH_SIZE-1);
+    return (h);
+}
+
+void ClearCompressTable()
+{
+    htblmax = 0;
+    memset(hTable, 0, sizeof(hTable));
+    memset(htblHash, 0, sizeof(htblHash));
+}
+
+void CountCompressible(int opcode)
+{
+    int h;
+
+    h = htblSlot(opcode);
+    if (htblHash[h]) {
+        hTable[htblHash[h]-1].count++;
+        return;
+    }
+    if (htblmax < 100000) {
+        hTable[htblmax].opcode = opcode;
+        hTable[htblmax].count = 1;
+        htblmax++;
+        htblHash[h] = htblmax;
+        return;
+    }
+    printf("Too many instructions.\r\n");
+}
+
+// Order the table by frequency and keep the index for the 1024 most
+// frequent opcodes, the ones that can be compressed.
+
+void SelectCompressed()
+{
+    int nn;
+
+    qsort((HTBLE*)hTable, htblmax, sizeof(HTBLE), hcmp);
+    memset(htblHash, 0, sizeof(htblHash));
+    for (nn = 0; nn < htblmax && nn < 1024; nn++)
+        htblHash[htblSlot(hTable[nn].opcode)] = nn + 1;
+}
+
+// Returns the compressed index of the opcode or -1 if it isn't in the
+// table.
+
+int FindCompressed(int opcode)
+{
+    return (htblHash[htblSlot(opcode)] - 1);
+}
+
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 
@@ -1271,6 +1338,7 @@ j1:
     strcat(masterFile, databuf);
     strcat(masterFile, bssbuf);
     strcat(masterFile, tlsbuf);
+    ResetTokenStream();
     if (debug) {
         FILE *fp;
         fp = fopen("a64-segments.asm", "w");
@@ -1288,6 +1356,7 @@ void skipif(int64_t val)
 	bool codecut = false;
 
 	// Cut out the if statement
+	ResetTokenStream();
 	p1 = pif1;
 	memmove(pif1,pif2,sizeof(masterFile)-(pif2-masterFile));
 
@@ -1493,6 +1562,7 @@ int checksum64(int64_t *val)
 void processMaster()
 {
     expandedBlock = 0;
+	BeginTokenStream();
 	switch(gCpu) {
 	case 888:	Table888_processMaster();	break;
 	case 889:	Table888mmu_processMaster();	break;
@@ -1506,6 +1576,7 @@ void processMaster()
 	case 'G':	FT64x36_processMaster();	break;
 	default:	FT64_processMaster();
 	}
+	EndTokenStream();
 }
 
 // ----------------------------------------------------------------------------
@@ -1604,6 +1675,10 @@ void WriteELFFile(FILE *fp)
     sections[5].hdr.sh_info = 0;
     sections[5].hdr.sh_addralign = 1;
     sections[5].hdr.sh_entsize = 0;
+    if (nmTable.length > (int)sizeof(sections[5].bytes)) {
+        printf("Too many names for the .elf string table.\r\n");
+        return;
+    }
     memcpy(sections[5].bytes, nmTable.text, nmTable.length);
 
     sections[6].hdr.sh_type = clsElf64Shdr::SHT_SYMTAB;
@@ -1883,7 +1958,7 @@ int main(int argc, char *argv[])
     pass = 3;
     processMaster();       // Pass 3 collect up opcodes
     printf("Qsorting\r\n");
-    qsort((HTBLE*)hTable, htblmax, sizeof(HTBLE), hcmp);
+    SelectCompressed();
    
     pass = 4;
     if (verbose) printf("Pass 4 - get all symbols, set initial values.\r\n");
@@ -0,0 +1,669 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2014-2018  Robert Finch, Waterloo
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// A64 - Assembler
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU Lesser General Public License as published 
+// by the Free Software Foundation, either version 3 of the License, or     
+// (at your option) any later version.                                      
+//                                                                          
+// This source file is distributed in the hope that it will be useful,      
+// but WITHOUT ANY WARRANTY; without even the implied warranty of           
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            
+// GNU General Public License for more details.                             
+//                                                                          
+// You should have received a copy of the GNU General Public License        
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.    
+//                                                                          
+// ============================================================================
+//
+#include "stdafx.h"
+
+// Mnemonics and directives.
+//
+// The table below lists the names NextToken() recognizes, the token for each
+// one, what has to follow it and the targets it's for. A name is matched
+// ignoring case. Names that start with the same identifier characters are
+// tried in table order.
+//
+// The first time a name is looked up for a target a minimal perfect hash of
+// the names for the target is built (hash and displace). The identifier
+// characters at inptr are hashed as they're read and one slot is probed.
+
+enum {
+	mt_none,		// nothing has to follow, the name ends in ':' or '.'
+	mt_space,		// white space
+	mt_spaceOrDot,	// white space or a '.'
+	mt_blankOrDot,	// a blank, tab, CR or '.'
+	mt_colon		// a ':', which isn't part of the token
+};
+
+#define M_THOR		0x01	// gCpu==4
+#define M_FRISCV	0x02	// gCpu==5
+#define M_DSD7		0x04	// gCpu==7
+#define M_DSD9		0x08	// gCpu=='A'
+#define M_FT64		0x10	// gCpu=='F'
+#define M_FT64X36	0x20	// gCpu=='G'
+
+typedef struct _tagMnemonic {
+	char *name;		// lower case
+	int token;
+	int follow;
+	int targets;	// zero for every target
+} Mnemonic;
+
+static Mnemonic mnemonics[] = {
+	{ "_4addu",    tk_4addu,    mt_space,      0 },
+	{ "_2addu",    tk_2addu,    mt_space,      0 },
+	{ "_8addu",    tk_8addu,    mt_space,      0 },
+	{ "_16addu",   tk_16addu,   mt_space,      0 },
+	{ "_4addui",   tk_4addui,   mt_space,      0 },
+	{ "_2addui",   tk_2addui,   mt_space,      0 },
+	{ "_8addui",   tk_8addui,   mt_space,      0 },
+	{ "_16addui",  tk_16addui,  mt_space,      0 },
+
+	{ "and",       tk_and,      mt_space,      0 },
+	{ "addu",      tk_addu,     mt_space,      0 },
+	{ "addui",     tk_addui,    mt_space,      0 },
+	{ "addi",      tk_addi,     mt_space,      0 },
+	{ "add",       tk_add,      mt_space,      0 },
+	{ "align",     tk_align,    mt_space,      0 },
+	{ "andi",      tk_andi,     mt_space,      0 },
+	{ "asri",      tk_asri,     mt_space,      0 },
+	{ "asr",       tk_asr,      mt_blankOrDot, 0 },
+	{ "asli",      tk_asli,     mt_blankOrDot, 0 },
+	{ "asl",       tk_asl,      mt_blankOrDot, 0 },
+	{ "abs",       tk_abs,      mt_space,      0 },
+
+	{ "beq",       tk_beq,      mt_space,      0 },
+	{ "beqi",      tk_beqi,     mt_space,      0 },
+	{ "bne",       tk_bne,      mt_space,      0 },
+	{ "bnei",      tk_bnei,     mt_space,      0 },
+	{ "bra",       tk_bra,      mt_space,      0 },
+	{ "brz",       tk_brz,      mt_space,      0 },
+	{ "blt",       tk_blt,      mt_space,      0 },
+	{ "blti",      tk_blti,     mt_space,      0 },
+	{ "bltu",      tk_bltu,     mt_space,      0 },
+	{ "bltui",     tk_bltui,    mt_space,      0 },
+	{ "blo",       tk_bltu,     mt_space,      0 },
+	{ "ble",       tk_ble,      mt_space,      0 },
+	{ "blei",      tk_blei,     mt_space,      0 },
+	{ "bleu",      tk_bleu,     mt_space,      0 },
+	{ "bleui",     tk_bleui,    mt_space,      0 },
+	{ "bls",       tk_bleu,     mt_space,      0 },
+	{ "bge",       tk_bge,      mt_space,      0 },
+	{ "bgei",      tk_bgei,     mt_space,      0 },
+	{ "bgeu",      tk_bgeu,     mt_space,      0 },
+	{ "bgeui",     tk_bgeui,    mt_space,      0 },
+	{ "bhs",       tk_bgeu,     mt_space,      0 },
+	{ "bgt",       tk_bgt,      mt_space,      0 },
+	{ "bgti",      tk_bgti,     mt_space,      0 },
+	{ "bgtu",      tk_bgtu,     mt_space,      0 },
+	{ "bgtui",     tk_bgtui,    mt_space,      0 },
+	{ "bhi",       tk_bgtu,     mt_space,      0 },
+	{ "brnz",      tk_brnz,     mt_space,      0 },
+	{ "bsr",       tk_bsr,      mt_space,      0 },
+	{ "bmi",       tk_bmi,      mt_space,      0 },
+	{ "bpl",       tk_bpl,      mt_space,      0 },
+	{ "bvc",       tk_bvc,      mt_space,      0 },
+	{ "bvs",       tk_bvs,      mt_space,      0 },
+	{ "brk",       tk_brk,      mt_space,      0 },
+	{ "brpl",      tk_bpl,      mt_space,      0 },
+	{ "brmi",      tk_bmi,      mt_space,      0 },
+	{ "bss",       tk_bss,      mt_space,      0 },
+	{ "bits",      tk_bits,     mt_space,      0 },
+	{ "byte",      tk_db,       mt_space,      0 },
+	{ "bfext",     tk_bfext,    mt_space,      0 },
+	{ "bfins",     tk_bfins,    mt_space,      0 },
+	{ "bfextu",    tk_bfextu,   mt_space,      0 },
+	{ "br",        tk_br,       mt_space,      M_THOR },
+	{ "bit",       tk_bit,      mt_space,      M_THOR },
+	{ "biti",      tk_biti,     mt_space,      M_THOR },
+	{ "bbc",       tk_bbc,      mt_space,      M_DSD7 | M_DSD9 | M_FT64 },
+	{ "bbs",       tk_bbs,      mt_space,      M_DSD7 | M_DSD9 | M_FT64 },
+
+	{ "cache",     tk_cache,    mt_space,      M_FT64 | M_FT64X36 },
+	{ "call",      tk_call,     mt_space,      M_DSD7 | M_DSD9 | M_FT64 | M_FT64X36 },
+	{ "calltgt",   tk_calltgt,  mt_space,      M_DSD7 | M_DSD9 | M_FT64 | M_FT64X36 },
+	{ "cmpi",      tk_cmpi,     mt_space,      M_THOR },
+	{ "cmpu",      tk_cmpu,     mt_space,      0 },
+	{ "cmpui",     tk_cmpui,    mt_space,      0 },
+	{ "cmp",       tk_cmp,      mt_space,      0 },
+	{ "code",      tk_code,     mt_space,      0 },
+	{ "cli",       tk_cli,      mt_space,      0 },
+	{ "com",       tk_com,      mt_space,      0 },
+	{ "cs:",       tk_cs,       mt_none,       0 },
+	{ "cpuid",     tk_cpuid,    mt_space,      0 },
+	{ "cas",       tk_cas,      mt_space,      0 },
+	{ "chk",       tk_chk,      mt_space,      0 },
+	{ "chki",      tk_chki,     mt_space,      0 },
+	{ "csrrc",     tk_csrrc,    mt_space,      M_FRISCV | M_DSD7 | M_DSD9 | M_FT64 | M_FT64X36 },
+	{ "csrrd",     tk_csrrd,    mt_space,      M_FRISCV | M_DSD7 | M_DSD9 | M_FT64 | M_FT64X36 },
+	{ "csrrs",     tk_csrrs,    mt_space,      M_FRISCV | M_DSD7 | M_DSD9 | M_FT64 | M_FT64X36 },
+	{ "csrrw",     tk_csrrw,    mt_space,      M_FRISCV | M_DSD7 | M_DSD9 | M_FT64 | M_FT64X36 },
+
+	{ "dbnz",      tk_dbnz,     mt_space,      0 },
+	{ "db",        tk_db,       mt_space,      0 },
+	{ "dc",        tk_dc,       mt_space,      0 },
+	{ "dh",        tk_dh,       mt_space,      0 },
+	{ "dd",        tk_dd,       mt_space,      M_DSD9 },
+	{ "do",        tk_do,       mt_space,      M_DSD9 },
+	{ "dt",        tk_dt,       mt_space,      M_DSD9 },
+	{ "dw",        tk_dw,       mt_space,      0 },
+	{ "div",       tk_div,      mt_space,      0 },
+	{ "divi",      tk_divi,     mt_space,      0 },
+	{ "divu",      tk_divu,     mt_space,      0 },
+	{ "divui",     tk_divui,    mt_space,      0 },
+	{ "divs",      tk_div,      mt_space,      0 },
+	{ "data",      tk_data,     mt_space,      0 },
+	{ "ds:",       tk_ds,       mt_none,       0 },
+	{ "dcb",       tk_fill,     mt_spaceOrDot, 0 },
+	{ "dec",       tk_dec,      mt_spaceOrDot, 0 },
+	{ "dh_htbl",   tk_dh_htbl,  mt_space,      0 },
+
+	{ "equ",       tk_equ,      mt_space,      0 },
+	{ "eori",      tk_eori,     mt_space,      0 },
+	{ "eor",       tk_eor,      mt_space,      0 },
+	{ "end",       tk_end,      mt_space,      0 },
+	{ "endif",     tk_endif,    mt_space,      0 },
+	{ "else",      tk_else,     mt_space,      0 },
+	{ "endpublic", tk_endpublic, mt_space,      0 },
+	{ "extern",    tk_extern,   mt_space,      0 },
+	{ "es:",       tk_es,       mt_none,       0 },
+	{ "eret",      tk_eret,     mt_space,      M_FRISCV },
+	{ "endm",      tk_endm,     mt_space,      0 },
+
+	{ "fill",      tk_fill,     mt_spaceOrDot, 0 },
+	{ "fadd",      tk_fadd,     mt_spaceOrDot, 0 },
+	{ "fsub",      tk_fsub,     mt_spaceOrDot, 0 },
+	{ "fcmp",      tk_fcmp,     mt_spaceOrDot, 0 },
+	{ "fmul",      tk_fmul,     mt_spaceOrDot, 0 },
+	{ "fmov",      tk_fmov,     mt_spaceOrDot, 0 },
+	{ "fdiv",      tk_fdiv,     mt_spaceOrDot, 0 },
+	{ "fix2flt",   tk_fix2flt,  mt_spaceOrDot, 0 },
+	{ "flt2fix",   tk_flt2fix,  mt_spaceOrDot, 0 },
+	{ "fabs",      tk_fabs,     mt_spaceOrDot, 0 },
+	{ "fneg",      tk_fneg,     mt_spaceOrDot, 0 },
+	{ "fnabs",     tk_fnabs,    mt_spaceOrDot, 0 },
+	{ "fcx",       tk_fcx,      mt_space,      0 },
+	{ "fdx",       tk_fdx,      mt_space,      0 },
+	{ "fex",       tk_fex,      mt_space,      0 },
+	{ "frm",       tk_frm,      mt_space,      0 },
+	{ "ftx",       tk_ftx,      mt_space,      0 },
+	{ "fstat",     tk_fstat,    mt_space,      0 },
+	{ "ftst",      tk_ftst,     mt_spaceOrDot, 0 },
+	{ "fbeq",      tk_fbeq,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+	{ "fbne",      tk_fbne,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+	{ "fblt",      tk_fblt,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+	{ "fble",      tk_fble,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+	{ "fbgt",      tk_fbgt,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+	{ "fbge",      tk_fbge,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+	{ "fbor",      tk_fbor,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+	{ "fbun",      tk_fbun,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+	{ "ftoi",      tk_ftoi,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+
+	{ "gran",      tk_gran,     mt_space,      0 },
+
+	{ "hint",      tk_hint,     mt_space,      0 },
+	{ "hs:",       tk_hs,       mt_none,       M_THOR },
+
+	{ "ibne",      tk_ibne,     mt_space,      M_FT64 },
+	{ "ios",       tk_ios,      mt_colon,      0 },
+	{ "inc",       tk_inc,      mt_spaceOrDot, 0 },
+	{ "int",       tk_int,      mt_space,      0 },
+	{ "iret",      tk_iret,     mt_space,      0 },
+	{ "ipush",     tk_ipush,    mt_space,      M_DSD7 },
+	{ "ipop",      tk_ipop,     mt_space,      M_DSD7 },
+	{ "itof",      tk_itof,     mt_spaceOrDot, M_DSD7 | M_DSD9 | M_FT64 },
+	{ "ifdef",     tk_ifdef,    mt_spaceOrDot, 0 },
+	{ "ifndef",    tk_ifndef,   mt_spaceOrDot, 0 },
+	{ "if",        tk_if,       mt_spaceOrDot, 0 },
+
+	{ "jal",       tk_jal,      mt_space,      0 },
+	{ "jsr",       tk_jsr,      mt_space,      0 },
+	{ "jsf",       tk_jsf,      mt_space,      0 },
+	{ "jmp",       tk_jmp,      mt_space,      0 },
+	{ "jsp",       tk_jsp,      mt_space,      0 },
+	{ "jgr",       tk_jgr,      mt_space,      0 },
+	{ "jci",       tk_jci,      mt_space,      M_THOR },
+	{ "jhi",       tk_jhi,      mt_space,      M_THOR },
+
+	{ "ldd",       tk_ldd,      mt_space,      M_DSD9 },
+	{ "ldb",       tk_ldb,      mt_space,      M_DSD9 },
+	{ "ldbu",      tk_ldbu,     mt_space,      M_DSD9 },
+	{ "ldw",       tk_ldw,      mt_space,      M_DSD9 },
+	{ "ldwu",      tk_ldwu,     mt_space,      M_DSD9 },
+	{ "ldt",       tk_ldt,      mt_space,      M_DSD9 },
+	{ "ldtu",      tk_ldtu,     mt_space,      M_DSD9 },
+	{ "ldp",       tk_ldp,      mt_space,      M_DSD9 },
+	{ "ldpu",      tk_ldpu,     mt_space,      M_DSD9 },
+	{ "ldvdar",    tk_ldvdar,   mt_space,      M_DSD9 },
+	{ "ld",        tk_ld,       mt_space,      0 },
+	{ "lb",        tk_lb,       mt_space,      0 },
+	{ "lbu",       tk_lbu,      mt_space,      0 },
+	{ "lf",        tk_lf,       mt_spaceOrDot, 0 },
+	{ "lv",        tk_lv,       mt_space,      0 },
+	{ "lw",        tk_lw,       mt_space,      0 },
+	{ "lh",        tk_lh,       mt_space,      0 },
+	{ "lhu",       tk_lhu,      mt_space,      0 },
+	{ "lc",        tk_lc,       mt_space,      0 },
+	{ "lcu",       tk_lcu,      mt_space,      0 },
+	{ "ldi",       tk_ldi,      mt_space,      0 },
+	{ "link",      tk_link,     mt_space,      0 },
+	{ "ldis",      tk_ldis,     mt_space,      0 },
+	{ "lea",       tk_lea,      mt_space,      0 },
+	{ "lmr",       tk_lmr,      mt_space,      0 },
+	{ "lsri",      tk_lsri,     mt_space,      0 },
+	{ "lsr",       tk_lsr,      mt_space,      0 },
+	{ "lfd",       tk_lfd,      mt_space,      0 },
+	{ "lwar",      tk_lwar,     mt_space,      0 },
+	{ "lvb",       tk_lvb,      mt_space,      M_FT64 | M_FT64X36 },
+	{ "lvc",       tk_lvc,      mt_space,      M_FT64 | M_FT64X36 },
+	{ "lvh",       tk_lvh,      mt_space,      M_FT64 | M_FT64X36 },
+	{ "lvw",       tk_lvw,      mt_space,      M_FT64 | M_FT64X36 },
+	{ "lwr",       tk_lwr,      mt_space,      M_FT64 | M_FT64X36 },
+	{ "lvb",       tk_lvb,      mt_space,      M_THOR },
+	{ "lvc",       tk_lvc,      mt_space,      M_THOR },
+	{ "lvh",       tk_lvh,      mt_space,      M_THOR },
+	{ "lvw",       tk_lvw,      mt_space,      M_THOR },
+	{ "lvwar",     tk_lvwar,    mt_space,      M_THOR },
+	{ "lws",       tk_lws,      mt_space,      M_THOR },
+	{ "loop",      tk_loop,     mt_space,      M_THOR },
+	{ "lla",       tk_lla,      mt_space,      M_THOR },
+	{ "llax",      tk_llax,     mt_space,      M_THOR },
+	{ "ltcb",      tk_ltcb,     mt_space,      M_DSD7 },
+
+	{ "max",       tk_max,      mt_space,      0 },
+	{ "mov",       tk_mov,      mt_space,      0 },
+	{ "mul",       tk_mul,      mt_space,      0 },
+	{ "mulu",      tk_mulu,     mt_space,      0 },
+	{ "mului",     tk_mului,    mt_space,      0 },
+	{ "muli",      tk_muli,     mt_space,      0 },
+	{ "mod",       tk_mod,      mt_space,      0 },
+	{ "modu",      tk_modu,     mt_space,      0 },
+	{ "modi",      tk_modi,     mt_space,      0 },
+	{ "modui",     tk_modui,    mt_space,      0 },
+	{ "mtspr",     tk_mtspr,    mt_space,      0 },
+	{ "mfspr",     tk_mfspr,    mt_space,      0 },
+	{ "mtfp",      tk_mtfp,     mt_space,      0 },
+	{ "mffp",      tk_mffp,     mt_space,      0 },
+	{ "message",   tk_message,  mt_space,      0 },
+	{ "mv2flt",    tk_mv2flt,   mt_space,      0 },
+	{ "mv2fix",    tk_mv2fix,   mt_space,      0 },
+	{ "memdb",     tk_memdb,    mt_space,      M_THOR },
+	{ "memsb",     tk_memsb,    mt_space,      M_THOR },
+	{ "mark1",     tk_mark1,    mt_space,      M_DSD9 },
+	{ "mark2",     tk_mark2,    mt_space,      M_DSD9 },
+	{ "marco",     tk_macro,    mt_space,      0 },
+
+	{ "not",       tk_not,      mt_space,      0 },
+	{ "neg",       tk_neg,      mt_space,      0 },
+	{ "nop",       tk_nop,      mt_space,      0 },
+
+	{ "ori",       tk_ori,      mt_space,      0 },
+	{ "or",        tk_or,       mt_space,      0 },
+	{ "org",       tk_org,      mt_space,      0 },
+
+	{ "push",      tk_push,     mt_spaceOrDot, 0 },
+	{ "pop",       tk_pop,      mt_spaceOrDot, 0 },
+	{ "pea",       tk_pea,      mt_space,      0 },
+	{ "php",       tk_php,      mt_space,      0 },
+	{ "plp",       tk_plp,      mt_space,      0 },
+	{ "public",    tk_public,   mt_space,      0 },
+	{ "pand",      tk_pand,     mt_space,      M_THOR },
+	{ "por",       tk_por,      mt_space,      M_THOR },
+	{ "peor",      tk_peor,     mt_space,      M_THOR },
+	{ "pandc",     tk_pandc,    mt_space,      M_THOR },
+	{ "porc",      tk_porc,     mt_space,      M_THOR },
+	{ "pnand",     tk_pnand,    mt_space,      M_THOR },
+	{ "pnor",      tk_pnor,     mt_space,      M_THOR },
+	{ "penor",     tk_penor,    mt_space,      M_THOR },
+
+	{ "ret",       tk_ret,      mt_space,      M_DSD7 | M_DSD9 | M_FT64 },
+	{ "rex",       tk_rex,      mt_space,      M_DSD7 | M_DSD9 | M_FT64 },
+	{ "rts",       tk_rts,      mt_space,      0 },
+	{ "rtf",       tk_rtf,      mt_space,      0 },
+	{ "rtl",       tk_rtl,      mt_space,      0 },
+	{ "rol",       tk_rol,      mt_blankOrDot, 0 },
+	{ "roli",      tk_roli,     mt_blankOrDot, 0 },
+	{ "ror",       tk_ror,      mt_blankOrDot, 0 },
+	{ "rori",      tk_rori,     mt_blankOrDot, 0 },
+	{ "rti",       tk_rti,      mt_space,      0 },
+	{ "rte",       tk_rte,      mt_space,      0 },
+	{ "rtd",       tk_rtd,      mt_space,      0 },
+	{ "rodata",    tk_rodata,   mt_space,      0 },
+
+	{ "std",       tk_std,      mt_space,      M_DSD9 },
+	{ "stdcr",     tk_stdcr,    mt_space,      M_DSD9 },
+	{ "stb",       tk_stb,      mt_space,      M_DSD9 },
+	{ "stp",       tk_stp,      mt_space,      M_DSD9 },
+	{ "stt",       tk_stt,      mt_space,      M_DSD9 },
+	{ "stw",       tk_stw,      mt_space,      M_DSD9 },
+	{ "sw",        tk_sw,       mt_space,      0 },
+	{ "sb",        tk_sb,       mt_space,      0 },
+	{ "sc",        tk_sc,       mt_space,      0 },
+	{ "sh",        tk_sh,       mt_space,      0 },
+	{ "sf",        tk_sf,       mt_spaceOrDot, 0 },
+	{ "subui",     tk_subui,    mt_space,      0 },
+	{ "subi",      tk_subi,     mt_space,      0 },
+	{ "subu",      tk_subu,     mt_space,      0 },
+	{ "sub",       tk_sub,      mt_space,      0 },
+	{ "sfd",       tk_sfd,      mt_space,      0 },
+	{ "shli",      tk_shli,     mt_blankOrDot, 0 },
+	{ "shl",       tk_shl,      mt_blankOrDot, 0 },
+	{ "shrui",     tk_shrui,    mt_blankOrDot, 0 },
+	{ "shru",      tk_shru,     mt_blankOrDot, 0 },
+	{ "shr",       tk_shru,     mt_blankOrDot, 0 },
+	{ "sei",       tk_sei,      mt_space,      0 },
+	{ "smr",       tk_smr,      mt_space,      0 },
+	{ "sxb",       tk_sxb,      mt_space,      0 },
+	{ "sxc",       tk_sxc,      mt_space,      0 },
+	{ "sxh",       tk_sxh,      mt_space,      0 },
+	{ "seq",       tk_seq,      mt_space,      0 },
+	{ "seqi",      tk_seqi,     mt_space,      0 },
+	{ "sne",       tk_sne,      mt_space,      0 },
+	{ "snei",      tk_snei,     mt_space,      0 },
+	{ "sge",       tk_sge,      mt_space,      0 },
+	{ "sgei",      tk_sgei,     mt_space,      0 },
+	{ "sgt",       tk_sgt,      mt_space,      0 },
+	{ "sgti",      tk_sgti,     mt_space,      0 },
+	{ "sle",       tk_sle,      mt_space,      0 },
+	{ "slei",      tk_slei,     mt_space,      0 },
+	{ "slt",       tk_slt,      mt_space,      0 },
+	{ "slti",      tk_slti,     mt_space,      0 },
+	{ "sgeu",      tk_sgeu,     mt_space,      0 },
+	{ "sgeui",     tk_sgeui,    mt_space,      0 },
+	{ "sgtu",      tk_sgtu,     mt_space,      0 },
+	{ "sgtui",     tk_sgtui,    mt_space,      0 },
+	{ "sleu",      tk_sleu,     mt_space,      0 },
+	{ "sleui",     tk_sleui,    mt_space,      0 },
+	{ "sltu",      tk_sltu,     mt_space,      0 },
+	{ "sltui",     tk_sltui,    mt_space,      0 },
+	{ "ss:",       tk_ss,       mt_none,       0 },
+	{ "swap",      tk_swap,     mt_space,      0 },
+	{ "st",        tk_sw,       mt_space,      0 },
+	{ "sv",        tk_sv,       mt_space,      0 },
+	{ "sys",       tk_sys,      mt_space,      0 },
+	{ "stp",       tk_stp,      mt_space,      0 },
+	{ "stsb",      tk_stsb,     mt_space,      M_THOR },
+	{ "stsc",      tk_stsc,     mt_space,      M_THOR },
+	{ "stsh",      tk_stsh,     mt_space,      M_THOR },
+	{ "stsw",      tk_stsw,     mt_space,      M_THOR },
+	{ "sws",       tk_sws,      mt_space,      M_THOR },
+	{ "stcmp.",    tk_stcmp,    mt_none,       M_THOR },
+	{ "stmov.",    tk_stmov,    mt_none,       M_THOR },
+	{ "stset.",    tk_stset,    mt_none,       M_THOR },
+	{ "shri",      tk_shri,     mt_space,      M_THOR },
+	{ "shr",       tk_shr,      mt_blankOrDot, M_THOR },
+	{ "sync",      tk_sync,     mt_space,      0 },
+	{ "swcr",      tk_swcr,     mt_space,      0 },
+	{ "swc",       tk_swc,      mt_space,      0 },
+	{ "slli",      tk_slli,     mt_blankOrDot, M_FRISCV },
+	{ "srai",      tk_srai,     mt_blankOrDot, M_FRISCV },
+	{ "srli",      tk_srli,     mt_blankOrDot, M_FRISCV },
+	{ "stcb",      tk_stcb,     mt_space,      M_DSD7 },
+
+	{ "to",        tk_to,       mt_space,      0 },
+	{ "tgt",       tk_tgt,      mt_space,      M_DSD9 },
+	{ "tst",       tk_tst,      mt_space,      M_THOR },
+	{ "tlbdis",    tk_tlbdis,   mt_space,      M_THOR },
+	{ "tlben",     tk_tlben,    mt_space,      M_THOR },
+	{ "tlbpb",     tk_tlbpb,    mt_space,      M_THOR },
+	{ "tlbrd",     tk_tlbrd,    mt_space,      M_THOR },
+	{ "tlbrdreg",  tk_tlbrdreg, mt_space,      M_THOR },
+	{ "tlbwi",     tk_tlbwi,    mt_space,      M_THOR },
+	{ "tlbwr",     tk_tlbwr,    mt_space,      M_THOR },
+	{ "tlbwrreg",  tk_tlbwrreg, mt_space,      M_THOR },
+
+	{ "unlink",    tk_unlink,   mt_space,      0 },
+
+	{ "vadd",      tk_vadd,     mt_blankOrDot, 0 },
+	{ "vadds",     tk_vadds,    mt_blankOrDot, 0 },
+	{ "vand",      tk_vand,     mt_blankOrDot, 0 },
+	{ "vands",     tk_vands,    mt_blankOrDot, 0 },
+	{ "vdiv",      tk_vdiv,     mt_blankOrDot, 0 },
+	{ "vdivs",     tk_vdivs,    mt_blankOrDot, 0 },
+	{ "vmov",      tk_vmov,     mt_blankOrDot, 0 },
+	{ "vmul",      tk_vmul,     mt_blankOrDot, 0 },
+	{ "vmuls",     tk_vmuls,    mt_blankOrDot, 0 },
+	{ "vor",       tk_vor,      mt_blankOrDot, 0 },
+	{ "vors",      tk_vors,     mt_blankOrDot, 0 },
+	{ "vsub",      tk_vsub,     mt_blankOrDot, 0 },
+	{ "vsubs",     tk_vsubs,    mt_blankOrDot, 0 },
+	{ "vxor",      tk_vxor,     mt_blankOrDot, 0 },
+	{ "vxors",     tk_vxors,    mt_blankOrDot, 0 },
+
+	{ "wai",       tk_wai,      mt_space,      0 },
+
+	{ "xori",      tk_xori,     mt_space,      0 },
+	{ "xor",       tk_xor,      mt_space,      0 },
+
+	{ "zs:",       tk_zs,       mt_none,       M_THOR },
+	{ "zxb",       tk_zxb,      mt_space,      M_THOR },
+	{ "zxc",       tk_zxc,      mt_space,      M_THOR },
+	{ "zxh",       tk_zxh,      mt_space,      M_THOR },
+	{ nullptr,     tk_none,     mt_none,       0 }
+};
+
+#define NMNEMONICS	(sizeof(mnemonics)/sizeof(Mnemonic)-1)
+
+typedef struct _tagMnemonicKey {
+	char name[16];	// identifier characters of the names
+	int len;
+	int first;		// first name in mnemonicList
+	int count;
+} MnemonicKey;
+
+static MnemonicKey keyList[NMNEMONICS];
+static int mnemonicList[NMNEMONICS];
+static int slotKey[NMNEMONICS*2];
+static int displacement[NMNEMONICS];
+static int nkeys;
+static int nslots, nbuckets;	// powers of two
+static int slotShift;			// 32 - log2(nslots)
+static unsigned int hashSeed;
+static int builtFor = -1;		// gCpu the hash was built for
+
+static int TargetMask()
+{
+	switch(gCpu) {
+	case 4:		return (M_THOR);
+	case 5:		return (M_FRISCV);
+	case 7:		return (M_DSD7);
+	case 'A':	return (M_DSD9);
+	case 'F':	return (M_FT64);
+	case 'G':	return (M_FT64X36);
+	}
+	return (0);
+}
+
+static uint64_t HashStart()
+{
+	return (14695981039346656037ULL ^ (hashSeed * 0x9E3779B97F4A7C15ULL));
+}
+
+static uint64_t HashStep(uint64_t h, char ch)
+{
+	return ((h ^ (unsigned char)ch) * 1099511628211ULL);
+}
+
+static int HashSlot(uint64_t h, int d)
+{
+	// The multiply brings all the bits of the hash into the top bits.
+	return ((int)((((unsigned int)h ^ ((unsigned int)d * 0x9E3779B9u)) * 0x85EBCA6Bu) >> slotShift));
+}
+
+// Find a displacement for each bucket, biggest buckets first, that puts the
+// keys of the bucket in empty slots. Returns false if there's a bucket
+// that can't be placed.
+
+static bool PlaceKeys(uint64_t *hash, int *next, int *head, int *size, bool *used)
+{
+	int sz, bb, kk, mm, d, slot;
+	bool ok;
+
+	for (kk = 0; kk < nslots; kk++) {
+		used[kk] = false;
+		slotKey[kk] = -1;
+	}
+	for (sz = nkeys; sz > 0; sz--) {
+		for (bb = 0; bb < nbuckets; bb++) {
+			if (size[bb] != sz)
+				continue;
+			for (d = 0; d < 65536; d++) {
+				ok = true;
+				for (kk = head[bb]; kk >= 0; kk = next[kk]) {
+					slot = HashSlot(hash[kk], d);
+					if (used[slot]) {
+						ok = false;
+						break;
+					}
+					used[slot] = true;
+					slotKey[slot] = kk;
+				}
+				if (ok)
+					break;
+				// Take back the slots used so far.
+				for (mm = head[bb]; mm != kk; mm = next[mm])
+					used[HashSlot(hash[mm], d)] = false;
+			}
+			if (!ok)
+				return (false);
+			displacement[bb] = d;
+		}
+	}
+	return (true);
+}
+
+static void BuildMnemonicHash()
+{
+	static uint64_t hash[NMNEMONICS];
+	static int next[NMNEMONICS], head[NMNEMONICS], size[NMNEMONICS];
+	static int entryKey[NMNEMONICS];
+	static bool used[NMNEMONICS*2];
+	int mask, nn, kk, bb, len, nentries;
+	Mnemonic *mp;
+	char *p;
+	uint64_t h;
+
+	builtFor = gCpu;
+	mask = TargetMask();
+	// Group the names for the target by their identifier characters.
+	nkeys = 0;
+	nentries = 0;
+	for (nn = 0; nn < NMNEMONICS; nn++) {
+		mp = &mnemonics[nn];
+		entryKey[nn] = -1;
+		if (mp->targets && !(mp->targets & mask))
+			continue;
+		for (len = 0; isIdentChar(mp->name[len]); len++)
+			;
+		for (kk = 0; kk < nkeys; kk++) {
+			if (keyList[kk].len==len && strncmp(keyList[kk].name, mp->name, len)==0)
+				break;
+		}
+		if (kk==nkeys) {
+			memcpy(keyList[kk].name, mp->name, len);
+			keyList[kk].name[len] = '\0';
+			keyList[kk].len = len;
+			keyList[kk].count = 0;
+			nkeys++;
+		}
+		keyList[kk].count++;
+		entryKey[nn] = kk;
+		nentries++;
+	}
+	for (nn = kk = 0; kk < nkeys; kk++) {
+		keyList[kk].first = nn;
+		nn += keyList[kk].count;
+		keyList[kk].count = 0;
+	}
+	for (nn = 0; nn < NMNEMONICS; nn++) {
+		if ((kk = entryKey[nn]) >= 0) {
+			mnemonicList[keyList[kk].first + keyList[kk].count] = nn;
+			keyList[kk].count++;
+		}
+	}
+	if (nkeys==0)
+		return;
+
+	for (nslots = 2, slotShift = 31; nslots < nkeys; nslots <<= 1)
+		slotShift--;
+	for (nbuckets = 1; nbuckets * 4 < nkeys; nbuckets <<= 1)
+		;
+	for (hashSeed = 0; ; hashSeed++) {
+		for (bb = 0; bb < nbuckets; bb++) {
+			head[bb] = -1;
+			size[bb] = 0;
+		}
+		for (kk = 0; kk < nkeys; kk++) {
+			h = HashStart();
+			for (p = keyList[kk].name; *p; p++)
+				h = HashStep(h, *p);
+			hash[kk] = h;
+			bb = (int)(h >> 32) & (nbuckets - 1);
+			next[kk] = head[bb];
+			head[bb] = kk;
+			size[bb]++;
+		}
+		if (PlaceKeys(hash, next, head, size, used))
+			break;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Look for a mnemonic at inptr. If there is one inptr is moved past it and
+// the token is returned, otherwise tk_none is returned.
+// ----------------------------------------------------------------------------
+
+int FindMnemonic()
+{
+	char name[16];
+	int len, nn, n, slot;
+	uint64_t h;
+	MnemonicKey *kp;
+	Mnemonic *mp;
+	char ch;
+
+	if (builtFor != gCpu)
+		BuildMnemonicHash();
+	if (nkeys==0)
+		return (tk_none);
+	h = HashStart();
+	for (len = 0; isalnum(ch = inptr[len]) || ch=='_'; len++) {
+		if (len >= sizeof(name)-1)
+			return (tk_none);
+		name[len] = tolower(ch);
+		h = HashStep(h, name[len]);
+	}
+	slot = slotKey[HashSlot(h, displacement[(int)(h >> 32) & (nbuckets - 1)])];
+	if (slot < 0)
+		return (tk_none);
+	kp = &keyList[slot];
+	if (kp->len != len || memcmp(kp->name, name, len) != 0)
+		return (tk_none);
+	for (nn = kp->first; nn < kp->first + kp->count; nn++) {
+		mp = &mnemonics[mnemonicList[nn]];
+		// Any ':' or '.' the name ends in
+		for (n = len; mp->name[n] && inptr[n]==mp->name[n]; n++)
+			;
+		if (mp->name[n])
+			continue;
+		ch = inptr[n];
+		switch(mp->follow) {
+		case mt_space:		if (!isspace(ch)) continue; break;
+		case mt_spaceOrDot:	if (!isspace(ch) && ch!='.') continue; break;
+		case mt_blankOrDot:	if (!isspaceOrDot(ch)) continue; break;
+		case mt_colon:		if (ch!=':') continue; break;
+		}
+		inptr += n;
+		return (mp->token);
+	}
+	return (tk_none);
+}
@@ -443,8 +443,13 @@ enum {
 
 extern int token;
 extern int isIdentChar(char ch);
+extern int isspaceOrDot(char ch);
 extern void ScanToEOL();
 extern int NextToken();
+extern int FindMnemonic();
+extern void BeginTokenStream();
+extern void EndTokenStream();
+extern void ResetTokenStream();
 extern void SkipSpaces();
 extern void prevToken();
 extern int need(int);
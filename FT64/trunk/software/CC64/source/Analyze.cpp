@@ -34,6 +34,12 @@ static void repcse_compound(Statement *stmt);
 CSE *CSETable;
 short int csendx;
 short int loop_active;
+static int stmtno;			// statement being scanned
+static int loopno;			// outermost loop being scanned
+static int loopbegin;		// first statement of the loop
+static int loopdepth;
+static bool hasJumps;		// goto or try in the function
+static int profileWeight;	// weight of a use from the profile, 0 if none
 
 /*
  *      this module will step through the parse tree and find all
@@ -125,6 +131,100 @@ static ENODE *DuplicateEnode(ENODE *node)
 }
 
 
+// Only the contents of a local variable can be left unloaded until the
+// variable is first used. Everything else, constants, addresses and
+// parameters, is loaded into its register on entry to the function.
+
+static bool IsLocalVar(ENODE *node)
+{
+	if (!IsLValue(node) || node->nodetype==en_struct_ref)
+		return (false);
+	if (node->p[0]->nodetype != en_autocon && node->p[0]->nodetype != en_autofcon)
+		return (false);
+	return (node->p[0]->i < 0);
+}
+
+// Extend the live range of an expression to cover the statement being
+// scanned. A value used in a loop may be carried around it, so the range
+// covers the whole of the outermost loop.
+
+static void ExtendRange(CSE *csp)
+{
+	if (csp->first > stmtno)
+		csp->first = stmtno;
+	if (csp->last < stmtno)
+		csp->last = stmtno;
+	if (loopdepth > 0) {
+		if (csp->first > loopbegin)
+			csp->first = loopbegin;
+		csp->loop = loopno;
+	}
+}
+
+// A use counts for more the more often it's executed. Without a profile
+// uses inside loops are taken to be executed more often.
+
+static int UseWeight()
+{
+	if (profileWeight > 0)
+		return (profileWeight);
+	if (loop_active > 1)
+		return ((loop_active - 1) * 5);
+	return (1);
+}
+
+static void ProfileWeight(Statement *stmt, int part)
+{
+	if (profileWeight > 0 && stmt->exp && stmt->exp->nodetype != en_icon)
+		profileWeight = Profile::Weight(stmt, part);
+}
+
+// Note a statement copying one local variable to another where the
+// destination's live range starts. If the source isn't used after the copy
+// the two can be held in the same register and the move goes away.
+
+static void ScanCopy(ENODE *node)
+{
+	CSE *dst, *src;
+
+	if (node==nullptr || node->nodetype != en_assign)
+		return;
+	if (!IsLocalVar(node->p[0]) || !IsLocalVar(node->p[1]))
+		return;
+	if (node->p[0]->isDouble != node->p[1]->isDouble)
+		return;
+	dst = SearchCSEList(node->p[0]);
+	src = SearchCSEList(node->p[1]);
+	if (dst==nullptr || src==nullptr || dst==src || dst->copy)
+		return;
+	if (dst->first==stmtno) {
+		dst->copy = src->exp;
+		dst->copyAt = stmtno;
+	}
+}
+
+static void BeginLoop()
+{
+	if (loopdepth==0) {
+		loopno++;
+		loopbegin = stmtno;
+	}
+	loopdepth++;
+}
+
+static void EndLoop()
+{
+	int cnt;
+
+	loopdepth--;
+	if (loopdepth > 0)
+		return;
+	for (cnt = 0; cnt < csendx; cnt++) {
+		if (CSETable[cnt].loop==loopno && CSETable[cnt].last < stmtno)
+			CSETable[cnt].last = stmtno;
+	}
+}
+
 // InsertNodeIntoCSEList will enter a reference to an expression node into the
 // common expression table. duse is a flag indicating whether or not
 // this reference will be dereferenced.
@@ -138,30 +238,24 @@ CSE *InsertNodeIntoCSEList(ENODE *node, int duse)
 			throw new C64PException(ERR_CSETABLE,0x01);
 		csp = &CSETable[csendx];
 		csendx++;
-		if (loop_active > 1) {
-			csp->uses = (loop_active - 1) * 5;
-			csp->duses = (duse != 0) * ((loop_active-1) * 5);
-		}
-		else {
-			csp->uses = 1;
-			csp->duses = (duse != 0);
-		}
+		csp->uses = UseWeight();
+		csp->duses = (duse != 0) * UseWeight();
         csp->exp = DuplicateEnode(node);
         csp->voidf = 0;
 		csp->reg = 0;
 		csp->isfp = csp->exp->isDouble;
+		csp->first = IsLocalVar(node) ? stmtno : 0;
+		csp->last = stmtno;
+		csp->loop = 0;
+		csp->copy = nullptr;
+		csp->copyAt = 0;
+		ExtendRange(csp);
         return (csp);
     }
-	if (loop_active < 2) {
-	    (csp->uses)++;
-		if( duse )
-            (csp->duses)++;
-	}
-	else {
-		(csp->uses) += ((loop_active-1) * 5);
-		 if( duse )
-            (csp->duses) += ((loop_active-1) * 5);
-	}
+	csp->uses += UseWeight();
+	if( duse )
+		csp->duses += UseWeight();
+	ExtendRange(csp);
     return (csp);
 }
 
@@ -383,7 +477,7 @@ static void scanexpr(ENODE *node, int duse)
                 scanexpr(node->p[0],1);
                 scanexpr(node->p[1],0);
                 break;
-        default: dfs.printf("Uncoded node in scanexpr():%d\r\n", node->nodetype);
+        default: DTRACE(TRC_CSE).printf("Uncoded node in scanexpr():%d\r\n", node->nodetype);
         }
 }
 
@@ -393,8 +487,11 @@ static void scanexpr(ENODE *node, int duse)
  */
 void scan(Statement *block)
 {
-	loop_active = 1;
+	int ow;
+
 	while( block != NULL ) {
+		ow = profileWeight;
+		stmtno++;
         switch( block->stype ) {
 			case st_compound:
 					scan(block->prolog);
@@ -407,38 +504,50 @@ void scan(Statement *block)
             case st_expr:
                     opt_const(&block->exp);
                     scanexpr(block->exp,0);
+                    ScanCopy(block->exp);
                     break;
             case st_while:
 			case st_until:
             case st_do:
 			case st_dountil:
 					loop_active++;
+					BeginLoop();
                     opt_const(&block->exp);
+					ProfileWeight(block,0);
                     scanexpr(block->exp,0);
                     scan(block->s1);
+					EndLoop();
 					loop_active--;
                     break;
 			case st_doloop:
 			case st_forever:
 					loop_active++;
+					BeginLoop();
                     scan(block->s1);
+					EndLoop();
 					loop_active--;
                     break;
             case st_for:
 					loop_active++;
+					BeginLoop();
                     opt_const(&block->initExpr);
                     scanexpr(block->initExpr,0);
                     opt_const(&block->exp);
+					ProfileWeight(block,0);
                     scanexpr(block->exp,0);
                     scan(block->s1);
                     opt_const(&block->incrExpr);
                     scanexpr(block->incrExpr,0);
+					EndLoop();
 					loop_active--;
                     break;
             case st_if:
                     opt_const(&block->exp);
+					ProfileWeight(block,0);
                     scanexpr(block->exp,0);
+					ProfileWeight(block,1);
                     scan(block->s1);
+					ProfileWeight(block,2);
                     scan(block->s2);
                     break;
             case st_switch:
@@ -455,13 +564,21 @@ void scan(Statement *block)
             //        scan(block->s1);
             //        scan(block->s2);
             //        break;
+			// Jumps that don't follow the structure of the code make the
+			// live ranges unreliable.
+			case st_goto:
+			case st_label:
+			case st_try:
+			case st_catch:
+					hasJumps = true;
+					break;
             // nothing to process for these statement
             case st_break:
             case st_continue:
-            case st_goto:
                     break;
             default:      ;// printf("Uncoded statement in scan():%d\r\n", block->stype);
         }
+		profileWeight = ow;
         block = block->next;
     }
 }
@@ -638,7 +755,7 @@ void repexpr(ENODE *node)
 				case en_fpregvar:
                   break;
                 default:
-                        dfs.printf("Uncoded node in repexr():%d\r\n",node->nodetype);
+                        DTRACE(TRC_CSE).printf("Uncoded node in repexr():%d\r\n",node->nodetype);
                 }
 }
 
@@ -729,33 +846,33 @@ int opt1(Statement *block)
 
 	//csendx = 0;
     nn = 0;
-	if (pass==1) {
-		if (currentFn->csetbl==nullptr) {
-			currentFn->csetbl = new CSE[500];
-			currentFn->csendx = 0;
-		}
-		csendx = 0;
-		CSETable = currentFn->csetbl;
-		ZeroMemory(CSETable,sizeof(CSETable));
-	}
-	else if (pass==2) {
-		CSETable = currentFn->csetbl;
-		csendx = currentFn->csendx;
-	}
+	if (currentFn->csetbl==nullptr)
+		currentFn->csetbl = new CSE[500];
+	csendx = 0;
+	CSETable = currentFn->csetbl;
+	ZeroMemory(CSETable,sizeof(CSETable));
     if (opt_noregs==FALSE) {
-		if (pass==1)
-			scan(block);            /* collect expressions */
+		loop_active = 1;
+		profileWeight = Profile::Measured() ? 1 : 0;
+		stmtno = 0;
+		loopno = 0;
+		loopdepth = 0;
+		hasJumps = false;
+		scan(block);            /* collect expressions */
+		// Without reliable live ranges every expression is taken to be
+		// live throughout the function.
+		if (hasJumps) {
+			for (nn = 0; nn < csendx; nn++) {
+				CSETable[nn].first = 0;
+				CSETable[nn].last = stmtno;
+			}
+			nn = 0;
+		}
         nn = AllocateRegisterVars();
-		if (pass==2)
-    		repcse(block);          /* replace allocated expressions */
+   		repcse(block);          /* replace allocated expressions */
     }
-	if (pass==1)
-		currentFn->csendx = csendx;
-	else if (pass==2) {
-		if (currentFn->csetbl) {
-			delete[] currentFn->csetbl;
-			currentFn->csetbl = nullptr;
-		}
-	}
+	currentFn->csendx = csendx;
+	delete[] currentFn->csetbl;
+	currentFn->csetbl = nullptr;
 	return (nn);
 }
@@ -10,7 +10,7 @@ BasicBlock *BasicBlock::MakeNew()
 {
 	BasicBlock *bb;
 
-	bb = (BasicBlock *)allocx(sizeof(BasicBlock));
+	bb = (BasicBlock *)allocx(sizeof(BasicBlock), MEM_OPT);
 	bb->gen = CSet::MakeNew();
 	bb->kill = CSet::MakeNew();
 	bb->LiveIn = CSet::MakeNew();
@@ -54,7 +54,23 @@ bool IsBasicBlockSeparater(OCODE *ip)
 	return (false);
 }
 
-// Break the program down into basic blocks
+// Start a new block following the block passed, beginning with ip.
+
+static BasicBlock *NextBlock(BasicBlock *pb, OCODE *ip, int num)
+{
+	pb->next = BasicBlock::MakeNew();
+	pb->next->prev = pb;
+	pb->next->code = ip;
+	pb = pb->next;
+	pb->num = num;
+	basicBlocks[num] = pb;
+	return (pb);
+}
+
+// Break the program down into basic blocks. A block ends after a branch,
+// and a label starts a new block because it may be branched to. The leader
+// flags are recomputed so the code may be broken down again after it has
+// been changed.
 
 BasicBlock *BasicBlock::Blockize(OCODE *start)
 {
@@ -68,22 +84,20 @@ BasicBlock *BasicBlock::Blockize(OCODE *start)
 	bbs->num = num;
 	pb = bbs;
 	basicBlocks[0] = RootBlock;
-	start->leader = true;
 	for (ip = start; ip; ip = ip2) {
+		ip2 = ip->fwd;
+		if (ip->opcode==op_label && ip != pb->code) {
+			pb->lcode = ip->back;
+			num++;
+			pb = NextBlock(pb, ip, num);
+		}
+		ip->leader = ip==pb->code;
 		ip->bb = pb;
 		pb->depth = ip->loop_depth;
-		ip2 = ip->fwd;
 		if (IsBasicBlockSeparater(ip)) {
 			pb->lcode = ip;
-			if (ip->fwd)
-				ip->fwd->leader = true;
 			num++;
-			pb->next = BasicBlock::MakeNew();
-			pb->next->prev = pb;
-			pb->next->code = ip2;
-			pb = pb->next;
-			pb->num = num;
-			basicBlocks[num] = pb;
+			pb = NextBlock(pb, ip2, num);
 		}
 	}
 	nBasicBlocks = num;
@@ -92,8 +106,8 @@ BasicBlock *BasicBlock::Blockize(OCODE *start)
 		LastBlock = RootBlock;
 	// ASSERT(LastBlock!=nullptr);
 	pb->next = nullptr;
-	dfs.printf("%s: ", (char *)currentFn->name->c_str());
-	dfs.printf("%d basic blocks\n", num);
+	DTRACE(TRC_REGALLOC).printf("%s: ", (char *)currentFn->name->c_str());
+	DTRACE(TRC_REGALLOC).printf("%d basic blocks\n", num);
 	return (bbs);
 }
 
@@ -107,7 +121,7 @@ Edge *BasicBlock::MakeOutputEdge(BasicBlock *dst)
 		if (p->dst==dst)
 			return (nullptr);
 	}
-	edge = (Edge *)allocx(sizeof(Edge));
+	edge = (Edge *)allocx(sizeof(Edge), MEM_OPT);
 	edge->src = this;
 	edge->dst = dst;
 	edge->backedge = dst->num < num;
@@ -131,7 +145,7 @@ Edge *BasicBlock::MakeInputEdge(BasicBlock *src)
 	for (p = ihead; p; p = p->next)
 		if (p->src==src)
 			return (nullptr);
-	edge = (Edge *)allocx(sizeof(Edge));
+	edge = (Edge *)allocx(sizeof(Edge), MEM_OPT);
 	edge->src = src;
 	edge->dst = this;
 	edge->backedge = src->num > num;
@@ -155,7 +169,7 @@ Edge *BasicBlock::MakeDomEdge(BasicBlock *dst)
 	for (p = dhead; p; p = p->next)
 		if (p->dst==dst)
 			return (nullptr);
-	edge = (Edge *)allocx(sizeof(Edge));
+	edge = (Edge *)allocx(sizeof(Edge), MEM_OPT);
 	edge->src = this;
 	edge->dst = dst;
 	if (dtail) {
@@ -169,194 +183,129 @@ Edge *BasicBlock::MakeDomEdge(BasicBlock *dst)
 	return (edge);
 }
 
-CSet *BasicBlock::livo;
+static int LiveRegno(int regno)
+{
+	if ((regno & 0xFFF) >= 0x800)
+		return ((regno & 0xfff)-0x780);
+	return (regno);
+}
+
+// A register read by an instruction is only used before being defined if
+// it hasn't already been defined earlier in the block.
+
+static void AddUse(CSet *gen, CSet *kill, int regno)
+{
+	regno = LiveRegno(regno);
+	if (!kill->isMember(regno))
+		gen->add(regno);
+}
+
+static void AddDef(CSet *gen, CSet *kill, int tr)
+{
+	kill->add(LiveRegno(tr));
+	if (tr >= 18 && tr <= 24)
+		gen->add(tr);
+}
+
+// Compute the registers used before being defined (gen) and the registers
+// defined (kill) in the block. These don't change while the live variables
+// are being solved for so they are only computed once. The registers read
+// by an instruction are looked at before the ones it defines.
 
-void BasicBlock::ComputeLiveVars()
+void BasicBlock::ComputeGenKill()
 {
 	OCODE *ip;
-	Edge *ep;
 	int tr;
-	static CSet OldLiveIn, OldLiveOut;
-//	char buf [4000];
 
-	if (livo==nullptr)
-		livo = CSet::MakeNew();
-	livo->clear();
-	changed = false;
 	gen->clear();
 	kill->clear();
 	for (ip = code; ip && (!ip->leader || ip == code); ip = ip->fwd) {
 		if (ip->remove || ip->remove2)
 			continue;
-		if (ip->opcode!=op_label) {
-			if (ip->HasTargetReg()) {
-				tr = ip->GetTargetReg() & 0xffff;
-				if ((tr & 0xFFF) >= 0x800) {
-					kill->add((tr & 0xfff)-0x780);
-				}
-				else {
-					kill->add(tr);
-				}
-				if (tr >= 18 && tr <= 24)
-					gen->add(tr);
-				// There could be a second target
-				tr = (ip->GetTargetReg() >> 16) & 0xffff;
-				if (tr) {
-					if ((tr & 0xFFF) >= 0x800) {
-						kill->add((tr & 0xfff)-0x780);
-					}
-					else {
-						kill->add(tr);
-					}
-					if (tr >= 18 && tr <= 24)
-						gen->add(tr);
-				}
-			}
-			// If there was an explicit target it would have been oper1
-			// there was an else here
-			else 
-			//if (ip->oper1 && ip->oper1->mode == am_reg) {
-			if (ip->oper1) {
-				if ((ip->oper1->preg & 0xfff) >= 0x800) {
-					gen->add((ip->oper1->preg & 0xfff)-0x780);
-				}
-				else {
-					gen->add(ip->oper1->preg);
-				}
-			}
-			// Stack operations implicitly read SP. It doesn't appear in the operx operands.
-			if (ip->opcode==op_push || ip->opcode==op_pop || ip->opcode==op_link || ip->opcode==op_unlk) {
-				gen->add(regSP);
-			}
-			if (ip->oper2) {
-//				if (ip->oper2->mode == am_reg) {
-					if ((ip->oper2->preg & 0xfff) >= 0x800) {
-						gen->add((ip->oper2->preg & 0xfff)-0x780);
-					}
-					else {
-						gen->add(ip->oper2->preg);
-					}
-					if (ip->oper2->mode == am_indx2) {
-						gen->add(ip->oper2->sreg);
-					}
-//				}
-			}
-			if (ip->oper3) {
-//				if (ip->oper3->mode == am_reg) {
-					if ((ip->oper3->preg & 0xfff) >= 0x800) {
-						gen->add((ip->oper3->preg & 0xfff)-0x780);
-					}
-					else {
-						gen->add(ip->oper3->preg);
-					}
-//				}
-			}
-			if (ip->oper4) {
-//				if (ip->oper4->mode == am_reg) {
-					if ((ip->oper4->preg & 0xfff) >= 0x800) {
-						gen->add((ip->oper4->preg & 0xfff)-0x780);
-					}
-					else {
-						gen->add(ip->oper4->preg);
-					}
-//				}
-			}
+		if (ip->opcode==op_label)
+			continue;
+		// If there was an explicit target it would have been oper1
+		if (!ip->HasTargetReg() && ip->oper1)
+			AddUse(gen, kill, ip->oper1->preg);
+		// Stack operations implicitly read SP. It doesn't appear in the operx operands.
+		if (ip->opcode==op_push || ip->opcode==op_pop || ip->opcode==op_link || ip->opcode==op_unlk)
+			AddUse(gen, kill, regSP);
+		if (ip->oper2) {
+			AddUse(gen, kill, ip->oper2->preg);
+			if (ip->oper2->mode == am_indx2)
+				AddUse(gen, kill, ip->oper2->sreg);
 		}
-	}
-	OldLiveIn.clear();
-	OldLiveOut.clear();
-	OldLiveIn.copy(*LiveIn);
-	OldLiveOut.copy(*LiveOut);
-	LiveIn->copy(*LiveOut);
-	LiveIn->remove(*kill);
-	LiveIn->add(gen);
-	//gen->resetPtr();
-	//kill->resetPtr();
-	//dfs.printf("%d: ", num);
-	//for (nn = 0; nn < gen->NumMember(); nn++)
-	//	dfs.printf("g%d ", gen->nextMember());
-	//dfs.printf(" || ");
-	//for (nn = 0; nn < kill->NumMember(); nn++)
-	//	dfs.printf("k%d ", kill->nextMember());
-	//dfs.printf("\n");
-	//dfs.printf("Edges to: ");
-	if (ohead==nullptr)
-		LiveOut->copy(*LiveIn);
-	else
-		AddLiveOut(this);
-	/*
-	for (ep = ohead; ep; ep = ep->next) {
-		if (ep->dst) {
-			//dfs.printf("%d ", ep->dst->num);
-			LiveOut->add(ep->dst->LiveIn);
-			//LiveOut->sprint(buf,sizeof(buf));
-			//dfs.printf("LiveOut: %s", buf);
+		if (ip->oper3)
+			AddUse(gen, kill, ip->oper3->preg);
+		if (ip->oper4)
+			AddUse(gen, kill, ip->oper4->preg);
+		if (ip->HasTargetReg()) {
+			tr = ip->GetTargetReg();
+			AddDef(gen, kill, tr & 0xffff);
+			// There could be a second target
+			if ((tr >> 16) & 0xffff)
+				AddDef(gen, kill, (tr >> 16) & 0xffff);
 		}
 	}
-	*/
-//	dfs.printf("\n");
-	if (OldLiveIn != *LiveIn)
-		changed = true;
-	if (OldLiveOut != *LiveOut)
-		changed = true;
 }
 
-void BasicBlock::AddLiveOut(BasicBlock *ip)
+// Update the live variables of the block from the LiveIn sets of its
+// successors. Returns true if LiveIn changed, which means the predecessors
+// have to be looked at again.
+
+bool BasicBlock::ComputeLiveVars()
 {
 	Edge *ep;
 
+	changed = false;
 	for (ep = ohead; ep; ep = ep->next) {
-		if (!livo->isMember(ep->dst->num)) {
-			livo->add(ep->dst->num);
-			if (ep->dst) {
-				AddLiveOut(ep->dst);
-			//dfs.printf("%d ", ep->dst->num);
-				LiveOut->add(ep->dst->LiveIn);
-			//LiveOut->sprint(buf,sizeof(buf));
-			//dfs.printf("LiveOut: %s", buf);
-			}
+		if (LiveOut->add(ep->dst->LiveIn))
+			changed = true;
+	}
+	// LiveIn = gen + (LiveOut - kill)
+	if (!LiveIn->unionDiff(*gen, *LiveOut, *kill))
+		return (false);
+	// An exit block's LiveOut follows its own LiveIn.
+	if (ohead==nullptr) {
+		while (*LiveOut != *LiveIn) {
+			LiveOut->copy(*LiveIn);
+			LiveIn->unionDiff(*gen, *LiveOut, *kill);
 		}
 	}
+	changed = true;
+	return (true);
 }
 
 bool BasicBlock::IsIdom(BasicBlock *b)
 {
-	Edge *e;
+	return (b->idom==this);
+}
 
-	for (e = dhead; e; e = e->next) {
-		if (e->dst==b)
-			return (true);
-	}
-	return (false);
+static bool LiveTransfer(BasicBlock *b)
+{
+	return (b->ComputeLiveVars());
 }
 
 void ComputeLiveVars()
 {
 	BasicBlock *b;
-	bool changed;
-	int iter;
-	int changes;
 
-	changed = false;
-	for (iter = 0; (iter==0 || changed) && iter < 10000; iter++) {
-		changes = 0;
-		changed = false;
-		for (b = LastBlock; b; b = b->prev) {
-			b->ComputeLiveVars();
-			if (b->changed) {
-				changes++;
-				changed = true;
-			}
-		}
+	for (b = RootBlock; b; b = b->next) {
+		b->ComputeGenKill();
+		if (b==LastBlock)
+			break;
 	}
+	CFG::IterateDataflow(true, LiveTransfer);
 }
 
 void DumpLiveVars()
 {
 	BasicBlock *b;
-	int nn;
+	int nn, m;
 	int lomax, limax;
 
+	if (!DTRACE_ON(TRC_REGALLOC))
+		return;
 	lomax = limax = 0;
 	for (b = RootBlock; b; b = b->next) {
 		lomax = max(lomax,b->LiveOut->NumMember());
@@ -366,16 +315,16 @@ void DumpLiveVars()
 	dfs.printf("<table style=\"width:100%\">\n");
 	//dfs.printf("<LiveVarTable>\n");
 	for (b = RootBlock; b; b = b->next) {
-		b->LiveIn->resetPtr();
-		b->LiveOut->resetPtr();
 		dfs.printf("<tr><td>%d: </td>", b->num);
-		for (nn = 0; nn < b->LiveIn->NumMember(); nn++)
-			dfs.printf("<td>vi%d </td>", b->LiveIn->nextMember());
+		nn = 0;
+		for (m = b->LiveIn->firstMember(); m >= 0; m = b->LiveIn->nextMember(m), nn++)
+			dfs.printf("<td>vi%d </td>", m);
 		for (; nn < limax; nn++)
 			dfs.printf("<td></td>");
 		dfs.printf("<td> || </td>");
-		for (nn = 0; nn < b->LiveOut->NumMember(); nn++)
-			dfs.printf("<td>vo%d </td>", b->LiveOut->nextMember());
+		nn = 0;
+		for (m = b->LiveOut->firstMember(); m >= 0; m = b->LiveOut->nextMember(m), nn++)
+			dfs.printf("<td>vo%d </td>", m);
 		for (; nn < lomax; nn++)
 			dfs.printf("<td></td>");
 		dfs.printf("</tr>\n");
@@ -389,16 +338,16 @@ void DumpLiveRegs()
 	int regno;
 	BasicBlock *b;
 
-	dfs.printf("<LiveRegisters>\n");
+	DTRACE(TRC_REGALLOC).printf("<LiveRegisters>\n");
 	for (regno = 1; regno < 32; regno++) {
-		dfs.printf("Reg:%d ", regno);
+		DTRACE(TRC_REGALLOC).printf("Reg:%d ", regno);
 		for (b = RootBlock; b; b = b->next) {
 			if (/*b->LiveOut->isMember(regno) || */b->LiveIn->isMember(regno))
-				dfs.printf("%d ", b->num);
+				DTRACE(TRC_REGALLOC).printf("%d ", b->num);
 		}
-		dfs.printf("\n");
+		DTRACE(TRC_REGALLOC).printf("\n");
 	}
-	dfs.printf("</LiveRegisters>\n");
+	DTRACE(TRC_REGALLOC).printf("</LiveRegisters>\n");
 }
 
 
@@ -38,6 +38,7 @@ void CFG::Create()
 	OCODE *ip, *ip1;
 	int nn;
 	struct scase *cs;
+	struct clit *ct;
 
 	for (ip = peep_head; ip; ip = ip->fwd) {
 		if (ip->leader) {
@@ -92,8 +93,12 @@ void CFG::Create()
 		case op_jal:
 			// Was it a switch statement ?
 			if (ip->oper3) {
-				for (nn = 1; nn < ((struct scase *)(ip->oper3))->label; nn++) {
-					cs = &((struct scase *)(ip->oper3))[1];
+				for (ct = casetab; ct; ct = ct->next) {
+					if (ct->label == ip->oper3->offset->i)
+						break;
+				}
+				for (nn = 0; ct && nn < ct->num; nn++) {
+					cs = &ct->cases[nn];
 					ip1 = FindLabel(cs->label);
 					if (ip1) {
 						ip->bb->MakeOutputEdge(ip1->bb);
@@ -118,92 +123,149 @@ void CFG::Create()
 	}
 }
 
-static CSet *visited;
-static CSet *paths[1000];
-static int npaths;
+static BasicBlock *order[10000];	// blocks in reverse postorder
+static int nOrder;
+static int nReached;	// number of blocks reachable from the root
 
-// Walk down the path beginning at block b.
+// Order the blocks in reverse postorder of a depth first walk of the CFG
+// from the root block. Blocks that can't be reached from the root follow in
+// program order. Only the blocks up to LastBlock are ordered, the same ones
+// that the rest of the analysis looks at.
 
-static void DownPath(BasicBlock *b)
+void CFG::ComputeOrder()
 {
+	static BasicBlock *stk[10000];
+	static Edge *estk[10000];
+	BasicBlock *b;
 	Edge *e;
-	int path;
-	bool first;
+	int sp, n, post;
 
-	if (visited->isMember(b->num))
-		return;
-	path = npaths-1;
-	paths[path]->add(b->num);
-	visited->add(b->num);
-	first = true;
-	for (e = b->ohead; e; e = e->next) {
-		if (!first) {
-			paths[npaths] = CSet::MakeNew();
-			paths[npaths]->add(paths[path]);
-			npaths++;
+	for (b = RootBlock; b; b = b->next)
+		b->order = -1;
+	nOrder = LastBlock->num + 1;
+	post = nOrder;
+	sp = 0;
+	stk[0] = RootBlock;
+	estk[0] = RootBlock->ohead;
+	RootBlock->order = -2;
+	while (sp >= 0) {
+		b = stk[sp];
+		e = estk[sp];
+		if (e) {
+			estk[sp] = e->next;
+			if (e->dst->order==-1 && e->dst->num <= LastBlock->num) {
+				e->dst->order = -2;
+				sp++;
+				stk[sp] = e->dst;
+				estk[sp] = e->dst->ohead;
+			}
 		}
-//		if (!e->backedge) {
-			first = false;
-			DownPath(e->dst);
-//		}
+		else {
+			order[--post] = b;
+			sp--;
+		}
+	}
+	nReached = nOrder - post;
+	if (post > 0)
+		memmove(&order[0], &order[post], nReached * sizeof(BasicBlock *));
+	n = nReached;
+	for (b = RootBlock; b; b = b->next) {
+		if (b->order==-1)
+			order[n++] = b;
+		if (b==LastBlock)
+			break;
 	}
+	for (n = 0; n < nOrder; n++)
+		order[n]->order = n;
 }
 
-// Discover all the paths in the CFG.
+// Iterative dataflow. Blocks are taken from a work list in reverse
+// postorder, or postorder for a backward problem, and a block is only looked
+// at again when the transfer function of one of its predecessors (successors
+// for a backward problem) reports that its output changed.
 
-static void DiscoverPaths()
+void CFG::IterateDataflow(bool backward, bool (*transfer)(BasicBlock *))
 {
-	BasicBlock *b;
+	BasicBlock *b, *d;
+	CSet *w;
+	Edge *e;
 	int n;
-	char buf[2000];
 
-	b = RootBlock;
-	visited = CSet::MakeNew();
-	paths[0] = CSet::MakeNew();
-	paths[0]->add(b->num);
-	npaths = 1;
-	DownPath(b);
-	dfs.printf("<Paths>\n");
-	for (n = 0; n < npaths; n++) {
-		paths[n]->sprint(buf, sizeof(buf));
-		dfs.printf("%d: ", n);
-		dfs.printf("%s\n", buf);
+	ComputeOrder();
+	w = CSet::MakeNew();
+	for (n = 0; n < nOrder; n++)
+		w->add(n);
+	n = -1;
+	while (!w->isEmpty()) {
+		n = w->nextMember(n);
+		if (n < 0)
+			n = w->firstMember();
+		w->remove(n);
+		b = backward ? order[nOrder - 1 - n] : order[n];
+		if (!(*transfer)(b))
+			continue;
+		for (e = backward ? b->ihead : b->ohead; e; e = e->next) {
+			d = backward ? e->src : e->dst;
+			if (d->order >= 0)
+				w->add(backward ? nOrder - 1 - d->order : d->order);
+		}
 	}
-	dfs.printf("</Paths>\n");
 }
 
+static BasicBlock *Intersect(BasicBlock *b1, BasicBlock *b2)
+{
+	while (b1 != b2) {
+		while (b1->order > b2->order)
+			b1 = b1->idom;
+		while (b2->order > b1->order)
+			b2 = b2->idom;
+	}
+	return (b1);
+}
+
+// Find the immediate dominators using the algorithm of Cooper, Harvey and
+// Kennedy, "A Simple, Fast Dominance Algorithm". A block that can't be
+// reached from the root is hung off the block before it so that it is still
+// visited when walking the dominator tree.
 
 void CFG::CalcDominatorTree()
 {
-	int n, m, o, ps;
-	CSet *pathSet;
-	bool oInAllPaths;
+	BasicBlock *b, *nd;
+	Edge *e;
+	bool changed;
+	int n;
 
-	DiscoverPaths();
-	pathSet = CSet::MakeNew();
-	for (n = LastBlock->num; n >= 1; n--) {
-		pathSet->clear();
-		// Get all paths that contain n
-		for (m = 0; m < npaths; m++)
-			if (paths[m]->isMember(n))
-				pathSet->add(m);
-		// If o is in all paths to n, then o dominates over n. Note there could
-		// be several o's that dominate over n. We only want the last one to do
-		// so. So we start the search at n-1 and work backwards.
-		for (o = n - 1; o >= 0; o--) {
-			oInAllPaths = true;
-			pathSet->resetPtr();
-			for (ps = pathSet->nextMember(); ps >= 0; ps=pathSet->nextMember()) {
-				if (!paths[ps]->isMember(o)) {
-					oInAllPaths = false;
-					break;
-				}
+	ComputeOrder();
+	for (n = 0; n < nOrder; n++)
+		order[n]->idom = nullptr;
+	RootBlock->idom = RootBlock;
+	do {
+		changed = false;
+		for (n = 1; n < nReached; n++) {
+			b = order[n];
+			nd = nullptr;
+			for (e = b->ihead; e; e = e->next) {
+				if (e->src->order < 0 || e->src->idom==nullptr)
+					continue;
+				nd = nd ? Intersect(e->src, nd) : e->src;
+			}
+			if (b->idom != nd) {
+				b->idom = nd;
+				changed = true;
 			}
-			if (oInAllPaths)
-				break;
 		}
-		basicBlocks[o]->MakeDomEdge(basicBlocks[n]);
-	}
+	} while (changed);
+	RootBlock->idom = nullptr;
+	for (n = nReached; n < nOrder; n++)
+		order[n]->idom = basicBlocks[order[n]->num - 1];
+	for (n = LastBlock->num; n >= 1; n--)
+		basicBlocks[n]->idom->MakeDomEdge(basicBlocks[n]);
+	if (!DTRACE_ON(TRC_REGALLOC))
+		return;
+	dfs.printf("<Dominators>\n");
+	for (n = 1; n <= LastBlock->num; n++)
+		dfs.printf("%d: %d\n", n, basicBlocks[n]->idom->num);
+	dfs.printf("</Dominators>\n");
 }
 
 void CFG::CalcDominanceFrontiers()
@@ -211,27 +273,26 @@ void CFG::CalcDominanceFrontiers()
 	BasicBlock *x;
 	Edge *e;
 	Edge *z;
-	int y;
+	int n, y;
 
 	CalcDominatorTree();
-	for (x = LastBlock; x; x = x->prev) {
-		x->DF = nullptr;
-		if (x->dhead) {
-			x->DF = CSet::MakeNew();
-			// Check the successors of X
-			for (e = x->ohead; e; e = e->next) {
-				if (!x->IsIdom(e->dst)) {
-					x->DF->add(e->dst->num);
-				}
+	// The children of X have to be done before X.
+	for (n = nOrder - 1; n >= 0; n--) {
+		x = order[n];
+		x->DF = CSet::MakeNew();
+		// Check the successors of X. A block without children in the
+		// dominator tree still has a frontier where the paths from it join.
+		for (e = x->ohead; e; e = e->next) {
+			if (!x->IsIdom(e->dst)) {
+				x->DF->add(e->dst->num);
 			}
-			// Check the children of X
-			for (z = x->dhead; z; z = z->next) {
-				if (z->dst->DF) {
-					z->dst->DF->resetPtr();
-					for (y = z->dst->DF->nextMember(); y >= 0; y = z->dst->DF->nextMember()) {
-						if (!x->IsIdom(basicBlocks[y]))
-							x->DF->add(y);
-					}
+		}
+		// Check the children of X
+		for (z = x->dhead; z; z = z->next) {
+			if (z->dst->DF) {
+				for (y = z->dst->DF->firstMember(); y >= 0; y = z->dst->DF->nextMember(y)) {
+					if (!x->IsIdom(basicBlocks[y]))
+						x->DF->add(y);
 				}
 			}
 		}
@@ -259,29 +320,27 @@ void CFG::InsertPhiInsns()
 		if (v->num==0)
 			continue;
 		IterCount++;
-		v->forest->resetPtr();
-		for (n = v->forest->nextMember(); n >= 0; n = v->forest->nextMember()) {
+		for (n = v->forest->firstMember(); n >= 0; n = v->forest->nextMember(n)) {
 			x = basicBlocks[n];
 			x->Work = IterCount;
 			w->add(x->num);
 		}
-		w->resetPtr();
-		while (w->NumMember() > 0) {
-			n = w->nextMember();
+		// Blocks are taken from the work list in a circular order.
+		n = -1;
+		while (!w->isEmpty()) {
+			n = w->nextMember(n);
 			if (n < 0) {
-				w->resetPtr();
-				n = w->nextMember();
+				n = w->firstMember();
 				if (n < 0)
 					break;
 			}
 			w->remove(n);
 			x = basicBlocks[n];
 			if (x->DF) {
-				x->DF->resetPtr();
-				for (y = x->DF->nextMember(); y >= 0; y = x->DF->nextMember()) {
+				for (y = x->DF->firstMember(); y >= 0; y = x->DF->nextMember(y)) {
 					if (basicBlocks[y]->HasAlready < IterCount) {
 						// Place phi node at Y
-						phiNode = (OCODE *)allocx(sizeof(OCODE));
+						phiNode = OCODE::MakeNew();
 						phiNode->insn = GetInsn(op_phi);
 						phiNode->opcode = op_phi;
 						phiNode->oper1 = makereg(v->num);
@@ -376,16 +435,21 @@ void CFG::Search(BasicBlock *x)
 	}
 	for (e = x->ohead; e; e = e->next) {
 		y = e->dst->num;
-		j = WhichPred(x,y);
-		if (j < 0 || j > 99) {	// Internal compiler error
-			printf("DIAG: CFG Rename j=%d out of range.\n", j);
-			fatal("");
-			continue;
-		}
+		j = -1;
 		b = basicBlocks[y];
 		eol = false;
 		for (s = b->code; s && !eol; s = s->fwd) {
 			if (s->opcode==op_phi) {
+				// A block may have more predecessors than a phi node has
+				// operands; that only matters when there is a phi node.
+				if (j < 0) {
+					j = WhichPred(x,y);
+					if (j < 0 || j > 99) {	// Internal compiler error
+						printf("DIAG: CFG Rename j=%d out of range.\n", j);
+						fatal("");
+						break;
+					}
+				}
 				v = Var::Find2(s->oper1->preg);
 				if (v)
 					s->phiops[j] = v->istk->tos();
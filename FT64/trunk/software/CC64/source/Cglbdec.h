@@ -82,6 +82,7 @@ extern int regFirstParm;
 extern int regLastParm;
 extern int farcode;
 extern int wcharSupport;
+extern int extfpp;
 extern int verbose;
 extern int use_gp;
 extern int address_bits;
@@ -201,7 +202,7 @@ extern void closefiles();
 extern void error(int n);
 extern void needpunc(enum e_sym p,int);
 // Memmgt.c
-extern void *allocx(int);
+extern void *allocx(int, int);
 extern char *xalloc(int);
 extern SYM *allocSYM();
 extern TYP *allocTYP();
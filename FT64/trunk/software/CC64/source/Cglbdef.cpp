@@ -61,6 +61,11 @@ int regFirstParm = 18;
 int regLastParm = 24;
 int farcode = 0;
 int wcharSupport = 1;
+#ifdef FPP_LIB
+int extfpp = 0;			// run fpp as a separate process
+#else
+int extfpp = 1;			// fpp isn't built in
+#endif
 int verbose = 0;
 int use_gp = 0;
 int address_bits = 32;
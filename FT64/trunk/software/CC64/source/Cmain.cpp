@@ -24,6 +24,9 @@
 // ============================================================================
 //
 #include "stdafx.h"
+#include <thread>
+#include <atomic>
+#include <vector>
 /*
  *	68000 C compiler
  *
@@ -62,9 +65,96 @@ int uctran_off;
 extern int lstackptr;
 
 Compiler compiler;
+static int njobs = 0;
+static bool traceSelected = false;	// a -d option picked trace categories
+
+// Compiling several files at once (-jN) is done by running the compiler
+// separately for each file, since its state is global. Each run's console
+// output is saved to a file and shown in command line order at the end.
+// With -j1 the files are compiled one at a time, still each in a fresh run.
+
+static std::string Quoted(const char *s)
+{
+	return (std::string("\"") + s + "\"");
+}
+
+static void CompileJobs(std::vector<std::string> *cmds, std::vector<int> *status, std::atomic<int> *next)
+{
+	int n;
+
+	while ((n = (*next)++) < (int)cmds->size())
+		(*status)[n] = system((*cmds)[n].c_str());
+}
+
+// Returns the number of files that failed to compile.
+
+static int RunJobs(int argc, char **argv)
+{
+	std::vector<std::string> cmds;
+	std::vector<std::string> logs;
+	std::vector<std::string> files;
+	std::vector<std::thread> workers;
+	std::vector<int> status;
+	std::atomic<int> next(0);
+	std::string opts, cmd;
+	FILE *fp;
+	char buf[4096];
+	size_t n;
+	int nn, nfailed;
+
+	// Options apply to the files that follow them, as they do when the
+	// files are compiled one after another.
+	for (nn = 1; nn < argc; nn++) {
+		if (argv[nn][0]=='-') {
+			if (argv[nn][1]!='j')
+				opts += " " + Quoted(argv[nn]);
+		}
+		else {
+			files.push_back(argv[nn]);
+			logs.push_back(std::string(argv[nn]) + ".jlog");
+			cmd = Quoted(argv[0]) + opts + " " + Quoted(argv[nn]) + " >" + Quoted(logs.back().c_str()) + " 2>&1";
+#ifdef _MSC_VER
+			// cmd.exe takes the first and last quote off the command.
+			cmd = "\"" + cmd + "\"";
+#endif
+			cmds.push_back(cmd);
+		}
+	}
+	status.resize(cmds.size(), -1);
+	for (nn = 0; nn < njobs && nn < (int)cmds.size(); nn++)
+		workers.push_back(std::thread(CompileJobs, &cmds, &status, &next));
+	for (nn = 0; nn < (int)workers.size(); nn++)
+		workers[nn].join();
+	nfailed = 0;
+	for (nn = 0; nn < (int)logs.size(); nn++) {
+		if ((fp = fopen(logs[nn].c_str(), "rb")) != nullptr) {
+			while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+				fwrite(buf, 1, n, stdout);
+			fclose(fp);
+		}
+		remove(logs[nn].c_str());
+		if (status[nn] != 0) {
+			printf("\n -- %s failed to compile.\n", files[nn].c_str());
+			nfailed++;
+		}
+	}
+	return (nfailed);
+}
+
+// The exit status is nonzero if any file couldn't be compiled or had
+// errors.
 
 int main(int argc, char **argv)
 {
+	int nn;
+	int failed = 0;
+
+	for (nn = 1; nn < argc; nn++) {
+		if (argv[nn][0]=='-' && argv[nn][1]=='j')
+			njobs = atoi(&argv[nn][2]);
+	}
+	if (njobs > 0)
+		exit(RunJobs(argc, argv) ? 1 : 0);
 	opt_nopeep = FALSE;
 	uctran_off = 0;
 	optimize =1;
@@ -79,32 +169,38 @@ int main(int argc, char **argv)
     if( **++argv == '-')
       options(*argv);
 		else {
-			if (PreProcessFile(*argv) == -1)
+			if (PreProcessFile(*argv) == -1) {
+				failed = 1;
 				break;
+			}
 			if( openfiles(*argv)) {
 				lineno = 0;
 				initsym();
 	compiler.compile();
 //				compile();
 				summary();
-				MBlk::ReleaseAll();
-//				ReleaseGlobalMemory();
+				if (total_errors > 0)
+					failed = 1;
+				ReleaseGlobalMemory();
 				closefiles();
 			}
+			else
+				failed = 1;
     }
     dfs.printf("<CmdNext>Next on command line (%d).</CmdNext>\n", argc);
   }
 	//getchar();
 	dfs.printf("<Exit></Exit>\n");
 	dfs.close();
- 	exit(0);
-	return (0);
+ 	exit(failed);
+	return (failed);
 }
 
 int	options(char *s)
 {
     int nn;
 
+	Pch::AddOption(s);
 	if (s[1]=='o') {
         for (nn = 2; s[nn]; nn++) {
             switch(s[nn]) {
@@ -112,6 +208,11 @@ int	options(char *s)
 			case 'p':     ::opt_nopeep = TRUE; break;
             case 'x':     opt_noexpr = TRUE; break;
 			case 'c':	  opt_nocgo = TRUE; break;
+			case 'i':	  opt_noinline = TRUE; break;
+			case 'l':	  opt_noloop = TRUE; break;
+			case 'v':	  opt_novector = TRUE; break;
+			case 'g':	  opt_nossa = TRUE; break;
+			case 'h':	  opt_nosched = TRUE; break;
             }
         }
         if (nn==2) {
@@ -119,6 +220,11 @@ int	options(char *s)
             ::opt_nopeep = TRUE;
             opt_noexpr = TRUE;
 			opt_nocgo = TRUE;
+			opt_noinline = TRUE;
+			opt_noloop = TRUE;
+			opt_novector = TRUE;
+			opt_nossa = TRUE;
+			opt_nosched = TRUE;
             optimize = FALSE;
         }
     }
@@ -127,6 +233,14 @@ int	options(char *s)
 			exceptions = 0;
 		if (strcmp(&s[2],"farcode")==0)
 			farcode = 1;
+		if (strcmp(&s[2],"external-fpp")==0)
+			extfpp = 1;
+		if (strncmp(&s[2],"pch=",4)==0)
+			Pch::SetHeader(&s[6]);
+		if (strcmp(&s[2],"profile-generate")==0)
+			Profile::SetGenerate();
+		if (strncmp(&s[2],"profile-use=",12)==0)
+			Profile::SetUse(&s[14]);
 	}
 	else if (s[1]=='a') {
         address_bits = atoi(&s[2]);
@@ -153,14 +267,51 @@ int	options(char *s)
     }
     else if (s[1]=='S')
         mixedSource = TRUE;
+	// Trace categories written to the debug file: s=symbols, p=parser,
+	// c=CSE, r=register allocation, o=peephole, i=inlining, l=loops,
+	// v=vectorizer, g=global optimizations, h=scheduler. Everything is
+	// traced unless categories are picked.
+	else if (s[1]=='d') {
+		if (!traceSelected)
+			dfs.mask = 0;
+		traceSelected = true;
+		if (s[2]=='\0')
+			dfs.mask = TRC_ALL;
+		for (nn = 2; s[nn]; nn++) {
+			switch(s[nn]) {
+			case 's':	dfs.mask |= TRC_SYM; break;
+			case 'p':	dfs.mask |= TRC_PARSE; break;
+			case 'c':	dfs.mask |= TRC_CSE; break;
+			case 'r':	dfs.mask |= TRC_REGALLOC; break;
+			case 'o':	dfs.mask |= TRC_PEEP; break;
+			case 'i':	dfs.mask |= TRC_INLINE; break;
+			case 'l':	dfs.mask |= TRC_LOOP; break;
+			case 'v':	dfs.mask |= TRC_VECTOR; break;
+			case 'g':	dfs.mask |= TRC_SSA; break;
+			case 'h':	dfs.mask |= TRC_SCHED; break;
+			}
+		}
+	}
 	return 0;
 }
 
+#ifndef FPP_LIB
+// Without fpp built in it always runs as a separate process, these are
+// never called.
+int fppOpen(char *nm) { return (1); }
+int fppGetLine(char *buf, int len) { return (0); }
+void fppClose(void) { }
+void fppMarkInclude(char *nm) { }
+#endif
+
 int PreProcessFile(char *nm)
 {
 	static char outname[1000];
 	static char sysbuf[500];
 
+	// The built in preprocessor passes its output straight to getline().
+	if (!extfpp)
+		return (fppOpen(nm) ? -1 : 0);
 	strcpy_s(outname, sizeof(outname), nm);
 	makename(outname,".fpp");
 	snprintf(sysbuf, sizeof(sysbuf), "fpp -b %s %s", nm, outname);
@@ -186,7 +337,8 @@ int openfiles(char *s)
         makename(outfile,".s");
     dbgfile += ".xml";
 		ifs = new std::ifstream();
-		ifs->open(infile,std::ios::in);
+		if (extfpp)
+			ifs->open(infile,std::ios::in);
 /*
         if( (input = fopen(infile,"r")) == 0) {
 				i = errno;
@@ -279,6 +431,8 @@ void closefiles()
 	dfs.printf("<closefiles>\n");
 	ifs->close();
 	delete ifs;
+	if (!extfpp)
+		fppClose();
 	dfs.printf("A");
 	lfs.close();
 	dfs.printf("B");
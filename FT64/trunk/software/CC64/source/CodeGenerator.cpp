@@ -1127,6 +1127,7 @@ AMODE *GenerateHook(ENODE *node,int flags, int size)
 	if (opt_nocgo)
 		n1 = 9999;
 	if (n1 > 4) {
+		LabelIndex::RemoveFrom(ip1->fwd);
 		peep_tail = ip1;
 		peep_tail->fwd = nullptr;
 	}
@@ -2412,8 +2413,12 @@ int GetNaturalSize(ENODE *node)
 
 static void GenerateCmp(ENODE *node, int op, int label, unsigned int prediction)
 {
+	char *key;
+
 	Enter("GenCmp");
+	key = Profile::Branch(&prediction);
 	GenerateCmp(node, op, label, 0, prediction);
+	Profile::Attach(key, label);
 	Leave("GenCmp",0);
 }
 
@@ -58,7 +58,6 @@ int Compiler::main2(int argc, char **argv)
 				NextToken();
 				compile();
 				summary();
-//				MBlk::ReleaseAll();
 //				ReleaseGlobalMemory();
 				CloseFiles();
 			}
@@ -79,6 +78,7 @@ void Compiler::compile()
 	symnum = 257;
 	classname = nullptr;
 	ZeroMemory(&gsyms[0],sizeof(gsyms));
+	SymbolIndex::Clear();
 	ZeroMemory(&defsyms,sizeof(defsyms));
 	ZeroMemory(&tagtable,sizeof(tagtable));
 	ZeroMemory(&symbolTable,sizeof(symbolTable));
@@ -90,6 +90,8 @@ void Compiler::compile()
 	gd = decls;
 	lastst = tk_nop;
 
+	Pch::Start();
+	Profile::Start();
 	getch();
 	lstackptr = 0;
 	lastst = 0;
@@ -122,6 +124,8 @@ int Compiler::PreprocessFile(char *nm)
 	static char outname[1000];
 	static char sysbuf[500];
 
+	if (!extfpp)
+		return (fppOpen(nm) ? -1 : 0);
 	strcpy_s(outname, sizeof(outname), nm);
 	makename(outname,".fpp");
 	sprintf_s(sysbuf, sizeof(sysbuf), "fpp -b %s %s", nm, outname);
@@ -134,6 +138,8 @@ void Compiler::CloseFiles()
 	ofs.close();
 	dfs.close();
 	ifs->close();
+	if (!extfpp)
+		fppClose();
 }
 
 void Compiler::AddStandardTypes()
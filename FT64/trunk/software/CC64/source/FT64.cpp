@@ -68,60 +68,101 @@ static int CSECmp(const void *a, const void *b)
 		return (-1);
 }
 
-static int AllocateRegisters1(int *dregr)
+// Which register file an expression would be held in.
+
+static int RegisterFile(CSE *csp)
 {
-	int nn,csecnt,reg,dreg;
-	CSE *csp;
+	if (csp->isfp)
+		return (1);
+	if (csp->exp->etype==bt_vector)
+		return (2);
+	return (0);
+}
 
-	reg = regFirstRegvar;
-	dreg = regFirstRegvar;
-	for (nn = 0; nn < 3; nn++) {
-		for (csecnt = 0; csecnt < csendx; csecnt++)	{
-			csp = &CSETable[csecnt];
-			if (csp->reg==-1) {
-				if( csp->OptimizationDesireability() >= 4-nn ) {
-					if (csp->isfp) {
-						if (dreg <= regLastRegvar)
-    						csp->reg = dreg++;
-					}
-					else if (csp->exp->etype!=bt_vector) {
-//    					if(( csp->duses > csp->uses / (8 << nn)) && reg < regLastRegvar )	// <- address register assignments
-						if (reg <= regLastRegvar)
-    						csp->reg = reg++;
-					}
-				}
-			}
-		}
-	}
-	*dregr = dreg;
-	return reg;
+// Two expressions interfere if they are in the same register file and their
+// live ranges overlap.
+
+static bool Interferes(CSE *csp1, CSE *csp2)
+{
+	if (RegisterFile(csp1) != RegisterFile(csp2))
+		return (false);
+	return (csp1->first <= csp2->last && csp2->first <= csp1->last);
 }
 
-static int FinalAllocateRegisters(int reg, int dreg)
+// A variable that starts as a copy of another can be coalesced with it if
+// the source was live before the copy and dies there. The ranges then only
+// meet at the copy, which holding both in one register turns into a move of
+// a register to itself.
+
+static bool Coalescable(CSE *dst, CSE *src)
 {
-	int csecnt;
-	CSE *csp;
+	if (dst->copy != src->exp || RegisterFile(dst) != RegisterFile(src))
+		return (false);
+	return (dst->first==dst->copyAt && src->last==dst->copyAt && src->first < dst->copyAt);
+}
+
+// Allocate registers by coloring the interference graph of the expressions'
+// live ranges. Expressions are colored in order of desirability, each one
+// getting the lowest register not held by an expression it interferes with.
+// If there isn't one the expression is spilled, it stays in memory.
+// Expressions whose live ranges don't overlap can share a register.
+// Copies are coalesced conservatively: an expression takes the register of
+// the one it's copied from, or to, only if no interfering expression already
+// holds it, so coalescing never causes a spill.
+// Vector registers are allocated separately.
+
+static void ColorRegisters()
+{
+	int csecnt, nn, reg;
+	uint64_t used;
+	CSE *csp, *csp2;
+	int partner;
 
 	for (csecnt = 0; csecnt < csendx; csecnt++)	{
 		csp = &CSETable[csecnt];
-		if (csp->OptimizationDesireability() != 0) {
-			if (!csp->voidf && csp->reg==-1) {
-				if (csp->isfp) {
-    				if(( csp->OptimizationDesireability() >= 4) && dreg < regLastRegvar )
-    					csp->reg = dreg++;
-    				else
-    					csp->reg = -1;
-				}
-				else if (csp->exp->etype!=bt_vector) {
-    				if(( csp->OptimizationDesireability() >= 4) && reg < regLastRegvar )
-    					csp->reg = reg++;
-    				else
-    					csp->reg = -1;
-				}
+		if (RegisterFile(csp)==2 || csp->OptimizationDesireability() < 2)
+			continue;
+		used = 0;
+		partner = -1;
+		for (nn = 0; nn < csecnt; nn++) {
+			csp2 = &CSETable[nn];
+			if (csp2->reg==-1)
+				continue;
+			if (Coalescable(csp, csp2) || Coalescable(csp2, csp))
+				partner = csp2->reg;
+			else if (Interferes(csp, csp2))
+				used |= 1LL << csp2->reg;
+		}
+		if (partner >= 0 && (used & (1LL << partner))==0) {
+			csp->reg = partner;
+			continue;
+		}
+		for (reg = regFirstRegvar; reg <= regLastRegvar; reg++) {
+			if ((used & (1LL << reg))==0) {
+				csp->reg = reg;
+				break;
 			}
 		}
 	}
-	return reg;
+}
+
+// An expression sharing its register with one whose live range comes first
+// isn't loaded on entry, that would overwrite the earlier value.
+
+static bool SharesRegister(CSE *csp)
+{
+	int csecnt;
+	CSE *csp2;
+
+	if (RegisterFile(csp)==2)
+		return (false);
+	for (csecnt = 0; csecnt < csendx; csecnt++) {
+		csp2 = &CSETable[csecnt];
+		if (csp2->reg==csp->reg && RegisterFile(csp2)==RegisterFile(csp)
+			&& csp2->first < csp->first)
+			return (true);
+	}
+	return (false);
 }
 
 static int AllocateVectorRegisters1()
@@ -177,7 +218,7 @@ int AllocateRegisterVars()
 {
 	CSE *csp;
     ENODE *exptr;
-    int reg, dreg, vreg;
+    int vreg;
 	uint64_t mask, rmask;
     uint64_t fpmask, fprmask;
 	uint64_t vmask, vrmask;
@@ -185,8 +226,6 @@ int AllocateRegisterVars()
 	int size;
 	int csecnt;
 
-	reg = regFirstRegvar;
-	dreg = regFirstRegvar;
 	vreg = 11;
     mask = 0;
 	rmask = 0;
@@ -197,20 +236,16 @@ int AllocateRegisterVars()
 
 	// Sort the CSE table according to desirability of allocating
 	// a register.
-	if (pass==1)
-		qsort(CSETable,(size_t)csendx,sizeof(CSE),CSECmp);
+	qsort(CSETable,(size_t)csendx,sizeof(CSE),CSECmp);
 
 	// Initialize to no allocated registers
 	for (csecnt = 0; csecnt < csendx; csecnt++)
 		CSETable[csecnt].reg = -1;
 
-	// Make multiple passes over the CSE table in order to use
-	// up all temporary registers. Allocates on the progressively
-	// less desirable.
-	reg = AllocateRegisters1(&dreg);
+	// Vector registers are still handed out by making multiple passes over
+	// the CSE table, allocating on the progressively less desirable.
+	ColorRegisters();
 	vreg = AllocateVectorRegisters1();
-	if (reg < regLastRegvar)
-		reg = FinalAllocateRegisters(reg,dreg);
 	if (vreg < 18)
 		vreg = FinalAllocateVectorRegisters(vreg);
 
@@ -252,7 +287,7 @@ int AllocateRegisterVars()
 	// Initialize temporaries
 	for (csecnt = 0; csecnt < csendx; csecnt++) {
 		csp = &CSETable[csecnt];
-        if( csp->reg != -1 )
+        if( csp->reg != -1 && !SharesRegister(csp))
         {               // see if preload needed
             exptr = csp->exp;
             if( 1 || !IsLValue(exptr) || (exptr->p[0]->i > 0) || (exptr->nodetype==en_struct_ref))
@@ -915,7 +950,21 @@ static void SetupReturnBlock(SYM *sym)
 	if (exceptions && (!sym->IsLeaf || sym->DoesThrow))
 		GenerateDiadic(op_ldi,0,makereg(regXLR),ap);
 	GenerateDiadic(op_mov,0,makereg(regFP),makereg(regSP));
-	GenerateTriadic(op_sub,0,makereg(regSP),makereg(regSP),make_immed(sym->stkspace));
+	ap = make_immed(sym->stkspace);
+	if (!sym->IsInline)
+		AddFrameFixup(ap->offset,FF_STKSPACE);
+	GenerateTriadic(op_sub,0,makereg(regSP),makereg(regSP),ap);
+}
+
+// An inline function without parameters or locals runs in the caller's
+// frame when it is expanded, so it doesn't need a frame of its own.
+
+static bool IsFrameless(SYM *sym)
+{
+	if (sym->IsNocall)
+		return (true);
+	return (sym->IsInline && !opt_noinline && sym->IsLeaf && sym->NumParms==0
+		&& sym->stkspace==0 && !sym->DoesThrow && !sym->UsesNew);
 }
 
 // Generate a function body.
@@ -954,7 +1003,7 @@ void GenerateFunction(SYM *sym)
 	    sym->prolog->Generate();
 	}
 	// Setup the return block.
-	if (!sym->IsNocall)
+	if (!IsFrameless(sym))
 		SetupReturnBlock(sym);
 	if (optimize)
 		opt1(stmt);
@@ -1177,7 +1226,7 @@ void GenerateReturn(Statement *stmt)
 		GenerateTriadic(op_add,0,makereg(regSP),makereg(regSP),make_immed(cnt2+sizeOfFP));
 	}
 	RestoreRegisterVars();
-    if (sym->IsNocall) {
+    if (IsFrameless(sym)) {
 		if (sym->epilog) {
 			sym->epilog->Generate();
 			return;
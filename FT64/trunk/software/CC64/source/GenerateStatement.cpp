@@ -252,6 +252,7 @@ void Statement::GenerateUntil()
 void Statement::GenerateFor()
 {
 	int old_break, old_cont, exit_label, loop_label;
+	bool fallback;
 
     old_break = breaklab;
     old_cont = contlab;
@@ -262,6 +263,12 @@ void Statement::GenerateFor()
     if( initExpr != NULL )
             ReleaseTempRegister(GenerateExpression(initExpr,F_ALL | F_NOVALUE
                     ,GetNaturalSize(initExpr)));
+	// The scalar loop is only needed if the vector loop might not be able
+	// to do the work.
+	if (GenerateVectorFor(loop_label, &fallback) && !fallback) {
+		contlab = old_cont;
+		return;
+	}
     GenerateLabel(loop_label);
     initstack();
     if( exp != NULL )
@@ -314,6 +321,21 @@ void Statement::GenerateIf()
     lab2 = nextlabel++;     // exit label
     oldbreak = breaklab;    // save break label
     initstack();            // clear temps
+	// If the profile shows the else part runs more often it's placed where
+	// the condition falls through.
+	if (s2 != 0 && Profile::ElseHotter(this)) {
+		swapped = 1;
+		GenerateTrueJump(exp,lab1,prediction);
+        if (mixedSource)
+          	GenerateMonadicNT(op_rem,0,make_string("; else"));
+		s2->Generate();
+        GenerateDiadicNT(op_bra,0,make_clabel(lab2),0);
+		GenerateLabel(lab1);
+		s1->Generate();
+		GenerateLabel(lab2);
+		breaklab = oldbreak;
+		return;
+	}
     GenerateFalseJump(exp,lab1,prediction);
     s1->Generate();
     if( s2 != 0 )             /* else part exists */
@@ -386,68 +408,6 @@ void Statement::GenerateDoUntil()
 //    GenerateDiadic(op_call,0,make_strlab(lib_name),NULL);
 //}
 
-//
-// Generate a switch composed of a series of compare and branch instructions.
-// Also called a linear switch.
-//
-void Statement::GenerateLinearSwitch()
-{    
-	int curlab;
-	int64_t *bf;
-	int nn,jj;
-	Statement *defcase, *stmt;
-	AMODE *ap, *ap1;
-
-	curlab = nextlabel++;
-	defcase = 0;
-	initstack();
-		if (exp==NULL) {
-		error(ERR_BAD_SWITCH_EXPR);
-		return;
-	}
-    ap = GenerateExpression(exp,F_REG,GetNaturalSize(exp));
-//        if( ap->preg != 0 )
-//                GenerateDiadic(op_mov,0,makereg(1),ap);
-//		ReleaseTempRegister(ap);
-    for(stmt = s1; stmt != NULL; stmt = stmt->next )
-    {
-		stmt->GenMixedSource();
-        if( stmt->s2 )          /* default case ? */
-        {
-			stmt->label = (int64_t *)curlab;
-			defcase = stmt;
-        }
-        else
-        {
-			bf = (int64_t *)stmt->casevals;
-			for (nn = (int)bf[0]; nn >= 1; nn--) {
-				if ((jj = pwrof2(bf[nn])) != -1) {
-					GenerateTriadicNT(op_bbs,0,ap,make_immed(jj),make_clabel(curlab));
-				}
-				else if (bf[nn] < -256 || bf[nn] > 255) {
-					ap1 = GetTempRegister();
-					GenerateTriadic(op_cmp,0,ap1,ap,make_immed(bf[nn]));
-					ReleaseTempRegister(ap1);
-					GenerateTriadicNT(op_beq,0,ap1,makereg(0),make_clabel(curlab));
-				}
-				else {
-					GenerateTriadicNT(op_beqi,0,ap,make_immed(bf[nn]),make_clabel(curlab));
-				}
-			}
-	        //GenerateDiadic(op_dw,0,make_label(curlab), make_direct(stmt->label));
-            stmt->label = (int64_t *)curlab;
-        }
-        if( stmt->s1 != NULL && stmt->next != NULL )
-            curlab = nextlabel++;
-    }
-    if( defcase == NULL )
-        GenerateMonadicNT(op_bra,0,make_clabel(breaklab));
-    else
-		GenerateMonadicNT(op_bra,0,make_clabel((int)defcase->label));
-    ReleaseTempRegister(ap);
-}
-
-
 // generate all cases for a switch statement.
 //
 void Statement::GenerateCase()
@@ -467,6 +427,22 @@ void Statement::GenerateCase()
     }
 }
 
+//
+// A switch is lowered by sorting the case values and splitting them into
+// clusters. A dense run of values gets a jump table, a run of values that
+// lie within 64 of each other and go to only a few labels gets a bit test,
+// and any other value is compared on its own. The clusters are then
+// searched with a balanced tree of compares, so a sparse switch takes
+// about log2(n) branches rather than n.
+//
+enum { CL_VALUE, CL_TABLE, CL_BITS };
+
+struct scluster {
+	int kind;
+	int first, last;	// index of the first and last case in the cluster
+	int64_t lo, hi;		// lowest and highest case value
+};
+
 static int casevalcmp(const void *a, const void *b)
 {
 	int64_t aa,bb;
@@ -480,10 +456,161 @@ static int casevalcmp(const void *a, const void *b)
 		return 1;
 }
 
+// Branch to the label if the switch value compares with val.
+
+static void GenerateCaseBranch(int op, AMODE *ap, int64_t val, int label)
+{
+	AMODE *ap1;
+
+	if (op==op_beq && val >= -256 && val <= 255)
+		GenerateTriadicNT(op_beqi,0,ap,make_immed(val),make_clabel(label));
+	else {
+		ap1 = GetTempRegister();
+		GenerateDiadic(op_ldi,0,ap1,make_immed(val));
+		GenerateTriadicNT(op,0,ap,ap1,make_clabel(label));
+		ReleaseTempRegister(ap1);
+	}
+}
+
+// Subtract the lowest case value from the switch value, then check that
+// the result falls within the cluster unless the tree has already done so.
+// Values outside the cluster go to misslbl. key is the profiling key of the
+// range check.
+
+static AMODE *GenerateClusterIndex(AMODE *ap, AMODE *ap1, scluster *cl, int64_t lb, int64_t ub, int misslbl, char *key)
+{
+	if (cl->lo != 0) {
+		GenerateTriadic(op_sub,0,ap1,ap,make_immed(cl->lo));
+		ap = ap1;
+	}
+	// One unsigned compare checks both ends of the range.
+	if (lb < cl->lo || ub > cl->hi) {
+		GenerateCaseBranch(op_bgeu,ap,cl->hi - cl->lo + 1,misslbl);
+		Profile::Attach(key,misslbl);
+	}
+	return (ap);
+}
+
+static void GenerateCaseTable(AMODE *ap, scase *cases, scluster *cl, int64_t lb, int64_t ub, int misslbl, int deflbl, char *key)
+{
+	AMODE *ap1, *ap2;
+	scase *tab;
+	int64_t nn, num;
+	int kk;
+	int tablabel;
+
+	num = cl->hi - cl->lo + 1;
+	tab = (scase *)allocx(sizeof(scase) * (int)num, MEM_CODE);
+	kk = cl->first;
+	for (nn = 0; nn < num; nn++) {
+		tab[nn].val = cl->lo + nn;
+		if (kk <= cl->last && cases[kk].val == tab[nn].val)
+			tab[nn].label = cases[kk++].label;
+		else
+			tab[nn].label = deflbl;
+	}
+	tablabel = caselit(tab,num);
+	ap1 = GetTempRegister();
+	ap2 = GenerateClusterIndex(ap,ap1,cl,lb,ub,misslbl,key);
+	GenerateTriadic(op_shl,0,ap1,ap2,make_immed(3));
+	GenerateDiadic(op_lw,0,ap1,make_indexed2(tablabel,ap1->preg));
+	// The table rides along as a third operand so the flow graph gets an
+	// edge to each case.
+	GenerateTriadic(op_jal,0,makereg(0),make_indexed(0,ap1->preg),make_clabel(tablabel));
+	ReleaseTempRegister(ap1);
+}
+
+// Each label gets a mask with a bit set for every case value that goes to
+// it. The mask is shifted down by the index so the bit can be tested.
+
+static void GenerateCaseBits(AMODE *ap, scase *cases, scluster *cl, int64_t lb, int64_t ub, int misslbl, int deflbl, char *key)
+{
+	AMODE *ap1, *ap2, *ap3;
+	uint64_t mask, done;
+	int kk, jj;
+
+	ap1 = GetTempRegister();
+	ap2 = GenerateClusterIndex(ap,ap1,cl,lb,ub,misslbl,key);
+	ap3 = GetTempRegister();
+	done = 0;
+	for (kk = cl->first; kk <= cl->last; kk++) {
+		if (done & (1ULL << (kk - cl->first)))
+			continue;
+		mask = 0;
+		for (jj = kk; jj <= cl->last; jj++) {
+			if (cases[jj].label == cases[kk].label) {
+				mask |= 1ULL << (cases[jj].val - cl->lo);
+				done |= 1ULL << (jj - cl->first);
+			}
+		}
+		GenerateDiadic(op_ldi,0,ap3,make_immed((int64_t)mask));
+		GenerateTriadic(op_shru,0,ap3,ap3,ap2);
+		GenerateTriadicNT(op_bbs,0,ap3,make_immed(0),make_clabel(cases[kk].label));
+	}
+	ReleaseTempRegister(ap3);
+	ReleaseTempRegister(ap1);
+	GenerateMonadicNT(op_bra,0,make_clabel(deflbl));
+}
+
+// Generate the search for the clusters given. Only values from lb to ub
+// reach this point. A few clusters are tested in turn, since beqi is a
+// single instruction while a split costs an ldi and a branch. The clusters
+// tested in turn are ordered by how often the profile shows them selected.
 
-// Currently inline in GenerateSwitch()
-void Statement::GenerateTabularSwitch()
+static void GenerateCaseTree(AMODE *ap, scase *cases, scluster *cl, int n, int64_t lb, int64_t ub, int deflbl)
 {
+	int nn, mid, kk, jj;
+	int lab;
+	int ord[5];
+	char *key[5];
+	int64_t freq[5];
+
+	if (n > 5) {
+		mid = n / 2;
+		lab = nextlabel++;
+		GenerateCaseBranch(op_bge,ap,cl[mid].lo,lab);
+		GenerateCaseTree(ap,cases,cl,mid,lb,cl[mid].lo - 1,deflbl);
+		GenerateLabel(lab);
+		GenerateCaseTree(ap,cases,&cl[mid],n - mid,cl[mid].lo,ub,deflbl);
+		return;
+	}
+	for (kk = 0; kk < n; kk++) {
+		key[kk] = Profile::Case(cl[kk].kind==CL_VALUE ? 'c' : 'r',cl[kk].first,&freq[kk]);
+		for (jj = kk; jj > 0 && freq[ord[jj-1]] < freq[kk]; jj--)
+			ord[jj] = ord[jj-1];
+		ord[jj] = kk;
+	}
+	for (kk = 0; kk < n; kk++) {
+		nn = ord[kk];
+		lab = deflbl;
+		switch(cl[nn].kind) {
+		case CL_VALUE:
+			if (lb == ub) {
+				GenerateMonadicNT(op_bra,0,make_clabel(cases[cl[nn].first].label));
+				return;
+			}
+			GenerateCaseBranch(op_beq,ap,cl[nn].lo,cases[cl[nn].first].label);
+			Profile::Attach(key[nn],cases[cl[nn].first].label);
+			break;
+		case CL_TABLE:
+			if (kk < n - 1)
+				lab = nextlabel++;
+			GenerateCaseTable(ap,cases,&cl[nn],lb,ub,lab,deflbl,key[nn]);
+			if (kk == n - 1)
+				return;
+			GenerateLabel(lab);
+			break;
+		case CL_BITS:
+			if (kk < n - 1)
+				lab = nextlabel++;
+			GenerateCaseBits(ap,cases,&cl[nn],lb,ub,lab,deflbl,key[nn]);
+			if (kk == n - 1)
+				return;
+			GenerateLabel(lab);
+			break;
+		}
+	}
+	GenerateMonadicNT(op_bra,0,make_clabel(deflbl));
 }
 
 //
@@ -491,94 +618,108 @@ void Statement::GenerateTabularSwitch()
 //
 void Statement::GenerateSwitch()
 { 
-	AMODE *ap, *ap1, *ap2;
-	Statement *st, *defcase;
+	AMODE *ap;
+	Statement *st;
+	scase *cases;
+	scluster *cl;
 	int oldbreak;
-	int tablabel;
 	int64_t *bf;
-	int64_t nn;
-	int64_t mm,kk;
-	int64_t minv,maxv;
+	int64_t lb, ub;
+	uint64_t range;
+	int nn, jj, kk, mm, ncl;
+	int ndest;
 	int deflbl;
 	int curlab;
+
     oldbreak = breaklab;
     breaklab = nextlabel++;
-	bf = (int64_t *)label;
-	minv = 0x7FFFFFFFL;
-	maxv = 0;
-	struct scase casetab[512];
+	deflbl = breaklab;
 
-	st = s1;
+	// Record case values and labels. Cases with no statements share the
+	// label of the case following.
+	mm = 0;
+	for (st = s1; st != (Statement *)NULL; st = st->next)
+		if (st->s2 == nullptr)
+			mm += (int)st->casevals[0];
+	cases = (scase *)allocx(sizeof(scase) * max(mm,1), MEM_CODE);
+	cl = (scluster *)allocx(sizeof(scluster) * max(mm,1), MEM_CODE);
 	mm = 0;
-	deflbl = 0;
-	defcase = nullptr;
 	curlab = nextlabel++;
-	// Determine minimum and maximum values in all cases
-	// Record case values and labels.
-	for(st = s1; st != (Statement *)NULL; st = st->next )
+	for (st = s1; st != (Statement *)NULL; st = st->next)
 	{
-		if (st->s2) {
-			defcase = st->s2;
+		st->label = (int64_t *)curlab;
+		if (st->s2)		// default case ?
 			deflbl = curlab;
-			curlab = nextlabel++;
-		}
 		else {
 			bf = st->casevals;
-			for (nn = bf[0]; nn >= 1; nn--) {
-				minv = min(bf[nn],minv);
-				maxv = max(bf[nn],maxv);
-				st->label = (int64_t *)curlab;
-				casetab[mm].label = curlab;
-				casetab[mm].val = bf[nn];
+			for (nn = (int)bf[0]; nn >= 1; nn--) {
+				cases[mm].label = curlab;
+				cases[mm].val = bf[nn];
 				mm++;
 			}
-			curlab = nextlabel++;
 		}
+		if (st->s1 != NULL && st->next != NULL)
+			curlab = nextlabel++;
 	}
-	//
-	// check case density
-	// If there are enough cases
-	// and if the case is dense enough use a computed jump
-	if (mm * 100 / max((maxv-minv),1) > 50 && (maxv-minv) > (nkd ? 7 : 12)) {
-		if (deflbl==0)
-			deflbl = nextlabel++;
-		for (nn = mm; nn < 512; nn++) {
-			casetab[nn].label = deflbl;
-			casetab[nn].val = maxv+1;
+	qsort(cases,mm,sizeof(scase),casevalcmp);
+
+	// Split the sorted values into clusters.
+	for (nn = ncl = 0; nn < mm; ncl++, nn = cl[ncl-1].last + 1) {
+		cl[ncl].kind = CL_VALUE;
+		cl[ncl].first = cl[ncl].last = nn;
+		// Look for a run of values dense enough for a jump table.
+		for (jj = nn; jj + 1 < mm; jj++) {
+			range = (uint64_t)cases[jj+1].val - (uint64_t)cases[nn].val;
+			if ((uint64_t)(jj + 2 - nn) * 2 <= range)		// under half full
+				break;
 		}
-		for (kk = minv; kk < maxv; kk++) {
-			for (nn = 0; nn < mm; nn++) {
-				if (casetab[nn].val==kk)
-					goto j1;
-			}
-			// value not found
-			casetab[mm].val = kk;
-			casetab[mm].label = defcase ? (int)defcase->label : breaklab;
-			mm++;
-j1:	;
+		range = (uint64_t)cases[jj].val - (uint64_t)cases[nn].val;
+		if (range > (uint64_t)(nkd ? 7 : 12)) {
+			cl[ncl].kind = CL_TABLE;
+			cl[ncl].last = jj;
 		}
-		qsort(&casetab[0],512,sizeof(struct scase),casevalcmp);
-		tablabel = caselit(casetab,maxv-minv+1);
-	    ap = GenerateExpression(exp,F_REG,GetNaturalSize(exp));
-		ap1 = GetTempRegister();
-		ap2 = GetTempRegister();
-		if (!nkd) {
-			GenerateDiadic(op_ldi,0,ap1,make_immed(minv));
-			GenerateTriadicNT(op_blt,0,ap,ap1,make_clabel(defcase ? (int)defcase->label : breaklab));
-			GenerateDiadic(op_ldi,0,ap2,make_immed(maxv+1));
-			GenerateTriadicNT(op_bge,0,ap,ap2,make_clabel(defcase ? (int)defcase->label : breaklab));
-			//Generate4adic(op_chk,0,ap,ap1,ap2,make_clabel(defcase ? (int)defcase->label : breaklab));
+		else {
+			// Look for values close enough for a bit mask going to at most
+			// three labels. It pays when it saves at least two branches.
+			ndest = 1;
+			for (jj = nn; jj + 1 < mm; jj++) {
+				range = (uint64_t)cases[jj+1].val - (uint64_t)cases[nn].val;
+				if (range >= 64)
+					break;
+				for (kk = nn; kk <= jj; kk++)
+					if (cases[kk].label == cases[jj+1].label)
+						break;
+				if (kk > jj) {
+					if (ndest == 3)
+						break;
+					ndest++;
+				}
+			}
+			if (jj - nn + 1 >= ndest + 3) {
+				cl[ncl].kind = CL_BITS;
+				cl[ncl].last = jj;
+			}
 		}
-		if (minv != 0)
-			GenerateTriadic(op_sub,0,ap,ap,make_immed(minv));
-		GenerateTriadic(op_shl,0,ap,ap,make_immed(3));
-		GenerateDiadic(op_lw,0,ap,make_indexed2(tablabel,ap->preg));
-		GenerateDiadic(op_jal,0,makereg(0),make_indexed(0,ap->preg));
-		s1->GenerateCase();
-		GenerateLabel(breaklab);
+		cl[ncl].lo = cases[cl[ncl].first].val;
+		cl[ncl].hi = cases[cl[ncl].last].val;
+	}
+
+	initstack();
+	if (exp==NULL) {
+		error(ERR_BAD_SWITCH_EXPR);
+		breaklab = oldbreak;
 		return;
 	}
-	GenerateLinearSwitch();
+    ap = GenerateExpression(exp,F_REG,GetNaturalSize(exp));
+	lb = INT64_MIN;
+	ub = INT64_MAX;
+	// A naked switch has no range check on a single jump table.
+	if (nkd && ncl == 1 && cl[0].kind == CL_TABLE) {
+		lb = cl[0].lo;
+		ub = cl[0].hi;
+	}
+	GenerateCaseTree(ap,cases,cl,ncl,lb,ub,deflbl);
+    ReleaseTempRegister(ap);
 	s1->GenerateCase();
 	GenerateLabel(breaklab);
     breaklab = oldbreak;
@@ -760,10 +901,11 @@ void Statement::GenerateFuncBody()
 void Statement::Generate()
 {
 	AMODE *ap;
-	Statement *stmt;
+	Statement *stmt, *outer;
  
 	for(stmt = this; stmt != NULL; stmt = stmt->next )
     {
+		outer = Profile::Enter(stmt);
         stmt->GenMixedSource();
         switch( stmt->stype )
         {
@@ -853,6 +995,7 @@ void Statement::Generate()
                 printf("DIAG - unknown statement.\n");
                 break;
         }
+		Profile::Enter(outer);
     }
 }
 
@@ -0,0 +1,366 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2017-2018  Robert Finch, Waterloo
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// CC64 - 'C' derived language compiler
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This source file is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================================
+//
+#include "stdafx.h"
+
+// Calls to small functions are replaced with a copy of the function's body
+// before the caller's code is generated. A function can be expanded when
+// its body is a single return of an integer expression without side
+// effects; the arguments are substituted for the parameters. Functions
+// declared inline may be larger than other functions.
+//
+// A function's expression is kept after its own calls have been expanded,
+// so expansion works bottom up. The depth counts the levels of calls folded
+// into the expression and limits how far expansion nests.
+
+#define INLINE_MAXNODES		40		// size limit for functions declared inline
+#define INLINE_MAXLEAF		12		// size limit for other functions
+#define INLINE_MAXDEPTH		4		// levels of calls folded into one expression
+#define INLINE_MAXPARMS		16
+
+static int inlineDepth;		// deepest expansion in the current function
+static int inlineCount;		// calls expanded in the current function
+
+static int IsParameterRef(ENODE *node)
+{
+	return ((node->nodetype==en_w_ref || node->nodetype==en_uw_ref)
+		&& node->p[0] && node->p[0]->nodetype==en_autocon);
+}
+
+// Count the nodes of an expression that may be expanded in line. Returns
+// -1 if the expression has side effects or contains anything other than
+// integer arithmetic on constants, memory and the parameters. Parameters
+// are only allowed as word sized values, so an argument can take their
+// place without a conversion. When nparms is negative the expression is an
+// argument of the caller and may refer to anything in the caller's frame.
+
+static int CountInlineNodes(ENODE *node, int64_t *parms, int nparms, int *uses)
+{
+	int n0, n1, nn;
+
+	if (node == nullptr)
+		return (0);
+	switch(node->nodetype) {
+	case en_icon:
+	case en_labcon:
+	case en_nacon:
+	case en_clabcon:
+	case en_cnacon:
+		return (1);
+	case en_autocon:
+	case en_regvar:
+		return (nparms < 0 ? 1 : -1);
+	case en_c_ref: case en_uc_ref:
+	case en_h_ref: case en_uh_ref:
+	case en_b_ref: case en_ub_ref:
+	case en_w_ref: case en_uw_ref:
+	case en_ref32: case en_ref32u:
+		if (nparms >= 0 && node->p[0] && node->p[0]->nodetype==en_autocon) {
+			if (!IsParameterRef(node))
+				return (-1);
+			for (nn = 0; nn < nparms; nn++) {
+				if (parms[nn]==node->p[0]->i) {
+					uses[nn]++;
+					return (1);
+				}
+			}
+			return (-1);
+		}
+	case en_cbu: case en_ccu: case en_chu:
+	case en_cubu: case en_cucu: case en_cuhu:
+	case en_cbw: case en_ccw: case en_chw:
+	case en_cubw: case en_cucw: case en_cuhw:
+	case en_cbc: case en_cbh: case en_cch:
+	case en_uminus: case en_not: case en_compl:
+	case en_bfieldref: case en_ubfieldref:
+	case en_cfieldref: case en_ucfieldref:
+	case en_hfieldref: case en_uhfieldref:
+	case en_wfieldref: case en_uwfieldref:
+		n0 = CountInlineNodes(node->p[0], parms, nparms, uses);
+		return (n0 < 0 ? -1 : n0 + 1);
+	case en_add: case en_sub:
+	case en_mul: case en_mulu:
+	case en_div: case en_udiv:
+	case en_mod: case en_umod:
+	case en_shl: case en_shlu: case en_asl:
+	case en_shr: case en_shru: case en_asr:
+	case en_and: case en_or: case en_xor:
+	case en_land: case en_lor:
+	case en_eq: case en_ne:
+	case en_lt: case en_le: case en_gt: case en_ge:
+	case en_ult: case en_ule: case en_ugt: case en_uge:
+	case en_cond: case en_void:
+		n0 = CountInlineNodes(node->p[0], parms, nparms, uses);
+		n1 = CountInlineNodes(node->p[1], parms, nparms, uses);
+		return ((n0 < 0 || n1 < 0) ? -1 : n0 + n1 + 1);
+	default:
+		return (-1);
+	}
+}
+
+// An argument may be copied to more than one place if it is cheap and
+// gives the same value each time.
+
+static int IsSimpleArgument(ENODE *node)
+{
+	if (node->isVolatile)
+		return (FALSE);
+	switch(node->nodetype) {
+	case en_icon:
+	case en_labcon:
+	case en_nacon:
+	case en_clabcon:
+	case en_cnacon:
+	case en_autocon:
+	case en_regvar:
+		return (TRUE);
+	case en_w_ref: case en_uw_ref:
+		return (node->p[0]->nodetype==en_autocon || node->p[0]->nodetype==en_labcon
+			|| node->p[0]->nodetype==en_nacon);
+	}
+	return (FALSE);
+}
+
+static int GetParameterOffsets(SYM *sp, int64_t *parms)
+{
+	SYM *p;
+	int nn;
+
+	nn = 0;
+	for (p = SYM::GetPtr(sp->params.GetHead()); p; p = p->GetNextPtr()) {
+		if (p->IsRegister || nn >= INLINE_MAXPARMS)
+			return (-1);
+		parms[nn++] = p->value.i;
+	}
+	return (nn);
+}
+
+static ENODE *CopyInlineExpression(ENODE *node, int64_t *parms, int nparms, ENODE **args)
+{
+	ENODE *ep;
+	int nn;
+
+	if (node == nullptr)
+		return (nullptr);
+	if (nparms > 0 && IsParameterRef(node)) {
+		for (nn = 0; nn < nparms; nn++) {
+			if (parms[nn]==node->p[0]->i)
+				return (CopyInlineExpression(args[nn], parms, 0, args));
+		}
+	}
+	ep = (ENODE *)xalloc(sizeof(ENODE));
+	*ep = *node;
+	ep->p[0] = CopyInlineExpression(node->p[0], parms, nparms, args);
+	ep->p[1] = CopyInlineExpression(node->p[1], parms, nparms, args);
+	ep->p[2] = CopyInlineExpression(node->p[2], parms, nparms, args);
+	return (ep);
+}
+
+// Keep a copy of the function's return expression if the function can be
+// expanded in line. The copy is made before the function's code is
+// generated, since code generation rewrites the tree.
+
+static void SetInlineExpression(SYM *sp)
+{
+	Statement *stmt;
+	TYP *tp;
+	int64_t parms[INLINE_MAXPARMS];
+	int uses[INLINE_MAXPARMS];
+	int nparms, size;
+
+	sp->inlinexp = nullptr;
+	if (opt_noinline || sp->IsInterrupt || sp->IsNocall || sp->IsTask
+		|| sp->IsVirtual || sp->DoesThrow || sp->prolog || sp->epilog)
+		return;
+	tp = sp->tp->GetBtp();
+	if (tp == nullptr || tp->IsFloatType() || tp->IsVectorType() || tp->size != sizeOfWord)
+		return;
+	if (tp->type==bt_struct || tp->type==bt_union || tp->type==bt_class)
+		return;
+	stmt = sp->stmt;
+	if (stmt == nullptr || stmt->stype != st_compound || stmt->prolog || stmt->epilog
+		|| stmt->ssyms.GetHead())
+		return;
+	stmt = stmt->s1;
+	if (stmt == nullptr || stmt->stype != st_return || stmt->exp == nullptr || stmt->next)
+		return;
+	if ((nparms = GetParameterOffsets(sp, parms)) < 0)
+		return;
+	ZeroMemory(uses, sizeof(uses));
+	size = CountInlineNodes(stmt->exp, parms, nparms, uses);
+	if (size < 0 || size > (sp->IsInline ? INLINE_MAXNODES : INLINE_MAXLEAF))
+		return;
+	sp->inlinexp = CopyInlineExpression(stmt->exp, parms, 0, nullptr);
+	sp->inlineDepth = inlineDepth + 1;
+	DTRACE(TRC_INLINE).printf("<InlineCandidate>%s", (char *)sp->name->c_str());
+	DTRACE(TRC_INLINE).printf(" nodes=%d depth=%d</InlineCandidate>\n", size, sp->inlineDepth);
+}
+
+// A call made after a prototype refers to the prototype's symbol; the
+// expression is kept with the function's definition.
+
+static SYM *FindDefinition(SYM *sp)
+{
+	SYM *p;
+	int nn;
+
+	if (sp == nullptr || sp->inlinexp)
+		return (sp);
+	if (sp->mangledName == nullptr || gsyms[0].Find(*sp->name) == 0)
+		return (nullptr);
+	for (nn = 0; nn < TABLE::matchno; nn++) {
+		p = TABLE::match[nn];
+		if (p->inlinexp && p->mangledName && *p->mangledName == *sp->mangledName)
+			return (p);
+	}
+	return (nullptr);
+}
+
+// Replace a call with the callee's expression if possible.
+
+static void InlineCall(ENODE *node)
+{
+	SYM *sp;
+	ENODE *ep;
+	ENODE *args[INLINE_MAXPARMS];
+	int64_t parms[INLINE_MAXPARMS];
+	int uses[INLINE_MAXPARMS];
+	int nparms, nargs, nn;
+
+	sp = FindDefinition(node->sym);
+	if (sp == nullptr || sp == currentFn)
+		return;
+	if (node->p[0] == nullptr || node->p[0]->nodetype != en_cnacon)
+		return;
+	if (sp->inlineDepth >= INLINE_MAXDEPTH)
+		return;
+	if ((nparms = GetParameterOffsets(sp, parms)) < 0)
+		return;
+	// The argument list is built last argument first.
+	nargs = 0;
+	for (ep = node->p[1]; ep; ep = ep->p[1]) {
+		if (nargs >= nparms)
+			return;
+		args[nparms - 1 - nargs] = ep->p[0];
+		nargs++;
+	}
+	if (nargs != nparms)
+		return;
+	ZeroMemory(uses, sizeof(uses));
+	CountInlineNodes(sp->inlinexp, parms, nparms, uses);
+	for (nn = 0; nn < nparms; nn++) {
+		if (args[nn]==nullptr || CountInlineNodes(args[nn], nullptr, -1, nullptr) < 0)
+			return;
+		if (uses[nn] > 1 && !IsSimpleArgument(args[nn]))
+			return;
+	}
+	DTRACE(TRC_INLINE).printf("<Inline>%s into %s</Inline>\n",
+		(char *)sp->name->c_str(), (char *)currentFn->name->c_str());
+	*node = *CopyInlineExpression(sp->inlinexp, parms, nparms, args);
+	inlineDepth = max(inlineDepth, sp->inlineDepth);
+	inlineCount++;
+}
+
+static void InlineExpr(ENODE *node)
+{
+	if (node == nullptr)
+		return;
+	InlineExpr(node->p[0]);
+	InlineExpr(node->p[1]);
+	InlineExpr(node->p[2]);
+	if (node->nodetype==en_fcall)
+		InlineCall(node);
+}
+
+static void InlineStmt(Statement *block)
+{
+	SYM *sp;
+
+	for (; block; block = block->next) {
+		switch(block->stype) {
+		case st_compound:
+			InlineStmt(block->prolog);
+			for (sp = SYM::GetPtr(block->ssyms.GetHead()); sp; sp = sp->GetNextPtr())
+				InlineExpr(sp->initexp);
+			InlineStmt(block->s1);
+			InlineStmt(block->epilog);
+			break;
+		case st_return:
+		case st_throw:
+		case st_check:
+		case st_expr:
+			InlineExpr(block->exp);
+			break;
+		case st_while:
+		case st_until:
+		case st_do:
+		case st_dountil:
+			InlineExpr(block->exp);
+		case st_doloop:
+		case st_forever:
+			InlineStmt(block->s1);
+			InlineStmt(block->s2);
+			break;
+		case st_for:
+			InlineExpr(block->initExpr);
+			InlineExpr(block->exp);
+			InlineStmt(block->s1);
+			InlineExpr(block->incrExpr);
+			break;
+		case st_if:
+			InlineExpr(block->exp);
+			InlineStmt(block->s1);
+			InlineStmt(block->s2);
+			break;
+		case st_switch:
+			InlineExpr(block->exp);
+			InlineStmt(block->s1);
+			break;
+		case st_try:
+		case st_catch:
+		case st_case:
+		case st_default:
+		case st_firstcall:
+			InlineStmt(block->s1);
+			break;
+		}
+	}
+}
+
+// Expand calls in the function's body, then see if the function itself
+// can be expanded where it's called.
+
+void InlineCalls(SYM *sp)
+{
+	inlineDepth = 0;
+	inlineCount = 0;
+	if (opt_noinline)
+		return;
+	InlineStmt(sp->stmt);
+	if (inlineCount)
+		DTRACE(TRC_INLINE).printf("<InlineCount>%s %d</InlineCount>\n",
+			(char *)sp->name->c_str(), inlineCount);
+	SetInlineExpression(sp);
+}
@@ -56,7 +56,7 @@ Float128 *GetFloatExpression(ENODE **pnode)       /* simple integer value */
 	ENODE *node;
 	Float128 *flt;
 
-	flt = (Float128 *)allocx(sizeof(Float128));
+	flt = (Float128 *)allocx(sizeof(Float128), MEM_LIT);
 	tp = NonCommaExpression(&node);
 	if (node==NULL) {
 		error(ERR_SYNTAX);
@@ -0,0 +1,144 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2017-2018  Robert Finch, Waterloo
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// CC64 - 'C' derived language compiler
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU Lesser General Public License as published 
+// by the Free Software Foundation, either version 3 of the License, or     
+// (at your option) any later version.                                      
+//                                                                          
+// This source file is distributed in the hope that it will be useful,      
+// but WITHOUT ANY WARRANTY; without even the implied warranty of           
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            
+// GNU General Public License for more details.                             
+//                                                                          
+// You should have received a copy of the GNU General Public License        
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.    
+//                                                                          
+// ============================================================================
+//
+#include "stdafx.h"
+
+// The index is an open addressed hash table with linear probing. Label
+// numbers come from a single counter so they are close together; the
+// multiplicative hash spreads them across the table. The table lives
+// across functions and is cleared at the start of each one.
+
+OCODE **LabelIndex::tbl = nullptr;
+int LabelIndex::size = 0;
+int LabelIndex::count = 0;
+
+static inline int LabelOf(OCODE *ip)
+{
+	return ((int)ip->oper1);
+}
+
+int LabelIndex::Slot(int64_t lab)
+{
+	return ((int)(((uint64_t)lab * 0x9E3779B97F4A7C15ULL) >> 32) & (size - 1));
+}
+
+void LabelIndex::Clear()
+{
+	if (tbl)
+		ZeroMemory(tbl, size * sizeof(OCODE *));
+	count = 0;
+}
+
+void LabelIndex::Grow()
+{
+	OCODE **old;
+	int oldsize;
+	int nn, ndx;
+
+	old = tbl;
+	oldsize = size;
+	size = size ? size * 2 : 1024;
+	tbl = new OCODE *[size];
+	ZeroMemory(tbl, size * sizeof(OCODE *));
+	for (nn = 0; nn < oldsize; nn++) {
+		if (old[nn]) {
+			for (ndx = Slot(LabelOf(old[nn])); tbl[ndx]; ndx = (ndx + 1) & (size - 1))
+				;
+			tbl[ndx] = old[nn];
+		}
+	}
+	delete[] old;
+}
+
+// A label number that is already present is re-pointed to the new OCODE.
+// This happens when code generation backs up and regenerates a sequence.
+
+void LabelIndex::Insert(OCODE *ip)
+{
+	int ndx;
+
+	if (count * 2 >= size)
+		Grow();
+	for (ndx = Slot(LabelOf(ip)); tbl[ndx]; ndx = (ndx + 1) & (size - 1)) {
+		if (LabelOf(tbl[ndx]) == LabelOf(ip)) {
+			tbl[ndx] = ip;
+			return;
+		}
+	}
+	tbl[ndx] = ip;
+	count++;
+}
+
+// Only the entry for this particular OCODE is removed. Entries that follow
+// in the same probe run are shifted back so that lookups don't stop short.
+
+void LabelIndex::Remove(OCODE *ip)
+{
+	int ndx, nxt, home;
+
+	if (count == 0)
+		return;
+	for (ndx = Slot(LabelOf(ip)); tbl[ndx]; ndx = (ndx + 1) & (size - 1)) {
+		if (tbl[ndx] == ip)
+			break;
+	}
+	if (tbl[ndx] == nullptr)
+		return;
+	tbl[ndx] = nullptr;
+	count--;
+	for (nxt = (ndx + 1) & (size - 1); tbl[nxt]; nxt = (nxt + 1) & (size - 1)) {
+		home = Slot(LabelOf(tbl[nxt]));
+		// Move the entry back if its home slot is not between the hole and
+		// its current position (cyclically).
+		if (((nxt - home) & (size - 1)) >= ((nxt - ndx) & (size - 1))) {
+			tbl[ndx] = tbl[nxt];
+			tbl[nxt] = nullptr;
+			ndx = nxt;
+		}
+	}
+}
+
+// Remove the labels in a tail of the peep list that is being discarded.
+
+void LabelIndex::RemoveFrom(OCODE *ip)
+{
+	for (; ip; ip = ip->fwd) {
+		if (ip->opcode==op_label)
+			Remove(ip);
+	}
+}
+
+OCODE *LabelIndex::Find(int64_t lab)
+{
+	int ndx;
+
+	if (count == 0)
+		return (nullptr);
+	for (ndx = Slot(lab); tbl[ndx]; ndx = (ndx + 1) & (size - 1)) {
+		if (LabelOf(tbl[ndx]) == lab)
+			return (tbl[ndx]);
+	}
+	return (nullptr);
+}
@@ -234,7 +234,7 @@ void DumpCSETable()
 	dfs.printf(
 "*The expression must be used three or more times before it will be allocated\n"
 "to a register.\n");
-	dfs.printf("N OD Uses DUses Void Reg Sym\n");
+	dfs.printf("N OD Uses DUses Void Reg Range Sym\n");
 	for (nn = 0; nn < csendx; nn++) {
 		csp = &CSETable[nn];
 		dfs.printf("%d: ", nn);
@@ -243,6 +243,7 @@ void DumpCSETable()
 		dfs.printf("%d   ",csp->duses);
 		dfs.printf("%d   ",(int)csp->voidf);
 		dfs.printf("%d   ",csp->reg);
+		dfs.printf("%d-%d   ",csp->first,csp->last);
 		if (csp->exp && csp->exp->sym)
 			dfs.printf("%s   ",(char *)csp->exp->sym->name->c_str());
 		dfs.printf("\n");
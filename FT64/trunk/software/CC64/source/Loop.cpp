@@ -0,0 +1,925 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2017-2018  Robert Finch, Waterloo
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// CC64 - 'C' derived language compiler
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This source file is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================================
+//
+#include "stdafx.h"
+
+// The loops in a function's code are found from the control flow graph once
+// the peephole optimizer is done with the code. Instructions computing the
+// same value on every trip around a loop are moved in front of it, a
+// multiply of an induction variable is replaced by an add each time the
+// variable is stepped, and small loops that go around a constant number of
+// times are unrolled.
+//
+// Code can only be placed in front of a loop that is entered by falling
+// into its header. A loop containing a call or inline assembler is left
+// alone, because the temporary registers a moved value is kept in aren't
+// preserved across a call. A value that is also used for something else in
+// the loop is moved into a temporary register the function doesn't use.
+//
+// Each change makes the control flow graph and the live variables out of
+// date, so once a loop has been changed the loops nested with it are left
+// for the next round, which starts over with a new graph.
+
+#define LOOP_MAXROUNDS	16		// times the loops are looked at
+#define LOOP_MAXTRIP	8		// most trips around a loop that is unrolled
+#define LOOP_MAXUNROLL	32		// most instructions in an unrolled loop
+#define LOOP_MAXUSES	16		// most uses of a value that is renamed
+
+extern BasicBlock *RootBlock;
+extern BasicBlock *LastBlock;
+extern BasicBlock *basicBlocks[10000];
+extern OCODE *peep_head;
+extern OCODE *FindLabel(int64_t);
+extern AMODE *copy_addr(AMODE *ap);
+extern Instruction *GetInsn(int);
+extern void ComputeLiveVars();
+extern bool IsBasicBlockSeparater(OCODE *ip);
+
+static Loop *loops;
+static CSet *regsUsed;		// registers referred to by the function's code
+static int loopChanges;		// number of changes made in the function
+
+Loop *Loop::MakeNew(BasicBlock *head)
+{
+	Loop *lp;
+
+	lp = (Loop *)allocx(sizeof(Loop), MEM_OPT);
+	lp->head = head;
+	lp->blocks = CSet::MakeNew();
+	lp->blocks->add(head->num);
+	return (lp);
+}
+
+bool Loop::Contains(BasicBlock *b)
+{
+	return (blocks->isMember(b->num));
+}
+
+static bool Dominates(BasicBlock *d, BasicBlock *b)
+{
+	for (; b; b = b->idom)
+		if (b==d)
+			return (true);
+	return (false);
+}
+
+// Add the blocks of the loop reaching the source of a back edge.
+
+static void AddBody(Loop *lp, BasicBlock *src)
+{
+	static BasicBlock *stk[10000];
+	BasicBlock *b;
+	Edge *e;
+	int sp;
+
+	if (lp->Contains(src))
+		return;
+	lp->blocks->add(src->num);
+	sp = 0;
+	stk[sp++] = src;
+	while (sp > 0) {
+		b = stk[--sp];
+		for (e = b->ihead; e; e = e->next) {
+			if (!lp->Contains(e->src)) {
+				lp->blocks->add(e->src->num);
+				stk[sp++] = e->src;
+			}
+		}
+	}
+}
+
+// Find the natural loops. Back edges to the same header make up a single
+// loop. The list is ordered by size so inner loops come before the loops
+// containing them.
+
+void Loop::FindLoops()
+{
+	BasicBlock *b;
+	Loop *lp, *nxt, **plp;
+	Edge *e;
+
+	loops = nullptr;
+	for (b = RootBlock; b; b = b->next) {
+		for (e = b->ohead; e; e = e->next) {
+			if (!Dominates(e->dst, b))
+				continue;
+			for (lp = loops; lp; lp = lp->next)
+				if (lp->head==e->dst)
+					break;
+			if (lp==nullptr) {
+				lp = MakeNew(e->dst);
+				lp->next = loops;
+				loops = lp;
+			}
+			AddBody(lp, b);
+		}
+		if (b==LastBlock)
+			break;
+	}
+	// Sort by insertion
+	lp = loops;
+	loops = nullptr;
+	for (; lp; lp = nxt) {
+		nxt = lp->next;
+		for (plp = &loops; *plp; plp = &(*plp)->next)
+			if ((*plp)->blocks->NumMember() > lp->blocks->NumMember())
+				break;
+		lp->next = *plp;
+		*plp = lp;
+	}
+}
+
+static int64_t LabelNumber(OCODE *ip)
+{
+	return ((int64_t)ip->oper1);
+}
+
+// Get the label a branch goes to, -1 if it isn't a branch to a label.
+
+int64_t BranchTarget(OCODE *ip)
+{
+	switch(ip->opcode) {
+	case op_bra:
+	case op_jmp:
+		if (ip->oper1 && ip->oper1->offset)
+			return (ip->oper1->offset->i);
+		break;
+	case op_beq:
+	case op_bne:
+	case op_blt:
+	case op_bge:
+	case op_ble:
+	case op_bgt:
+	case op_bltu:
+	case op_bgeu:
+	case op_bleu:
+	case op_bgtu:
+	case op_bbs:
+	case op_bbc:
+	case op_beqi:
+	case op_bnei:
+		if (ip->oper3 && ip->oper3->offset)
+			return (ip->oper3->offset->i);
+		break;
+	}
+	return (-1);
+}
+
+static bool IsStore(OCODE *ip)
+{
+	return (ip->insn && ip->insn->memacc && !ip->insn->HasTarget);
+}
+
+// An instruction that reads its target register as well as writing it.
+
+static bool ReadsTarget(OCODE *ip)
+{
+	return (ip->opcode==op_bfins || ip->opcode==op_swap);
+}
+
+static bool OperReg(AMODE *ap, int regno)
+{
+	if (ap==nullptr)
+		return (false);
+	switch(ap->mode) {
+	case am_reg:
+	case am_ind:
+	case am_indx:
+	case am_ainc:
+	case am_adec:
+		return (ap->preg==regno);
+	case am_indx2:
+	case am_indx3:
+		return (ap->preg==regno || ap->sreg==regno);
+	}
+	return (false);
+}
+
+// The first operand of an instruction without a target register is read,
+// unless the instruction is one of the few whose target isn't marked in the
+// instruction table. Those are counted as reading and writing it.
+
+bool Oper1Read(OCODE *ip)
+{
+	return (ReadsTarget(ip) || ip->insn==nullptr || !ip->insn->HasTarget);
+}
+
+static bool Oper1Written(OCODE *ip)
+{
+	if (ip->insn==nullptr)
+		return (true);
+	if (ip->insn->HasTarget)
+		return (true);
+	return (!IsBasicBlockSeparater(ip) && !IsStore(ip));
+}
+
+static bool MayUse(OCODE *ip, int regno)
+{
+	if (ip->opcode==op_label)
+		return (false);
+	if (Oper1Read(ip) && OperReg(ip->oper1, regno))
+		return (true);
+	return (OperReg(ip->oper2, regno) || OperReg(ip->oper3, regno) || OperReg(ip->oper4, regno));
+}
+
+bool MayDefine(OCODE *ip, int regno)
+{
+	int tr;
+
+	if (ip->opcode==op_label)
+		return (false);
+	if (ip->insn && ip->insn->HasTarget) {
+		tr = ip->GetTargetReg();
+		if ((tr & 0xffff)==regno || ((tr >> 16) & 0xffff)==regno)
+			return (true);
+	}
+	else if (Oper1Written(ip) && ip->oper1 && ip->oper1->mode==am_reg && ip->oper1->preg==regno)
+		return (true);
+	return (
+		(ip->oper1 && (ip->oper1->mode==am_ainc || ip->oper1->mode==am_adec) && ip->oper1->preg==regno)
+		|| (ip->oper2 && (ip->oper2->mode==am_ainc || ip->oper2->mode==am_adec) && ip->oper2->preg==regno)
+		);
+}
+
+// Walk the instructions of a block.
+
+#define FOR_BLOCK(ip, b)	for (ip = (b)->code; ip && ip->bb==(b); ip = ip->fwd)
+
+// A loop can be changed if it doesn't contain anything that might use or
+// change registers in ways that can't be seen in the operands.
+
+bool Loop::IsSafe()
+{
+	BasicBlock *b;
+	OCODE *ip;
+	int nn;
+
+	for (nn = blocks->firstMember(); nn >= 0; nn = blocks->nextMember(nn)) {
+		b = basicBlocks[nn];
+		FOR_BLOCK(ip, b) {
+			if (ip->opcode==op_label)
+				continue;
+			if (ip->insn==nullptr)
+				return (false);
+			switch(ip->opcode) {
+			case op_call:
+			case op_jal:
+			case op_asm:
+			case op_push:
+			case op_pop:
+			case op_link:
+			case op_unlk:
+			case op_ret:
+			case op_rte:
+			case op_bex:
+			// Vector registers have the same numbers as the general registers.
+			case op_lv: case op_sv: case op_vmov:
+			case op_vadd: case op_vsub: case op_vmul: case op_vdiv:
+			case op_vadds: case op_vsubs: case op_vmuls: case op_vdivs:
+			case op_vseq: case op_vsne: case op_vslt: case op_vsge: case op_vsle: case op_vsgt:
+			case op_vex: case op_veins:
+				return (false);
+			}
+		}
+	}
+	return (true);
+}
+
+int Loop::CountDefs(int regno)
+{
+	BasicBlock *b;
+	OCODE *ip;
+	int nn, count;
+
+	count = 0;
+	for (nn = blocks->firstMember(); nn >= 0; nn = blocks->nextMember(nn)) {
+		b = basicBlocks[nn];
+		FOR_BLOCK(ip, b) {
+			if (MayDefine(ip, regno))
+				count++;
+		}
+	}
+	return (count);
+}
+
+// Is the register live on leaving the loop ?
+
+bool Loop::IsLiveOut(int regno)
+{
+	BasicBlock *b;
+	Edge *e;
+	int nn;
+
+	for (nn = blocks->firstMember(); nn >= 0; nn = blocks->nextMember(nn)) {
+		b = basicBlocks[nn];
+		for (e = b->ohead; e; e = e->next) {
+			if (!Contains(e->dst) && e->dst->LiveIn->isMember(regno))
+				return (true);
+		}
+	}
+	return (false);
+}
+
+// Find where code to be run before the loop can go. The header must be
+// entered from outside the loop only by falling into it from the block
+// before it.
+
+static OCODE *FindEntry(Loop *lp)
+{
+	BasicBlock *h;
+	Edge *e;
+	int nn;
+
+	h = lp->head;
+	if (h==RootBlock || h->prev==nullptr || h->code==nullptr)
+		return (nullptr);
+	if (h->code->opcode != op_label)
+		return (nullptr);
+	nn = 0;
+	for (e = h->ihead; e; e = e->next) {
+		if (lp->Contains(e->src))
+			continue;
+		if (e->src != h->prev || e->src->lcode==nullptr)
+			return (nullptr);
+		if (BranchTarget(e->src->lcode)==LabelNumber(h->code))
+			return (nullptr);
+		nn++;
+	}
+	return (nn > 0 ? h->code : nullptr);
+}
+
+// Find the registers the function's code refers to. A temporary register
+// that isn't among them can hold a value for the length of a loop.
+
+static void FindRegsUsed()
+{
+	OCODE *ip;
+	int regno;
+
+	regsUsed->clear();
+	for (ip = peep_head; ip; ip = ip->fwd) {
+		if (ip->opcode==op_label)
+			continue;
+		// The registers used by inline assembler aren't known.
+		if (ip->opcode==op_asm) {
+			for (regno = regFirstTemp; regno <= regLastTemp; regno++)
+				regsUsed->add(regno);
+			return;
+		}
+		for (regno = regFirstTemp; regno <= regLastTemp; regno++) {
+			if (MayUse(ip, regno) || MayDefine(ip, regno) || OperReg(ip->oper1, regno))
+				regsUsed->add(regno);
+		}
+	}
+}
+
+static int GetFreeReg()
+{
+	int regno;
+
+	for (regno = regFirstTemp; regno <= regLastTemp; regno++) {
+		if (!regsUsed->isMember(regno)) {
+			regsUsed->add(regno);
+			return (regno);
+		}
+	}
+	return (-1);
+}
+
+// Put an instruction in front of the loop.
+
+static void InsertEntry(Loop *lp, OCODE *ip)
+{
+	Peep::InsertBefore(lp->entry, ip);
+	ip->bb = lp->head->prev;
+}
+
+static OCODE *MakeInsn(int op, AMODE *ap1, AMODE *ap2, AMODE *ap3, int depth)
+{
+	OCODE *cd;
+
+	cd = OCODE::MakeNew();
+	cd->predop = 1;
+	cd->pregreg = 15;
+	cd->insn = GetInsn(op);
+	cd->opcode = op;
+	cd->oper1 = ap1;
+	cd->oper1->isTarget = 1;
+	cd->oper2 = ap2;
+	cd->oper3 = ap3;
+	cd->loop_depth = depth;
+	return (cd);
+}
+
+static OCODE *CopyInsn(OCODE *ip)
+{
+	OCODE *cd;
+
+	cd = OCODE::MakeNew();
+	memcpy(cd, ip, sizeof(OCODE));
+	cd->fwd = cd->back = nullptr;
+	cd->comment = nullptr;
+	cd->profile = nullptr;		// the original keeps the profiling label
+	cd->oper1 = copy_addr(ip->oper1);
+	cd->oper2 = copy_addr(ip->oper2);
+	cd->oper3 = copy_addr(ip->oper3);
+	cd->oper4 = copy_addr(ip->oper4);
+	return (cd);
+}
+
+void Unlink(OCODE *ip)
+{
+	BasicBlock *b;
+
+	// Keep the block's first and last instructions up to date.
+	if ((b = ip->bb) != nullptr) {
+		if (b->code==ip)
+			b->code = ip->fwd && ip->fwd->bb==b ? ip->fwd : nullptr;
+		if (b->lcode==ip)
+			b->lcode = ip->back && ip->back->bb==b ? ip->back : nullptr;
+	}
+	if (ip->fwd && ip->fwd->comment==nullptr)
+		ip->fwd->comment = ip->comment;
+	ip->comment = nullptr;
+	if (ip->back)
+		ip->back->fwd = ip->fwd;
+	if (ip->fwd)
+		ip->fwd->back = ip->back;
+	ip->fwd = ip->back = nullptr;
+}
+
+void RemoveInsn(OCODE *ip)
+{
+	MarkRemove(ip);
+	Unlink(ip);
+}
+
+// Replace a register in the operands an instruction reads.
+
+static void RenameOper(AMODE **pap, int oldreg, int newreg)
+{
+	AMODE *ap;
+
+	if (!OperReg(*pap, oldreg))
+		return;
+	ap = copy_addr(*pap);
+	if (ap->preg==oldreg)
+		ap->preg = newreg;
+	if ((ap->mode==am_indx2 || ap->mode==am_indx3) && ap->sreg==oldreg)
+		ap->sreg = newreg;
+	*pap = ap;
+}
+
+static void RenameUses(OCODE *ip, int oldreg, int newreg)
+{
+	if (Oper1Read(ip))
+		RenameOper(&ip->oper1, oldreg, newreg);
+	RenameOper(&ip->oper2, oldreg, newreg);
+	RenameOper(&ip->oper3, oldreg, newreg);
+	RenameOper(&ip->oper4, oldreg, newreg);
+}
+
+// Find the uses of the value an instruction defines. The value must only be
+// used in the rest of the instruction's block and be dead after it, so that
+// the uses can be made to refer to another register. If ivreg is an
+// induction variable it must not be stepped before the last use.
+
+static int FindLocalUses(OCODE *def, int ivreg, OCODE **uses)
+{
+	OCODE *ip;
+	int regno, nuses;
+	bool stepped;
+
+	regno = def->oper1->preg;
+	nuses = 0;
+	stepped = false;
+	for (ip = def->fwd; ip && ip->bb==def->bb; ip = ip->fwd) {
+		if (MayUse(ip, regno)) {
+			if (stepped || nuses >= LOOP_MAXUSES)
+				return (-1);
+			// The register might also be the target.
+			if (Oper1Read(ip) && MayDefine(ip, regno) && OperReg(ip->oper1, regno))
+				return (-1);
+			uses[nuses++] = ip;
+		}
+		if (MayDefine(ip, regno))
+			return (nuses);
+		if (ivreg >= 0 && MayDefine(ip, ivreg))
+			stepped = true;
+	}
+	return (def->bb->LiveOut->isMember(regno) ? -1 : nuses);
+}
+
+// Instructions that only compute a value from their operands, so that they
+// can be executed more often than they were without any effect other than
+// on their target register.
+
+bool IsPure(OCODE *ip)
+{
+	switch(ip->opcode) {
+	case op_add:	case op_addu:	case op_sub:	case op_subu:
+	case op_and:	case op_or:		case op_xor:	case op_eor:
+	case op_shl:	case op_shlu:	case op_shr:	case op_shru:
+	case op_asl:	case op_asr:	case op_ror:	case op_rol:
+	case op_mul:	case op_mulu:
+	case op_com:	case op_not:	case op_neg:
+	case op_sxb:	case op_sxc:	case op_sxh:
+	case op_zxb:	case op_zxc:	case op_zxh:
+	case op_ldi:	case op_mov:	case op_lea:
+		break;
+	default:
+		return (false);
+	}
+	if (ip->oper1==nullptr || ip->oper1->mode != am_reg)
+		return (false);
+	if (ip->oper1->preg==0 || ip->oper1->preg==regSP || ip->oper1->preg==regFP
+		|| ip->oper1->preg==regLR || ip->oper1->preg==regGP)
+		return (false);
+	return (true);
+}
+
+// Check that none of the registers an instruction reads are changed in the
+// loop.
+
+static bool IsInvariant(Loop *lp, OCODE *ip)
+{
+	AMODE *ops[3];
+	int nn;
+
+	ops[0] = ip->oper2;
+	ops[1] = ip->oper3;
+	ops[2] = ip->oper4;
+	for (nn = 0; nn < 3; nn++) {
+		if (ops[nn]==nullptr)
+			continue;
+		switch(ops[nn]->mode) {
+		case am_reg:
+		case am_ind:
+		case am_indx:
+			if (lp->CountDefs(ops[nn]->preg) > 0)
+				return (false);
+			break;
+		case am_indx2:
+		case am_indx3:
+			if (lp->CountDefs(ops[nn]->preg) > 0 || lp->CountDefs(ops[nn]->sreg) > 0)
+				return (false);
+			break;
+		case am_immed:
+		case am_direct:
+			break;
+		default:
+			return (false);
+		}
+	}
+	return (true);
+}
+
+// Move an instruction in front of the loop. If its target register is only
+// set by this instruction, isn't used before it's set on a trip around the
+// loop and isn't used after the loop, the instruction can be moved as it
+// is. Otherwise the value is moved into a free register for the uses that
+// follow in the block.
+
+static bool HoistInsn(Loop *lp, OCODE *ip)
+{
+	OCODE *uses[LOOP_MAXUSES];
+	int regno, newreg, nuses, nn;
+
+	regno = ip->oper1->preg;
+	if (lp->CountDefs(regno)==1 && !lp->head->LiveIn->isMember(regno) && !lp->IsLiveOut(regno)) {
+		Unlink(ip);
+		InsertEntry(lp, ip);
+		DTRACE(TRC_LOOP).printf("<Hoist>%s r%d</Hoist>\n", ip->insn->mnem, regno);
+		return (true);
+	}
+	nuses = FindLocalUses(ip, -1, uses);
+	if (nuses < 0)
+		return (false);
+	newreg = GetFreeReg();
+	if (newreg < 0)
+		return (false);
+	for (nn = 0; nn < nuses; nn++)
+		RenameUses(uses[nn], regno, newreg);
+	Unlink(ip);
+	ip->oper1 = copy_addr(ip->oper1);
+	ip->oper1->preg = newreg;
+	InsertEntry(lp, ip);
+	DTRACE(TRC_LOOP).printf("<Hoist>%s", ip->insn->mnem);
+	DTRACE(TRC_LOOP).printf(" r%d as r%d</Hoist>\n", regno, newreg);
+	return (true);
+}
+
+// Move the loop invariant instructions in front of the loop. Once an
+// instruction has been moved, the ones using its value may become
+// invariant, so the loop is looked at again.
+
+bool Loop::Hoist()
+{
+	BasicBlock *b;
+	OCODE *ip, *ip2;
+	bool changed, moved;
+	int nn;
+
+	changed = false;
+	do {
+		moved = false;
+		for (nn = blocks->firstMember(); nn >= 0; nn = blocks->nextMember(nn)) {
+			b = basicBlocks[nn];
+			for (ip = b->code; ip && ip->bb==b; ip = ip2) {
+				ip2 = ip->fwd;
+				if (!IsPure(ip) || !IsInvariant(this, ip))
+					continue;
+				if (HoistInsn(this, ip)) {
+					loopChanges++;
+					moved = changed = true;
+				}
+			}
+		}
+	} while (moved);
+	return (changed);
+}
+
+static bool IsImmedStep(OCODE *ip, int regno)
+{
+	return ((ip->opcode==op_add || ip->opcode==op_sub)
+		&& ip->oper1->mode==am_reg && ip->oper1->preg==regno
+		&& ip->oper2 && ip->oper2->mode==am_reg && ip->oper2->preg==regno
+		&& ip->oper3 && ip->oper3->mode==am_immed && ip->oper3->offset);
+}
+
+// Find the instruction stepping an induction variable. The variable must
+// be set only by adding or subtracting a constant.
+
+static OCODE *FindStep(Loop *lp, int regno)
+{
+	BasicBlock *b;
+	OCODE *ip, *step;
+	int nn;
+
+	step = nullptr;
+	for (nn = lp->blocks->firstMember(); nn >= 0; nn = lp->blocks->nextMember(nn)) {
+		b = basicBlocks[nn];
+		FOR_BLOCK(ip, b) {
+			if (!MayDefine(ip, regno))
+				continue;
+			if (step || !IsImmedStep(ip, regno))
+				return (nullptr);
+			step = ip;
+		}
+	}
+	return (step);
+}
+
+static int64_t StepOf(OCODE *step)
+{
+	return (step->opcode==op_sub ? -step->oper3->offset->i : step->oper3->offset->i);
+}
+
+// Replace a multiply of an induction variable by a constant with a register
+// that is set before the loop and increased whenever the variable is
+// stepped. The uses of the product have to follow the multiply in its block
+// with the variable not stepped in between.
+
+bool Loop::StrengthReduce()
+{
+	BasicBlock *b;
+	OCODE *ip, *step, *cd;
+	OCODE *uses[LOOP_MAXUSES];
+	int nn, mm, nuses, regno, ivreg, newreg;
+	int64_t k;
+
+	for (nn = blocks->firstMember(); nn >= 0; nn = blocks->nextMember(nn)) {
+		b = basicBlocks[nn];
+		FOR_BLOCK(ip, b) {
+			if (ip->opcode != op_mul && ip->opcode != op_mulu)
+				continue;
+			if (!IsPure(ip) || ip->oper2==nullptr || ip->oper2->mode != am_reg)
+				continue;
+			if (ip->oper3==nullptr || ip->oper3->mode != am_immed || ip->oper3->offset==nullptr)
+				continue;
+			ivreg = ip->oper2->preg;
+			regno = ip->oper1->preg;
+			if (ivreg==regno || (step = FindStep(this, ivreg))==nullptr)
+				continue;
+			nuses = FindLocalUses(ip, ivreg, uses);
+			if (nuses < 0)
+				continue;
+			newreg = GetFreeReg();
+			if (newreg < 0)
+				return (false);
+			k = ip->oper3->offset->i;
+			cd = CopyInsn(ip);
+			cd->oper1->preg = newreg;
+			InsertEntry(this, cd);
+			cd = MakeInsn(op_add, makereg(newreg), makereg(newreg), make_immed(StepOf(step) * k), step->loop_depth);
+			Peep::InsertAfter(step, cd);
+			cd->bb = step->bb;
+			for (mm = 0; mm < nuses; mm++)
+				RenameUses(uses[mm], regno, newreg);
+			RemoveInsn(ip);
+			DTRACE(TRC_LOOP).printf("<StrengthReduce>r%d", ivreg);
+			DTRACE(TRC_LOOP).printf("*%lld", k);
+			DTRACE(TRC_LOOP).printf(" as r%d</StrengthReduce>\n", newreg);
+			loopChanges++;
+			return (true);
+		}
+	}
+	return (false);
+}
+
+// Evaluate the condition of a branch comparing a value with zero.
+
+static bool BranchTaken(int op, int64_t v)
+{
+	switch(op) {
+	case op_beq:	return (v==0);
+	case op_bne:	return (v!=0);
+	case op_blt:	return (v < 0);
+	case op_bge:	return (v >= 0);
+	case op_ble:	return (v <= 0);
+	case op_bgt:	return (v > 0);
+	}
+	return (false);
+}
+
+// Find the constant an induction variable is set to before the loop. It
+// must be loaded in the block the loop is entered from.
+
+static bool FindInitial(Loop *lp, int regno, int64_t *init)
+{
+	OCODE *ip;
+
+	for (ip = lp->entry->back; ip && ip->bb==lp->head->prev; ip = ip->back) {
+		if (ip->opcode==op_label || IsBasicBlockSeparater(ip))
+			return (false);
+		if (MayDefine(ip, regno)) {
+			if (ip->opcode != op_ldi || ip->oper2==nullptr || ip->oper2->mode != am_immed
+				|| ip->oper2->offset==nullptr || ip->oper2->offset->nodetype != en_icon)
+				return (false);
+			*init = ip->oper2->offset->i;
+			return (true);
+		}
+	}
+	return (false);
+}
+
+// Unroll a loop that is tested at the top and goes around a small constant
+// number of times. The loop must be a header that compares the induction
+// variable with a constant and branches out, followed by a body of
+// straight line code that steps the variable and branches back. The body is
+// copied once for each trip and the test and branches are dropped.
+
+bool Loop::Unroll()
+{
+	BasicBlock *body, *exit;
+	OCODE *ip, *ip2, *cmp, *br, *step;
+	int64_t lim, val, trips, count;
+	int ivreg, cmpreg;
+	bool isUnsigned;
+
+	if (blocks->NumMember() != 2)
+		return (false);
+	body = head->next;
+	if (body==nullptr || !Contains(body) || body->next==nullptr)
+		return (false);
+	exit = body->next;
+	// Header: label, optional compare, branch out of the loop.
+	ip = head->code->fwd;
+	if (ip==nullptr || ip->bb != head)
+		return (false);
+	cmp = nullptr;
+	cmpreg = -1;
+	isUnsigned = false;
+	if (ip->opcode==op_cmp || ip->opcode==op_cmpu) {
+		cmp = ip;
+		if (cmp->oper2==nullptr || cmp->oper2->mode != am_reg)
+			return (false);
+		if (cmp->oper3==nullptr || cmp->oper3->mode != am_immed || cmp->oper3->offset==nullptr)
+			return (false);
+		ivreg = cmp->oper2->preg;
+		cmpreg = cmp->oper1->preg;
+		lim = cmp->oper3->offset->i;
+		isUnsigned = cmp->opcode==op_cmpu;
+		ip = ip->fwd;
+	}
+	br = ip;
+	if (br==nullptr || br != head->lcode || BranchTarget(br) < 0)
+		return (false);
+	if (br->oper1==nullptr || br->oper1->mode != am_reg || br->oper2==nullptr
+		|| br->oper2->mode != am_reg || br->oper2->preg != 0)
+		return (false);
+	if (cmp) {
+		if (br->oper1->preg != cmpreg)
+			return (false);
+		if (body->LiveIn->isMember(cmpreg) || exit->LiveIn->isMember(cmpreg))
+			return (false);
+	}
+	else {
+		ivreg = br->oper1->preg;
+		lim = 0;
+	}
+	if (exit->code==nullptr || exit->code->opcode != op_label
+		|| LabelNumber(exit->code) != BranchTarget(br))
+		return (false);
+	// Body: straight line code stepping the variable once and branching back.
+	if (body->code==nullptr || body->code->opcode==op_label || body->lcode==nullptr)
+		return (false);
+	if (body->lcode->opcode != op_bra || BranchTarget(body->lcode) != LabelNumber(head->code))
+		return (false);
+	if ((step = FindStep(this, ivreg))==nullptr || step->bb != body)
+		return (false);
+	if (!FindInitial(this, ivreg, &val))
+		return (false);
+	count = 0;
+	FOR_BLOCK(ip, body)
+		count++;
+	count--;
+	// Count the trips around the loop.
+	for (trips = 0; ; trips++) {
+		if (cmp && isUnsigned) {
+			if (BranchTaken(br->opcode, (uint64_t)val < (uint64_t)lim ? -1 : val==lim ? 0 : 1))
+				break;
+		}
+		else if (BranchTaken(br->opcode, val < lim ? -1 : val==lim ? 0 : 1))
+			break;
+		if (trips >= LOOP_MAXTRIP || (trips + 1) * count > LOOP_MAXUNROLL)
+			return (false);
+		val += StepOf(step);
+	}
+	for (; trips > 0; trips--) {
+		FOR_BLOCK(ip, body) {
+			if (ip != body->lcode)
+				Peep::InsertBefore(head->code, CopyInsn(ip));
+		}
+	}
+	for (ip = head->code; ip && ip != exit->code; ip = ip2) {
+		ip2 = ip->fwd;
+		RemoveInsn(ip);
+	}
+	DTRACE(TRC_LOOP).printf("<Unroll>%lld instructions</Unroll>\n", count);
+	loopChanges++;
+	return (true);
+}
+
+// Loop optimizations for the function's code.
+
+void Loop::Optimize()
+{
+	Loop *lp;
+	CSet *touched;
+	int round;
+	bool changed;
+
+	if (currentFn->IsInterrupt || currentFn->IsNocall)
+		return;
+	regsUsed = CSet::MakeNew();
+	touched = CSet::MakeNew();
+	loopChanges = 0;
+	for (round = 0; round < LOOP_MAXROUNDS; round++) {
+		RootBlock = BasicBlock::Blockize(peep_head);
+		CFG::Create();
+		ComputeLiveVars();
+		CFG::CalcDominatorTree();
+		FindLoops();
+		FindRegsUsed();
+		changed = false;
+		touched->clear();
+		for (lp = loops; lp; lp = lp->next) {
+			if (lp->blocks->isIntersecting(*touched))
+				continue;
+			if (!lp->IsSafe() || (lp->entry = FindEntry(lp))==nullptr)
+				continue;
+			if (lp->Hoist() || lp->StrengthReduce() || lp->Unroll()) {
+				touched->add(lp->blocks);
+				touched->add(lp->head->prev->num);
+				changed = true;
+			}
+		}
+		if (!changed)
+			break;
+	}
+	DTRACE(TRC_LOOP).printf("<LoopChanges>%s %d</LoopChanges>\n",
+		(char *)currentFn->name->c_str(), loopChanges);
+}
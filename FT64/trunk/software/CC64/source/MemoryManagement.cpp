@@ -45,147 +45,192 @@
  *		Norcross, Ga 30092
  */
 
-#define BLKSIZE		4000
+// Chunks start at 64kB and double up to 4MB. A request larger than the
+// chunk size gets a chunk of its own.
 
-struct blk {
-	char name[8];			// string overwrite area
-    struct blk *next;
-    char       m[1];           /* memory area */
+#define CHUNKMIN	65536
+#define CHUNKMAX	4194304
+
+struct ArenaChunk {
+	ArenaChunk *next;
+	int size;				// bytes available in m[]
+	int used;
+	int clean;				// m[] is zero from here on
+	int pad;
+	char m[8];
 };
 
-MBlk *MBlk::first = 0;
+Arena Arena::file;
+Arena Arena::func;
+
+static const char *memKindName[MEM_LAST] = {
+	"misc", "parse", "symbols", "literals", "code", "optimizer"
+};
+static int64_t memCalls[MEM_LAST];
+static int64_t memBytes[MEM_LAST];
+
+void Arena::NewChunk(int sz)
+{
+	ArenaChunk *cp, **pp;
+
+	// First look for a chunk given back by Release() that is big enough.
+	for (pp = &spare; *pp; pp = &(*pp)->next) {
+		if ((*pp)->size >= sz) {
+			cp = *pp;
+			*pp = cp->next;
+			cp->used = 0;
+			cp->next = head;
+			head = cp;
+			return;
+		}
+	}
+	if (chunksize < CHUNKMIN)
+		chunksize = CHUNKMIN;
+	if (sz < chunksize)
+		sz = chunksize;
+	cp = (ArenaChunk *)calloc(1, sizeof(ArenaChunk) + sz);
+	if (cp == nullptr) {
+		printf(" not enough memory.\n");
+		exit(1);
+	}
+	cp->size = sz;
+	if (chunksize < CHUNKMAX)
+		chunksize *= 2;
+	nbytes += sz;
+	if (nbytes > peak)
+		peak = nbytes;
+	cp->next = head;
+	head = cp;
+}
+
+void *Arena::alloc(int sz)
+{
+	char *p;
+	int cls;
+
+	sz = (sz + 7) & ~7;		// align word
+	cls = sz >> 3;
+	if (cls < 64 && freelist[cls]) {
+		p = (char *)freelist[cls];
+		freelist[cls] = *(void **)p;
+		ZeroMemory(p, sz);
+		return (p);
+	}
+	if (head == nullptr || head->size - head->used < sz)
+		NewChunk(sz);
+	p = &head->m[head->used];
+	// Memory that was used before a release has to be cleared again.
+	if (head->used < head->clean)
+		ZeroMemory(p, min(sz, head->clean - head->used));
+	head->used += sz;
+	if (head->used > head->clean)
+		head->clean = head->used;
+	return (p);
+}
 
-void *allocx(int sz)
+// Small blocks are kept on a list for their size and handed out again by
+// alloc(). Larger blocks are simply left until the arena is released.
+
+void Arena::free(void *p, int sz)
 {
-	return MBlk::alloc(sz);
+	int cls;
+
+	sz = (sz + 7) & ~7;
+	cls = sz >> 3;
+	if (p == nullptr || cls >= 64)
+		return;
+	*(void **)p = freelist[cls];
+	freelist[cls] = p;
 }
 
-void *MBlk::alloc(int sz)
+ArenaMark Arena::Mark()
 {
-//  dfs.printf("Enter MBlk::alloc()\n");
-	MBlk *p = (MBlk *)new char[sz+sizeof(MBlk)+15];
-	if (p==0)
-	   return p;
-	ZeroMemory((void *)p,sz+sizeof(MBlk));
-	p->next = first;
-	first = p;
-//  dfs.printf("Leave MBlk::alloc()\n");
-	return &p[1];
+	ArenaMark mk;
+
+	mk.chunk = head;
+	mk.used = head ? head->used : 0;
+	return (mk);
 }
 
-void MBlk::ReleaseAll()
+void Arena::Release(ArenaMark mk)
 {
-	MBlk *mbk;
-	while (first) {
-		mbk = first->next;
-		delete[] first;
-		first = mbk;
+	ArenaChunk *cp;
+
+	while (head && head != mk.chunk) {
+		cp = head;
+		head = cp->next;
+		cp->next = spare;
+		spare = cp;
 	}
+	if (head)
+		head->used = mk.used;
+	// Blocks on the free lists may be in the released memory.
+	ZeroMemory(freelist, sizeof(freelist));
 }
 
-static int      glbsize = 0,    /* size left in current global block */
-                locsize = 0,    /* size left in current local block */
-                glbindx = 0,    /* global index */
-                locindx = 0;    /* local index */
-
-static struct blk       *locblk = 0,    /* pointer to local block */
-                        *glbblk = 0;    /* pointer to global block */
-
-char    *xalloc(int siz)
-{   
-	struct blk *bp;
-    char       *rv;
-
-	while(siz % 8)	// align word
-		siz++;
-    if( global_flag ) {
-        if( glbsize >= siz ) {
-            rv = &(glbblk->m[glbindx]);
-            glbsize -= siz;
-            glbindx += siz;
-            return rv;
-        }
-        else {
-            bp = (struct blk *)calloc(1,sizeof(struct blk) + BLKSIZE);
-			if( bp == (struct blk *)NULL )
-			{
-				printf(" not enough memory.\n");
-				exit(1);
-			}
-			strcpy_s(bp->name,8,"C64    ");
-            bp->next = glbblk;
-            glbblk = bp;
-            glbsize = BLKSIZE - siz;
-            glbindx = siz;
-            return glbblk->m;
-        }
-    }
-    else    {
-        if( locsize >= siz ) {
-            rv = &(locblk->m[locindx]);
-            locsize -= siz;
-            locindx += siz;
-            return rv;
-        }
-        else {
-            bp = (struct blk *)calloc(1,sizeof(struct blk) + BLKSIZE);
-			if( bp == NULL )
-			{
-				printf(" not enough local memory.\n");
-				exit(1);
-			}
-			strcpy_s(bp->name,8,"C64    ");
-            bp->next = locblk;
-            locblk = bp;
-            locsize = BLKSIZE - siz;
-            locindx = siz;
-            return locblk->m;
-        }
-    }
+void Arena::ReleaseAll()
+{
+	ArenaChunk *cp;
+
+	while (head) {
+		cp = head->next;
+		::free(head);
+		head = cp;
+	}
+	while (spare) {
+		cp = spare->next;
+		::free(spare);
+		spare = cp;
+	}
+	ZeroMemory(freelist, sizeof(freelist));
+	chunksize = 0;
+	nbytes = 0;
+}
+
+// Code and optimizer data are allocated from the function arena, which is
+// released once the function's code has been output.
+
+void *allocx(int sz, int kind)
+{
+	memCalls[kind]++;
+	memBytes[kind] += sz;
+	if (kind==MEM_CODE || kind==MEM_OPT)
+		return (Arena::func.alloc(sz));
+	return (Arena::file.alloc(sz));
+}
+
+char *xalloc(int siz)
+{
+	return ((char *)allocx(siz, MEM_PARSE));
+}
+
+static void DumpMemoryStats()
+{
+	int nn;
+
+	printf("\n memory allocated:\n");
+	for (nn = 0; nn < MEM_LAST; nn++)
+		printf("   %-10s %10lld calls %12lld bytes\n", memKindName[nn], (long long)memCalls[nn], (long long)memBytes[nn]);
+	printf("   largest file arena %lld bytes, function arena %lld bytes\n", (long long)Arena::file.peak, (long long)Arena::func.peak);
 }
 
 void ReleaseLocalMemory()
 {
-	struct blk      *bp1, *bp2;
-    int             blkcnt;
-    blkcnt = 0;
-    bp1 = locblk;
-    while( bp1 != NULL ) {
-		if (strcmp(bp1->name,"C64    "))
-			printf("Block corrupted.");
-        bp2 = bp1->next;
-        free( bp1 );
-        ++blkcnt;
-        bp1 = bp2;
-    }
-    locblk = (struct blk *)NULL;
-    locsize = 0;
+	Arena::func.ReleaseAll();
 	currentStmt = (Statement *)NULL;
-	if (verbose) printf(" releasing %d bytes local tables.\n",blkcnt * BLKSIZE);
 }
 
 void ReleaseGlobalMemory()
 {
-	struct blk      *bp1, *bp2;
-  int             blkcnt;
-
   dfs.printf("Enter ReleaseGlobalMemory\n");
-  bp1 = glbblk;
-  blkcnt = 0;
-  while( bp1 != (struct blk *)NULL ) {
-		if (strcmp(bp1->name,"C64    "))
-		  dfs.printf("Block corrupted.");
-    bp2 = bp1->next;
-    free(bp1);
-    ++blkcnt;
-    bp1 = bp2;
-  }
-  glbblk = (struct blk *)NULL;
-  glbsize = 0;
+	if (verbose)
+		DumpMemoryStats();
+	ReleaseLocalMemory();
+	Arena::file.ReleaseAll();
 //    gsyms.head = NULL;         /* clear global symbol table */
 //	gsyms.tail = NULL;
 	memset(gsyms,0,sizeof(gsyms));
-	if (verbose) printf(" releasing %d bytes global tables.\n",blkcnt * BLKSIZE);
+	SymbolIndex::Clear();
     strtab = (struct slit *)NULL;             /* clear literal table */
  dfs.printf("Leave ReleaseGlobalMemory\n");
 }
@@ -230,10 +275,10 @@ TYP *allocTYP()
 Statement *allocSnode() { return (Statement *)xalloc(sizeof(Statement)); };
 ENODE *allocEnode() {
   ENODE *p;
-  p = (ENODE *)allocx(sizeof(ENODE));
+  p = (ENODE *)allocx(sizeof(ENODE), MEM_PARSE);
   p->sp = new std::string();
   return p;
 };
-AMODE *allocAmode() { return (AMODE *)xalloc(sizeof(AMODE)); };
+AMODE *allocAmode() { return (AMODE *)allocx(sizeof(AMODE), MEM_CODE); };
 CSE *allocCSE() { return (CSE *)xalloc(sizeof(CSE)); };
 
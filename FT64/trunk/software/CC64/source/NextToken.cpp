@@ -98,9 +98,16 @@ int getline(int listflag)
     }
     ++lineno;
 	memset(inpline, 0, sizeof(inpline));
-    ifs->getline(inpline,512);
+	// Files included by the compiler itself are read directly.
+	if (extfpp || incldepth > 0) {
+		ifs->getline(inpline,512);
+		rv = ifs->gcount()==0;
+	}
+	else if (Pch::Replaying())
+		rv = Pch::GetLine(inpline,512)==0;
+	else
+		rv = fppGetLine(inpline,512)==0;
 	strcat_s(inpline,sizeof(inpline),"\n");
-	rv = ifs->gcount()==0;
 	//printf("line:%.60s\r\n", inpline);
     if( rv && incldepth > 0 ) {
         ifs->close();
@@ -468,7 +475,7 @@ restart:        /* we come back here after comments */
 	SkipSpaces();
   if( lastch == -1) {
     lastst = my_eof;
-    dfs.printf("Returning EOF from NextToken.\n");
+    DTRACE(TRC_PARSE).printf("Returning EOF from NextToken.\n");
   }
   else if(isdigit(lastch)) {
     getnum();
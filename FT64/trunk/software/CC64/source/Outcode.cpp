@@ -45,62 +45,64 @@ struct oplst {
         int     ov;
         };
 
+// The latency and unit fields are used by the instruction scheduler. An
+// instruction with no latency given is never moved.
 Instruction opl[] =
 {   
-	{"mov", op_mov,1,true},
+	{"mov", op_mov,1,true,false,1,fu_alu},
 	{"move",op_move,1,true},
-	{"add",op_add,1,true},
-	{"addu", op_addu,1,true},
-	{"ldi",op_ldi,1,true},
-	{"addi",op_addi,1,true},
-	{"lw", op_lw,4,true,true},
-	{"sw", op_sw,4,false,true},
+	{"add",op_add,1,true,false,1,fu_alu},
+	{"addu", op_addu,1,true,false,1,fu_alu},
+	{"ldi",op_ldi,1,true,false,1,fu_alu},
+	{"addi",op_addi,1,true,false,1,fu_alu},
+	{"lw", op_lw,4,true,true,4,fu_mem},
+	{"sw", op_sw,4,false,true,1,fu_mem},
 	{"call", op_call,4,true,true},
 	{"ret", op_ret,1,false},
-	{"sub",op_sub,1,true},
-	{"subu", op_subu,1,true},
-	{"subi",op_subi,1,true},
-	{"and",op_and,1,true},
-	{"andi", op_andi,1,true},
-	{"or",op_or,1,true},
-	{"ori",op_ori,1,true},
-	{"eor",op_eor,1,true},
-	{"eori", op_eori,1,true},
-	{"xor",op_xor,1,true},
-	{"xori", op_xori,1,true},
-	{"divi", op_divi,68,true},
-	{"modi", op_modi,68,true},
-	{"modui", op_modui,68,true},
-	{"div", op_div,68,true}, 
+	{"sub",op_sub,1,true,false,1,fu_alu},
+	{"subu", op_subu,1,true,false,1,fu_alu},
+	{"subi",op_subi,1,true,false,1,fu_alu},
+	{"and",op_and,1,true,false,1,fu_alu},
+	{"andi", op_andi,1,true,false,1,fu_alu},
+	{"or",op_or,1,true,false,1,fu_alu},
+	{"ori",op_ori,1,true,false,1,fu_alu},
+	{"eor",op_eor,1,true,false,1,fu_alu},
+	{"eori", op_eori,1,true,false,1,fu_alu},
+	{"xor",op_xor,1,true,false,1,fu_alu},
+	{"xori", op_xori,1,true,false,1,fu_alu},
+	{"divi", op_divi,68,true,false,68,fu_div},
+	{"modi", op_modi,68,true,false,68,fu_div},
+	{"modui", op_modui,68,true,false,68,fu_div},
+	{"div", op_div,68,true,false,68,fu_div}, 
 	{"subui",op_subui},
-	{"shru", op_shru,2,true},
-	{"divsi", op_divsi,68,true},
-	{"not", op_not,2,true},
-	{"addui",op_addui,1,true},
+	{"shru", op_shru,2,true,false,1,fu_alu0},
+	{"divsi", op_divsi,68,true,false,68,fu_div},
+	{"not", op_not,2,true,false,1,fu_alu},
+	{"addui",op_addui,1,true,false,1,fu_alu},
 	{"dw", op_dw},
-	{"bfext", op_bfext,2,true},
-	{"bfextu", op_bfextu,2,true},
-	{"bfins", op_bfins,2,true},
-	{"lh", op_lh,4,true,true},
-	{"lc", op_lc,4,true,true},
-	{"lb", op_lb,4,true,true},
-	{"lbu", op_lbu,4,true,true},
-	{"lcu", op_lcu,4,true,true},
-	{"lhu", op_lhu,4,true,true},
+	{"bfext", op_bfext,2,true,false,1,fu_alu0},
+	{"bfextu", op_bfextu,2,true,false,1,fu_alu0},
+	{"bfins", op_bfins,2,true,false,1,fu_alu0},
+	{"lh", op_lh,4,true,true,4,fu_mem},
+	{"lc", op_lc,4,true,true,4,fu_mem},
+	{"lb", op_lb,4,true,true,4,fu_mem},
+	{"lbu", op_lbu,4,true,true,4,fu_mem},
+	{"lcu", op_lcu,4,true,true,4,fu_mem},
+	{"lhu", op_lhu,4,true,true,4,fu_mem},
 	{"sti", op_sti},
 	{"lft", op_lft},
 	{"sft", op_sft},
 
 	{"lws", op_lws}, {"sws", op_sws},
 	{"lm", op_lm}, {"sm",op_sm},
-	{"sb",op_sb,4,false,true},
-	{"sc",op_sc,4,false,true},
-	{"sh",op_sh,4,false,true},
+	{"sb",op_sb,4,false,true,1,fu_mem},
+	{"sc",op_sc,4,false,true,1,fu_mem},
+	{"sh",op_sh,4,false,true,1,fu_mem},
 	{"loop", op_loop},
 	{"jal", op_jal,1,true},
 
-	{"cmp",op_cmp,1,true},
-	{"cmpu",op_cmpu,1,true},
+	{"cmp",op_cmp,1,true,false,1,fu_alu},
+	{"cmpu",op_cmpu,1,true,false,1,fu_alu},
 	// Branches
 	// Branches weighted as 3 because they might cause a pipeline flush
 	{"beq", op_beq,3,false},
@@ -123,36 +125,36 @@ Instruction opl[] =
 	{"swc", op_swc,4,false,true},
 	{"cache",op_cache},
 	{"iret", op_iret,2},
-	{"mul",op_mul,18,true}, {"muli", op_muli,18,true}, {"mului", op_mului,18,true}, 
+	{"mul",op_mul,18,true,false,18,fu_mul}, {"muli", op_muli,18,true,false,18,fu_mul}, {"mului", op_mului,18,true,false,18,fu_mul}, 
 		
 		{"fmul", op_fdmul}, {"fdiv", op_fddiv}, {"fadd", op_fdadd}, {"fsub", op_fdsub}, {"fcmp", op_fcmp},
 		{"fmul.s", op_fsmul}, {"fdiv.s", op_fsdiv}, {"fadd.s", op_fsadd}, {"fsub.s", op_fssub},
 		{"fs2d", op_fs2d}, {"fi2d", op_i2d}, {"fneg", op_fneg}, 
 
-		{"divs",op_divs,68,true}, {"swap",op_swap,1,true}, {"mod", op_mod,68,true}, {"modu", op_modu,68,true},
+		{"divs",op_divs,68,true,false,68,fu_div}, {"swap",op_swap,1,true}, {"mod", op_mod,68,true,false,68,fu_div}, {"modu", op_modu,68,true,false,68,fu_div},
 		{"eq",op_eq}, {"bnei", op_bnei}, {"sei", op_sei,1},
 		{"ltu", op_ltu}, {"leu",op_leu}, {"gtu",op_gtu}, {"geu", op_geu},
                 {"bhi",op_bhi}, {"bhs",op_bhs}, {"blo",op_blo}, {"bun", op_bun},
-                {"bls",op_bls}, {"mulu",op_mulu}, {"divu",op_divu},
+                {"bls",op_bls}, {"mulu",op_mulu,18,true,false,18,fu_mul}, {"divu",op_divu,68,true,false,68,fu_div},
                 {"ne",op_ne}, {"lt",op_lt}, {"le",op_le},
-		{"gt",op_gt}, {"ge",op_ge}, {"neg",op_neg}, {"nr", op_nr},
-	{"not",op_not,2,true},
-	{"com", op_com,2,true},
+		{"gt",op_gt}, {"ge",op_ge}, {"neg",op_neg,1,true,false,1,fu_alu}, {"nr", op_nr},
+	{"not",op_not,2,true,false,1,fu_alu},
+	{"com", op_com,2,true,false,1,fu_alu},
 	{"ext",op_ext}, 
 	{"jmp",op_jmp,1,false},
-	{"lea",op_lea,1,true},
+	{"lea",op_lea,1,true,false,1,fu_alu},
 
                 {"link",op_link,4,true,true}, {"unlink",op_unlk,4,true,true},
                 {"br",op_br,3,false}, {"bra",op_bra,3,false}, {"pea",op_pea},
-				{"cmpi",op_cmpi,1,true}, {"tst",op_tst,1,true},
+				{"cmpi",op_cmpi,1,true,false,1,fu_alu}, {"tst",op_tst,1,true},
 		{"stop", op_stop}, {"movs", op_movs},
 		{"bmi", op_bmi},
 				{"dc",op_dc},
 		{"push",op_push,4,true,true}, {"pop", op_pop,4,true,true}, {"pea", op_pea},
 		// Set
-		{"seq", op_seq,1,true}, {"sne",op_sne,1,true},
-		{"slt", op_slt,1,true}, {"sle",op_sle,1,true},{"sgt",op_sgt,1,true}, {"sge",op_sge,1,true},
-		{"sltu", op_sltu,1,true}, {"sleu",op_sleu,1,true},{"sgtu",op_sgtu,1,true}, {"sgeu",op_sgeu,1,true},
+		{"seq", op_seq,1,true,false,1,fu_alu}, {"sne",op_sne,1,true,false,1,fu_alu},
+		{"slt", op_slt,1,true,false,1,fu_alu}, {"sle",op_sle,1,true,false,1,fu_alu},{"sgt",op_sgt,1,true,false,1,fu_alu}, {"sge",op_sge,1,true,false,1,fu_alu},
+		{"sltu", op_sltu,1,true,false,1,fu_alu}, {"sleu",op_sleu,1,true,false,1,fu_alu},{"sgtu",op_sgtu,1,true,false,1,fu_alu}, {"sgeu",op_sgeu,1,true,false,1,fu_alu},
 
 		{"",op_empty}, {"",op_asm,100}, {"", op_fnname},
 		{"ftadd", op_ftadd}, {"ftsub", op_ftsub}, {"ftmul", op_ftmul}, {"ftdiv", op_ftdiv},
@@ -162,14 +164,14 @@ Instruction opl[] =
 
 	// Shifts
 	// Shifts are weighted as 2 because they can only execute on one ALU
-	{"asr",op_asr,2,true}, {"asri", op_asri,2,true },
-	{"shl", op_shl,2,true}, {"shr", op_shr,2,true}, {"shru", op_shru,2,true},
-	{"shlu", op_shlu,2,true}, {"shlui", op_shlui,2,true},
-	{"shli", op_shli,2,true}, {"shri", op_shri,2,true}, {"shrui", op_shrui,2,true},
-	{"ror", op_ror,2,true}, {"rori", op_rori,2,true}, {"rol", op_rol,2,true}, {"roli", op_roli,2,true},
-	{"sll", op_sll,2,true}, {"slli", op_slli,2,true}, {"srl", op_srl,2,true}, {"srli", op_srli,2,true},
-	{"sra", op_sra,2,true}, {"srai", op_srai,2,true},
-	{"asl", op_asl,2,true}, {"asli", op_asli,2,true}, {"lsr", op_lsr,2,true}, {"lsri", op_lsri,2,true},
+	{"asr",op_asr,2,true,false,1,fu_alu0}, {"asri", op_asri,2,true,false,1,fu_alu0 },
+	{"shl", op_shl,2,true,false,1,fu_alu0}, {"shr", op_shr,2,true,false,1,fu_alu0}, {"shru", op_shru,2,true,false,1,fu_alu0},
+	{"shlu", op_shlu,2,true,false,1,fu_alu0}, {"shlui", op_shlui,2,true,false,1,fu_alu0},
+	{"shli", op_shli,2,true,false,1,fu_alu0}, {"shri", op_shri,2,true,false,1,fu_alu0}, {"shrui", op_shrui,2,true,false,1,fu_alu0},
+	{"ror", op_ror,2,true,false,1,fu_alu0}, {"rori", op_rori,2,true,false,1,fu_alu0}, {"rol", op_rol,2,true,false,1,fu_alu0}, {"roli", op_roli,2,true,false,1,fu_alu0},
+	{"sll", op_sll,2,true,false,1,fu_alu0}, {"slli", op_slli,2,true,false,1,fu_alu0}, {"srl", op_srl,2,true,false,1,fu_alu0}, {"srli", op_srli,2,true,false,1,fu_alu0},
+	{"sra", op_sra,2,true,false,1,fu_alu0}, {"srai", op_srai,2,true,false,1,fu_alu0},
+	{"asl", op_asl,2,true,false,1,fu_alu0}, {"asli", op_asli,2,true,false,1,fu_alu0}, {"lsr", op_lsr,2,true,false,1,fu_alu0}, {"lsri", op_lsri,2,true,false,1,fu_alu0},
 		
 		{"chk", op_chk }, {"chki",op_chki}, {";", op_rem},
 
@@ -188,12 +190,12 @@ Instruction opl[] =
 		{"hint", op_hint,0}, {"hint2",op_hint2,0},
 		{"abs", op_abs,2},
 	// Vector operations
-	{"lv", op_lv,256,true}, {"sv", op_sv,256,true},
+	{"lv", op_lv,256,false,true}, {"sv", op_sv,256,false,true},
 	{"vadd", op_vadd,10}, {"vsub", op_vsub,10}, {"vmul", op_vmul,10}, {"vdiv", op_vdiv,100},
 	{"vseq", op_vseq,10}, {"vsne", op_vsne,10},
 	{"vslt", op_vslt,10}, {"vsge", op_vsge,10}, {"vsle", op_vsle,10}, {"vsgt", op_vsgt,10},
 	{"vadds", op_vadds,10}, {"vsubs", op_vsubs,10}, {"vmuls", op_vmuls,10}, {"vdivs", op_vdivs,100},
-	{"vex", op_vex,10}, {"veins",op_veins,10},
+	{"vex", op_vex,10}, {"veins",op_veins,10}, {"vmov", op_vmov,1},
 	{"redor", op_redor,2,true},
 	{"rti", op_rti,2,false},
 	{"rte", op_rte,2,false},
@@ -216,14 +218,30 @@ static char *pad(char *op)
 	return buf;
 }
 
-Instruction *GetInsn(int op)
+// Index of the opcode table by opcode, built on first use. Where an opcode
+// appears more than once in opl[] the first entry is the one used.
+static Instruction *opIndex[op_empty+1];
+
+static void InitOpIndex()
 {
 	int i;
 
     for(i = 0; opl[i].mnem; i++)
-		if( opl[i].opcode == op )
-			return (&opl[i]);
-	return (nullptr);
+		if (opl[i].opcode >= 0 && opl[i].opcode <= op_empty && opIndex[opl[i].opcode]==nullptr)
+			opIndex[opl[i].opcode] = &opl[i];
+}
+
+Instruction *GetInsn(int op)
+{
+	static bool initialized = false;
+
+	if (!initialized) {
+		InitOpIndex();
+		initialized = true;
+	}
+	if (op < 0 || op > op_empty)
+		return (nullptr);
+	return (opIndex[op]);
 }
 
 /*
@@ -515,6 +533,10 @@ void put_code(OCODE *p)
 	ap3 = p->oper3;
 	ap4 = p->oper4;
 
+	// A new function's blocks may be at the same address as the last
+	// function's were.
+	if (op == op_fnname)
+		b = nullptr;
 	if (p->bb != b) {
 		ofs.printf(";====================================================\n");
 		ofs.printf("; Basic Block %d\n", p->bb->num);
@@ -568,7 +590,9 @@ void put_code(OCODE *p)
 							if (op==op_cmp && apd->mode != am_reg)
 								printf("aha\r\n");
                        		PutAddressMode(apd);
-							if (ap3 != NULL) {
+							// A jal's third operand is only the case table
+							// the jump goes through.
+							if (ap3 != NULL && op != op_jal) {
 								if (op==op_push || op==op_pop)
 									ofs.printf("/");
 								else
@@ -827,7 +851,7 @@ int stringlit(char *s)
 {      
 	struct slit *lp;
 
-	lp = (struct slit *)allocx(sizeof(struct slit));
+	lp = (struct slit *)allocx(sizeof(struct slit), MEM_LIT);
 	lp->label = nextlabel++;
 	lp->str = my_strdup(s);
 	lp->nmspace = my_strdup(GetNamespace());
@@ -840,10 +864,10 @@ int caselit(struct scase *cases, int64_t num)
 {
 	struct clit *lp;
 
-	lp = (struct clit *)allocx(sizeof(struct clit));
+	lp = (struct clit *)allocx(sizeof(struct clit), MEM_LIT);
 	lp->label = nextlabel++;
 	lp->nmspace = my_strdup(GetNamespace());
-	lp->cases = (struct scase *)allocx(sizeof(struct scase)*(int)num);
+	lp->cases = (struct scase *)allocx(sizeof(struct scase)*(int)num, MEM_LIT);
 	lp->num = (int)num;
 	memcpy(lp->cases, cases, (int)num * sizeof(struct scase));
 	lp->next = casetab;
@@ -865,7 +889,7 @@ int quadlit(Float128 *f128)
 			return lp->label;
 		lp = lp->next;
 	}
-	lp = (Float128 *)allocx(sizeof(Float128));
+	lp = (Float128 *)allocx(sizeof(Float128), MEM_LIT);
 	lp->label = nextlabel++;
 	Float128::Assign(lp,f128);
 	lp->nmspace = my_strdup(GetNamespace());
@@ -70,7 +70,7 @@ int ClassDeclaration::Parse(int ztype)
   SYM *cls;
 
   cls = currentClass;
-	dfs.puts("<ParseClassDeclaration>\n");
+	DTRACE(TRC_PARSE).puts("<ParseClassDeclaration>\n");
 	alignment = 0;
 	isTypedef = TRUE;
 	NextToken();
@@ -91,15 +91,15 @@ int ClassDeclaration::Parse(int ztype)
 	bit_next = 0;
 	bit_width = -1;
 
-  dfs.printf("---------------------------------");
-  dfs.printf("Class decl:%s\n", lastid);
-  dfs.printf("---------------------------------");
+  DTRACE(TRC_PARSE).printf("---------------------------------");
+  DTRACE(TRC_PARSE).printf("Class decl:%s\n", lastid);
+  DTRACE(TRC_PARSE).printf("---------------------------------");
 	if((sp = tagtable.Find(std::string(lastid),false)) == NULL) {
     sp = allocSYM();
     sp->SetName(*(new std::string(lastid)));
 		sp->tp = nullptr;
     NextToken();
-    dfs.printf("A");
+    DTRACE(TRC_PARSE).printf("A");
 		if (lastst == kw_align) {
       NextToken();
       alignment = (int)GetIntegerExpression(&pnd);
@@ -110,7 +110,7 @@ int ClassDeclaration::Parse(int ztype)
 		// Could be a forward structure declaration like:
 		// struct buf;
 		if (lastst==semicolon) {
-      dfs.printf("B");
+      DTRACE(TRC_PARSE).printf("B");
 			ret = 1;
 			printf("classdecl insert1\r\n");
       tagtable.insert(sp);
@@ -118,12 +118,12 @@ int ClassDeclaration::Parse(int ztype)
 		}
 		// Defining a pointer to an unknown struct ?
 		else if (lastst == star) {
-      dfs.printf("C");
+      DTRACE(TRC_PARSE).printf("C");
 			printf("classdecl insert2\r\n");
       tagtable.insert(sp);
 		}
 		else if (lastst==colon) {
-      dfs.printf("D");
+      DTRACE(TRC_PARSE).printf("D");
 			NextToken();
 			// Absorb and ignore public/private keywords
 			if (lastst == kw_public || lastst==kw_private)
@@ -137,13 +137,13 @@ int ClassDeclaration::Parse(int ztype)
 				error(ERR_UNDEFINED);
 				goto lxit;
 			}
-      dfs.printf("E");
+      DTRACE(TRC_PARSE).printf("E");
 			// Copy the type chain of base class
 			//sp->tp = TYP::Copy(bcsp->tp);
 			// Start off at the size of the base.
 			sp->tp = allocTYP();
 			sp->tp->lst.SetBase(bcsp->GetIndex());
-			dfs.printf("Set base class: %d\n", sp->tp->lst.base);
+			DTRACE(TRC_PARSE).printf("Set base class: %d\n", sp->tp->lst.base);
 			sp->tp->size = bcsp->tp->size;
 			sp->tp->type = (e_bt)ztype;
 			sp->tp->typeno = typeno++;
@@ -167,9 +167,9 @@ int ClassDeclaration::Parse(int ztype)
       tagtable.insert(sp);
       NextToken();
       currentClass = sp;
-      dfs.printf("f");
+      DTRACE(TRC_PARSE).printf("f");
       ParseMembers(sp,ztype);
-      dfs.printf("G");
+      DTRACE(TRC_PARSE).printf("G");
 		}
     else if(lastst != begin)
       error(ERR_INCOMPLETE);
@@ -210,7 +210,7 @@ lxit:
 	if (classname) delete classname;
 	classname = new std::string(idsave);
 	currentClass = cls;
-	dfs.puts("</ParseClassDeclaration>\n");
+	DTRACE(TRC_PARSE).puts("</ParseClassDeclaration>\n");
 	return ret;
 }
 
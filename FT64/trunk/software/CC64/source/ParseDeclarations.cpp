@@ -487,12 +487,12 @@ SYM *Declaration::ParseId()
 {
 	SYM *sp;
 
-  dfs.printf("<ParseId>%s",lastid);
+  DTRACE(TRC_PARSE).printf("<ParseId>%s",lastid);
 	sp = tagtable.Find(lastid,false);//gsyms[0].Find(lastid);
 	if (sp==nullptr)
 		sp = gsyms[0].Find(lastid,false);
 	if (sp) {
-		dfs.printf("Actually found type.\r\n");
+		DTRACE(TRC_PARSE).printf("Actually found type.\r\n");
 		if (sp->storage_class==sc_typedef || sp->storage_class==sc_type) {
 			NextToken();
 			head = tail = sp->tp;
@@ -506,7 +506,7 @@ SYM *Declaration::ParseId()
 		tail = head;
 		bit_max = 64;
 	}
-  dfs.puts("</ParseId>");
+  DTRACE(TRC_PARSE).puts("</ParseId>");
 	return sp;
 }
 
@@ -518,14 +518,14 @@ int Declaration::ParseSpecifier(TABLE *table)
 {
 	SYM *sp;
 
-	dfs.printf("<ParseSpecifier>\n");
+	DTRACE(TRC_PARSE).printf("<ParseSpecifier>\n");
 	isUnsigned = FALSE;
 	isSigned = FALSE;
 	isVolatile = FALSE;
 	isVirtual = FALSE;
 	isIO = FALSE;
 	isConst = FALSE;
-	dfs.printf("A");
+	DTRACE(TRC_PARSE).printf("A");
 	for (;;) {
 		switch (lastst) {
 				
@@ -555,7 +555,7 @@ int Declaration::ParseSpecifier(TABLE *table)
 				goto lxit;
 
       case kw_virtual:
-        dfs.printf("virtual");
+        DTRACE(TRC_PARSE).printf("virtual");
         isVirtual = TRUE;
         NextToken();
         break;
@@ -686,7 +686,7 @@ int Declaration::ParseSpecifier(TABLE *table)
 			}
 	}
 lxit:;
-	dfs.printf("</ParseSpecifier>\n");
+	DTRACE(TRC_PARSE).printf("</ParseSpecifier>\n");
 	return 0;
 }
 
@@ -714,13 +714,13 @@ void Declaration::ParseDoubleColon(SYM *sp)
 	    NextToken();
 	currentClass = sp->GetParentPtr();
 	if (sp->parent)
-		dfs.printf("Setting parent:%s|\r\n",
+		DTRACE(TRC_PARSE).printf("Setting parent:%s|\r\n",
 	(char *)sp->GetParentPtr()->name->c_str());
 }
 
 void Declaration::ParseBitfieldSpec(bool isUnion)
 {
-	dfs.puts("<ParseBitfieldSpec>");
+	DTRACE(TRC_PARSE).puts("<ParseBitfieldSpec>");
 	NextToken();
 	bit_width = (int)GetIntegerExpression((ENODE **)NULL);
 	if (isUnion)
@@ -734,19 +734,19 @@ void Declaration::ParseBitfieldSpec(bool isUnion)
 	if (bit_width == 0 || bit_offset + bit_width > bit_max)
 		bit_offset = 0;
 	bit_next = bit_offset + bit_width;
-	dfs.puts("</ParseBitfieldSpec>\n");
+	DTRACE(TRC_PARSE).puts("</ParseBitfieldSpec>\n");
 }
 
 SYM *Declaration::ParsePrefixId()
 {
 	SYM *sp;
 
-	dfs.puts("<ParsePrefixId>");            
+	DTRACE(TRC_PARSE).puts("<ParsePrefixId>");            
 	if (declid) delete declid;
 	declid = new std::string(lastid);
-	dfs.printf("B|%s|",(char *)declid->c_str());
+	DTRACE(TRC_PARSE).printf("B|%s|",(char *)declid->c_str());
 	sp = allocSYM();
-	dfs.printf("C"); 
+	DTRACE(TRC_PARSE).printf("C"); 
 	if (funcdecl==1) {
 		if (nparms > 19)
 			error(ERR_TOOMANY_PARAMS);
@@ -755,13 +755,13 @@ SYM *Declaration::ParsePrefixId()
 			nparms++;
 		}
 	}
-	dfs.printf("D"); 
+	DTRACE(TRC_PARSE).printf("D"); 
 	NextToken();
 	ParseDoubleColon(sp);
 	if (declid) delete declid;
 	declid = new std::string(lastid);
 	sp->SetName(*declid);
-	dfs.printf("E"); 
+	DTRACE(TRC_PARSE).printf("E"); 
 	if (lastst == colon) {
 		ParseBitfieldSpec(isUnion);
 		goto lxit;	// no ParseDeclarationSuffix()
@@ -769,7 +769,7 @@ SYM *Declaration::ParsePrefixId()
 	sp->SetName(*declid);
 	sp = ParseSuffix(sp);
 	lxit:
-	dfs.puts("</ParsePrefixId>");
+	DTRACE(TRC_PARSE).puts("</ParsePrefixId>");
 	return sp;
 }
 
@@ -778,7 +778,7 @@ SYM *Declaration::ParsePrefixOpenpa(bool isUnion)
 	TYP *temp1, *temp2, *temp3, *temp4;
 	SYM *sp;
 
-	dfs.puts("<ParsePrefixOpenpa>\n");
+	DTRACE(TRC_PARSE).puts("<ParsePrefixOpenpa>\n");
 	NextToken();
 	temp1 = head;
 	temp2 = tail;
@@ -804,7 +804,7 @@ SYM *Declaration::ParsePrefixOpenpa(bool isUnion)
 			temp4->size *= head->size;
 		head = temp3;
 	}
-	dfs.puts("</ParsePrefixOpenpa>\n");
+	DTRACE(TRC_PARSE).puts("</ParsePrefixOpenpa>\n");
 	return sp;
 }
 
@@ -816,7 +816,7 @@ SYM *Declaration::ParsePrefix(bool isUnion)
 	TYP *temp1;
 	SYM *sp;
 
-	dfs.printf("<ParseDeclPrefix>(%d)\n",lastst);
+	DTRACE(TRC_PARSE).printf("<ParseDeclPrefix>(%d)\n",lastst);
 
 	sp = nullptr;
 j1:
@@ -834,7 +834,7 @@ j1:
 
 	case star:
 		bit_max = 64;
-		dfs.putch('*');
+		DTRACE(TRC_PARSE).putch('*');
 		temp1 = TYP::Make(bt_pointer,sizeOfPtr);
 		temp1->btp = head->GetIndex();
 		head = temp1;
@@ -852,11 +852,11 @@ j1:
 
 	default:
 		sp = ParseSuffix(sp);
-		dfs.printf("Z");
+		DTRACE(TRC_PARSE).printf("Z");
 		goto lxit;
 	}
 lxit:
-	dfs.puts("</ParseDeclPrefix>\n");
+	DTRACE(TRC_PARSE).puts("</ParseDeclPrefix>\n");
 	return sp;
 }
 
@@ -887,7 +887,7 @@ void Declaration::ParseSuffixOpenbr()
 		temp1->size = sz2 * head->size;
 		temp1->numele = sz2;
 		temp1->dimen = head->dimen + 1;
-		dfs.printf("Setting array size:%d\n", (int)temp1->size);
+		DTRACE(TRC_PARSE).printf("Setting array size:%d\n", (int)temp1->size);
 		temp1->alignment = head->alignment;
 		needpunc(closebr,21);
 	}
@@ -940,12 +940,12 @@ void Declaration::ParseSuffixOpenpa(SYM *sp)
 	int numa = 0;
 	SYM *cf;
 	
-	dfs.printf("<openpa>\n");
-	dfs.printf("****************************\n");
-	dfs.printf("****************************\n");
-	dfs.printf("Function: %s\n", (char *)sp->name->c_str());
-	dfs.printf("****************************\n");
-	dfs.printf("****************************\n");
+	DTRACE(TRC_PARSE).printf("<openpa>\n");
+	DTRACE(TRC_PARSE).printf("****************************\n");
+	DTRACE(TRC_PARSE).printf("****************************\n");
+	DTRACE(TRC_PARSE).printf("Function: %s\n", (char *)sp->name->c_str());
+	DTRACE(TRC_PARSE).printf("****************************\n");
+	DTRACE(TRC_PARSE).printf("****************************\n");
 	NextToken();
 	sp->IsPascal = isPascal;
 	sp->IsInline = isInline;
@@ -956,9 +956,9 @@ void Declaration::ParseSuffixOpenpa(SYM *sp)
 	//  isFuncPtr = head->type==bt_pointer;
 	temp1 =(TYP *) TYP::Make(bt_func,0/*isFuncPtr ? bt_func : bt_ifunc,0*/);
 	temp1->val_flag = 1;
-	dfs.printf("o ");
+	DTRACE(TRC_PARSE).printf("o ");
 	if (isFuncPtr) {
-		dfs.printf("Got function pointer in declarations.\n");
+		DTRACE(TRC_PARSE).printf("Got function pointer in declarations.\n");
 		temp1->btp = head->btp;
 		head->btp = temp1->GetIndex();
 	}
@@ -966,14 +966,14 @@ void Declaration::ParseSuffixOpenpa(SYM *sp)
 		temp1->btp= head->GetIndex();
 		head = temp1;
 	}
-	dfs.printf("p ");
+	DTRACE(TRC_PARSE).printf("p ");
 	if (tail==NULL) {
 		if (temp1->GetBtp())
 			tail = temp1->GetBtp();
 		else
 			tail = temp1;
 	}
-	dfs.printf("q ");
+	DTRACE(TRC_PARSE).printf("q ");
 	needParseFunction = 1;
 	sp->params.Clear();
 	sp->parent = currentClass->GetIndex();
@@ -1004,7 +1004,7 @@ void Declaration::ParseSuffixOpenpa(SYM *sp)
 		}
 	      temp1->type = bt_func;
 		  needParseFunction = 0;
-		  dfs.printf("Set false\n");
+		  DTRACE(TRC_PARSE).printf("Set false\n");
 	  }
 	  currentFn = sp;
 	  sp->NumParms = 0;
@@ -1013,19 +1013,19 @@ j1: ;
   }
   else {
 j2:
-    dfs.printf("r");
+    DTRACE(TRC_PARSE).printf("r");
 	  currentFn = sp;
-    dfs.printf("s");
+    DTRACE(TRC_PARSE).printf("s");
     temp1->type = bt_func;
   	// Parse the parameter list for a function pointer passed as a
   	// parameter.
   	// Parse parameter list for a function pointer defined within
   	// a structure.
   	if (parsingParameterList || isStructDecl) {
-      dfs.printf("s ");
+      DTRACE(TRC_PARSE).printf("s ");
   		fd = funcdecl;
   		needParseFunction = FALSE;
-  	  dfs.printf("Set false\n");
+  	  DTRACE(TRC_PARSE).printf("Set false\n");
 		if (declid)
   			odecl = *declid;
 		else
@@ -1038,7 +1038,7 @@ j2:
   //				SetType(sp);
   		sp->BuildParameterList(&nump, &numa);
   		needParseFunction = 0;
-  	  dfs.printf("Set false\n");
+  	  DTRACE(TRC_PARSE).printf("Set false\n");
   //				sp->parms = sym;
   		sp->NumParms = nump;
   		isStructDecl = isd;
@@ -1055,9 +1055,9 @@ j2:
   
   		if (lastst==begin) {
   		  needParseFunction = 2;
-  		  dfs.printf("Set true1\n");
+  		  DTRACE(TRC_PARSE).printf("Set true1\n");
   			if (sp->params.GetHead() && sp->proto.GetHead()) {
-  			  dfs.printf("Matching parameter types to prototype.\n");
+  			  DTRACE(TRC_PARSE).printf("Matching parameter types to prototype.\n");
   			  if (!sp->ParameterTypesMatch(sp))
   			     error(ERR_PARMLIST_MISMATCH);
   		  }
@@ -1075,7 +1075,7 @@ j2:
 		else
   			error(ERR_SYNTAX);
   	  }
-      dfs.printf("Z\r\n");
+      DTRACE(TRC_PARSE).printf("Z\r\n");
 //				if (isFuncPtr)
 //					temp1->type = bt_func;
 //				if (lastst != begin)
@@ -1084,11 +1084,11 @@ j2:
 //					ParseFunction(sp);
 //				}
     }
-    dfs.printf("Y");
+    DTRACE(TRC_PARSE).printf("Y");
 	  sp->PrintParameterTypes();
-    dfs.printf("X");
+    DTRACE(TRC_PARSE).printf("X");
   }
-  dfs.printf("</openpa>\n");
+  DTRACE(TRC_PARSE).printf("</openpa>\n");
 }
 
 
@@ -1098,7 +1098,7 @@ j2:
 
 SYM *Declaration::ParseSuffix(SYM *sp)
 {
-	dfs.printf("<ParseDeclSuffix>\n");
+	DTRACE(TRC_PARSE).printf("<ParseDeclSuffix>\n");
 
   while(true) {
     switch (lastst) {
@@ -1122,7 +1122,7 @@ SYM *Declaration::ParseSuffix(SYM *sp)
     }
   }
 lxit:
-  dfs.printf("</ParseDeclSuffix>\n");
+  DTRACE(TRC_PARSE).printf("</ParseDeclSuffix>\n");
 	return sp;
 }
 
@@ -1245,18 +1245,18 @@ void InsertMethod(SYM *sp)
   std::string name;
   
   name = *sp->name;
-  dfs.printf("<InsertMethod>%s type %d ", (char *)sp->name->c_str(), sp->tp->type);
+  DTRACE(TRC_PARSE).printf("<InsertMethod>%s type %d ", (char *)sp->name->c_str(), sp->tp->type);
   sp->GetParentPtr()->tp->lst.insert(sp);
   nn = sp->GetParentPtr()->tp->lst.FindRising(*sp->name);
   sym = sp->FindRisingMatch(true);
   if (sym) {
-    dfs.puts("Found in a base class:");
+    DTRACE(TRC_PARSE).puts("Found in a base class:");
     if (sym->IsVirtual) {
-      dfs.printf("Found virtual:");
+      DTRACE(TRC_PARSE).printf("Found virtual:");
       sym->AddDerived(sp);
     }
   }
-  dfs.printf("</InsertMethod>\n");
+  DTRACE(TRC_PARSE).printf("</InsertMethod>\n");
 }
 
 /*
@@ -1287,19 +1287,19 @@ int Declaration::declare(SYM *parent,TABLE *table,int al,int ilc,int ztype)
     static long old_nbytes;
     int nbytes;
 
-	dfs.printf("Enter declare()\r\n");
+	DTRACE(TRC_PARSE).printf("Enter declare()\r\n");
 	nbytes = 0;
-	dfs.printf("A");
+	DTRACE(TRC_PARSE).printf("A");
 	classname = new std::string("");
 	sp1 = nullptr;
 	if (ParseSpecifier(table))
 		goto xit1;
-	dfs.printf("B");
+	DTRACE(TRC_PARSE).printf("B");
 	dhead = head;
 	for(;;) {
 	    if (declid) delete declid;
 		declid = nullptr;
-		dfs.printf("b");
+		DTRACE(TRC_PARSE).printf("b");
 		bit_width = -1;
 		sp = ParsePrefix(ztype==bt_union);
 		if (declid==nullptr)
@@ -1321,7 +1321,7 @@ int Declaration::declare(SYM *parent,TABLE *table,int al,int ilc,int ztype)
 		  missingArgumentName = TRUE;
 	  }
 
-    dfs.printf("C");
+    DTRACE(TRC_PARSE).printf("C");
     if( declid->length() > 0 || classname->length()!=0) {      /* otherwise just struct tag... */
 		  if (sp == nullptr) {
         sp = allocSYM();
@@ -1342,7 +1342,7 @@ int Declaration::declare(SYM *parent,TABLE *table,int al,int ilc,int ztype)
 		  if (declid==nullptr)
 		    declid = new std::string("");
       sp->SetName(classname->length() > 0 ? *classname : *declid);
-      dfs.printf("D");
+      DTRACE(TRC_PARSE).printf("D");
       if (classname) delete classname;
 		  classname = new std::string("");
 		  sp->IsVirtual = isVirtual;
@@ -1359,7 +1359,7 @@ int Declaration::declare(SYM *parent,TABLE *table,int al,int ilc,int ztype)
 				  sp->storage_class = sc_typedef;
 			  isTypedef = FALSE;
 		  }
-dfs.printf("E");
+DTRACE(TRC_PARSE).printf("E");
 		  if ((ilc + nbytes) % roundAlignment(head)) {
 			  if (al==sc_thread)
 				  tseg();
@@ -1376,17 +1376,17 @@ dfs.printf("E");
           genstorage(bcnt);
       }
 /*
-      dfs.printf("F");
+      DTRACE(TRC_PARSE).printf("F");
 		  if (sp->parent) {
-        dfs.printf("f:%d",sp->parent);
+        DTRACE(TRC_PARSE).printf("f:%d",sp->parent);
         if (sp->GetParentPtr()->tp==nullptr) {
-          dfs.printf("f:%d",sp->parent);
-          dfs.printf("null type pointer.\n");
+          DTRACE(TRC_PARSE).printf("f:%d",sp->parent);
+          DTRACE(TRC_PARSE).printf("null type pointer.\n");
           parentBytes = 0;
         }
         else {
 			    parentBytes = sp->GetParentPtr()->tp->size;
-			    dfs.printf("ParentBytes=%d\n",parentBytes);
+			    DTRACE(TRC_PARSE).printf("ParentBytes=%d\n",parentBytes);
 		    }
 		  }
 		  else
@@ -1411,7 +1411,7 @@ dfs.printf("E");
       sp->value.i = -(ilc + nbytes + roundSize(head));// + parentBytes);
 		}
 
-    dfs.printf("G");
+    DTRACE(TRC_PARSE).printf("G");
 		if (isConst)
 			sp->tp->isConst = TRUE;
     if((sp->tp->type == bt_func) && sp->storage_class == sc_global )
@@ -1435,7 +1435,7 @@ dfs.printf("E");
 		}
 	}
 
-    dfs.printf("H");
+    DTRACE(TRC_PARSE).printf("H");
       // For a class declaration there may not be any variables declared as
       // part of the declaration. In that case the symbol name is an empty
       // string. There's nothing to insert in the symbol table.
@@ -1462,35 +1462,35 @@ dfs.printf("E");
         else
   			  sp1 = table->Find(*sp->name,false);
 
-        dfs.printf("h");
+        DTRACE(TRC_PARSE).printf("h");
         if (sp->tp) {
-          dfs.printf("h1");
+          DTRACE(TRC_PARSE).printf("h1");
   			  if (sp->tp->type == bt_ifunc || sp->tp->type==bt_func) {
-            dfs.printf("h2");
+            DTRACE(TRC_PARSE).printf("h2");
   				  sp1 = sp->FindExactMatch(TABLE::matchno);
-            dfs.printf("i");
+            DTRACE(TRC_PARSE).printf("i");
   			  }
   		  }
   			else {
-  dfs.printf("j");
+  DTRACE(TRC_PARSE).printf("j");
   				if (TABLE::matchno)
   					sp1 = TABLE::match[TABLE::matchno-1];
   				else
   					sp1 = nullptr;
   			}
-  dfs.printf("k");
+  DTRACE(TRC_PARSE).printf("k");
   			flag = false;
   			if (sp1) {
   			  if (sp1->tp) {
-  dfs.printf("l");
+  DTRACE(TRC_PARSE).printf("l");
   				   flag = sp1->tp->type == bt_func;
   	      }
   			}
-  dfs.printf("I");
+  DTRACE(TRC_PARSE).printf("I");
   			if (sp->tp->type == bt_ifunc && flag)
   			{
-  dfs.printf("Ia");
-  				dfs.printf("bt_ifunc\r\n");
+  DTRACE(TRC_PARSE).printf("Ia");
+  				DTRACE(TRC_PARSE).printf("bt_ifunc\r\n");
   				sp1->SetType(sp->tp);
   				sp1->storage_class = sp->storage_class;
           sp1->value.i = sp->value.i;
@@ -1504,10 +1504,10 @@ dfs.printf("E");
   				sp = sp1;
               }
   			else {
-  dfs.printf("Ib");
+  DTRACE(TRC_PARSE).printf("Ib");
   				// Here the symbol wasn't found in the table.
   				if (sp1 == nullptr) {
-  dfs.printf("Ic");
+  DTRACE(TRC_PARSE).printf("Ic");
             if ((sp->tp->type==bt_class)
                && (sp->storage_class == sc_type || sp->storage_class==sc_typedef))
               ; // Do nothing. The class was already entered in the tag table.
@@ -1517,8 +1517,8 @@ dfs.printf("E");
               ; // If there was no struct tag and this is a typedef, then it
                 // still needs to be inserted into the table.
             else {
-              dfs.printf("insert type: %d\n", sp->tp->type);
-  					  dfs.printf("***Inserting:%s into %p\n",(char *)sp->name->c_str(), (char *) table);
+              DTRACE(TRC_PARSE).printf("insert type: %d\n", sp->tp->type);
+  					  DTRACE(TRC_PARSE).printf("***Inserting:%s into %p\n",(char *)sp->name->c_str(), (char *) table);
   					   // Need to know the type before a name can be generated.
               sp->mangledName = sp->BuildSignature();
    					  if (sp->parent && ((sp->tp->type==bt_func || sp->tp->type==bt_ifunc)
@@ -1532,7 +1532,7 @@ dfs.printf("E");
   				  }
   				}
   			}
-  dfs.printf("J");
+  DTRACE(TRC_PARSE).printf("J");
   			if (needParseFunction) {
   				needParseFunction = FALSE;
   				fn_doneinit = ParseFunction(sp);
@@ -1543,7 +1543,7 @@ dfs.printf("E");
      //             ParseFunction(sp);
      //             return nbytes;
      //         }
-  dfs.printf("K");
+  DTRACE(TRC_PARSE).printf("K");
               if( (al == sc_global || al == sc_static || al==sc_thread) && !fn_doneinit &&
                       sp->tp->type != bt_func && sp->tp->type != bt_ifunc && sp->storage_class!=sc_typedef)
                       doinit(sp);
@@ -1643,8 +1643,9 @@ void GlobalDeclaration::Parse()
   isPascal = FALSE;
   isInline = false;
   lc_auto = 0;
-	dfs.puts("<ParseGlobalDecl>\n");
+	DTRACE(TRC_PARSE).puts("<ParseGlobalDecl>\n");
   for(;;) {
+    Pch::Boundary();
     currentClass = nullptr;
     currentFn = nullptr;
     currentStmt = nullptr;
@@ -1765,7 +1766,7 @@ void GlobalDeclaration::Parse()
 		}
 	}
 xit:
-	dfs.puts("</ParseGlobalDecl>\n");
+	DTRACE(TRC_PARSE).puts("</ParseGlobalDecl>\n");
 	;
 }
 
@@ -1792,16 +1793,16 @@ void AutoDeclaration::Parse(SYM *parent, TABLE *ssyms)
 				break;
 		case ellipsis:
 		case id: //return;
-        dfs.printf("Found %s\n", lastid);
+        DTRACE(TRC_PARSE).printf("Found %s\n", lastid);
 				sp = tagtable.Find(lastid,false);
 				if (sp)
-				   dfs.printf("Found in tagtable");
+				   DTRACE(TRC_PARSE).printf("Found in tagtable");
 				if (sp==nullptr)
 					sp = gsyms[0].Find(lastid,false);
 				if (sp) {
-				  dfs.printf("sp okay sc=%d\n", sp->storage_class);
+				  DTRACE(TRC_PARSE).printf("sp okay sc=%d\n", sp->storage_class);
 					if (sp->storage_class==sc_typedef || sp->storage_class==sc_type) {
-					  dfs.printf("Declaring var of type\n");
+					  DTRACE(TRC_PARSE).printf("Declaring var of type\n");
 			            lc_auto += declare(parent,ssyms,sc_auto,lc_auto,bt_struct);
 						break;
 					}
@@ -1852,7 +1853,7 @@ int ParameterDeclaration::Parse(int fd)
 
   isFuncPtr = false;
 	nparms = 0;
-	dfs.puts("<ParseParmDecls>\n");
+	DTRACE(TRC_PARSE).puts("<ParseParmDecls>\n");
 	worstAlignment = 0;
 	ofd = funcdecl;
 	opascal = isPascal;
@@ -1862,7 +1863,7 @@ int ParameterDeclaration::Parse(int fd)
 	missingArgumentName = FALSE;
 	parsingParameterList++;
     for(;;) {
-dfs.printf("A(%d)",lastst);
+DTRACE(TRC_PARSE).printf("A(%d)",lastst);
 		switch(lastst) {
 		case kw_auto:
 			NextToken();
@@ -1879,7 +1880,7 @@ dfs.printf("A(%d)",lastst);
 		case kw_nocall:
 		case kw_oscall:
 		case kw_typedef:
-dfs.printf("B");
+DTRACE(TRC_PARSE).printf("B");
       error(ERR_ILLCLASS);
       declare(NULL,&currentFn->params,sc_auto,0,bt_struct);
 				isAuto = false;
@@ -1894,7 +1895,7 @@ dfs.printf("B");
     case kw_enum: case kw_void:
     case kw_float: case kw_double:
 	case kw_vector: case kw_vector_mask:
-dfs.printf("C");
+DTRACE(TRC_PARSE).printf("C");
     declare(NULL,&currentFn->params,sc_auto,0,bt_struct);
 				isAuto = false;
 	            break;
@@ -1911,7 +1912,7 @@ dfs.printf("C");
 				isAuto = false;
 				break;
         case kw_extern:
-dfs.printf("D");
+DTRACE(TRC_PARSE).printf("D");
                 NextToken();
                 error(ERR_ILLCLASS);
 				if (lastst==kw_oscall || lastst==kw_interrupt || lastst == kw_nocall || lastst==kw_naked || lastst==kw_kernel)
@@ -1928,19 +1929,19 @@ dfs.printf("D");
         default:
 				goto xit;
 		}
-dfs.printf("E");
+DTRACE(TRC_PARSE).printf("E");
 	}
 xit:
 	parsingParameterList--;
 	funcdecl = ofd;
 	isPascal = opascal;
-	dfs.printf("</ParseParmDecls>\n");
+	DTRACE(TRC_PARSE).printf("</ParseParmDecls>\n");
 	return nparms;
 }
 
 GlobalDeclaration *GlobalDeclaration::Make()
 {
-  GlobalDeclaration *p = (GlobalDeclaration *)allocx(sizeof(GlobalDeclaration));
+  GlobalDeclaration *p = (GlobalDeclaration *)allocx(sizeof(GlobalDeclaration), MEM_PARSE);
   return p;
 }
 
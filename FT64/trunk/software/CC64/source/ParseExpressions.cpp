@@ -333,7 +333,7 @@ void PromoteConstFlag(ENODE *ep)
  */
 TYP *deref(ENODE **node, TYP *tp)
 {
-  dfs.printf("<Deref>");
+  DTRACE(TRC_PARSE).printf("<Deref>");
   if (tp==nullptr || node==nullptr || *node==nullptr)
     throw new C64PException(ERR_NULLPOINTER,8);
 	switch( tp->type ) {
@@ -512,22 +512,22 @@ TYP *deref(ENODE **node, TYP *tp)
 		case bt_class:
 		case bt_struct:
 		case bt_union:
-		  dfs.printf("F");
+		  DTRACE(TRC_PARSE).printf("F");
 			(*node)->esize = tp->size;
 			(*node)->etype = (e_bt)tp->type;
       *node = makenode(en_struct_ref,*node,NULL);
 			(*node)->isUnsigned = TRUE;
       break;
 		default:
-		  dfs.printf("Deref :%d\n", tp->type);
+		  DTRACE(TRC_PARSE).printf("Deref :%d\n", tp->type);
 		  if ((*node)->msp)
-		     dfs.printf("%s\n",(char *)(*node)->msp->c_str());
+		     DTRACE(TRC_PARSE).printf("%s\n",(char *)(*node)->msp->c_str());
 			error(ERR_DEREF);
 			break;
     }
 	(*node)->isVolatile = tp->isVolatile;
 	(*node)->constflag = tp->isConst;
-  dfs.printf("</Deref>");
+  DTRACE(TRC_PARSE).printf("</Deref>");
     return tp;
 }
 
@@ -590,9 +590,9 @@ TYP *nameref2(std::string name, ENODE **node,int nt,bool alloc,TypeArray *typear
 	TYP *tp;
 	std::string stnm;
 
-	dfs.puts("<nameref2>\n");
+	DTRACE(TRC_PARSE).puts("<nameref2>\n");
 	if (tbl) {
-		dfs.printf("searching table for:%d:%s|",TABLE::matchno,(char *)name.c_str());
+		DTRACE(TRC_PARSE).printf("searching table for:%d:%s|",TABLE::matchno,(char *)name.c_str());
 		tbl->Find(name,bt_long,typearray,true);
 		//		gsearch2(name,bt_long,typearray,true);
 		sp = SYM::FindExactMatch(TABLE::matchno, name, bt_long, typearray);
@@ -602,7 +602,7 @@ TYP *nameref2(std::string name, ENODE **node,int nt,bool alloc,TypeArray *typear
 		//		}
 	}
 	else {
-	dfs.printf("A:%d:%s",TABLE::matchno,(char *)name.c_str());
+	DTRACE(TRC_PARSE).printf("A:%d:%s",TABLE::matchno,(char *)name.c_str());
 	sp = SYM::FindExactMatch(TABLE::matchno, name, bt_long, typearray);
 	// If we didn't have an exact match and no (parameter) types are known
 	// return the match if there is only a single one.
@@ -614,7 +614,7 @@ TYP *nameref2(std::string name, ENODE **node,int nt,bool alloc,TypeArray *typear
 	//		sp = gsearch2(name,typearray);
 	}
 	if (sp==nullptr && !alloc) {
-		dfs.printf("returning nullptr");
+		DTRACE(TRC_PARSE).printf("returning nullptr");
 		*node = makeinode(en_labcon,9999);
 		tp = nullptr;
 		goto xit;
@@ -628,8 +628,9 @@ TYP *nameref2(std::string name, ENODE **node,int nt,bool alloc,TypeArray *typear
 			sp->SetName(*(new std::string(lastid)));
 			sp->storage_class = sc_external;
 			sp->IsUndefined = TRUE;
-			dfs.printf("Insert at nameref\r\n");
-			typearray->Print();
+			DTRACE(TRC_PARSE).printf("Insert at nameref\r\n");
+			if (DTRACE_ON(TRC_PARSE))
+				typearray->Print();
 			//    gsyms[0].insert(sp);
 			tp = &stdfunc;
 			*node = makesnode(en_cnacon,sp->name,sp->BuildSignature(),sp->value.i);
@@ -640,15 +641,16 @@ TYP *nameref2(std::string name, ENODE **node,int nt,bool alloc,TypeArray *typear
 			(*node)->esize = 8;
 		}
 		else {
-			dfs.printf("Undefined symbol2 in nameref\r\n");
+			DTRACE(TRC_PARSE).printf("Undefined symbol2 in nameref\r\n");
 			tp = (TYP *)NULL;
 			*node = makeinode(en_labcon,9999);
 			error(ERR_UNDEFINED);
 		}
 	}
 	else {
-		dfs.printf("sp is not null\n");
-		typearray->Print();
+		DTRACE(TRC_PARSE).printf("sp is not null\n");
+		if (DTRACE_ON(TRC_PARSE))
+			typearray->Print();
 		if( (tp = sp->tp) == NULL ) {
 			error(ERR_UNDEFINED);
 			goto xit;            // guard against untyped entries
@@ -772,18 +774,18 @@ TYP *nameref2(std::string name, ENODE **node,int nt,bool alloc,TypeArray *typear
 		(*node)->isPascal = sp->IsPascal;
 		(*node)->SetType(sp->tp);
 		(*node)->sym = sp;
-		dfs.printf("tp:%p ",(char *)tp);
+		DTRACE(TRC_PARSE).printf("tp:%p ",(char *)tp);
 		// Not sure about this if - wasn't here in the past.
 		if (sp->tp->type!=bt_func && sp->tp->type!=bt_ifunc)
 			tp = CondDeref(node,tp);
-		dfs.printf("deref tp:%p ",(char *)tp);
+		DTRACE(TRC_PARSE).printf("deref tp:%p ",(char *)tp);
 	}
 	if (nt)
 		NextToken();
 xit:
 	if (!tp)
-		dfs.printf("returning nullptr2");
-	dfs.puts("</nameref2>\n");
+		DTRACE(TRC_PARSE).printf("returning nullptr2");
+	DTRACE(TRC_PARSE).puts("</nameref2>\n");
 	return tp;
 }
 
@@ -792,8 +794,8 @@ TYP *nameref(ENODE **node,int nt)
 	TYP *tp;
   bool found;
  
-	dfs.puts("<Nameref>\n");
-	dfs.printf("GSearchfor:%s|",lastid);
+	DTRACE(TRC_PARSE).puts("<Nameref>\n");
+	DTRACE(TRC_PARSE).printf("GSearchfor:%s|",lastid);
 	found = false;
 /*
 	if (ptp1) {
@@ -808,7 +810,7 @@ TYP *nameref(ENODE **node,int nt)
  */
   gsearch2(lastid,(__int16)bt_long,nullptr,false);
 	tp = nameref2(lastid, node, nt, true, nullptr, nullptr);
-	dfs.puts("</Nameref>\n");
+	DTRACE(TRC_PARSE).puts("</Nameref>\n");
 	return tp;
 }
 /*
@@ -834,7 +836,7 @@ ENODE *ArgumentList(ENODE *hidden, TypeArray *typearray)
 	TYP *typ;
 	int nn;
 
-	dfs.printf("<ArgumentList>");
+	DTRACE(TRC_PARSE).printf("<ArgumentList>");
 	nn = 0;
 	ep1 = 0;
 	if (hidden) {
@@ -845,9 +847,9 @@ ENODE *ArgumentList(ENODE *hidden, TypeArray *typearray)
 	{
 		typ = NonCommaExpression(&ep2);          // evaluate a parameter
 		if (typ)
-			dfs.printf("%03d ", typ->typeno);
+			DTRACE(TRC_PARSE).printf("%03d ", typ->typeno);
 		else
-			dfs.printf("%03d ", 0);
+			DTRACE(TRC_PARSE).printf("%03d ", 0);
 		if (ep2==nullptr)
 			ep2 = makeinode(en_icon, 0);
 		if (typ==nullptr) {
@@ -863,13 +865,13 @@ ENODE *ArgumentList(ENODE *hidden, TypeArray *typearray)
 		}
 		ep1 = makenode(en_void,ep2,ep1);
 		if(lastst != comma) {
-			dfs.printf("lastst=%d", lastst);
+			DTRACE(TRC_PARSE).printf("lastst=%d", lastst);
 			break;
 		}
 		NextToken();
 	}
 	NextToken();
-	dfs.printf("</ArgumentList>\n");
+	DTRACE(TRC_PARSE).printf("</ArgumentList>\n");
 	return ep1;
 }
 
@@ -1023,7 +1025,7 @@ TYP *ParsePrimaryExpression(ENODE **node, int got_pa)
         needpunc(closepa,7);
         *node = pnode;
         if (pnode==NULL)
-           dfs.printf("pnode is NULL\r\n");
+           DTRACE(TRC_PARSE).printf("pnode is NULL\r\n");
         else
            (*node)->SetType(tptr);
         if (tptr)
@@ -1184,7 +1186,7 @@ TYP *ParsePrimaryExpression(ENODE **node, int got_pa)
         break;
 
     case kw_this:
-		dfs.puts("<ExprThis>");
+		DTRACE(TRC_PARSE).puts("<ExprThis>");
 		TYP *tptr2;
 
 		tptr2 = TYP::Make(bt_class,0);
@@ -1197,9 +1199,9 @@ TYP *ParsePrimaryExpression(ENODE **node, int got_pa)
 		NextToken();
 		tptr = TYP::Make(bt_pointer,sizeOfPtr);
 		tptr->btp = tptr2->GetIndex();
-		dfs.puts((char *)tptr->GetBtp()->sname->c_str());
+		DTRACE(TRC_PARSE).puts((char *)tptr->GetBtp()->sname->c_str());
 		pnode = makeinode(en_regvar,regCLP);
-		dfs.puts("</ExprThis>");
+		DTRACE(TRC_PARSE).puts("</ExprThis>");
         break;
 
 	case begin:
@@ -1535,9 +1537,9 @@ TYP *ParsePostfixExpression(ENODE **node, int got_pa)
 				break;
 			}
 			if (tp2->type == bt_pointer) {
-				dfs.printf("Got function pointer.\n");
+				DTRACE(TRC_PARSE).printf("Got function pointer.\n");
 			}
-			dfs.printf("tp2->type=%d",tp2->type);
+			DTRACE(TRC_PARSE).printf("tp2->type=%d",tp2->type);
 			name = lastid;
 			NextToken();
 			tp3 = tp1->GetBtp();
@@ -1548,15 +1550,16 @@ TYP *ParsePostfixExpression(ENODE **node, int got_pa)
 			}
 			//ep2 = ArgumentList(ep1->p[2],&typearray);
 			ep2 = ArgumentList(ep4,&typearray);
-			typearray.Print();
-			dfs.printf("Got Type: %d",tp1->type);
+			if (DTRACE_ON(TRC_PARSE))
+				typearray.Print();
+			DTRACE(TRC_PARSE).printf("Got Type: %d",tp1->type);
 			if (tp1->type==bt_pointer) {
-				dfs.printf("Got function pointer.\n");
+				DTRACE(TRC_PARSE).printf("Got function pointer.\n");
 				ep1 = makenode(en_fcall,ep1,ep2);
 				currentFn->IsLeaf = FALSE;
 				break;
 			}
-			dfs.printf("openpa calling gsearch2");
+			DTRACE(TRC_PARSE).printf("openpa calling gsearch2");
 			sp = nullptr;
 			ii = tp1->lst.FindRising(name);
 			if (ii) {
@@ -1583,12 +1586,12 @@ TYP *ParsePostfixExpression(ENODE **node, int got_pa)
 				sp->IsUndefined = false;
 			}
 			if (sp->tp->type==bt_pointer) {
-				dfs.printf("Got function pointer");
+				DTRACE(TRC_PARSE).printf("Got function pointer");
 				ep1 = makefcnode(en_fcall,ep1,ep2,sp);
 				currentFn->IsLeaf = FALSE;
 			}
 			else {
-				dfs.printf("Got direct function %s ", (char *)sp->name->c_str());
+				DTRACE(TRC_PARSE).printf("Got direct function %s ", (char *)sp->name->c_str());
 				ep3 = makesnode(en_cnacon,sp->name,sp->mangledName,sp->value.i);
 				ep1 = makefcnode(en_fcall,ep3,ep2,sp);
 				currentFn->IsLeaf = FALSE;
@@ -1639,20 +1642,20 @@ TYP *ParsePostfixExpression(ENODE **node, int got_pa)
 				error(ERR_IDEXPECT);
 				break;
 			}
-			dfs.printf("dot search: %p\r\n", (char *)&tp1->lst);
+			DTRACE(TRC_PARSE).printf("dot search: %p\r\n", (char *)&tp1->lst);
 			ptp1 = tp1;
 			pep1 = ep1;
 			name = lastid;
 			ii = tp1->lst.FindRising(name);
 			if (ii==0) {
-				dfs.printf("Nomember1");
+				DTRACE(TRC_PARSE).printf("Nomember1");
 				error(ERR_NOMEMBER);
 				break;
 			}
 			sp = TABLE::match[ii-1];
 			sp = sp->FindRisingMatch();
 			if( sp == NULL ) {
-				dfs.printf("Nomember2");
+				DTRACE(TRC_PARSE).printf("Nomember2");
 				error(ERR_NOMEMBER);
 				break;
 			}
@@ -1661,17 +1664,18 @@ TYP *ParsePostfixExpression(ENODE **node, int got_pa)
 				break;
 			}
 			tp1 = sp->tp;
-			dfs.printf("tp1->type:%d",tp1->type);
+			DTRACE(TRC_PARSE).printf("tp1->type:%d",tp1->type);
 			if (tp1==nullptr)
 				throw new C64PException(ERR_NULLPOINTER,5);
 			if (tp1->type==bt_ifunc || tp1->type==bt_func) {
 				// build the name vector and create a nacon node.
-				dfs.printf("%s is a func\n",(char *)sp->name->c_str());
+				DTRACE(TRC_PARSE).printf("%s is a func\n",(char *)sp->name->c_str());
 				NextToken();
 				if (lastst==openpa) {
 					NextToken();
 					ep2 = ArgumentList(pep1,&typearray);
-					typearray.Print();
+					if (DTRACE_ON(TRC_PARSE))
+						typearray.Print();
 					sp = SYM::FindExactMatch(ii,name,bt_long,&typearray);
 					if (sp) {
 //						sp = TABLE::match[TABLE::matchno-1];
@@ -1694,7 +1698,7 @@ TYP *ParsePostfixExpression(ENODE **node, int got_pa)
 			}
 			else {
 j2:
-				dfs.printf("tp1->type:%d",tp1->type);
+				DTRACE(TRC_PARSE).printf("tp1->type:%d",tp1->type);
 				qnode = makeinode(en_icon,sp->value.i);
 				qnode->constflag = TRUE;
 				iu = ep1->isUnsigned;
@@ -1704,16 +1708,16 @@ j2:
 				ep1->esize = 2;
 				ep1->p[2] = pep1;
 				if (tp1->type==bt_pointer && (tp1->GetBtp()->type==bt_func || tp1->GetBtp()->type==bt_ifunc))
-					dfs.printf("Pointer to func");
+					DTRACE(TRC_PARSE).printf("Pointer to func");
 				else
 					tp1 = CondDeref(&ep1,tp1);
 				ep1->SetType(tp1);
-				dfs.printf("tp1->type:%d",tp1->type);
+				DTRACE(TRC_PARSE).printf("tp1->type:%d",tp1->type);
 			}
 			if (tp1==nullptr)
 				getchar();
 			NextToken();       /* past id */
-			dfs.printf("B");
+			DTRACE(TRC_PARSE).printf("B");
 			break;
 
 		case autodec:
@@ -53,7 +53,17 @@ extern bool isFuncBody;
 extern bool isInline;
 extern unsigned int ArgRegCount;
 
+struct FrameFixup {
+	ENODE *ep;
+	int kind;
+};
+static FrameFixup *frameFixups;
+static int nFrameFixups;
+static int maxFrameFixups;
+
 static Statement *ParseFunctionBody(SYM *sp);
+static int TempMemSpace();
+static void FixupFrame(SYM *sp);
 void funcbottom(Statement *stmt);
 void ListCompound(Statement *stmt);
 
@@ -138,20 +148,20 @@ int ParseFunction(SYM *sp)
 	int nump, numa;
 	std::string name;
 
-  dfs.puts("<ParseFunction>\n");
+  DTRACE(TRC_PARSE).puts("<ParseFunction>\n");
   isFuncBody = true;
 	if (sp==NULL) {
 		fatal("Compiler error: ParseFunction: SYM is NULL\r\n");
 	}
-	dfs.printf("***********************************\n");
-	dfs.printf("***********************************\n");
-	dfs.printf("***********************************\n");
+	DTRACE(TRC_PARSE).printf("***********************************\n");
+	DTRACE(TRC_PARSE).printf("***********************************\n");
+	DTRACE(TRC_PARSE).printf("***********************************\n");
 	if (sp->parent)
-		dfs.printf("Parent: %s\n", (char *)sp->GetParentPtr()->name->c_str());
-	dfs.printf("Parsing function: %s\n", (char *)sp->name->c_str());
-	dfs.printf("***********************************\n");
-	dfs.printf("***********************************\n");
-	dfs.printf("***********************************\n");
+		DTRACE(TRC_PARSE).printf("Parent: %s\n", (char *)sp->GetParentPtr()->name->c_str());
+	DTRACE(TRC_PARSE).printf("Parsing function: %s\n", (char *)sp->name->c_str());
+	DTRACE(TRC_PARSE).printf("***********************************\n");
+	DTRACE(TRC_PARSE).printf("***********************************\n");
+	DTRACE(TRC_PARSE).printf("***********************************\n");
 	sp->stkname = stkname;
 	if (verbose) printf("Parsing function: %s\r\n", (char *)sp->name->c_str());
   nump = nparms;
@@ -159,14 +169,14 @@ int ParseFunction(SYM *sp)
   looplevel = 0;
   	foreverlevel = 0;
 		// There could be unnamed parameters in a function prototype.
-	dfs.printf("A");
+	DTRACE(TRC_PARSE).printf("A");
   // declare parameters
   // Building a parameter list here allows both styles of parameter
   // declarations. the original 'C' style is parsed here. Originally the
   // parameter types appeared as list after the parenthesis and before the
   // function body.
 	sp->BuildParameterList(&nump, &numa);
-	dfs.printf("B");
+	DTRACE(TRC_PARSE).printf("B");
   sp->mangledName = sp->BuildSignature(1);  // build against parameters
 
 	// If the symbol has a parent then it must be a class
@@ -176,10 +186,10 @@ int ParseFunction(SYM *sp)
 	name = *sp->name;
 	if (sp->parent) {
 	  SYM *sp2;
-	  dfs.printf("Parent Class:%s|",(char *)sp->GetParentPtr()->name->c_str());
+	  DTRACE(TRC_PARSE).printf("Parent Class:%s|",(char *)sp->GetParentPtr()->name->c_str());
 		sp2 = sp->GetParentPtr()->Find(name);
 		if (sp2) {
-		  dfs.printf("Found at least inexact match");
+		  DTRACE(TRC_PARSE).printf("Found at least inexact match");
       sp2 = sp->FindExactMatch(TABLE::matchno);
     }
 		if (sp2 == nullptr)
@@ -193,10 +203,10 @@ int ParseFunction(SYM *sp)
 			sp = TABLE::match[TABLE::matchno-1];
 		}
 	}
-	dfs.printf("C");
+	DTRACE(TRC_PARSE).printf("C");
 
   if (sp != osp) {
-    dfs.printf("ParseFunction: sp changed\n");
+    DTRACE(TRC_PARSE).printf("ParseFunction: sp changed\n");
     osp->params.CopyTo(&sp->params);
     osp->proto.CopyTo(&sp->proto);
     sp->derivitives = osp->derivitives;
@@ -208,7 +218,7 @@ int ParseFunction(SYM *sp)
 		while (lastst == kw_attribute)
 			Declaration::ParseFunctionAttribute(sp);
 	}
-	dfs.printf("D");
+	DTRACE(TRC_PARSE).printf("D");
 	if (sp->tp->type == bt_pointer) {
 		if (lastst==assign) {
 			doinit(sp);
@@ -232,9 +242,9 @@ int ParseFunction(SYM *sp)
 		return 1;
 	}
 j2:
-	dfs.printf("E");
+	DTRACE(TRC_PARSE).printf("E");
 	if (lastst == semicolon) {	// Function prototype
-		dfs.printf("e");
+		DTRACE(TRC_PARSE).printf("e");
 		sp->IsPrototype = 1;
 		sp->IsNocall = isNocall;
 		sp->IsPascal = isPascal;
@@ -262,7 +272,7 @@ j2:
 		goto j2;
 	}
 	else if(lastst != begin) {
-			dfs.printf("F");
+			DTRACE(TRC_PARSE).printf("F");
 //			NextToken();
 //			ParameterDeclaration::Parse(2);
 			sp->BuildParameterList(&nump, &numa);
@@ -315,7 +325,7 @@ j2:
 		}
 //                error(ERR_BLOCK);
     else {
-dfs.printf("G");
+DTRACE(TRC_PARSE).printf("G");
 			sp->IsNocall = isNocall;
 			sp->IsPascal = isPascal;
 			sp->IsInline = isInline;
@@ -339,8 +349,8 @@ dfs.printf("G");
 			funcbottom(stmt);
     }
 j1:
-dfs.printf("F");
-  dfs.puts("</ParseFunction>\n");
+DTRACE(TRC_PARSE).printf("F");
+  DTRACE(TRC_PARSE).puts("</ParseFunction>\n");
   return 0;
 }
 
@@ -373,7 +383,7 @@ void check_table(SYM *head)
 
 void funcbottom(Statement *stmt)
 { 
-	dfs.printf("Enter funcbottom\n");
+	DTRACE(TRC_PARSE).printf("Enter funcbottom\n");
 	nl();
     check_table(SYM::GetPtr(currentFn->lsyms.GetHead()));
     lc_auto = 0;
@@ -381,7 +391,7 @@ void funcbottom(Statement *stmt)
     ListTable(&currentFn->lsyms,0);
 	// Should recurse into all the compound statements
 	if (stmt==NULL)
-		dfs.printf("DIAG: null statement in funcbottom.\r\n");
+		DTRACE(TRC_PARSE).printf("DIAG: null statement in funcbottom.\r\n");
 	else {
 		if (stmt->stype==st_compound)
 			ListCompound(stmt);
@@ -393,7 +403,7 @@ void funcbottom(Statement *stmt)
 	isOscall = FALSE;
 	isInterrupt = FALSE;
 	isNocall = FALSE;
-	dfs.printf("Leave funcbottom\n");
+	DTRACE(TRC_PARSE).printf("Leave funcbottom\n");
 }
 
 std::string TraceName(SYM *sp)
@@ -425,9 +435,9 @@ static Statement *ParseFunctionBody(SYM *sp)
 {    
 	std::string lbl;
 	char *p;
-	OCODE *ip;
+	ArenaMark mark;
 
-  dfs.printf("<Parse function body>:%s|\n", (char *)sp->name->c_str());
+  DTRACE(TRC_PARSE).printf("<Parse function body>:%s|\n", (char *)sp->name->c_str());
 
 	lbl = std::string("");
 	needpunc(begin,47);
@@ -451,9 +461,10 @@ static Statement *ParseFunctionBody(SYM *sp)
 		lbl += *sp->mangledName;
 		//gen_strlab(lbl);
 	}
-  dfs.printf("B");
+  DTRACE(TRC_PARSE).printf("B");
   p = my_strdup((char *)lbl.c_str());
-  dfs.printf("b");
+  DTRACE(TRC_PARSE).printf("b");
+	mark = Arena::func.Mark();
 	if (!sp->IsInline)
 		GenerateMonadicNT(op_fnname,0,make_string(p));
 	currentFn = sp;
@@ -464,44 +475,94 @@ static Statement *ParseFunctionBody(SYM *sp)
 	regmask = 0;
 	bregmask = 0;
 	currentStmt = (Statement *)NULL;
-  dfs.printf("C");
+  DTRACE(TRC_PARSE).printf("C");
   stmtdepth = 0;
+	Profile::BeginFunction();
 	sp->stmt = Statement::ParseCompound();
-  dfs.printf("D");
+  DTRACE(TRC_PARSE).printf("D");
 //	stmt->stype = st_funcbody;
 	while( lc_auto % sizeOfWord )	// round frame size to word
 		++lc_auto;
 	sp->stkspace = lc_auto;
+	if (optimize)
+		InlineCalls(sp);
 	if (!sp->IsInline) {
-		pass = 1;
-		ip = peep_tail;
+		nFrameFixups = 0;
+		maxFrameFixups = 0;
+		frameFixups = nullptr;
 		looplevel = 0;
 		GenerateFunction(sp);
 		sp->stkspace += (ArgRegCount-regFirstArg) * sizeOfWord;
 		sp->argbot = -sp->stkspace;
-		sp->stkspace += GetTempMemSpace();
+		sp->stkspace += TempMemSpace();
 		sp->tempbot = -sp->stkspace;
-		pass = 2;
-		peep_tail = ip;
-		peep_tail->fwd = nullptr;
-		looplevel = 0;
-		GenerateFunction(sp);
-		dfs.putch('E');
+		FixupFrame(sp);
+		DTRACE(TRC_PARSE).putch('E');
 
 		flush_peep();
 		if (sp->storage_class == sc_global) {
 			ofs.printf("endpublic\r\n\r\n");
 		}
+		ofs.flush();
+		dfs.flush();
+		// The function's code and optimizer data are no longer needed.
+		Arena::func.Release(mark);
 	}
 	//if (sp->stkspace)
 	//ofs.printf("%sSTKSIZE_ EQU %d\r\n", (char *)sp->mangledName->c_str(), sp->stkspace);
 	isFuncBody = false;
-	dfs.printf("</ParseFunctionBody>\n");
+	DTRACE(TRC_PARSE).printf("</ParseFunctionBody>\n");
 	return sp->stmt;
 }
 
-int TempBot()
+// Record an operand that depends on the frame layout. The function's code
+// is generated once, before the space needed for argument registers and
+// spilled temporaries is known, so these operands are generated relative to
+// the part of the frame they refer to and patched by FixupFrame().
+
+void AddFrameFixup(ENODE *ep, int kind)
+{
+	FrameFixup *ff;
+
+	if (nFrameFixups >= maxFrameFixups) {
+		maxFrameFixups = maxFrameFixups ? maxFrameFixups * 2 : 32;
+		ff = (FrameFixup *)allocx(sizeof(FrameFixup) * maxFrameFixups, MEM_CODE);
+		if (frameFixups)
+			memcpy(ff, frameFixups, sizeof(FrameFixup) * nFrameFixups);
+		frameFixups = ff;
+	}
+	frameFixups[nFrameFixups].ep = ep;
+	frameFixups[nFrameFixups].kind = kind;
+	nFrameFixups++;
+}
+
+// Spilled temporaries get a word each, numbered up from the bottom of the
+// temporary area.
+
+static int TempMemSpace()
 {
-	return (currentFn->tempbot);
+	int nn, sz;
+
+	sz = 0;
+	for (nn = 0; nn < nFrameFixups; nn++) {
+		if (frameFixups[nn].kind==FF_TEMPBOT)
+			sz = max(sz, (int)frameFixups[nn].ep->i + sizeOfWord);
+	}
+	return (sz);
+}
+
+// The code shares the offset nodes with the recorded operands, so patching
+// the node updates the instruction.
+
+static void FixupFrame(SYM *sp)
+{
+	int nn;
+
+	for (nn = 0; nn < nFrameFixups; nn++) {
+		switch(frameFixups[nn].kind) {
+		case FF_STKSPACE:	frameFixups[nn].ep->i = sp->stkspace; break;
+		case FF_TEMPBOT:	frameFixups[nn].ep->i += sp->tempbot; break;
+		}
+	}
 }
 
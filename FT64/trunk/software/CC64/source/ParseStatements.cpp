@@ -50,6 +50,7 @@ Statement *NewStatement(int typ, int gt) {
 	s->lptr = my_strdup(inpline);
 	s->prediction = 0;
 	s->depth = stmtdepth;
+	Profile::Number(s);
 	//memset(s->ssyms,0,sizeof(s->ssyms));
 	if (gt) NextToken();
 	return s;
@@ -237,7 +238,7 @@ Statement *Statement::ParseFirstcall()
 	SYM *sp;
 	int st;
 
-	dfs.puts("<ParseFirstcall>");
+	DTRACE(TRC_PARSE).puts("<ParseFirstcall>");
 	snp = NewStatement(st_firstcall, TRUE); 
 	sp = allocSYM();
 	//	sp->SetName(*(new std::string(snp->fcname)));
@@ -254,7 +255,7 @@ Statement *Statement::ParseFirstcall()
 	// Empty statements return NULL
 	if (snp->s1)
 		snp->s1->outer = snp;
-	dfs.puts("</ParseFirstcall>");
+	DTRACE(TRC_PARSE).puts("</ParseFirstcall>");
 	return snp; 
 } 
   
@@ -262,7 +263,7 @@ Statement *Statement::ParseIf()
 {
 	Statement *snp; 
 
-	dfs.puts("<ParseIf>");
+	DTRACE(TRC_PARSE).puts("<ParseIf>");
 	NextToken();
 	if (lastst == kw_firstcall)
 		return (ParseFirstcall());
@@ -303,7 +304,7 @@ Statement *Statement::ParseIf()
 			snp->s2 = 0; 
 	} 
 	iflevel--;
-	dfs.puts("</ParseIf>");
+	DTRACE(TRC_PARSE).puts("</ParseIf>");
 	return snp; 
 } 
 
@@ -421,31 +422,46 @@ Statement *Statement::ParseCase()
     return (snp); 
 } 
   
+static int casevalcmp(const void *a, const void *b)
+{
+	int64_t aa,bb;
+	aa = *(int64_t *)a;
+	bb = *(int64_t *)b;
+	if (aa < bb)
+		return -1;
+	else if (aa==bb)
+		return 0;
+	else
+		return 1;
+}
+
 int Statement::CheckForDuplicateCases() 
 {     
 	Statement *head;
-	Statement *top, *cur, *def;
-	int cnt, cnt2;
-	static int64_t buf[1000];
+	Statement *top, *def;
+	int cnt;
+	int64_t *buf;
 	int ndx;
 
-	ndx = 0;
 	head = this;
-	cur = top = head;
+	// Sort the case values so that duplicates end up next to each other.
+	ndx = 0;
+	for (top = head; top != (Statement *)NULL; top = top->next)
+		if (top->casevals)
+			ndx += (int)top->casevals[0];
+	buf = (int64_t *)xalloc(sizeof(int64_t) * max(ndx,1));
+	ndx = 0;
 	for (top = head; top != (Statement *)NULL; top = top->next)
 	{
 		if (top->casevals) {
-			for (cnt = 1; cnt < top->casevals[0]+1; cnt++) {
-				for (cnt2 = 0; cnt2 < ndx; cnt2++)
-					if (top->casevals[cnt]==buf[cnt2])
-						return (TRUE);
-				if (ndx > 999)
-					throw new C64PException(ERR_TOOMANYCASECONSTANTS,1);
-				buf[ndx] = top->casevals[cnt];
-				ndx++;
-			}
+			for (cnt = 1; cnt < top->casevals[0]+1; cnt++)
+				buf[ndx++] = top->casevals[cnt];
 		}
 	}
+	qsort(buf,ndx,sizeof(int64_t),casevalcmp);
+	for (cnt = 1; cnt < ndx; cnt++)
+		if (buf[cnt]==buf[cnt-1])
+			return (TRUE);
 
 	// Check for duplicate default: statement
 	def = nullptr;
@@ -655,7 +671,7 @@ Statement *Statement::ParseExpression()
 {       
 	Statement *snp;
 
-	dfs.printf("<ParseExpression>\n");
+	DTRACE(TRC_PARSE).printf("<ParseExpression>\n");
 	snp = NewStatement(st_expr, FALSE); 
 	if( expression(&(snp->exp)) == NULL ) { 
 		error(ERR_EXPREXPECT);
@@ -663,7 +679,7 @@ Statement *Statement::ParseExpression()
 	} 
 	if( lastst != end )
 		needpunc( semicolon,44 );
-	dfs.printf("</ParseExpression>\n");
+	DTRACE(TRC_PARSE).printf("</ParseExpression>\n");
 	return snp; 
 } 
 
@@ -803,7 +819,7 @@ Statement *Statement::ParseGoto()
 Statement *Statement::Parse() 
 {
 	Statement *snp; 
-	dfs.puts("<Parse>");
+	DTRACE(TRC_PARSE).puts("<Parse>");
     switch( lastst ) { 
     case semicolon: 
         snp = NewStatement(st_empty,1);
@@ -854,7 +870,7 @@ Statement *Statement::Parse()
 	if( snp != NULL ) {
         snp->next = (Statement *)NULL;
 	}
-	dfs.puts("</Parse>");
+	DTRACE(TRC_PARSE).puts("</Parse>");
 	return snp;
 } 
 
@@ -0,0 +1,505 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2017-2018  Robert Finch, Waterloo
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// CC64 - 'C' derived language compiler
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This source file is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================================
+//
+#include "stdafx.h"
+
+// Precompiled headers.
+//
+// With -fpch=<header> the built in preprocessor puts a "#pch begin" line
+// before the text of the header and a "#pch end" line after it. If the
+// header comes before the first declaration of the source file, its text
+// is read up to the end mark and hashed along with the options. When the
+// image file for the header was made from the same text, the tables it
+// holds are loaded and the text is skipped. Otherwise the text is handed
+// back to getline() and parsed as usual. Once the parser is between
+// declarations after the end of the header the tables are saved to the
+// image for the next compile.
+//
+// The image holds the symbol and type tables, the global hash chains, the
+// tag table, the #define symbols and the global name index. Pointers are
+// stored as table indexes or as offsets into a pool of strings. Output
+// emitted while the header was parsed is kept and written again when the
+// image is loaded. A header that defines a function or initializes data
+// is not saved.
+
+#define PCH_MAGIC	"CC64PCH1"
+
+extern char infile[256];
+extern int gentype;
+extern int curseg;
+extern int outcol;
+
+struct PchHeader {
+	char magic[8];
+	uint64_t key;			// hash of the options and the header text
+	int symsize;			// layout of the tables
+	int typsize;
+	int nsyms;
+	int ntypes;
+	int nkeys;				// size of the name index
+	int nnames;				// names in the name index
+	int nent;
+	int poolsize;
+	int outsize;
+	int nlabels;			// labels, static and thread storage used
+	int nstatic;
+	int nthread;
+	int curseg, gentype, outcol;	// output state before the header
+	int curseg1, gentype1, outcol1;	// and after
+};
+
+static char *header;		// header to precompile, nullptr if none
+static char image[260];
+static std::string opts;
+static std::string text;	// text of the header while it's replayed
+static size_t textpos;
+static uint64_t key;
+static bool ready;			// nothing has been parsed yet
+static bool replay;
+static bool ended;			// replay reached the end of the header
+static int startSym, startTyp, startLabel, startStatic, startThread;
+static int startSeg, startGen, startCol;
+static int endSym, endTyp;
+static int64_t startOut;
+static struct slit *startStr;
+static struct clit *startCase;
+static Float128 *startQuad;
+
+static TYP *stdtypes[] = {
+	&stdint, &stduint, &stdlong, &stdulong, &stdshort, &stdushort, &stdchar,
+	&stduchar, &stdbyte, &stdubyte, &stdstring, &stddbl, &stdtriple, &stdflt,
+	&stddouble, &stdfunc, &stdexception, &stdconst, &stdquad, &stdvector
+};
+
+// The image is named after the header, in the current directory.
+
+void Pch::SetHeader(char *nm)
+{
+	header = nm;
+	_splitpath_s(nm, NULL, 0, NULL, 0, image, sizeof(image) - 4, NULL, 0);
+	strcat_s(image, sizeof(image), ".pch");
+	fppMarkInclude(nm);
+}
+
+void Pch::AddOption(char *opt)
+{
+	opts += opt;
+	opts += " ";
+}
+
+void Pch::Start()
+{
+	ready = header != nullptr && !extfpp;
+	replay = false;
+	ended = false;
+	startSym = compiler.symnum;
+	startTyp = compiler.typenum;
+	startLabel = nextlabel;
+	startStatic = lc_static;
+	startThread = lc_thread;
+	startSeg = curseg;
+	startGen = gentype;
+	startCol = outcol;
+	startOut = ofs.Tell();
+	startStr = strtab;
+	startCase = casetab;
+	startQuad = quadtab;
+}
+
+bool Pch::Replaying()
+{
+	return (replay);
+}
+
+// Called by preprocess() for a "#pch" line. The lines of the header are
+// read here when it's the first thing in the source file.
+
+int Pch::Directive()
+{
+	char buf[514];
+	int nlines;
+	bool loaded;
+	FILE *fp;
+
+	NextToken();
+	// The marks don't count as lines of the source.
+	--lineno;
+	if (!ready || lastst != id || strcmp(lastkw, "begin") != 0)
+		return (getline(incldepth == 0));
+	ready = false;
+	text.clear();
+	for (nlines = 0; fppGetLine(buf, 512) > 0; nlines++) {
+		if (strncmp(buf, "#pch end", 8)==0)
+			break;
+		text += buf;
+		text += "\n";
+	}
+	key = SymbolIndex::Hash(opts + text);
+	loaded = false;
+	if ((fp = fopen(image, "rb")) != nullptr) {
+		loaded = Load(fp);
+		fclose(fp);
+	}
+	if (loaded) {
+		DTRACE(TRC_SYM).printf("<Pch>Loaded %s</Pch>\n", image);
+		lineno += nlines;
+		text.clear();
+	}
+	else {
+		textpos = 0;
+		replay = true;
+	}
+	return (getline(incldepth == 0));
+}
+
+// Hands the header text back to getline() a line at a time, then goes on
+// with the source file.
+
+int Pch::GetLine(char *buf, int len)
+{
+	size_t nl;
+	int n;
+
+	if (textpos < text.length()) {
+		nl = text.find('\n', textpos);
+		n = (int)(nl - textpos);
+		if (n >= len)
+			n = len - 1;
+		memcpy(buf, &text[textpos], n);
+		buf[n] = '\0';
+		textpos = nl + 1;
+		return (n + 1);
+	}
+	replay = false;
+	ended = true;
+	endSym = compiler.symnum;
+	endTyp = compiler.typenum;
+	text.clear();
+	return (fppGetLine(buf, len));
+}
+
+// Called by the parser before each global declaration. If the end of the
+// header was reached since the last one, and nothing has been declared
+// since, the tables hold just the header.
+
+void Pch::Boundary()
+{
+	ready = false;
+	if (!ended)
+		return;
+	ended = false;
+	if (compiler.symnum == endSym && compiler.typenum == endTyp)
+		Save();
+	else
+		DTRACE(TRC_SYM).printf("<Pch>%s ends inside a declaration</Pch>\n", header);
+}
+
+static void *PutStr(std::string& pool, const char *s)
+{
+	size_t off;
+
+	if (s == nullptr)
+		return (nullptr);
+	off = pool.length() + 1;
+	pool += s;
+	pool += '\0';
+	return ((void *)off);
+}
+
+static std::string *PutName(std::string& pool, std::string *s)
+{
+	return ((std::string *)PutStr(pool, s ? s->c_str() : nullptr));
+}
+
+static char *GetStr(char *pool, void *p)
+{
+	return (p ? &pool[(size_t)p - 1] : nullptr);
+}
+
+static std::string *GetName(char *pool, std::string *p)
+{
+	return (p ? new std::string(&pool[(size_t)p - 1]) : nullptr);
+}
+
+static bool PutType(TYP **tpp)
+{
+	TYP *tp = *tpp;
+	int nn;
+
+	if (tp == nullptr)
+		return (true);
+	if (tp >= &compiler.typeTable[0] && tp < &compiler.typeTable[compiler.typenum]) {
+		*tpp = (TYP *)(intptr_t)(tp - compiler.typeTable + 1);
+		return (true);
+	}
+	for (nn = 0; nn < sizeof(stdtypes)/sizeof(stdtypes[0]); nn++) {
+		if (tp == stdtypes[nn]) {
+			*tpp = (TYP *)(intptr_t)-(nn + 1);
+			return (true);
+		}
+	}
+	return (false);
+}
+
+static TYP *GetType(TYP *tp)
+{
+	intptr_t n = (intptr_t)tp;
+
+	if (n > 0)
+		return (&compiler.typeTable[n - 1]);
+	if (n < 0)
+		return (stdtypes[-n - 1]);
+	return (nullptr);
+}
+
+static bool PutSym(SYM **spp)
+{
+	SYM *sp = *spp;
+
+	if (sp == nullptr)
+		return (true);
+	if (sp < &compiler.symbolTable[0] || sp >= &compiler.symbolTable[compiler.symnum])
+		return (false);
+	*spp = (SYM *)(intptr_t)(sp - compiler.symbolTable + 1);
+	return (true);
+}
+
+static SYM *GetSym(SYM *sp)
+{
+	return (sp ? &compiler.symbolTable[(intptr_t)sp - 1] : nullptr);
+}
+
+void Pch::Save()
+{
+	PchHeader hd;
+	std::string pool;
+	SYM *syms, *sp;
+	TYP *typs;
+	SymbolIndex::Key *keys;
+	std::string *nm;
+	bool *isdef;
+	const char *out;
+	char tmp[300];
+	char base[256];
+	int nn, n;
+	FILE *fp;
+
+	out = ofs.Since(startOut, &hd.outsize);
+	if (out == nullptr || strtab != startStr || casetab != startCase || quadtab != startQuad)
+		return;
+	memcpy(hd.magic, PCH_MAGIC, sizeof(hd.magic));
+	hd.key = key;
+	hd.symsize = sizeof(SYM);
+	hd.typsize = sizeof(TYP);
+	hd.nsyms = compiler.symnum;
+	hd.ntypes = compiler.typenum;
+	hd.nkeys = SymbolIndex::size;
+	hd.nnames = SymbolIndex::count;
+	// The index has no entries until the first global is declared.
+	hd.nent = SymbolIndex::entsym ? SymbolIndex::nent : 0;
+	hd.nlabels = nextlabel - startLabel;
+	hd.nstatic = lc_static - startStatic;
+	hd.nthread = lc_thread - startThread;
+	hd.curseg = startSeg;
+	hd.gentype = startGen;
+	hd.outcol = startCol;
+	hd.curseg1 = curseg;
+	hd.gentype1 = gentype;
+	hd.outcol1 = outcol;
+
+	isdef = new bool[hd.nsyms];
+	ZeroMemory(isdef, hd.nsyms * sizeof(bool));
+	for (n = defsyms.head; n > 0 && n < hd.nsyms && !isdef[n]; n = compiler.symbolTable[n].next)
+		isdef[n] = true;
+	syms = new SYM[hd.nsyms];
+	typs = new TYP[hd.ntypes];
+	keys = new SymbolIndex::Key[hd.nkeys];
+	memcpy(syms, compiler.symbolTable, hd.nsyms * sizeof(SYM));
+	memcpy(typs, compiler.typeTable, hd.ntypes * sizeof(TYP));
+	if (hd.nkeys)
+		memcpy(keys, SymbolIndex::keys, hd.nkeys * sizeof(SymbolIndex::Key));
+	for (nn = 0; nn < hd.nsyms; nn++) {
+		sp = &syms[nn];
+		// Code and initialized data can't be replayed from the image.
+		if (sp->derivitives || sp->initexp || sp->stmt || sp->prolog || sp->epilog
+			|| sp->csetbl || sp->inlinexp || sp->f128.next
+			|| !PutType(&sp->tp) || !PutSym(&sp->parms) || !PutSym(&sp->nextparm)) {
+			DTRACE(TRC_SYM).printf("<Pch>%s not saved</Pch>\n", header);
+			goto xit;
+		}
+		sp->name = PutName(pool, sp->name);
+		sp->name2 = PutName(pool, sp->name2);
+		sp->name3 = PutName(pool, sp->name3);
+		sp->shortname = PutName(pool, sp->shortname);
+		sp->mangledName = PutName(pool, sp->mangledName);
+		sp->realname = (char *)PutStr(pool, sp->realname);
+		sp->stkname = (char *)PutStr(pool, sp->stkname);
+		if (isdef[nn])
+			sp->value.s = (char *)PutStr(pool, sp->value.s);
+	}
+	for (nn = 0; nn < hd.ntypes; nn++)
+		typs[nn].sname = PutName(pool, typs[nn].sname);
+	// An index entry refers to one of the three names of its first symbol.
+	for (nn = 0; nn < hd.nkeys; nn++) {
+		if ((nm = keys[nn].name) != nullptr) {
+			sp = SYM::GetPtr(SymbolIndex::entsym[keys[nn].head]);
+			keys[nn].name = (std::string *)(intptr_t)(nm==sp->name ? 1 : nm==sp->name2 ? 2 : nm==sp->name3 ? 3 : 0);
+			if (keys[nn].name == nullptr)
+				goto xit;
+		}
+	}
+	hd.poolsize = pool.length();
+
+	_splitpath_s(infile, NULL, 0, NULL, 0, base, sizeof(base), NULL, 0);
+	snprintf(tmp, sizeof(tmp), "%s.%s", image, base);
+	if ((fp = fopen(tmp, "wb")) == nullptr)
+		goto xit;
+	fwrite(&hd, sizeof(hd), 1, fp);
+	fwrite(syms, sizeof(SYM), hd.nsyms, fp);
+	fwrite(typs, sizeof(TYP), hd.ntypes, fp);
+	fwrite(gsyms, sizeof(TABLE), 257, fp);
+	fwrite(&tagtable, sizeof(TABLE), 1, fp);
+	fwrite(&defsyms, sizeof(TABLE), 1, fp);
+	fwrite(keys, sizeof(SymbolIndex::Key), hd.nkeys, fp);
+	fwrite(SymbolIndex::entsym, sizeof(int), hd.nent, fp);
+	fwrite(SymbolIndex::entnext, sizeof(int), hd.nent, fp);
+	fwrite(pool.data(), 1, hd.poolsize, fp);
+	fwrite(out, 1, hd.outsize, fp);
+	n = ferror(fp);
+	fclose(fp);
+	// Compiles running at the same time each write a file of their own.
+	remove(image);
+	if (n || rename(tmp, image))
+		remove(tmp);
+	else
+		DTRACE(TRC_SYM).printf("<Pch>Saved %s</Pch>\n", image);
+xit:
+	delete[] keys;
+	delete[] typs;
+	delete[] syms;
+	delete[] isdef;
+}
+
+// Loads the image if it was made from the same header text, and from the
+// state the compiler is in at the start of a file.
+
+bool Pch::Load(FILE *fp)
+{
+	PchHeader hd;
+	SymbolIndex::Key *kp;
+	SYM *sp;
+	char *buf, *p, *pool;
+	size_t sz;
+	int nn, n;
+
+	if (fread(&hd, sizeof(hd), 1, fp) != 1)
+		return (false);
+	if (memcmp(hd.magic, PCH_MAGIC, sizeof(hd.magic)) || hd.key != key
+		|| hd.symsize != sizeof(SYM) || hd.typsize != sizeof(TYP)
+		|| hd.nsyms < startSym || hd.nsyms > 32760 || hd.ntypes < startTyp || hd.ntypes > 32760
+		|| hd.curseg != curseg || hd.gentype != gentype || hd.outcol != outcol
+		|| compiler.symnum != startSym || compiler.typenum != startTyp)
+		return (false);
+	sz = (size_t)hd.nsyms * sizeof(SYM) + (size_t)hd.ntypes * sizeof(TYP)
+		+ 259 * sizeof(TABLE) + (size_t)hd.nkeys * sizeof(SymbolIndex::Key)
+		+ (size_t)hd.nent * 2 * sizeof(int) + hd.poolsize + hd.outsize;
+	buf = new char[sz];
+	if (fread(buf, 1, sz, fp) != sz) {
+		delete[] buf;
+		return (false);
+	}
+	p = buf;
+	memcpy(compiler.symbolTable, p, hd.nsyms * sizeof(SYM));
+	p += hd.nsyms * sizeof(SYM);
+	memcpy(compiler.typeTable, p, hd.ntypes * sizeof(TYP));
+	p += hd.ntypes * sizeof(TYP);
+	memcpy(gsyms, p, 257 * sizeof(TABLE));
+	p += 257 * sizeof(TABLE);
+	memcpy(&tagtable, p, sizeof(TABLE));
+	p += sizeof(TABLE);
+	memcpy(&defsyms, p, sizeof(TABLE));
+	p += sizeof(TABLE);
+	kp = (SymbolIndex::Key *)p;
+	p += hd.nkeys * sizeof(SymbolIndex::Key);
+	pool = p + hd.nent * 2 * sizeof(int);
+
+	compiler.symnum = hd.nsyms;
+	compiler.typenum = hd.ntypes;
+	for (n = defsyms.head; n > 0 && n < hd.nsyms; n = compiler.symbolTable[n].next)
+		compiler.symbolTable[n].value.s = GetStr(pool, compiler.symbolTable[n].value.s);
+	for (nn = 0; nn < hd.nsyms; nn++) {
+		sp = &compiler.symbolTable[nn];
+		sp->name = GetName(pool, sp->name);
+		sp->name2 = GetName(pool, sp->name2);
+		sp->name3 = GetName(pool, sp->name3);
+		sp->shortname = GetName(pool, sp->shortname);
+		sp->mangledName = GetName(pool, sp->mangledName);
+		sp->realname = GetStr(pool, sp->realname);
+		sp->stkname = GetStr(pool, sp->stkname);
+		sp->tp = GetType(sp->tp);
+		sp->parms = GetSym(sp->parms);
+		sp->nextparm = GetSym(sp->nextparm);
+	}
+	for (nn = 0; nn < hd.ntypes; nn++)
+		compiler.typeTable[nn].sname = GetName(pool, compiler.typeTable[nn].sname);
+
+	// The name index
+	delete[] SymbolIndex::keys;
+	SymbolIndex::keys = hd.nkeys ? new SymbolIndex::Key[hd.nkeys] : nullptr;
+	if (hd.nkeys)
+		memcpy(SymbolIndex::keys, kp, hd.nkeys * sizeof(SymbolIndex::Key));
+	SymbolIndex::size = hd.nkeys;
+	SymbolIndex::count = hd.nnames;
+	for (nn = 0; nn < hd.nkeys; nn++) {
+		kp = &SymbolIndex::keys[nn];
+		if (kp->name) {
+			sp = SYM::GetPtr(((int *)p)[kp->head]);
+			kp->name = kp->name==(std::string *)1 ? sp->name : kp->name==(std::string *)2 ? sp->name2 : sp->name3;
+		}
+	}
+	if (SymbolIndex::maxent < hd.nent) {
+		delete[] SymbolIndex::entsym;
+		delete[] SymbolIndex::entnext;
+		SymbolIndex::maxent = hd.nent * 2;
+		SymbolIndex::entsym = new int[SymbolIndex::maxent];
+		SymbolIndex::entnext = new int[SymbolIndex::maxent];
+	}
+	if (hd.nent) {
+		memcpy(SymbolIndex::entsym, p, hd.nent * sizeof(int));
+		memcpy(SymbolIndex::entnext, p + hd.nent * sizeof(int), hd.nent * sizeof(int));
+	}
+	SymbolIndex::nent = max(hd.nent, 1);
+
+	nextlabel += hd.nlabels;
+	lc_static += hd.nstatic;
+	lc_thread += hd.nthread;
+	curseg = hd.curseg1;
+	gentype = hd.gentype1;
+	outcol = hd.outcol1;
+	if (hd.outsize > 0)
+		ofs.append(pool + hd.poolsize, hd.outsize);
+	delete[] buf;
+	return (true);
+}
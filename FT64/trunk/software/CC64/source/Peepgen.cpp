@@ -26,6 +26,8 @@
 #include "stdafx.h"
 
 static void AddToPeepList(OCODE *newc);
+static void PeepPush(OCODE *ip);
+static void PeepRemove(OCODE *ip);
 static void Remove();
 void MarkRemove(OCODE *ip);
 void peep_add(OCODE *ip);
@@ -64,6 +66,12 @@ extern BasicBlock *RootBlock;
 extern BasicBlock *LastBlock;
 
 int optimized;	// something got optimized
+static OCODE *peepWork;	// peephole work list
+
+OCODE *OCODE::MakeNew()
+{
+	return ((OCODE *)allocx(sizeof(OCODE), MEM_CODE));
+}
 
 AMODE *copy_addr(AMODE *ap)
 {
@@ -78,7 +86,7 @@ AMODE *copy_addr(AMODE *ap)
 void GeneratePredicatedMonadic(int pr, int pop, int op, int len, AMODE *ap1)
 {
 	OCODE *cd;
-	cd = (OCODE *)allocx(sizeof(OCODE));
+	cd = OCODE::MakeNew();
 	cd->predop = pop;
 	cd->pregreg = pr;
 	cd->insn = GetInsn(op);
@@ -94,34 +102,34 @@ void GeneratePredicatedMonadic(int pr, int pop, int op, int len, AMODE *ap1)
 
 void GenerateZeradic(int op)
 {
-	dfs.printf("<GenerateZeradic>\r\n");
+	DTRACE(TRC_PEEP).printf("<GenerateZeradic>\r\n");
 	OCODE *cd;
-	dfs.printf("A");
-	cd = (OCODE *)allocx(sizeof(OCODE));
-	dfs.printf("B");
+	DTRACE(TRC_PEEP).printf("A");
+	cd = OCODE::MakeNew();
+	DTRACE(TRC_PEEP).printf("B");
 	cd->predop = 1;
 	cd->pregreg = 15;
 	cd->insn = GetInsn(op);
 	cd->opcode = op;
 	cd->length = 0;
 	cd->oper1 = NULL;
-	dfs.printf("C");
+	DTRACE(TRC_PEEP).printf("C");
 	cd->oper2 = NULL;
 	cd->oper3 = NULL;
 	cd->oper4 = NULL;
-	dfs.printf("D");
+	DTRACE(TRC_PEEP).printf("D");
 	cd->loop_depth = looplevel;
 	AddToPeepList(cd);
-	dfs.printf("</GenerateZeradic>\r\n");
+	DTRACE(TRC_PEEP).printf("</GenerateZeradic>\r\n");
 }
 
 void GenerateMonadic(int op, int len, AMODE *ap1)
 {
-	dfs.printf("Enter GenerateMonadic\r\n");
+	DTRACE(TRC_PEEP).printf("Enter GenerateMonadic\r\n");
 	OCODE *cd;
-	dfs.printf("A");
-	cd = (OCODE *)allocx(sizeof(OCODE));
-	dfs.printf("B");
+	DTRACE(TRC_PEEP).printf("A");
+	cd = OCODE::MakeNew();
+	DTRACE(TRC_PEEP).printf("B");
 	cd->predop = 1;
 	cd->pregreg = 15;
 	cd->insn = GetInsn(op);
@@ -129,44 +137,44 @@ void GenerateMonadic(int op, int len, AMODE *ap1)
 	cd->length = len;
 	cd->oper1 = copy_addr(ap1);
 	cd->oper1->isTarget = 1;
-	dfs.printf("C");
+	DTRACE(TRC_PEEP).printf("C");
 	cd->oper2 = NULL;
 	cd->oper3 = NULL;
 	cd->oper4 = NULL;
-	dfs.printf("D");
+	DTRACE(TRC_PEEP).printf("D");
 	cd->loop_depth = looplevel;
 	AddToPeepList(cd);
-	dfs.printf("Leave GenerateMonadic\r\n");
+	DTRACE(TRC_PEEP).printf("Leave GenerateMonadic\r\n");
 }
 
 // NT = no target register
 void GenerateMonadicNT(int op, int len, AMODE *ap1)
 {
-	dfs.printf("Enter GenerateMonadic\r\n");
+	DTRACE(TRC_PEEP).printf("Enter GenerateMonadic\r\n");
 	OCODE *cd;
-	dfs.printf("A");
-	cd = (OCODE *)allocx(sizeof(OCODE));
-	dfs.printf("B");
+	DTRACE(TRC_PEEP).printf("A");
+	cd = OCODE::MakeNew();
+	DTRACE(TRC_PEEP).printf("B");
 	cd->predop = 1;
 	cd->pregreg = 15;
 	cd->insn = GetInsn(op);
 	cd->opcode = op;
 	cd->length = len;
 	cd->oper1 = copy_addr(ap1);
-	dfs.printf("C");
+	DTRACE(TRC_PEEP).printf("C");
 	cd->oper2 = NULL;
 	cd->oper3 = NULL;
 	cd->oper4 = NULL;
-	dfs.printf("D");
+	DTRACE(TRC_PEEP).printf("D");
 	cd->loop_depth = looplevel;
 	AddToPeepList(cd);
-	dfs.printf("Leave GenerateMonadic\r\n");
+	DTRACE(TRC_PEEP).printf("Leave GenerateMonadic\r\n");
 }
 
 void GeneratePredicatedDiadic(int pop, int pr, int op, int len, AMODE *ap1, AMODE *ap2)
 {
 	OCODE *cd;
-	cd = (OCODE *)allocx(sizeof(OCODE));
+	cd = OCODE::MakeNew();
 	cd->predop = pop;
 	cd->pregreg = pr;
 	cd->insn = GetInsn(op);
@@ -184,7 +192,7 @@ void GeneratePredicatedDiadic(int pop, int pr, int op, int len, AMODE *ap1, AMOD
 void GenerateDiadic(int op, int len, AMODE *ap1, AMODE *ap2)
 {
 	OCODE *cd;
-	cd = (OCODE *)xalloc(sizeof(OCODE));
+	cd = OCODE::MakeNew();
 	cd->predop = 1;
 	cd->pregreg = 15;
 	cd->insn = GetInsn(op);
@@ -209,7 +217,7 @@ void GenerateDiadic(int op, int len, AMODE *ap1, AMODE *ap2)
 void GenerateDiadicNT(int op, int len, AMODE *ap1, AMODE *ap2)
 {
 	OCODE *cd;
-	cd = (OCODE *)xalloc(sizeof(OCODE));
+	cd = OCODE::MakeNew();
 	cd->predop = 1;
 	cd->pregreg = 15;
 	cd->insn = GetInsn(op);
@@ -232,7 +240,7 @@ void GenerateDiadicNT(int op, int len, AMODE *ap1, AMODE *ap2)
 void GenerateTriadic(int op, int len, AMODE *ap1, AMODE *ap2, AMODE *ap3)
 {
 	OCODE    *cd;
-	cd = (OCODE *)allocx(sizeof(OCODE));
+	cd = OCODE::MakeNew();
 	cd->predop = 1;
 	cd->pregreg = 15;
 	cd->insn = GetInsn(op);
@@ -250,7 +258,7 @@ void GenerateTriadic(int op, int len, AMODE *ap1, AMODE *ap2, AMODE *ap3)
 void GenerateTriadicNT(int op, int len, AMODE *ap1, AMODE *ap2, AMODE *ap3)
 {
 	OCODE    *cd;
-	cd = (OCODE *)allocx(sizeof(OCODE));
+	cd = OCODE::MakeNew();
 	cd->predop = 1;
 	cd->pregreg = 15;
 	cd->insn = GetInsn(op);
@@ -267,7 +275,7 @@ void GenerateTriadicNT(int op, int len, AMODE *ap1, AMODE *ap2, AMODE *ap3)
 void Generate4adic(int op, int len, AMODE *ap1, AMODE *ap2, AMODE *ap3, AMODE *ap4)
 {
 	OCODE *cd;
-	cd = (OCODE *)allocx(sizeof(OCODE));
+	cd = OCODE::MakeNew();
 	cd->predop = 1;
 	cd->pregreg = 15;
 	cd->insn = GetInsn(op);
@@ -285,7 +293,7 @@ void Generate4adic(int op, int len, AMODE *ap1, AMODE *ap2, AMODE *ap3, AMODE *a
 void Generate4adicNT(int op, int len, AMODE *ap1, AMODE *ap2, AMODE *ap3, AMODE *ap4)
 {
 	OCODE *cd;
-	cd = (OCODE *)allocx(sizeof(OCODE));
+	cd = OCODE::MakeNew();
 	cd->predop = 1;
 	cd->pregreg = 15;
 	cd->insn = GetInsn(op);
@@ -346,18 +354,49 @@ int PeepCount(OCODE *ip)
 void GenerateLabel(int labno)
 {      
 	OCODE *newl;
-	newl = (OCODE *)allocx(sizeof(OCODE));
+	newl = OCODE::MakeNew();
 	newl->opcode = op_label;
 	newl->oper1 = (AMODE *)labno;
 	newl->oper2 = (AMODE *)my_strdup((char *)currentFn->name->c_str());
 	AddToPeepList(newl);
+	if (dogen)
+		LabelIndex::Insert(newl);
 }
 
 
-// Detect references to labels
-// Potential looping is N^2 although the inner loop is aborted as soon as a
-// reference is found. It's a good thing functions are small and without
-// too many lables.
+// Count references to labels
+// Each operand that could hold a label is looked up in the label index so
+// the cost is linear in the number of instructions. A label whose count
+// drops to zero goes on the work list to be removed.
+
+static void ReferenceLabel(AMODE *ap, int n)
+{
+	OCODE *p;
+
+	// Only label constants refer to labels; a plain immediate that happens
+	// to equal a label number doesn't.
+	if (ap && (ap->mode==am_direct || ap->mode==am_immed) && ap->offset
+		&& (ap->offset->nodetype==en_labcon || ap->offset->nodetype==en_clabcon)) {
+		p = LabelIndex::Find(ap->offset->i);
+		if (p) {
+			p->refcount += n;
+			if (p->refcount <= 0) {
+				p->refcount = 0;
+				PeepPush(p);
+			}
+		}
+	}
+}
+
+static void CountLabelRefs(OCODE *ip, int n)
+{
+	if (ip->opcode!=op_label && ip->opcode!=op_nop) {
+		ReferenceLabel(ip->oper1, n);
+		ReferenceLabel(ip->oper2, n);
+		ReferenceLabel(ip->oper3, n);
+		ReferenceLabel(ip->oper4, n);
+	}
+}
 
 static void SetLabelReference()
 {
@@ -366,44 +405,17 @@ static void SetLabelReference()
 	int nn;
 
 	for (p = peep_head; p; p = p->fwd) {
-		if (p->opcode==op_label) {
-			p->isReferenced = false;
-			for (q = peep_head; q; q = q->fwd) {
-				if (q != p) {
-					if (q->opcode!=op_label && q->opcode!=op_nop) {
-						if (q->oper1 && (q->oper1->mode==am_direct || q->oper1->mode==am_immed)) {
-							if (q->oper1->offset->i == (int)p->oper1) {
-								p->isReferenced = true;
-								break;
-							}
-						}
-						if (q->oper2 && (q->oper2->mode==am_direct || q->oper2->mode==am_immed)) {
-							if (q->oper2->offset->i == (int)p->oper1) {
-								p->isReferenced = true;
-								break;
-							}
-						}
-						if (q->oper3 && (q->oper3->mode==am_direct || q->oper3->mode==am_immed)) {
-							if (q->oper3->offset->i == (int)p->oper1) {
-								p->isReferenced = true;
-								break;
-							}
-						}
-						if (q->oper4 && (q->oper4->mode==am_direct || q->oper4->mode==am_immed)) {
-							if (q->oper4->offset->i == (int)p->oper1) {
-								p->isReferenced = true;
-								break;
-							}
-						}
-					}
-				}
-			}
-			// Now search case tables for label
-			for (ct = casetab; ct; ct = ct->next) {
-				for (nn = 0; nn < ct->num; nn++)
-					if (ct->cases[nn].label==(int)p->oper1)
-						p->isReferenced = true;
-			}
+		if (p->opcode==op_label)
+			p->refcount = 0;
+	}
+	for (q = peep_head; q; q = q->fwd)
+		CountLabelRefs(q, 1);
+	// Now search case tables for labels
+	for (ct = casetab; ct; ct = ct->next) {
+		for (nn = 0; nn < ct->num; nn++) {
+			p = LabelIndex::Find(ct->cases[nn].label);
+			if (p)
+				p->refcount++;
 		}
 	}
 }
@@ -413,15 +425,59 @@ static void EliminateUnreferencedLabels()
 	OCODE *p;
 
 	for (p = peep_head; p; p = p->fwd) {
-		if (p->opcode==op_label)
-			p->remove = false;
-		if (p->opcode==op_label && !p->isReferenced) {
-			MarkRemove(p);
-			optimized++;
+		if (p->opcode==op_label) {
+			if (p->refcount==0) {
+				MarkRemove(p);
+				optimized++;
+			}
+			else if (p->remove) {
+				p->remove = false;
+				LabelIndex::Insert(p);
+			}
 		}
 	}
 }
 
+// The peephole optimizer works from a list of instructions to look at.
+// When a rule changes the code, the instructions next to the change go
+// back on the list since another rule may now apply to them.
+
+static void PeepPush(OCODE *ip)
+{
+	if (ip==nullptr || ip->inWork)
+		return;
+	ip->inWork = true;
+	ip->wnext = peepWork;
+	peepWork = ip;
+}
+
+// Take an instruction out of the peep list right away, rather than marking
+// it for Remove().
+
+static void PeepRemove(OCODE *ip)
+{
+	if (ip==nullptr || ip->remove)
+		return;
+	ip->remove = true;
+	if (ip->back)
+		ip->back->fwd = ip->fwd;
+	else
+		peep_head = ip->fwd;
+	if (ip->fwd) {
+		if (ip->fwd->comment==nullptr)
+			ip->fwd->comment = ip->comment;
+		ip->fwd->back = ip->back;
+	}
+	else
+		peep_tail = ip->back;
+	if (ip->opcode==op_label)
+		LabelIndex::Remove(ip);
+	else
+		CountLabelRefs(ip, -1);
+	PeepPush(ip->fwd);
+	PeepPush(ip->back);
+}
+
 
 //
 // Output all code and labels in the peep list.
@@ -433,10 +489,13 @@ void flush_peep()
 	{
 		if( peep_head->opcode == op_label )
 			put_label((int)peep_head->oper1,"",GetNamespace(),'C');
-		else
+		else {
+			Profile::PutLabel(peep_head);
 			put_ocode(peep_head);
+		}
 		peep_head = peep_head->fwd;
 	}
+	LabelIndex::Clear();
 }
 
 /*
@@ -460,7 +519,7 @@ void put_ocode(OCODE *p)
 void peep_move(OCODE *ip)
 {
 	if (equal_address(ip->oper1, ip->oper2)) {
-		MarkRemove(ip);
+		PeepRemove(ip);
 		optimized++;
 		return;
 	}
@@ -516,8 +575,7 @@ void peep_add(OCODE *ip)
                             if (ip->fwd->oper1->preg == regSP) {
                                 if (ip->back==NULL)
                                     return;
-                                ip->back->fwd = ip->fwd;
-                                ip->fwd->back = ip->back;
+                                PeepRemove(ip);
 								optimized++;
                             }
                         }
@@ -579,7 +637,7 @@ static void MergeSubi(OCODE *first, OCODE *last, int64_t amt)
 	// First remove all the excess subtracts
 	for (ip = first; ip && ip != last; ip = ip->fwd) {
 		if (IsSubiSP(ip)) {
-			MarkRemove(ip);
+			PeepRemove(ip);
 			optimized++;
 		}
 	}
@@ -708,9 +766,7 @@ void PeepoptUctran(OCODE *ip)
 	if (uctran_off) return;
 	while( ip->fwd != NULL && ip->fwd->opcode != op_label)
 	{
-		ip->fwd = ip->fwd->fwd;
-		if( ip->fwd != NULL )
-			ip->fwd->back = ip;
+		PeepRemove(ip->fwd);
 		optimized++;
 	}
 }
@@ -723,17 +779,21 @@ void PeepoptJAL(OCODE *ip)
 }
 
 // Remove instructions that branch to the next label.
+// The branch is redundant if only labels lie between it and its target.
 //
 void PeepoptBranch(OCODE *ip)
 {
 	OCODE *p;
 
-	for (p = ip->fwd; p && p->opcode==op_label; p = p->fwd)
-		if (ip->oper1->offset->i == (int)p->oper1) {
-			MarkRemove(ip);
-			optimized++;
-			return;
-		}
+	p = LabelIndex::Find(ip->oper1->offset->i);
+	if (p==nullptr)
+		return;
+	for (p = p->back; p && p->opcode==op_label; p = p->back)
+		;
+	if (p==ip) {
+		PeepRemove(ip);
+		optimized++;
+	}
 	return;
 }
 
@@ -797,10 +857,8 @@ void PeepoptLc(OCODE *ip)
 		if (ip->fwd->opcode==op_sext16 || ip->fwd->opcode==op_sxc ||
 			(ip->fwd->opcode==op_bfext && ip->fwd->oper3->offset->i==0 && ip->fwd->oper4->offset->i==15)) {
 			if (ip->fwd->oper1->preg == ip->oper1->preg) {
-				if (ip->fwd->fwd) {
-					ip->fwd->fwd->back = ip;
-				}
-				ip->fwd = ip->fwd->fwd;
+				PeepRemove(ip->fwd);
+				optimized++;
 			}
 		}
 	}
@@ -963,10 +1021,10 @@ void peep_ld(OCODE *ip)
 		return;
 	if (ip->fwd->oper3->mode != am_immed)
 		return;
+	CountLabelRefs(ip, -1);
 	ip->oper2->offset->i = ip->oper2->offset->i & ip->fwd->oper3->offset->i;
-	if (ip->fwd->fwd)
-		ip->fwd->fwd->back = ip;
-	ip->fwd = ip->fwd->fwd;
+	CountLabelRefs(ip, 1);
+	PeepRemove(ip->fwd);
 	optimized++;
 }
 
@@ -977,16 +1035,16 @@ void PeepoptLd(OCODE *ip)
 }
 
 
-// Remove extra labels at end of subroutines
+// Remove labels that nothing refers to, and extra labels at the end of
+// subroutines.
 
 void PeepoptLabel(OCODE *ip)
 {
     if (!ip)
         return;
-    if (ip->fwd)
+    if (ip->fwd && ip->refcount > 0)
         return;
-	if (ip->back)
-		ip->back->fwd = nullptr;
+	PeepRemove(ip);
 	optimized++;
 }
  
@@ -1005,9 +1063,7 @@ void PeepoptSxb(OCODE *ip)
          return;
      // Now we must have the same instruction twice in a row. ELiminate the
      // duplicate.
-     ip->fwd = ip->fwd->fwd;
-     if (ip->fwd->fwd)
-          ip->fwd->fwd->back = ip;
+	PeepRemove(ip->fwd);
 	optimized++;
 }
 void PeepoptSxbAnd(OCODE *ip)
@@ -1022,37 +1078,23 @@ void PeepoptSxbAnd(OCODE *ip)
 		 return;
      if (ip->fwd->oper3->offset->i != 255)
          return;
-	MarkRemove(ip);
+	PeepRemove(ip);
 	optimized++;
 }
 
 
-// Eliminate branchs to the next line of code.
+// Process compiler hint opcodes
+
+// A register variable is still live after being copied, so the instruction
+// that set it can't be retargeted.
 
-static void opt_nbr()
+static bool IsRegvar(AMODE *ap)
 {
-	OCODE *ip,*pip;
-	
-	ip = peep_head;
-	pip = peep_head;
-	while(ip) { 
-		if (ip->opcode==op_label) {
-			if (pip->opcode==op_br || pip->opcode==op_bra) {
-				if ((int64_t)ip->oper1==pip->oper1->offset->i)	{
-					pip->back->fwd = pip->fwd;
-					ip->back = pip->back;
-					optimized++;
-				}
-			}
-		}
-		pip = ip;
-		ip = ip->fwd;
-	}
+	if (ap->mode != am_reg && ap->mode != am_fpreg)
+		return (false);
+	return (ap->preg >= regFirstRegvar && ap->preg <= regLastRegvar);
 }
 
-
-// Process compiler hint opcodes
-
 static void PeepoptHint(OCODE *ip)
 {
 	if ((ip->back && ip->back->opcode==op_label) || (ip->fwd && ip->fwd->opcode==op_label))
@@ -1069,35 +1111,35 @@ static void PeepoptHint(OCODE *ip)
 	//    MOV r18,#constant
 	case 1:
 		if (ip->fwd && ip->fwd->opcode != op_mov) {
-			MarkRemove(ip);
+			PeepRemove(ip);
 			optimized++;
 			return;
 		}
 		
 		if (ip->fwd && ip->fwd->oper1->preg >= 18 && ip->fwd->oper1->preg < 24) {
-			if (equal_address(ip->fwd->oper2, ip->back->oper1)) {
+			if (equal_address(ip->fwd->oper2, ip->back->oper1) && !IsRegvar(ip->back->oper1)) {
 				ip->back->oper1 = ip->fwd->oper1;
-				MarkRemove(ip);
-				MarkRemove(ip->fwd);
+				PeepRemove(ip);
+				PeepRemove(ip->fwd);
 				optimized++;
 				return;
 			}
 		}
 
 		if (ip->back && ip->back->opcode != op_mov) {
-			MarkRemove(ip);
+			PeepRemove(ip);
 			optimized++;
 			return;
 		}
 		
-		if (equal_address(ip->fwd->oper2, ip->back->oper1)) {
+		if (equal_address(ip->fwd->oper2, ip->back->oper1) && !IsRegvar(ip->back->oper1)) {
 			ip->back->oper1 = ip->fwd->oper1;
-			MarkRemove(ip);
-			MarkRemove(ip->fwd);
+			PeepRemove(ip);
+			PeepRemove(ip->fwd);
 			optimized++;
 		}
 		else {
-			MarkRemove(ip);
+			PeepRemove(ip);
 			optimized++;
 		}
 		break;
@@ -1113,14 +1155,14 @@ static void PeepoptHint(OCODE *ip)
 		if (ip->fwd==nullptr || ip->back==nullptr)
 			break;
 		if (equal_address(ip->fwd->oper2, ip->back->oper1)) {
-			if (ip->back->HasTargetReg()) {
+			if (ip->back->HasTargetReg() && !IsRegvar(ip->back->oper1)) {
 				ip->back->oper1 = ip->fwd->oper1;
-				MarkRemove(ip->fwd);
+				PeepRemove(ip->fwd);
 				optimized++;
 			}
 		}
 		else {
-			MarkRemove(ip);
+			PeepRemove(ip);
 			optimized++;
 		}
 		break;
@@ -1145,7 +1187,7 @@ static void PeepoptHint(OCODE *ip)
 				|| ip->back->oper3->offset->i == 3)) {
 					ip->fwd->oper2->preg = ip->back->oper2->preg;
 					ip->fwd->oper2->scale = 1 << ip->back->oper3->offset->i;
-					MarkRemove(ip->back);
+					PeepRemove(ip->back);
 					optimized++;
 			}
 		}
@@ -1181,6 +1223,7 @@ static void PeepoptSh(OCODE *ip)
 		if (ip->back->oper1->preg==ip->oper1->preg) {
 			if (ip->back->oper3->offset->i == 0 && ip->back->oper4->offset->i==31) {
 				Swap(ip->back,ip);
+				optimized++;
 			}
 		}
 	}
@@ -1202,7 +1245,7 @@ static void PeepoptStore(OCODE *ip)
 		return;
 	if (ip->fwd->isVolatile)
 		return;
-	MarkRemove(ip->fwd);
+	PeepRemove(ip->fwd);
 	optimized++;
 }
 
@@ -1222,7 +1265,7 @@ static void PeepoptAnd(OCODE *ip)
 	if (ip->oper1 && ip->oper2 && ip->oper3) {
 		if (ip->oper1->mode==am_reg && ip->oper2->mode==am_reg && ip->oper3->mode == am_immed) {
 			if (ip->oper1->preg==ip->oper2->preg && ip->oper3->offset->i==-1) {
-				MarkRemove(ip);
+				PeepRemove(ip);
 				optimized++;
 			}
 		}
@@ -1256,7 +1299,7 @@ static void PeepoptAnd(OCODE *ip)
 		// Could do this up to 32 bits
 		return;
 	if (ip->oper2->offset->i < ip->oper3->offset->i) {
-		MarkRemove(ip);
+		PeepRemove(ip);
 	}
 }
 
@@ -1296,6 +1339,8 @@ static int CountBPReferences()
 void MarkRemove(OCODE *ip)
 {
 	ip->remove = true;
+	if (ip->opcode==op_label)
+		LabelIndex::Remove(ip);
 }
 
 void MarkRemove2(OCODE *ip)
@@ -1320,6 +1365,8 @@ void Peep::InsertBefore(OCODE *an, OCODE *cd)
 	if (an->back)
 		an->back->fwd = cd;
 	an->back = cd;
+	if (cd->opcode==op_label)
+		LabelIndex::Insert(cd);
 }
 
 void Peep::InsertAfter(OCODE *an, OCODE *cd)
@@ -1329,6 +1376,8 @@ void Peep::InsertAfter(OCODE *an, OCODE *cd)
 	if (an->fwd)
 		an->fwd->back = cd;
 	an->fwd = cd;
+	if (cd->opcode==op_label)
+		LabelIndex::Insert(cd);
 }
 
 static void Remove()
@@ -1386,7 +1435,7 @@ static void RemoveDoubleTargets(OCODE *ip)
 		return;
 	if (ip->GetTargetReg()==regSP)
 		return;
-	MarkRemove(ip);
+	PeepRemove(ip);
 	optimized++;
 }
 
@@ -1442,6 +1491,151 @@ static void RemoveCompilerHints2()
 	Remove();
 }
 
+// A comment instruction is attached to the instruction following it.
+
+static void PeepoptRem(OCODE *ip)
+{
+	if (ip->fwd) {
+		ip->fwd->comment = ip;
+		PeepRemove(ip);
+		optimized++;
+	}
+}
+
+// Peephole rules are kept in lists by opcode. Rules in the last list are
+// tried on every instruction. Each rule counts the number of times it
+// changed the code.
+
+struct PeepRule {
+	const char *name;
+	void (*fn)(OCODE *);
+	int hits;
+	PeepRule *next;
+};
+
+static PeepRule peepRuleTab[40];
+static int npeepRules;
+static PeepRule *peepRules[op_empty + 2];
+
+static void AddPeepRule(int opcode, const char *name, void (*fn)(OCODE *))
+{
+	PeepRule *r, **pr;
+
+	if (npeepRules >= (int)(sizeof(peepRuleTab)/sizeof(PeepRule)))
+		throw new C64PException(ERR_NULLPOINTER,0x51);
+	r = &peepRuleTab[npeepRules++];
+	r->name = name;
+	r->fn = fn;
+	r->hits = 0;
+	r->next = nullptr;
+	// Rules are tried in the order they are added.
+	for (pr = &peepRules[opcode]; *pr; pr = &(*pr)->next)
+		;
+	*pr = r;
+}
+
+static void InitPeepRules()
+{
+	static bool initialized = false;
+	int any = op_empty + 1;
+
+	if (initialized)
+		return;
+	initialized = true;
+	AddPeepRule(op_rem, "rem", PeepoptRem);
+	AddPeepRule(op_ld, "ld", peep_ld);
+	AddPeepRule(op_ld, "ld2", PeepoptLd);
+	AddPeepRule(op_mov, "mov", peep_move);
+	AddPeepRule(op_add, "add", peep_add);
+	AddPeepRule(op_addu, "add", peep_add);
+	AddPeepRule(op_addui, "add", peep_add);
+	AddPeepRule(op_sub, "sub", PeepoptSub);
+	AddPeepRule(op_cmp, "cmp", peep_cmp);
+	AddPeepRule(op_lc, "lc", PeepoptLc);
+	AddPeepRule(op_sxb, "sx", PeepoptSxb);
+	AddPeepRule(op_sxb, "sxand", PeepoptSxbAnd);
+	AddPeepRule(op_sxc, "sx", PeepoptSxb);
+	AddPeepRule(op_sxc, "sxand", PeepoptSxbAnd);
+	AddPeepRule(op_sxh, "sx", PeepoptSxb);
+	AddPeepRule(op_sxh, "sxand", PeepoptSxbAnd);
+	AddPeepRule(op_br, "branch", PeepoptBranch);
+	AddPeepRule(op_br, "uctran", PeepoptUctran);
+	AddPeepRule(op_bra, "branch", PeepoptBranch);
+	AddPeepRule(op_bra, "uctran", PeepoptUctran);
+	AddPeepRule(op_pop, "pushpop", PeepoptPushPop);
+	AddPeepRule(op_push, "pushpop", PeepoptPushPop);
+	AddPeepRule(op_lea, "lea", PeepoptLea);
+	AddPeepRule(op_jal, "jal", PeepoptJAL);
+	AddPeepRule(op_jmp, "uctran", PeepoptUctran);
+	AddPeepRule(op_ret, "uctran", PeepoptUctran);
+	AddPeepRule(op_rts, "uctran", PeepoptUctran);
+	AddPeepRule(op_rte, "uctran", PeepoptUctran);
+	AddPeepRule(op_rtd, "uctran", PeepoptUctran);
+	AddPeepRule(op_label, "label", PeepoptLabel);
+	AddPeepRule(op_hint, "hint", PeepoptHint);
+	AddPeepRule(op_sh, "store", PeepoptStore);
+	AddPeepRule(op_sw, "store", PeepoptStore);
+	AddPeepRule(op_and, "and", PeepoptAnd);
+	AddPeepRule(any, "doubletarget", RemoveDoubleTargets);
+}
+
+// Apply the rules until none of them change the code. Every instruction
+// starts out on the work list, in order. When a rule fires the instruction
+// and its neighbours are looked at again.
+
+static void PeepoptWork()
+{
+	OCODE *ip;
+	PeepRule *r;
+	int n, nn;
+
+	InitPeepRules();
+	SetLabelReference();
+	for (ip = peep_head; ip && ip->fwd; ip = ip->fwd)
+		;
+	for (; ip; ip = ip->back)
+		PeepPush(ip);
+	while (peepWork) {
+		ip = peepWork;
+		peepWork = ip->wnext;
+		ip->inWork = false;
+		if (ip->remove)
+			continue;
+		// A segment prefix (op_ss) in the upper bits puts the opcode past
+		// the table; such instructions only get the rules for any opcode.
+		for (nn = (unsigned)ip->opcode <= op_empty ? 0 : 1; nn < 2; nn++) {
+			for (r = peepRules[nn ? op_empty + 1 : ip->opcode]; r; r = r->next) {
+				n = optimized;
+				(*r->fn)(ip);
+				if (optimized != n) {
+					r->hits++;
+					// A rule may change the instruction before this one,
+					// which the one before it looks at.
+					PeepPush(ip->fwd);
+					if (ip->back)
+						PeepPush(ip->back->back);
+					PeepPush(ip->back);
+					if (!ip->remove)
+						PeepPush(ip);
+					break;
+				}
+			}
+			if (r)
+				break;
+		}
+	}
+	if (DTRACE_ON(TRC_PEEP)) {
+		dfs.printf("<PeepholeRules>\r\n");
+		for (n = 0; n < npeepRules; n++) {
+			r = &peepRuleTab[n];
+			if (r->hits)
+				dfs.printf("%s: %d\r\n", (char *)r->name, r->hits);
+			r->hits = 0;
+		}
+		dfs.printf("</PeepholeRules>\r\n");
+	}
+}
+
 //
 //      peephole optimizer. This routine calls the instruction
 //      specific optimization routines above for each instruction
@@ -1449,116 +1643,13 @@ static void RemoveCompilerHints2()
 //
 static void opt_peep()
 {  
-	OCODE *ip;
-	int rep;
-	
 	// Remove any dead code identified by the code generator.
 	Remove();
 
 	if (!::opt_nopeep) {
 
-		opt_nbr();
-
-		// Performing peephole optimizations may lead to further optimizations so do
-		// the optimization step a few times.
 		optimized = 0;
-		for (rep = 0; (rep < 5) || (optimized && rep < 10); rep++)
-		{
-			// Peephole optimizations might lead to unreferenced labels, which may make
-			// further peephole optimizations possible.
-			SetLabelReference();
-			EliminateUnreferencedLabels();
-			Remove();
-			//MarkAllKeep();
-			for (ip = peep_head; ip != NULL; ip = ip->fwd )
-			{
-				if (!ip->remove) {
-				switch( ip->opcode )
-				{
-				case op_rem:
-					if (ip->fwd) {
-						ip->fwd->comment = ip;
-						MarkRemove(ip);
-					}
-					break;
-				case op_ld:
-					peep_ld(ip);
-					PeepoptLd(ip);
-				break;
-				case op_mov:
-						peep_move(ip);
-						break;
-				case op_add:
-				case op_addu:
-				case op_addui:
-						peep_add(ip);
-						break;
-				case op_sub:
-						PeepoptSub(ip);
-						break;
-				case op_cmp:
-						peep_cmp(ip);
-						break;
-				case op_mul:
-	//                    PeepoptMuldiv(ip,op_shl);
-						break;
-				case op_lc:
-						PeepoptLc(ip);
-						break;
-				case op_lw:
-						//PeepoptLw(ip);
-						break;
-				case op_sxb:
-				case op_sxc:
-				case op_sxh:
-						PeepoptSxb(ip);
-						PeepoptSxbAnd(ip);
-						break;
-				case op_br:
-				case op_bra:
-						PeepoptBranch(ip);
-						PeepoptUctran(ip);
-						break;
-				case op_pop:
-				case op_push:
-						PeepoptPushPop(ip);
-						break;
-				case op_lea:
-						PeepoptLea(ip);
-						break;
-				case op_jal:
-						PeepoptJAL(ip);
-						break;
-				case op_jmp:
-				case op_ret:
-				case op_rts:
-				case op_rte:
-				case op_rtd:
-						PeepoptUctran(ip);
-						break;
-				case op_label:
-						PeepoptLabel(ip);
-						break;
-				case op_hint:
-						PeepoptHint(ip);
-						break;
-				case op_sh:
-				case op_sw:
-						PeepoptStore(ip);
-						break;
-				case op_and:
-						PeepoptAnd(ip);
-						break;
-				}
-				}
-			}
-			Remove();
-			
-			for (ip = peep_head; ip != NULL; ip = ip->fwd )
-				RemoveDoubleTargets(ip);
-			Remove();
-			
-		}
+		PeepoptWork();
 		//PeepoptSubSP();
 
 		// Remove the link and unlink instructions if no references
@@ -1577,6 +1668,12 @@ static void opt_peep()
 	RemoveCompilerHints();
 	Remove();
 
+	if (!::opt_noloop)
+		Loop::Optimize();
+
+	if (!::opt_nossa)
+		SSA::Optimize();
+
 	RootBlock = BasicBlock::Blockize(peep_head);
 	CFG::Create();
 	RemoveMoves();
@@ -1596,34 +1693,25 @@ static void opt_peep()
 	Coalesce();
 	Var::DumpForests();
 	//DumpLiveRegs();
+
+	if (!::opt_nosched)
+		Scheduler::Run();
 }
 
 OCODE *FindLabel(int64_t i)
 {
-	OCODE *ip;
-
-	for (ip = peep_head; ip; ip = ip->fwd) {
-		if (ip->opcode==op_label) {
-			if ((int)ip->oper1==i)
-				return (ip);
-		}
-	}
-	return nullptr;
+	return (LabelIndex::Find(i));
 }
 
 void CreateVars()
 {
 	BasicBlock *b;
-	int nn;
 	int num;
 
 	varlist = nullptr;
 	for (b = RootBlock; b; b = b->next) {
-		b->LiveOut->resetPtr();
-		for (nn = 0; nn < b->LiveOut->NumMember(); nn++) {
-			num = b->LiveOut->nextMember();
+		for (num = b->LiveOut->firstMember(); num >= 0; num = b->LiveOut->nextMember(num))
 			Var::Find(num);
-		}
 	}
 }
 
@@ -1653,7 +1741,7 @@ void RemoveMoves()
 		}
 	}
 	if (!foundMove)
-		dfs.printf("No move instruction joins live ranges.\n");
+		DTRACE(TRC_PEEP).printf("No move instruction joins live ranges.\n");
 }
 
 bool Coalesce()
@@ -1696,8 +1784,8 @@ bool Coalesce()
 				continue;
 			}
 			
-			dfs.printf("Coalescing live range r%d with ", reg1);
-			dfs.printf("r%d \n", reg2);
+			DTRACE(TRC_PEEP).printf("Coalescing live range r%d with ", reg1);
+			DTRACE(TRC_PEEP).printf("r%d \n", reg2);
 			improved = true;
 			if (v1->trees==nullptr) {
 				v3 = v1;
@@ -1763,8 +1851,7 @@ static void CheckForDeaths(BasicBlock *b, int r)
 	int m;
 
 	if (!b->live->isMember(r)) {
-		b->NeedLoad->resetPtr();
-		for (m = b->NeedLoad->nextMember(); m >= 0; m = b->NeedLoad->nextMember()) {
+		for (m = b->NeedLoad->firstMember(); m >= 0; m = b->NeedLoad->nextMember(m)) {
 			alltrees[m]->loads += b->depth;
 			b->MustSpill->add(m);
 		}
@@ -1865,24 +1952,23 @@ void ComputeSpillCosts()
 			if (ip==b->code)
 				endLoop = true;
 		}
-		b->NeedLoad->resetPtr();
-		for (r = b->NeedLoad->nextMember(); r >= 0; r = b->NeedLoad->nextMember()) {
+		for (r = b->NeedLoad->firstMember(); r >= 0; r = b->NeedLoad->nextMember(r)) {
 			alltrees[r]->loads += b->depth;
 		}
 	}
 
 	// Summarize costs
-	dfs.printf("<TreeCosts>\n");
+	DTRACE(TRC_PEEP).printf("<TreeCosts>\n");
 	for (r = 0; r < Tree::treecount; r++) {
 		// If alltrees[r].lattice = BOT
 		alltrees[r]->cost = 2.0f * (alltrees[r]->loads + alltrees[r]->stores);
 		// else
 		// alltrees[r]->cost = alltrees[r]->loads - alltrees[r]->stores;
 		alltrees[r]->cost -= alltrees[r]->copies;
-		dfs.printf("Tree:%d ", r);
-		dfs.printf("cost = %d\n", (int)alltrees[r]->cost);
+		DTRACE(TRC_PEEP).printf("Tree:%d ", r);
+		DTRACE(TRC_PEEP).printf("cost = %d\n", (int)alltrees[r]->cost);
 	}
-	dfs.printf("</TreeCosts>\n");
+	DTRACE(TRC_PEEP).printf("</TreeCosts>\n");
 }
 
 // Renumber the registers according to the tree (live range) numbers.
@@ -1897,8 +1983,7 @@ static void Renumber()
 
 	for (tt = 0; tt < Tree::treecount; tt++) {
 		t = alltrees[tt];
-		t->tree->resetPtr();
-		for (bb = t->tree->nextMember(); bb >= 0; bb = t->tree->nextMember()) {
+		for (bb = t->tree->firstMember(); bb >= 0; bb = t->tree->nextMember(bb)) {
 			b = basicBlocks[bb];
 			eol = false;
 			for (ip = b->code; ip && !eol; ip = ip->fwd) {
@@ -1944,8 +2029,7 @@ void RemoveCode()
 		if (v->num==0 || v->num==regLR || v->num==regXLR)
 			continue;
 		for (t = v->trees; t; t = t->next) {
-			nn = t->tree->lastMember();
-			do {
+			for (nn = t->tree->lastMember(); nn >= 0; nn = t->tree->prevMember(nn)) {
 				for (p = basicBlocks[nn]->lcode; p && !p->leader; p = p->back) {
 					if (p->opcode==op_label)
 						continue;
@@ -1960,12 +2044,12 @@ void RemoveCode()
 					if (!p->remove && p->HasSourceReg(v->num))
 						goto j1;
 				}
-			} while((nn = t->tree->prevMember()) >= 0);
+			}
 j1:	;
 		}
 		Remove2();
 	}
-	dfs.printf("<CodeRemove>%d</CodeRemove>\n", count);
+	DTRACE(TRC_PEEP).printf("<CodeRemove>%d</CodeRemove>\n", count);
 }
 
 /*
@@ -76,6 +76,8 @@ int preprocess()
 			return doifndef();
     else if (strcmp(lastkw,"endif")==0)
 			return doendif();
+    else if (strcmp(lastkw,"pch")==0)
+			return Pch::Directive();
 	else
 	{
         error(ERR_PREPROC);
@@ -0,0 +1,412 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2017-2018  Robert Finch, Waterloo
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// CC64 - 'C' derived language compiler
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This source file is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================================
+//
+#include "stdafx.h"
+
+// Profile guided optimization.
+//
+// The statements of a function are numbered as they're parsed and the
+// branches generated for a statement are numbered in turn. With
+// -fprofile-generate each conditional branch gets a label made from the
+// namespace, the function, the statement and the branch number, so the
+// label stays the same from one compile to the next. The labels and the
+// source line they belong to are listed in a .bmap file.
+//
+// The emulator counts how often each conditional branch is executed and
+// taken and writes the counts by address to a .prof file named after the
+// hex file. -fprofile-use=<name> reads <name>.prof and the symbol table at
+// the end of the assembler listing <name>.lst to get the counts for each
+// label. The counts are used to:
+//	- set the prediction bits of the branches
+//	- weight the uses of expressions for register allocation
+//	- place the more frequent part of an if/else where the condition falls
+//	  through
+//	- test the more frequent cases of a switch first
+
+struct ProfEntry {
+	uint64_t hash;
+	char *name;
+	int64_t count;
+	int64_t taken;
+};
+
+struct ProfCount {
+	unsigned int ad;
+	int64_t count;
+	int64_t taken;
+};
+
+extern char infile[256];
+extern char *rtrim(char *);
+extern void makename(char *s, char *e);
+
+static bool generate;
+static char *useName;		// name of the .prof and .lst files
+static bool loaded;
+static FILE *mapfp;
+static int nstmt;			// statements numbered in the current function
+static Statement *current;	// statement code is being generated for
+static int64_t hottest;		// highest count in the current function
+static ProfEntry *tbl;
+static int size;			// always a power of two
+static int count;
+
+void Profile::SetGenerate()
+{
+	generate = true;
+}
+
+void Profile::SetUse(char *nm)
+{
+	useName = nm;
+}
+
+void Profile::Start()
+{
+	char nm[260];
+
+	current = nullptr;
+	if (generate) {
+		if (mapfp)
+			fclose(mapfp);
+		strcpy_s(nm, sizeof(nm), infile);
+		makename(nm, ".bmap");
+		mapfp = fopen(nm, "w");
+	}
+	if (useName && !loaded) {
+		loaded = true;
+		Read(useName);
+	}
+}
+
+void Profile::BeginFunction()
+{
+	nstmt = 0;
+}
+
+void Profile::Number(Statement *stmt)
+{
+	stmt->pid = ++nstmt;
+}
+
+// Returns the statement code was being generated for before.
+
+Statement *Profile::Enter(Statement *stmt)
+{
+	Statement *old;
+
+	old = current;
+	current = stmt;
+	return (old);
+}
+
+static int countcmp(const void *a, const void *b)
+{
+	unsigned int aa, bb;
+
+	aa = ((ProfCount *)a)->ad;
+	bb = ((ProfCount *)b)->ad;
+	if (aa < bb)
+		return (-1);
+	return (aa > bb);
+}
+
+static void Insert(char *name, uint64_t hash, int64_t cnt, int64_t tkn)
+{
+	ProfEntry *old;
+	int oldsize, nn, h;
+
+	if (count * 2 >= size) {
+		old = tbl;
+		oldsize = size;
+		size = size ? size * 2 : 256;
+		tbl = new ProfEntry[size];
+		ZeroMemory(tbl, size * sizeof(ProfEntry));
+		for (nn = 0; nn < oldsize; nn++) {
+			if (old[nn].name) {
+				h = (int)(old[nn].hash & (size - 1));
+				while (tbl[h].name)
+					h = (h + 1) & (size - 1);
+				tbl[h] = old[nn];
+			}
+		}
+		delete[] old;
+	}
+	h = (int)(hash & (size - 1));
+	while (tbl[h].name)
+		h = (h + 1) & (size - 1);
+	tbl[h].hash = hash;
+	tbl[h].name = _strdup(name);
+	tbl[h].count = cnt;
+	tbl[h].taken = tkn;
+	count++;
+}
+
+// Only the symbols the compiler made for profiling are kept.
+
+bool Profile::Read(char *nm)
+{
+	char path[300];
+	char buf[600];
+	char name[500], seg[40];
+	ProfCount *counts, key, *pc;
+	int ncounts, maxcounts;
+	unsigned int ad;
+	long long cnt, tkn;
+	unsigned long long sad;
+	int bits;
+	bool syms;
+	FILE *fp;
+
+	sprintf_s(path, sizeof(path), "%s.prof", nm);
+	if ((fp = fopen(path, "r")) == nullptr) {
+		printf(" cant open %s\n", path);
+		return (false);
+	}
+	ncounts = maxcounts = 0;
+	counts = nullptr;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (sscanf(buf, "%x %lld %lld", &ad, &cnt, &tkn) != 3)
+			continue;
+		if (ncounts == maxcounts) {
+			maxcounts = maxcounts ? maxcounts * 2 : 1024;
+			counts = (ProfCount *)realloc(counts, maxcounts * sizeof(ProfCount));
+		}
+		counts[ncounts].ad = ad;
+		counts[ncounts].count = cnt;
+		counts[ncounts].taken = tkn;
+		ncounts++;
+	}
+	fclose(fp);
+	qsort(counts, ncounts, sizeof(ProfCount), countcmp);
+
+	sprintf_s(path, sizeof(path), "%s.lst", nm);
+	if ((fp = fopen(path, "r")) == nullptr) {
+		printf(" cant open %s\n", path);
+		free(counts);
+		return (false);
+	}
+	syms = false;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (!syms) {
+			// The symbol table follows a line giving the number of symbols
+			// and a line of headings.
+			if (strstr(buf, " symbols\n") && isdigit(buf[0])) {
+				syms = true;
+				fgets(buf, sizeof(buf), fp);
+			}
+			continue;
+		}
+		if (strlen(buf) < 3 || sscanf(&buf[2], "%499s %39s %llx %d", name, seg, &sad, &bits) != 4)
+			break;
+		if (strstr(name, "_P") == nullptr)
+			continue;
+		key.ad = (unsigned int)sad;
+		pc = (ProfCount *)bsearch(&key, counts, ncounts, sizeof(ProfCount), countcmp);
+		if (pc)
+			Insert(name, SymbolIndex::Hash(std::string(name)), pc->count, pc->taken);
+	}
+	fclose(fp);
+	free(counts);
+	return (true);
+}
+
+// The key is kept in a static buffer.
+
+char *Profile::Key(Statement *stmt, char *sub)
+{
+	static char buf[600];
+
+	sprintf_s(buf, sizeof(buf), "%.200s%.300s_P%d_%s", GetNamespace(),
+		currentFn->mangledName ? currentFn->mangledName->c_str() : currentFn->name->c_str(),
+		stmt->pid, sub);
+	return (buf);
+}
+
+bool Profile::Find(char *key, int64_t *cnt, int64_t *tkn)
+{
+	uint64_t hash;
+	int h;
+
+	if (count == 0)
+		return (false);
+	hash = SymbolIndex::Hash(std::string(key));
+	for (h = (int)(hash & (size - 1)); tbl[h].name; h = (h + 1) & (size - 1)) {
+		if (tbl[h].hash == hash && strcmp(tbl[h].name, key) == 0) {
+			*cnt = tbl[h].count;
+			*tkn = tbl[h].taken;
+			return (true);
+		}
+	}
+	return (false);
+}
+
+static char *Keep(char *key)
+{
+	char *p;
+
+	p = (char *)allocx((int)strlen(key) + 1, MEM_CODE);
+	strcpy(p, key);
+	return (p);
+}
+
+// Get the key for the next branch of the statement. The prediction bits
+// are set from the counts when there are any.
+
+char *Profile::Branch(unsigned int *prediction)
+{
+	char sub[20];
+	char *key;
+	int64_t cnt, tkn;
+
+	if (current == nullptr || currentFn == nullptr || !(generate || useName))
+		return (nullptr);
+	sprintf_s(sub, sizeof(sub), "%d", current->nbranch++);
+	key = Key(current, sub);
+	if (Find(key, &cnt, &tkn) && cnt > 0) {
+		// The counts are for the branch on the condition being false.
+		if (current->swapped)
+			tkn = cnt - tkn;
+		*prediction = 2 | (tkn * 2 > cnt);
+	}
+	return (Keep(key));
+}
+
+// Get the key for the test of a switch cluster starting with the case
+// given. A single value is tested with a branch to the case ('c'), a range
+// is tested with a branch that skips it ('r'). freq is set to the number
+// of times the cluster was selected.
+
+char *Profile::Case(char kind, int first, int64_t *freq)
+{
+	char sub[20];
+	char *key;
+	int64_t cnt, tkn;
+
+	*freq = 0;
+	if (current == nullptr || currentFn == nullptr || !(generate || useName))
+		return (nullptr);
+	sprintf_s(sub, sizeof(sub), "%c%d", kind, first);
+	key = Key(current, sub);
+	if (Find(key, &cnt, &tkn))
+		*freq = kind == 'c' ? tkn : cnt - tkn;
+	return (Keep(key));
+}
+
+// Attach the key to the branch to label just generated.
+
+void Profile::Attach(char *key, int label)
+{
+	OCODE *ip;
+	char *p;
+
+	ip = peep_tail;
+	if (key == nullptr || ip == nullptr || ip->oper3 == nullptr)
+		return;
+	if (ip->oper3->mode != am_direct || ip->oper3->offset == nullptr
+		|| ip->oper3->offset->nodetype != en_clabcon || ip->oper3->offset->i != label)
+		return;
+	ip->profile = key;
+	if (mapfp) {
+		rtrim(current->lptr);
+		for (p = current->lptr; isspace(*p); p++)
+			;
+		fprintf(mapfp, "%s\t%s\n", key, p);
+	}
+}
+
+void Profile::PutLabel(OCODE *ip)
+{
+	if (generate && ip->profile)
+		ofs.printf("%s:\n", ip->profile);
+}
+
+// Find the highest count for the current function. Returns false if the
+// profile has no counts for it.
+
+bool Profile::Measured()
+{
+	char prefix[600];
+	size_t len;
+	int nn;
+
+	hottest = 0;
+	if (count == 0 || currentFn == nullptr)
+		return (false);
+	sprintf_s(prefix, sizeof(prefix), "%.200s%.300s_P", GetNamespace(),
+		currentFn->mangledName ? currentFn->mangledName->c_str() : currentFn->name->c_str());
+	len = strlen(prefix);
+	for (nn = 0; nn < size; nn++) {
+		if (tbl[nn].name && strncmp(tbl[nn].name, prefix, len) == 0 && tbl[nn].count > hottest)
+			hottest = tbl[nn].count;
+	}
+	return (hottest > 0);
+}
+
+// An integer compare is generated as a single branch on the condition or
+// its reverse.
+
+static bool IsCompare(ENODE *node)
+{
+	if (node == nullptr)
+		return (false);
+	switch(node->nodetype) {
+	case en_eq: case en_ne: case en_lt: case en_le: case en_gt: case en_ge:
+	case en_ult: case en_ule: case en_ugt: case en_uge:
+		return (true);
+	}
+	return (false);
+}
+
+// Get the weight for the uses in the condition (part 0), the then part
+// (part 1) or the else part (part 2) of a statement. The most frequent
+// statement in the function gets 21, a statement that never ran gets 1.
+
+int Profile::Weight(Statement *stmt, int part)
+{
+	int64_t cnt, tkn;
+
+	if (hottest <= 0)
+		return (0);
+	if (!Find(Key(stmt, "0"), &cnt, &tkn))
+		return (1);
+	if (stmt->stype == st_if && part > 0 && IsCompare(stmt->exp))
+		cnt = part == 1 ? cnt - tkn : tkn;
+	return (1 + (int)((cnt * 20) / hottest));
+}
+
+// True if the else part of an if statement ran more often than the then
+// part.
+
+bool Profile::ElseHotter(Statement *stmt)
+{
+	int64_t cnt, tkn;
+
+	if (stmt->s2 == nullptr || !IsCompare(stmt->exp))
+		return (false);
+	if (!Find(Key(stmt, "0"), &cnt, &tkn))
+		return (false);
+	return (tkn * 2 > cnt);
+}
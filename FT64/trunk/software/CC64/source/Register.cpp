@@ -162,11 +162,23 @@ void initRegStack()
     memset(save_vmreg_alloc,0,sizeof(save_vmreg_alloc));
 }
 
+// The memory slot for temporary number n, relative to the bottom of the
+// temporary area. The bottom isn't known until the function is generated.
+
+static AMODE *MakeTempSlot(int n)
+{
+	AMODE *ap;
+
+	ap = make_indexed(n*sizeOfWord,regFP);
+	AddFrameFixup(ap->offset,FF_TEMPBOT);
+	return (ap);
+}
+
 // Spill a register to memory.
 
 void SpillRegister(AMODE *ap, int number)
 {
-	GenerateDiadic(op_sw,0,ap,make_indexed(TempBot()-ap->deep*sizeOfWord,regFP));
+	GenerateDiadic(op_sw,0,ap,MakeTempSlot(ap->deep));
     reg_stack[reg_stack_ptr].amode = ap;
     reg_stack[reg_stack_ptr].f.allocnum = number;
     if (reg_alloc[number].f.isPushed=='T')
@@ -176,7 +188,7 @@ void SpillRegister(AMODE *ap, int number)
 
 void SpillFPRegister(AMODE *ap, int number)
 {
-	GenerateDiadic(op_sf,'d',ap,make_indexed(TempBot()-ap->deep*sizeOfWord,regFP));
+	GenerateDiadic(op_sf,'d',ap,MakeTempSlot(ap->deep));
     fpreg_stack[fpreg_stack_ptr].amode = ap;
     fpreg_stack[fpreg_stack_ptr].f.allocnum = number;
     if (fpreg_alloc[number].f.isPushed=='T')
@@ -191,7 +203,7 @@ void LoadRegister(int regno, int number)
 	if (reg_in_use[regno] >= 0)
 		fatal("LoadRegister():register still in use");
 	reg_in_use[regno] = number;
-	GenerateDiadic(op_lw,0,makereg(regno),make_indexed(TempBot()-number*sizeOfWord,regFP));
+	GenerateDiadic(op_lw,0,makereg(regno),MakeTempSlot(number));
     reg_alloc[number].f.isPushed = 'F';
 }
 
@@ -200,7 +212,7 @@ void LoadFPRegister(int regno, int number)
 	if (fpreg_in_use[regno] >= 0)
 		fatal("LoadRegister():register still in use");
 	fpreg_in_use[regno] = number;
-	GenerateDiadic(op_lf,'d',makefpreg(regno),make_indexed(TempBot()-number*sizeOfWord,regFP));
+	GenerateDiadic(op_lf,'d',makefpreg(regno),MakeTempSlot(number));
     fpreg_alloc[number].f.isPushed = 'F';
 }
 
@@ -768,11 +780,6 @@ void ReleaseTempReg(AMODE *ap)
 		ReleaseTempRegister(ap);
 }
 
-int GetTempMemSpace()
-{
-	return (reg_alloc_ptr * sizeOfWord);
-}
-
 bool IsArgumentReg(int regno)
 {
 	return (regno >= regFirstArg && regno <= regLastArg);
@@ -0,0 +1,1404 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2017-2018  Robert Finch, Waterloo
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// CC64 - 'C' derived language compiler
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This source file is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================================
+//
+#include "stdafx.h"
+
+// Global optimizations done on the static single assignment form of a
+// function's code, once the loop optimizations are finished with it.
+//
+// Every value written to a register is given a number. Phi instructions are
+// put at the dominance frontiers of the blocks writing a register, and the
+// operands of each instruction have the numbers of the values they read
+// set as their subscripts. Then
+//
+//	- sparse conditional constant propagation finds the values that are
+//	  constant and the branches that always go the same way,
+//	- a walk of the dominator tree numbers the values computed by the same
+//	  instruction from the same operands, and has each operand read the
+//	  first register holding its value if that register still holds it,
+//	- the instructions computing values nobody reads are removed, including
+//	  the ones that only feed each other around a loop.
+//
+// The registers instructions refer to are never renamed, so all there is to
+// taking the code out of SSA form is removing the phi instructions. An
+// operand is only changed to read another register when the other register
+// holds the same value at that point, which is known from the value the
+// register has at the point in the dominator tree walk. The phi instructions
+// are placed for every register written in more than one place, whether or
+// not it is live, so that this value is always the one reaching the point.
+//
+// Only the general registers a function's code allocates are followed. A
+// call is taken to change all of them except the register variables, and
+// to read all of them other than the temporaries.
+
+#define SSA_NREGS		32			// registers that might be followed
+#define SSA_MAXVALUES	32000		// phi operands are 16 bit value numbers
+#define SSA_MAXUSES		100000
+#define SSA_NBUCKETS	1024		// value numbering hash table
+#define SSA_MAXIMMED	32767		// largest constant made into an immediate
+
+// Constant propagation lattice
+#define LAT_TOP		0		// not known yet
+#define LAT_CONST	1
+#define LAT_BOTTOM	2		// not a constant
+
+extern BasicBlock *RootBlock;
+extern BasicBlock *LastBlock;
+extern BasicBlock *basicBlocks[10000];
+extern OCODE *peep_head;
+extern OCODE *FindLabel(int64_t);
+extern AMODE *copy_addr(AMODE *ap);
+extern Instruction *GetInsn(int);
+extern int64_t BranchTarget(OCODE *ip);
+extern bool Oper1Read(OCODE *ip);
+extern bool MayDefine(OCODE *ip, int regno);
+extern bool IsPure(OCODE *ip);
+extern void Unlink(OCODE *ip);
+extern void RemoveInsn(OCODE *ip);
+
+// A key for an instruction computing a value, made of the opcode and the
+// value numbers or constants of the operands.
+struct SSAKey {
+	int opcode;
+	char kind[3];		// 0 none, 'v' value, 'c' constant
+	int64_t val[3];
+};
+
+struct SSAEntry {
+	SSAKey key;
+	int value;
+	int next;
+};
+
+static OCODE *valDef[SSA_MAXVALUES];	// defining instruction, null for the value on entry
+static unsigned char valReg[SSA_MAXVALUES];
+static char lat[SSA_MAXVALUES];
+static int64_t latConst[SSA_MAXVALUES];
+static int vn[SSA_MAXVALUES];			// value number, the first value found to be equal
+static bool valLive[SSA_MAXVALUES];
+static int useHead[SSA_MAXVALUES];
+static int useNext[SSA_MAXUSES];
+static OCODE *useInsn[SSA_MAXUSES];
+static int valWork[SSA_MAXVALUES * 2];
+static SSAEntry table[SSA_MAXVALUES];
+static int buckets[SSA_NBUCKETS];
+static int nValues;
+static int nValWork;
+static int nUses;
+static int nTable;
+static int cur[SSA_NREGS];				// value each register holds during a walk
+static int entryVal[SSA_NREGS];			// value each register has on entry
+static bool overflow;
+static bool allExec;					// control flow can't be followed
+static CSet *execBlocks;
+static CSet *seeds;						// values read in ways the operands don't show
+static Edge **edgeWork;
+static int nEdgeWork;
+static int nPhis, nConsts, nBranches, nRedundant, nCopies, nDead;
+
+#define FOR_BLOCK(ip, b)	for (ip = (b)->code; ip && ip->bb==(b); ip = ip->fwd)
+
+static bool IsTracked(int regno)
+{
+	if (regno <= 0 || regno >= SSA_NREGS)
+		return (false);
+	return (regno != regSP && regno != regFP && regno != regLR && regno != regXLR
+		&& regno != regGP && regno != regTP && regno != regCLP);
+}
+
+static bool IsCall(OCODE *ip)
+{
+	return (ip->opcode==op_call || ip->opcode==op_jal || ip->opcode==op_bex);
+}
+
+static bool IsExit(OCODE *ip)
+{
+	switch(ip->opcode) {
+	case op_ret:
+	case op_rti:
+	case op_rte:
+	case op_iret:
+	case op_jmp:
+		return (true);
+	}
+	return (false);
+}
+
+static bool Defines(OCODE *ip, int regno)
+{
+	if (MayDefine(ip, regno))
+		return (true);
+	return (IsCall(ip) && (regno < regFirstRegvar || regno > regLastRegvar));
+}
+
+// The first operand of push and call is the value pushed or the address
+// called, even though the instructions are marked as having a target.
+
+static bool ReadsOper1(OCODE *ip)
+{
+	return (Oper1Read(ip) || ip->opcode==op_push || ip->opcode==op_call || ip->opcode==op_jmp);
+}
+
+static bool IsConditionalBranch(OCODE *ip)
+{
+	switch(ip->opcode) {
+	case op_beq:	case op_bne:
+	case op_blt:	case op_bge:	case op_ble:	case op_bgt:
+	case op_bltu:	case op_bgeu:	case op_bleu:	case op_bgtu:
+	case op_beqi:	case op_bbs:	case op_bbc:
+		return (BranchTarget(ip) >= 0);
+	}
+	return (false);
+}
+
+// An instruction whose only effect is to set its target register from its
+// operands. It can be evaluated, replaced or removed.
+
+static bool IsFoldable(OCODE *ip)
+{
+	if (ip->insn==nullptr || !ip->insn->HasTarget)
+		return (false);
+	switch(ip->opcode) {
+	case op_cmp:	case op_cmpu:
+	case op_bfext:	case op_bfextu:
+		if (ip->oper1==nullptr || ip->oper1->mode != am_reg)
+			return (false);
+		break;
+	default:
+		if (!IsPure(ip))
+			return (false);
+		break;
+	}
+	return (IsTracked(ip->oper1->preg));
+}
+
+static int NumPreds(BasicBlock *b)
+{
+	Edge *e;
+	int n;
+
+	n = 0;
+	for (e = b->ihead; e; e = e->next)
+		n++;
+	return (n);
+}
+
+static bool IsOtherRegister(AMODE *ap)
+{
+	if (ap==nullptr)
+		return (false);
+	if (ap->mode==am_fpreg || ap->mode==am_vreg || ap->mode==am_vmreg)
+		return (true);
+	if (ap->mode==am_reg)
+		return (ap->type==stdvector.GetIndex() || ap->type==stddouble.GetIndex()
+			|| ap->type==stdvectormask->GetIndex());
+	return (false);
+}
+
+// The code can only be optimized if everything that reads or writes the
+// followed registers is known.
+
+static bool CanOptimize()
+{
+	OCODE *ip;
+
+	if (currentFn->IsInterrupt || currentFn->IsNocall)
+		return (false);
+	allExec = false;
+	for (ip = peep_head; ip; ip = ip->fwd) {
+		if (ip->opcode==op_label)
+			continue;
+		if (ip->insn==nullptr || ip->opcode==op_asm)
+			return (false);
+		switch(ip->opcode) {
+		case op_lv: case op_sv: case op_vmov:
+		case op_vadd: case op_vsub: case op_vmul: case op_vdiv:
+		case op_vadds: case op_vsubs: case op_vmuls: case op_vdivs:
+		case op_vseq: case op_vsne: case op_vslt: case op_vsge: case op_vsle: case op_vsgt:
+		case op_vex: case op_veins:
+			return (false);
+		case op_jmp:
+			// A jump through a register could go anywhere.
+			if (BranchTarget(ip) < 0)
+				allExec = true;
+			break;
+		case op_jal:
+			// So could a jal through a register that isn't a call, unless
+			// it's a switch's jump with the case table attached.
+			if (ip->oper1->mode==am_reg && ip->oper1->preg==0 && ip->oper2
+				&& ip->oper2->mode != am_direct && ip->oper3==nullptr)
+				allExec = true;
+			break;
+		}
+		if (IsOtherRegister(ip->oper1) || IsOtherRegister(ip->oper2)
+			|| IsOtherRegister(ip->oper3) || IsOtherRegister(ip->oper4))
+			return (false);
+	}
+	return (true);
+}
+
+static int NewValue(OCODE *ip, int regno)
+{
+	if (nValues >= SSA_MAXVALUES) {
+		overflow = true;
+		return (0);
+	}
+	valDef[nValues] = ip;
+	valReg[nValues] = regno;
+	lat[nValues] = ip ? LAT_TOP : LAT_BOTTOM;
+	latConst[nValues] = 0;
+	vn[nValues] = nValues;
+	valLive[nValues] = false;
+	useHead[nValues] = -1;
+	return (nValues++);
+}
+
+// ----------------------------------------------------------------------------
+// Building the SSA form
+// ----------------------------------------------------------------------------
+
+static void InsertPhi(BasicBlock *b, int regno)
+{
+	OCODE *phi, *ip, *last;
+
+	if (b->code==nullptr || NumPreds(b) > 100) {
+		overflow = true;
+		return;
+	}
+	phi = OCODE::MakeNew();
+	phi->insn = GetInsn(op_phi);
+	phi->opcode = op_phi;
+	phi->oper1 = makereg(regno);
+	phi->loop_depth = b->code->loop_depth;
+	last = nullptr;
+	FOR_BLOCK(ip, b) {
+		if (ip->opcode != op_label)
+			break;
+		last = ip;
+	}
+	if (last) {
+		Peep::InsertAfter(last, phi);
+		if (b->lcode==last)
+			b->lcode = phi;
+	}
+	else {
+		Peep::InsertBefore(b->code, phi);
+		if (peep_head==b->code)
+			peep_head = phi;
+		b->code = phi;
+	}
+	phi->bb = b;
+	nPhis++;
+}
+
+// Place phi instructions for each register at the iterated dominance
+// frontier of the blocks writing it. The value a register has on entry to
+// the function counts as being written in the first block.
+
+void SSA::InsertPhis()
+{
+	CSet *defs[SSA_NREGS];
+	CSet *w, *has;
+	BasicBlock *b, *x;
+	OCODE *ip;
+	int regno, n, y;
+
+	for (regno = 0; regno < SSA_NREGS; regno++) {
+		defs[regno] = CSet::MakeNew();
+		defs[regno]->add(RootBlock->num);
+	}
+	for (b = RootBlock; b; b = b->next) {
+		FOR_BLOCK(ip, b) {
+			if (ip->opcode==op_label)
+				continue;
+			for (regno = 1; regno < SSA_NREGS; regno++)
+				if (IsTracked(regno) && Defines(ip, regno))
+					defs[regno]->add(b->num);
+		}
+		if (b==LastBlock)
+			break;
+	}
+	w = CSet::MakeNew();
+	has = CSet::MakeNew();
+	for (regno = 1; regno < SSA_NREGS && !overflow; regno++) {
+		if (!IsTracked(regno))
+			continue;
+		w->clear();
+		w->add(defs[regno]);
+		has->clear();
+		while (!w->isEmpty()) {
+			n = w->firstMember();
+			w->remove(n);
+			x = basicBlocks[n];
+			if (x->DF==nullptr)
+				continue;
+			for (y = x->DF->firstMember(); y >= 0; y = x->DF->nextMember(y)) {
+				if (has->isMember(y))
+					continue;
+				has->add(y);
+				InsertPhi(basicBlocks[y], regno);
+				w->add(y);
+			}
+		}
+	}
+}
+
+static void Subscript(AMODE *ap)
+{
+	if (ap==nullptr)
+		return;
+	switch(ap->mode) {
+	case am_reg:
+	case am_ind:
+	case am_indx:
+	case am_ainc:
+	case am_adec:
+		ap->pregs = IsTracked(ap->preg) ? cur[ap->preg] : 0;
+		break;
+	case am_indx2:
+	case am_indx3:
+		ap->pregs = IsTracked(ap->preg) ? cur[ap->preg] : 0;
+		ap->sregs = IsTracked(ap->sreg) ? cur[ap->sreg] : 0;
+		break;
+	}
+}
+
+// Set the phi operands for the edges leaving a block to the values the
+// registers have at the end of it.
+
+static void SetPhiOperands(BasicBlock *b)
+{
+	BasicBlock *y;
+	OCODE *s;
+	Edge *e;
+	int j;
+
+	for (e = b->ohead; e; e = e->next) {
+		y = e->dst;
+		if (y->num > LastBlock->num)
+			continue;
+		j = CFG::WhichPred(b, y->num);
+		FOR_BLOCK(s, y) {
+			if (s->opcode==op_label)
+				continue;
+			if (s->opcode != op_phi)
+				break;
+			s->phiops[j] = cur[s->oper1->preg];
+		}
+	}
+}
+
+// Give the values written numbers in a walk of the dominator tree, setting
+// the operand subscripts to the values read.
+
+void SSA::Rename(BasicBlock *b)
+{
+	int saved[SSA_NREGS];
+	OCODE *ip;
+	Edge *e;
+	int regno;
+
+	memcpy(saved, cur, sizeof(cur));
+	FOR_BLOCK(ip, b) {
+		if (ip->opcode==op_label)
+			continue;
+		if (ip->opcode==op_phi) {
+			ip->ssaValue = NewValue(ip, ip->oper1->preg);
+			cur[ip->oper1->preg] = ip->ssaValue;
+			continue;
+		}
+		// The operands may be shared with other instructions.
+		ip->oper1 = copy_addr(ip->oper1);
+		ip->oper2 = copy_addr(ip->oper2);
+		ip->oper3 = copy_addr(ip->oper3);
+		ip->oper4 = copy_addr(ip->oper4);
+		if (ReadsOper1(ip))
+			Subscript(ip->oper1);
+		Subscript(ip->oper2);
+		Subscript(ip->oper3);
+		Subscript(ip->oper4);
+		ip->ssaValue = 0;
+		for (regno = 1; regno < SSA_NREGS; regno++) {
+			if (IsTracked(regno) && Defines(ip, regno)) {
+				cur[regno] = NewValue(ip, regno);
+				if (ip->ssaValue==0)
+					ip->ssaValue = cur[regno];
+			}
+		}
+	}
+	SetPhiOperands(b);
+	for (e = b->dhead; e; e = e->next)
+		Rename(e->dst);
+	memcpy(cur, saved, sizeof(cur));
+}
+
+// Get the values an instruction reads.
+
+static int GetUses(OCODE *ip, int *vals)
+{
+	AMODE *ops[4];
+	int nn, n;
+
+	n = 0;
+	if (ip->opcode==op_phi) {
+		n = NumPreds(ip->bb);
+		for (nn = 0; nn < n; nn++)
+			vals[nn] = ip->phiops[nn];
+		return (n);
+	}
+	ops[0] = ReadsOper1(ip) ? ip->oper1 : nullptr;
+	ops[1] = ip->oper2;
+	ops[2] = ip->oper3;
+	ops[3] = ip->oper4;
+	for (nn = 0; nn < 4; nn++) {
+		if (ops[nn]==nullptr)
+			continue;
+		switch(ops[nn]->mode) {
+		case am_reg:
+		case am_ind:
+		case am_indx:
+		case am_ainc:
+		case am_adec:
+			if (ops[nn]->pregs)
+				vals[n++] = ops[nn]->pregs;
+			break;
+		case am_indx2:
+		case am_indx3:
+			if (ops[nn]->pregs)
+				vals[n++] = ops[nn]->pregs;
+			if (ops[nn]->sregs)
+				vals[n++] = ops[nn]->sregs;
+			break;
+		}
+	}
+	return (n);
+}
+
+static void FindUses()
+{
+	BasicBlock *b;
+	OCODE *ip;
+	int vals[100];
+	int nn, n;
+
+	nUses = 0;
+	for (b = RootBlock; b; b = b->next) {
+		FOR_BLOCK(ip, b) {
+			if (ip->opcode==op_label)
+				continue;
+			n = GetUses(ip, vals);
+			for (nn = 0; nn < n; nn++) {
+				if (nUses >= SSA_MAXUSES) {
+					overflow = true;
+					return;
+				}
+				useInsn[nUses] = ip;
+				useNext[nUses] = useHead[vals[nn]];
+				useHead[vals[nn]] = nUses++;
+			}
+		}
+		if (b==LastBlock)
+			break;
+	}
+}
+
+void SSA::Build()
+{
+	int regno;
+
+	nValues = 1;
+	overflow = false;
+	CFG::CalcDominanceFrontiers();
+	InsertPhis();
+	if (overflow)
+		return;
+	// The values on entry to the function.
+	for (regno = 0; regno < SSA_NREGS; regno++)
+		cur[regno] = entryVal[regno] = IsTracked(regno) ? NewValue(nullptr, regno) : 0;
+	Rename(RootBlock);
+	if (!overflow)
+		FindUses();
+}
+
+// ----------------------------------------------------------------------------
+// Sparse conditional constant propagation
+// ----------------------------------------------------------------------------
+
+static int OperLattice(AMODE *ap, int64_t *c)
+{
+	*c = 0;
+	switch(ap->mode) {
+	case am_reg:
+		if (ap->preg==0)
+			return (LAT_CONST);
+		if (!IsTracked(ap->preg) || ap->pregs==0)
+			return (LAT_BOTTOM);
+		*c = latConst[ap->pregs];
+		return (lat[ap->pregs]);
+	case am_immed:
+		if (ap->offset && ap->offset->nodetype==en_icon) {
+			*c = ap->offset->i;
+			return (LAT_CONST);
+		}
+		break;
+	}
+	return (LAT_BOTTOM);
+}
+
+static int64_t ExtractField(int64_t v, int64_t mb, int64_t me, bool isSigned)
+{
+	int width;
+
+	width = (int)(me - mb + 1);
+	v = (int64_t)((uint64_t)v >> mb);
+	if (width >= 64)
+		return (v);
+	v &= (1LL << width) - 1;
+	if (isSigned && (v & (1LL << (width-1))))
+		v |= (int64_t)(~0ULL << width);
+	return (v);
+}
+
+// Compute the value of an instruction from constant operands.
+
+static bool Fold(int op, int64_t *v, int64_t *r)
+{
+	uint64_t a, b;
+
+	a = (uint64_t)v[0];
+	b = (uint64_t)v[1];
+	switch(op) {
+	case op_ldi:
+	case op_mov:	*r = v[0]; break;
+	case op_add:
+	case op_addu:	*r = (int64_t)(a + b); break;
+	case op_sub:
+	case op_subu:	*r = (int64_t)(a - b); break;
+	case op_and:	*r = (int64_t)(a & b); break;
+	case op_or:		*r = (int64_t)(a | b); break;
+	case op_xor:
+	case op_eor:	*r = (int64_t)(a ^ b); break;
+	case op_shl:
+	case op_shlu:
+	case op_asl:	*r = (int64_t)(a << (b & 63)); break;
+	case op_shr:
+	case op_shru:	*r = (int64_t)(a >> (b & 63)); break;
+	case op_asr:	*r = v[0] >> (b & 63); break;
+	case op_mul:
+	case op_mulu:	*r = (int64_t)(a * b); break;
+	case op_com:	*r = (int64_t)~a; break;
+	case op_not:	*r = a==0; break;
+	case op_cmp:	*r = v[0] < v[1] ? -1 : v[0]==v[1] ? 0 : 1; break;
+	case op_cmpu:	*r = a < b ? -1 : a==b ? 0 : 1; break;
+	case op_bfext:
+	case op_bfextu:
+		if (v[1] < 0 || v[2] < v[1] || v[2] > 63)
+			return (false);
+		*r = ExtractField(v[0], v[1], v[2], op==op_bfext);
+		break;
+	default:
+		return (false);
+	}
+	return (true);
+}
+
+static int EvalInsn(OCODE *ip, int64_t *r)
+{
+	AMODE *ops[3];
+	int64_t v[3];
+	int nn, l, res;
+
+	ops[0] = ip->oper2;
+	ops[1] = ip->oper3;
+	ops[2] = ip->oper4;
+	res = LAT_CONST;
+	for (nn = 0; nn < 3; nn++) {
+		v[nn] = 0;
+		if (ops[nn]==nullptr)
+			continue;
+		l = OperLattice(ops[nn], &v[nn]);
+		if (l==LAT_BOTTOM)
+			return (LAT_BOTTOM);
+		if (l==LAT_TOP)
+			res = LAT_TOP;
+	}
+	if (res==LAT_TOP)
+		return (LAT_TOP);
+	return (Fold(ip->opcode, v, r) ? LAT_CONST : LAT_BOTTOM);
+}
+
+// Decide whether a conditional branch is taken. Returns the lattice value
+// of the condition.
+
+static int EvalBranch(OCODE *ip, bool *taken)
+{
+	int64_t a, b;
+	int la, lb;
+
+	la = OperLattice(ip->oper1, &a);
+	lb = OperLattice(ip->oper2, &b);
+	if (la==LAT_BOTTOM || lb==LAT_BOTTOM)
+		return (LAT_BOTTOM);
+	if (la==LAT_TOP || lb==LAT_TOP)
+		return (LAT_TOP);
+	switch(ip->opcode) {
+	case op_beq:
+	case op_beqi:	*taken = a==b; break;
+	case op_bne:	*taken = a!=b; break;
+	case op_blt:	*taken = a < b; break;
+	case op_bge:	*taken = a >= b; break;
+	case op_ble:	*taken = a <= b; break;
+	case op_bgt:	*taken = a > b; break;
+	case op_bltu:	*taken = (uint64_t)a < (uint64_t)b; break;
+	case op_bgeu:	*taken = (uint64_t)a >= (uint64_t)b; break;
+	case op_bleu:	*taken = (uint64_t)a <= (uint64_t)b; break;
+	case op_bgtu:	*taken = (uint64_t)a > (uint64_t)b; break;
+	case op_bbs:	*taken = ((a >> (b & 63)) & 1) != 0; break;
+	case op_bbc:	*taken = ((a >> (b & 63)) & 1)==0; break;
+	default:		return (LAT_BOTTOM);
+	}
+	return (LAT_CONST);
+}
+
+static void SetLattice(int v, int l, int64_t c)
+{
+	if (v <= 0 || lat[v]==LAT_BOTTOM)
+		return;
+	if (l==LAT_CONST && lat[v]==LAT_CONST && latConst[v] != c)
+		l = LAT_BOTTOM;
+	if (l==lat[v])
+		return;
+	lat[v] = l;
+	latConst[v] = c;
+	valWork[nValWork++] = v;
+}
+
+static void MarkEdge(BasicBlock *src, BasicBlock *dst)
+{
+	Edge *e;
+
+	if (dst->num > LastBlock->num)
+		return;
+	for (e = dst->ihead; e; e = e->next) {
+		if (e->src==src && !e->executable) {
+			e->executable = true;
+			edgeWork[nEdgeWork++] = e;
+		}
+	}
+}
+
+static void MarkAllEdges(BasicBlock *b)
+{
+	Edge *e;
+
+	for (e = b->ohead; e; e = e->next)
+		MarkEdge(b, e->dst);
+}
+
+static void VisitPhi(OCODE *ip)
+{
+	Edge *e;
+	int j, l;
+	int64_t c;
+	int v;
+
+	l = LAT_TOP;
+	c = 0;
+	for (e = ip->bb->ihead, j = 0; e; e = e->next, j++) {
+		if (!e->executable)
+			continue;
+		v = ip->phiops[j];
+		if (lat[v]==LAT_BOTTOM || (lat[v]==LAT_CONST && l==LAT_CONST && latConst[v] != c)) {
+			l = LAT_BOTTOM;
+			break;
+		}
+		if (lat[v]==LAT_CONST) {
+			l = LAT_CONST;
+			c = latConst[v];
+		}
+	}
+	SetLattice(ip->ssaValue, l, c);
+}
+
+static void VisitInsn(OCODE *ip)
+{
+	BasicBlock *b;
+	OCODE *lab;
+	int64_t c;
+	int regno, v, l;
+	bool taken;
+
+	// A block may end with a phi when it holds nothing else.
+	if (ip->opcode==op_phi)
+		VisitPhi(ip);
+	else if (IsFoldable(ip)) {
+		l = EvalInsn(ip, &c);
+		SetLattice(ip->ssaValue, l, c);
+	}
+	else if (ip->ssaValue > 0) {
+		v = ip->ssaValue;
+		for (regno = 1; regno < SSA_NREGS; regno++)
+			if (IsTracked(regno) && Defines(ip, regno))
+				SetLattice(v++, LAT_BOTTOM, 0);
+	}
+	b = ip->bb;
+	if (ip != b->lcode)
+		return;
+	if (!IsConditionalBranch(ip)) {
+		MarkAllEdges(b);
+		return;
+	}
+	switch(EvalBranch(ip, &taken)) {
+	case LAT_TOP:
+		break;
+	case LAT_CONST:
+		if (taken) {
+			if ((lab = FindLabel(BranchTarget(ip))) != nullptr)
+				MarkEdge(b, lab->bb);
+		}
+		else if (b->next)
+			MarkEdge(b, b->next);
+		break;
+	default:
+		MarkAllEdges(b);
+		break;
+	}
+}
+
+static void VisitBlock(BasicBlock *b)
+{
+	OCODE *ip;
+
+	FOR_BLOCK(ip, b) {
+		if (ip->opcode != op_label)
+			VisitInsn(ip);
+	}
+	// A block falling through into the next.
+	if (b->lcode==nullptr || b->lcode->opcode==op_label)
+		MarkAllEdges(b);
+}
+
+// Blocks that might be reached other than by the branches seen in the
+// control flow graph.
+
+static void MarkEntries()
+{
+	BasicBlock *b;
+	OCODE *ip, *lab;
+	AMODE *ops[4];
+	int nn;
+
+	execBlocks->add(RootBlock->num);
+	for (b = RootBlock; b; b = b->next) {
+		if (b->ihead==nullptr || allExec)
+			execBlocks->add(b->num);
+		FOR_BLOCK(ip, b) {
+			if (ip->opcode==op_label)
+				continue;
+			ops[0] = ip->oper1;
+			ops[1] = ip->oper2;
+			ops[2] = ip->oper3;
+			ops[3] = ip->oper4;
+			for (nn = 0; nn < 4; nn++) {
+				if (ops[nn]==nullptr || ops[nn]->offset==nullptr)
+					continue;
+				if (ops[nn]->mode != am_direct && ops[nn]->mode != am_immed)
+					continue;
+				if (ops[nn]->offset->nodetype != en_clabcon && ops[nn]->offset->nodetype != en_labcon)
+					continue;
+				if (nn==0 && (ip->opcode==op_bra || ip->opcode==op_jmp || ip->opcode==op_bex))
+					continue;
+				if (nn==2 && IsConditionalBranch(ip))
+					continue;
+				if ((lab = FindLabel(ops[nn]->offset->i)) != nullptr)
+					execBlocks->add(lab->bb->num);
+			}
+		}
+		if (b==LastBlock)
+			break;
+	}
+}
+
+void SSA::Propagate()
+{
+	BasicBlock *b;
+	OCODE *ip;
+	Edge *e;
+	int nedges, n, v, u;
+
+	nedges = 0;
+	for (b = RootBlock; b; b = b->next) {
+		for (e = b->ihead; e; e = e->next) {
+			e->executable = allExec;
+			nedges++;
+		}
+		if (b==LastBlock)
+			break;
+	}
+	edgeWork = (Edge **)allocx(sizeof(Edge *) * (nedges + 1), MEM_OPT);
+	nEdgeWork = 0;
+	nValWork = 0;
+	execBlocks = CSet::MakeNew();
+	MarkEntries();
+	for (n = execBlocks->firstMember(); n >= 0; n = execBlocks->nextMember(n))
+		if (n <= LastBlock->num)
+			VisitBlock(basicBlocks[n]);
+	while (nEdgeWork > 0 || nValWork > 0) {
+		if (nEdgeWork > 0) {
+			e = edgeWork[--nEdgeWork];
+			b = e->dst;
+			if (!execBlocks->isMember(b->num)) {
+				execBlocks->add(b->num);
+				VisitBlock(b);
+			}
+			else {
+				FOR_BLOCK(ip, b) {
+					if (ip->opcode==op_phi)
+						VisitPhi(ip);
+				}
+			}
+			continue;
+		}
+		v = valWork[--nValWork];
+		for (u = useHead[v]; u >= 0; u = useNext[u]) {
+			ip = useInsn[u];
+			if (execBlocks->isMember(ip->bb->num))
+				VisitInsn(ip);
+		}
+	}
+}
+
+static bool IsSmallConst(int64_t c)
+{
+	return (c >= -SSA_MAXIMMED && c <= SSA_MAXIMMED);
+}
+
+// An operand register that holds zero can be replaced by r0, and the last
+// operand of an instruction with an immediate form by a small constant.
+
+static void ReplaceConstOperands(OCODE *ip)
+{
+	AMODE **ops[4];
+	AMODE *ap;
+	int nn;
+
+	ops[0] = ReadsOper1(ip) && !IsFoldable(ip) ? &ip->oper1 : nullptr;
+	ops[1] = &ip->oper2;
+	ops[2] = &ip->oper3;
+	ops[3] = &ip->oper4;
+	for (nn = 0; nn < 4; nn++) {
+		if (ops[nn]==nullptr || (ap = *ops[nn])==nullptr || ap->mode != am_reg)
+			continue;
+		if (!IsTracked(ap->preg) || ap->pregs==0 || lat[ap->pregs] != LAT_CONST)
+			continue;
+		// An operand that is also written stays as it is.
+		if (nn==0 && MayDefine(ip, ap->preg))
+			continue;
+		if (latConst[ap->pregs]==0) {
+			ap->preg = 0;
+			ap->pregs = 0;
+			nConsts++;
+			continue;
+		}
+		if (nn != 2 || !IsSmallConst(latConst[ap->pregs]))
+			continue;
+		switch(ip->opcode) {
+		case op_add:	case op_sub:	case op_and:	case op_or:
+		case op_xor:	case op_eor:	case op_cmp:	case op_cmpu:
+		case op_shl:	case op_asl:	case op_asr:	case op_shru:
+			*ops[nn] = make_immed(latConst[ap->pregs]);
+			nConsts++;
+			break;
+		}
+	}
+}
+
+// Replace the instructions computing constants with loads of the constant,
+// and branches that always go the same way with a branch or nothing. The
+// code in blocks that can't be reached is removed.
+
+// Once a branch arm is gone the branch around it may lead to the next label.
+
+static void RemoveJumpsToNext()
+{
+	OCODE *ip, *ip2, *p;
+
+	for (ip = peep_head; ip; ip = ip2) {
+		ip2 = ip->fwd;
+		if (ip->opcode != op_bra || (p = FindLabel(BranchTarget(ip)))==nullptr)
+			continue;
+		for (p = p->back; p && p->opcode==op_label; p = p->back)
+			;
+		if (p==ip)
+			RemoveInsn(ip);
+	}
+}
+
+void SSA::ApplyConstants()
+{
+	BasicBlock *b;
+	OCODE *ip, *ip2;
+	int v;
+	bool taken;
+
+	for (b = RootBlock; b; b = b->next) {
+		if (!execBlocks->isMember(b->num)) {
+			for (ip = b->code; ip && ip->bb==b; ip = ip2) {
+				ip2 = ip->fwd;
+				if (ip->opcode != op_label && ip->opcode != op_phi) {
+					RemoveInsn(ip);
+					nDead++;
+				}
+			}
+		}
+		else {
+			for (ip = b->code; ip && ip->bb==b; ip = ip2) {
+				ip2 = ip->fwd;
+				if (ip->opcode==op_label || ip->opcode==op_phi)
+					continue;
+				v = ip->ssaValue;
+				if (IsFoldable(ip) && lat[v]==LAT_CONST) {
+					if (ip->opcode==op_ldi)
+						continue;
+					if (ip->opcode==op_mov && ip->oper2->mode==am_reg && ip->oper2->preg==0)
+						continue;
+					ip->opcode = op_ldi;
+					ip->insn = GetInsn(op_ldi);
+					ip->oper2 = make_immed(latConst[v]);
+					ip->oper3 = nullptr;
+					ip->oper4 = nullptr;
+					nConsts++;
+					continue;
+				}
+				ReplaceConstOperands(ip);
+				if (ip==b->lcode && IsConditionalBranch(ip) && EvalBranch(ip, &taken)==LAT_CONST) {
+					if (taken) {
+						ip->opcode = op_bra;
+						ip->insn = GetInsn(op_bra);
+						ip->oper1 = ip->oper3;
+						ip->oper2 = nullptr;
+						ip->oper3 = nullptr;
+						ip->oper4 = nullptr;
+					}
+					else
+						RemoveInsn(ip);
+					nBranches++;
+				}
+			}
+		}
+		if (b==LastBlock)
+			break;
+	}
+	if (nBranches)
+		RemoveJumpsToNext();
+}
+
+// ----------------------------------------------------------------------------
+// Value numbering and copy propagation
+// ----------------------------------------------------------------------------
+
+static bool MakeOperKey(AMODE *ap, char *kind, int64_t *val)
+{
+	*kind = 0;
+	*val = 0;
+	if (ap==nullptr)
+		return (true);
+	switch(ap->mode) {
+	case am_reg:
+		if (ap->preg==0) {
+			*kind = 'c';
+			return (true);
+		}
+		if (!IsTracked(ap->preg) || ap->pregs==0)
+			return (false);
+		*kind = 'v';
+		*val = vn[ap->pregs];
+		return (true);
+	case am_immed:
+		if (ap->offset && ap->offset->nodetype==en_icon) {
+			*kind = 'c';
+			*val = ap->offset->i;
+			return (true);
+		}
+		break;
+	}
+	return (false);
+}
+
+static bool IsCommutative(int op)
+{
+	switch(op) {
+	case op_add: case op_addu: case op_and: case op_or:
+	case op_xor: case op_eor: case op_mul: case op_mulu:
+		return (true);
+	}
+	return (false);
+}
+
+static bool MakeKey(OCODE *ip, SSAKey *key)
+{
+	char tk;
+	int64_t tv;
+
+	memset(key, 0, sizeof(SSAKey));
+	key->opcode = ip->opcode;
+	// A copy of r0 is the same as loading zero.
+	if (ip->opcode==op_mov && ip->oper2->mode==am_reg && ip->oper2->preg==0)
+		key->opcode = op_ldi;
+	if (!MakeOperKey(ip->oper2, &key->kind[0], &key->val[0])
+		|| !MakeOperKey(ip->oper3, &key->kind[1], &key->val[1])
+		|| !MakeOperKey(ip->oper4, &key->kind[2], &key->val[2]))
+		return (false);
+	if (IsCommutative(key->opcode) && (key->kind[0] > key->kind[1]
+		|| (key->kind[0]==key->kind[1] && key->val[0] > key->val[1]))) {
+		tk = key->kind[0];
+		key->kind[0] = key->kind[1];
+		key->kind[1] = tk;
+		tv = key->val[0];
+		key->val[0] = key->val[1];
+		key->val[1] = tv;
+	}
+	return (true);
+}
+
+static int HashKey(SSAKey *key)
+{
+	uint64_t h;
+	int nn;
+
+	h = key->opcode;
+	for (nn = 0; nn < 3; nn++)
+		h = h * 31 + key->kind[nn] * 7 + (uint64_t)key->val[nn];
+	return ((int)((h ^ (h >> 29)) % SSA_NBUCKETS));
+}
+
+static int LookupKey(SSAKey *key)
+{
+	int n;
+
+	for (n = buckets[HashKey(key)]; n >= 0; n = table[n].next) {
+		if (memcmp(&table[n].key, key, sizeof(SSAKey))==0)
+			return (table[n].value);
+	}
+	return (0);
+}
+
+static void InsertKey(SSAKey *key, int v)
+{
+	int h;
+
+	if (nTable >= SSA_MAXVALUES)
+		return;
+	h = HashKey(key);
+	table[nTable].key = *key;
+	table[nTable].value = v;
+	table[nTable].next = buckets[h];
+	buckets[h] = nTable++;
+}
+
+// Leaving a block, forget the values computed in it.
+
+static void PopKeys(int n)
+{
+	while (nTable > n) {
+		nTable--;
+		buckets[HashKey(&table[nTable].key)] = table[nTable].next;
+	}
+}
+
+// Is the value number available in the register it was first put in ?
+
+static bool IsAvailable(int k)
+{
+	return (k > 0 && IsTracked(valReg[k]) && cur[valReg[k]]==k);
+}
+
+// Have an operand read the register first holding the value it reads.
+
+static void PropagateCopy(AMODE *ap)
+{
+	int k;
+
+	if (ap==nullptr)
+		return;
+	switch(ap->mode) {
+	case am_reg:
+	case am_ind:
+	case am_indx:
+	case am_indx2:
+	case am_indx3:
+		if (ap->pregs && (k = vn[ap->pregs]) != ap->pregs && IsAvailable(k)) {
+			ap->preg = valReg[k];
+			ap->pregs = k;
+			nCopies++;
+		}
+		if ((ap->mode==am_indx2 || ap->mode==am_indx3) && ap->sregs
+			&& (k = vn[ap->sregs]) != ap->sregs && IsAvailable(k)) {
+			ap->sreg = valReg[k];
+			ap->sregs = k;
+			nCopies++;
+		}
+		break;
+	}
+}
+
+// The values of the registers a call or the end of the function might read.
+
+static void AddSeeds(bool temps)
+{
+	int regno;
+
+	for (regno = 1; regno < SSA_NREGS; regno++) {
+		if (!IsTracked(regno) || cur[regno]==0)
+			continue;
+		if (!temps && regno >= regFirstTemp && regno <= regLastTemp)
+			continue;
+		seeds->add(cur[regno]);
+	}
+}
+
+// A phi whose operands all have the same value number has that number too.
+// Operands coming around a loop haven't been numbered yet, so they don't
+// match.
+
+static void NumberPhi(OCODE *ip)
+{
+	Edge *e;
+	int j, k;
+
+	k = 0;
+	for (e = ip->bb->ihead, j = 0; e; e = e->next, j++) {
+		if (!e->executable && !allExec)
+			continue;
+		if (k==0)
+			k = vn[ip->phiops[j]];
+		else if (vn[ip->phiops[j]] != k) {
+			k = 0;
+			break;
+		}
+	}
+	if (k > 0)
+		vn[ip->ssaValue] = k;
+}
+
+void SSA::Number(BasicBlock *b)
+{
+	int saved[SSA_NREGS];
+	OCODE *ip, *ip2;
+	SSAKey key;
+	Edge *e;
+	int regno, v, k, ntab;
+
+	memcpy(saved, cur, sizeof(cur));
+	ntab = nTable;
+	for (ip = b->code; ip && ip->bb==b; ip = ip2) {
+		ip2 = ip->fwd;
+		if (ip->opcode==op_label)
+			continue;
+		if (ip->opcode==op_phi) {
+			NumberPhi(ip);
+			cur[ip->oper1->preg] = ip->ssaValue;
+			continue;
+		}
+		// An operand that is also written stays as it is.
+		if (ReadsOper1(ip) && !(ip->oper1->mode==am_reg && MayDefine(ip, ip->oper1->preg)))
+			PropagateCopy(ip->oper1);
+		PropagateCopy(ip->oper2);
+		PropagateCopy(ip->oper3);
+		PropagateCopy(ip->oper4);
+		if (ip->opcode==op_call)
+			AddSeeds(false);
+		else if (IsCall(ip) || IsExit(ip))
+			AddSeeds(true);
+		v = ip->ssaValue;
+		if (IsFoldable(ip)) {
+			if (ip->opcode==op_mov && ip->oper2->mode==am_reg && IsTracked(ip->oper2->preg)
+				&& ip->oper2->pregs) {
+				vn[v] = k = vn[ip->oper2->pregs];
+				if (IsAvailable(k) && valReg[k]==ip->oper1->preg) {
+					RemoveInsn(ip);
+					nRedundant++;
+				}
+			}
+			else if (MakeKey(ip, &key)) {
+				k = LookupKey(&key);
+				if (k > 0 && IsAvailable(k)) {
+					vn[v] = k;
+					if (valReg[k]==ip->oper1->preg) {
+						// The register already holds the value.
+						RemoveInsn(ip);
+						nRedundant++;
+					}
+					// Loading a constant is as cheap as a move.
+					else if (ip->opcode != op_ldi) {
+						ip->opcode = op_mov;
+						ip->insn = GetInsn(op_mov);
+						ip->oper2 = makereg(valReg[k]);
+						ip->oper2->pregs = k;
+						ip->oper3 = nullptr;
+						ip->oper4 = nullptr;
+						nRedundant++;
+					}
+				}
+				else
+					InsertKey(&key, v);
+			}
+		}
+		for (regno = 1; regno < SSA_NREGS; regno++)
+			if (IsTracked(regno) && Defines(ip, regno))
+				cur[regno] = v++;
+	}
+	if (b->ohead==nullptr)
+		AddSeeds(true);
+	for (e = b->dhead; e; e = e->next)
+		Number(e->dst);
+	PopKeys(ntab);
+	memcpy(cur, saved, sizeof(cur));
+}
+
+// ----------------------------------------------------------------------------
+// Dead code elimination
+// ----------------------------------------------------------------------------
+
+static void PushLive(int v)
+{
+	if (v > 0 && !valLive[v]) {
+		valLive[v] = true;
+		valWork[nValWork++] = v;
+	}
+}
+
+static void MarkLive(int v)
+{
+	OCODE *ip;
+	int vals[100];
+	int nn, n;
+
+	PushLive(v);
+	while (nValWork > 0) {
+		v = valWork[--nValWork];
+		ip = valDef[v];
+		if (ip==nullptr)
+			continue;
+		// The instruction was found to be redundant.
+		if (ip->remove) {
+			PushLive(vn[v]);
+			continue;
+		}
+		if (ip->opcode != op_phi && !IsFoldable(ip))
+			continue;
+		n = GetUses(ip, vals);
+		for (nn = 0; nn < n; nn++)
+			PushLive(vals[nn]);
+	}
+}
+
+// Mark the values read by the instructions that have to stay, and the
+// values read in computing those, then remove the instructions whose
+// values aren't read.
+
+void SSA::Sweep()
+{
+	BasicBlock *b;
+	OCODE *ip, *ip2;
+	int vals[100];
+	int nn, n;
+
+	for (n = seeds->firstMember(); n >= 0; n = seeds->nextMember(n))
+		MarkLive(n);
+	for (b = RootBlock; b; b = b->next) {
+		FOR_BLOCK(ip, b) {
+			if (ip->opcode==op_label || ip->opcode==op_phi || IsFoldable(ip))
+				continue;
+			n = GetUses(ip, vals);
+			for (nn = 0; nn < n; nn++)
+				MarkLive(vals[nn]);
+		}
+		if (b==LastBlock)
+			break;
+	}
+	for (b = RootBlock; b; b = b->next) {
+		for (ip = b->code; ip && ip->bb==b; ip = ip2) {
+			ip2 = ip->fwd;
+			if (IsFoldable(ip) && !valLive[ip->ssaValue]) {
+				RemoveInsn(ip);
+				nDead++;
+			}
+		}
+		if (b==LastBlock)
+			break;
+	}
+}
+
+// Taking the code out of SSA form only needs the phi instructions removed,
+// as the registers haven't been renamed.
+
+void SSA::RemovePhis()
+{
+	OCODE *ip, *ip2;
+
+	for (ip = peep_head; ip; ip = ip2) {
+		ip2 = ip->fwd;
+		if (ip->opcode==op_phi) {
+			if (ip==peep_head)
+				peep_head = ip2;
+			Unlink(ip);
+		}
+	}
+}
+
+void SSA::Optimize()
+{
+	int nn;
+
+	if (!CanOptimize())
+		return;
+	RootBlock = BasicBlock::Blockize(peep_head);
+	// Code falling off the end of the last block isn't looked at.
+	if (LastBlock->next && LastBlock->next->code)
+		return;
+	CFG::Create();
+	nPhis = nConsts = nBranches = nRedundant = nCopies = nDead = 0;
+	Build();
+	if (overflow) {
+		RemovePhis();
+		return;
+	}
+	Propagate();
+	ApplyConstants();
+	seeds = CSet::MakeNew();
+	nTable = 0;
+	for (nn = 0; nn < SSA_NBUCKETS; nn++)
+		buckets[nn] = -1;
+	memcpy(cur, entryVal, sizeof(cur));
+	nValWork = 0;
+	Number(RootBlock);
+	Sweep();
+	RemovePhis();
+	DTRACE(TRC_SSA).printf("<SSA>%s values=%d", (char *)currentFn->name->c_str(), nValues);
+	DTRACE(TRC_SSA).printf(" phis=%d consts=%d", nPhis, nConsts);
+	DTRACE(TRC_SSA).printf(" branches=%d redundant=%d", nBranches, nRedundant);
+	DTRACE(TRC_SSA).printf(" copies=%d dead=%d</SSA>\n", nCopies, nDead);
+}
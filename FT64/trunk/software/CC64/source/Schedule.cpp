@@ -0,0 +1,407 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2017-2018  Robert Finch, Waterloo
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// CC64 - 'C' derived language compiler
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This source file is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================================
+//
+#include "stdafx.h"
+
+// List scheduling of the instructions within a basic block.
+//
+// This runs last in the peephole optimizer, after the registers are
+// settled. A run of instructions with a latency in the instruction table,
+// none of them a label, branch, call or predicated instruction, is a
+// region. The instructions of a region are ordered by the dependences
+// between them, through registers and memory, and then issued cycle by
+// cycle. Among the instructions that are ready, the one with the longest
+// path of latencies after it goes first, so a load or multiply is started
+// as early as it can be and the instructions that don't need its result
+// fill the time until it's ready.
+//
+// Loads may pass each other. A store and another access are only taken to
+// be independent when both are at constant offsets from the same value of
+// a base register and don't overlap. No access is moved across a change
+// to the stack pointer.
+
+#define SCHED_MAX		100		// instructions in a region
+#define SCHED_WIDTH		2		// instructions issued per cycle
+#define SCHED_NALU		2
+
+extern OCODE *peep_head;
+extern OCODE *peep_tail;
+extern bool Oper1Read(OCODE *ip);
+
+static OCODE *insns[SCHED_MAX];
+static OCODE *comments[SCHED_MAX];
+static unsigned int uses[SCHED_MAX];		// registers read, as a bit mask
+static unsigned int defs[SCHED_MAX];		// registers written
+static char memop[SCHED_MAX];				// 0 none, 'l' load, 's' store
+static int baseVer[SCHED_MAX];			// writes to the base register before
+static short dep[SCHED_MAX][SCHED_MAX];	// cycles from i to j, -1 if independent
+static int npreds[SCHED_MAX];
+static int height[SCHED_MAX];
+static int earliest[SCHED_MAX];
+static int order[SCHED_MAX];
+static bool done[SCHED_MAX];
+static int nRegions, nMoved, nCyclesBefore, nCyclesAfter;
+
+static bool IsGeneralOperand(AMODE *ap)
+{
+	if (ap==nullptr)
+		return (true);
+	switch(ap->mode) {
+	case am_reg:
+		return (ap->type != stdvector.GetIndex() && ap->type != stddouble.GetIndex()
+			&& ap->type != stdvectormask->GetIndex());
+	case am_ind:
+	case am_indx:
+	case am_indx2:
+	case am_indx3:
+	case am_immed:
+	case am_direct:
+		return (true);
+	}
+	return (false);
+}
+
+static bool IsSchedulable(OCODE *ip)
+{
+	if (ip->insn==nullptr || ip->insn->latency==0)
+		return (false);
+	if (ip->remove || ip->isVolatile || ip->predop != 1)
+		return (false);
+	return (IsGeneralOperand(ip->oper1) && IsGeneralOperand(ip->oper2)
+		&& IsGeneralOperand(ip->oper3) && IsGeneralOperand(ip->oper4));
+}
+
+static unsigned int RegMask(int regno)
+{
+	return (regno > 0 && regno < 32 ? 1u << regno : 0);
+}
+
+// Registers used to form the address or read as the value.
+
+static unsigned int OperUses(AMODE *ap, bool isRead)
+{
+	if (ap==nullptr)
+		return (0);
+	switch(ap->mode) {
+	case am_reg:
+		return (isRead ? RegMask(ap->preg) : 0);
+	case am_ind:
+	case am_indx:
+		return (RegMask(ap->preg));
+	case am_indx2:
+	case am_indx3:
+		return (RegMask(ap->preg) | RegMask(ap->sreg));
+	}
+	return (0);
+}
+
+static int AccessSize(OCODE *ip)
+{
+	switch(ip->insn->opcode) {
+	case op_lb:	case op_lbu:	case op_sb:	return (1);
+	case op_lc:	case op_lcu:	case op_sc:	return (2);
+	case op_lh:	case op_lhu:	case op_sh:	return (4);
+	}
+	return (8);
+}
+
+// Get the base register and offset of an address, if it's a constant
+// offset from a register.
+
+static bool GetAddress(AMODE *ap, int *base, int64_t *offs, bool *isParm)
+{
+	*isParm = false;
+	if (ap==nullptr)
+		return (false);
+	if (ap->mode==am_ind) {
+		*base = ap->preg;
+		*offs = 0;
+		return (true);
+	}
+	if (ap->mode != am_indx || ap->offset==nullptr)
+		return (false);
+	if (ap->offset->nodetype != en_icon && ap->offset->nodetype != en_autocon)
+		return (false);
+	*base = ap->preg;
+	*offs = ap->offset->i;
+	// Parameter offsets are adjusted for the return block at output.
+	*isParm = ap->offset->sym && ap->offset->sym->IsParameter;
+	return (true);
+}
+
+static bool MayAlias(int i, int j)
+{
+	int b1, b2;
+	int64_t o1, o2;
+	bool p1, p2;
+
+	if (!GetAddress(insns[i]->oper2, &b1, &o1, &p1) || !GetAddress(insns[j]->oper2, &b2, &o2, &p2))
+		return (true);
+	if (b1 != b2 || baseVer[i] != baseVer[j] || p1 != p2)
+		return (true);
+	return (o1 < o2 + AccessSize(insns[j]) && o2 < o1 + AccessSize(insns[i]));
+}
+
+static int Latency(int i)
+{
+	return (insns[i]->insn->latency);
+}
+
+static void BuildDependences(int n)
+{
+	int i, j, r, w;
+	int writes[32];
+	OCODE *ip;
+
+	memset(writes, 0, sizeof(writes));
+	for (i = 0; i < n; i++) {
+		ip = insns[i];
+		uses[i] = OperUses(ip->oper1, Oper1Read(ip)) | OperUses(ip->oper2, true)
+			| OperUses(ip->oper3, true) | OperUses(ip->oper4, true);
+		defs[i] = 0;
+		if (ip->insn->HasTarget && ip->oper1->mode==am_reg)
+			defs[i] = RegMask(ip->oper1->preg);
+		memop[i] = 0;
+		baseVer[i] = 0;
+		if (ip->insn->memacc) {
+			memop[i] = ip->insn->HasTarget ? 'l' : 's';
+			if (ip->oper2 && ip->oper2->preg >= 0 && ip->oper2->preg < 32)
+				baseVer[i] = writes[ip->oper2->preg];
+		}
+		for (r = 1; r < 32; r++)
+			if (defs[i] & (1u << r))
+				writes[r]++;
+	}
+	for (j = 0; j < n; j++) {
+		npreds[j] = 0;
+		for (i = 0; i < j; i++) {
+			w = -1;
+			if (defs[i] & uses[j])
+				w = Latency(i);
+			else if ((uses[i] & defs[j]) || (defs[i] & defs[j]))
+				w = 0;
+			// Memory beyond the stack pointer may be overwritten by an
+			// interrupt, so no access crosses a change to it.
+			if ((memop[i] && (defs[j] & RegMask(regSP))) || (memop[j] && (defs[i] & RegMask(regSP))))
+				if (w < 0)
+					w = 0;
+			if (memop[i] && memop[j] && (memop[i]=='s' || memop[j]=='s') && MayAlias(i, j)) {
+				if (w < 0)
+					w = 0;
+				// A load has to wait for the store ahead of it to complete.
+				if (memop[i]=='s' && memop[j]=='l' && w < 1)
+					w = 1;
+			}
+			dep[i][j] = w;
+			if (w >= 0)
+				npreds[j]++;
+		}
+	}
+	for (i = n - 1; i >= 0; i--) {
+		height[i] = Latency(i);
+		for (j = i + 1; j < n; j++)
+			if (dep[i][j] >= 0 && dep[i][j] + height[j] > height[i])
+				height[i] = dep[i][j] + height[j];
+	}
+}
+
+// The functional units in use in the current cycle.
+struct SchedUnits {
+	int cycle;
+	int issued;
+	int nalu, nalu0, nmem, nmul;
+	int divBusy;		// the divider isn't pipelined
+};
+
+static void StartCycle(SchedUnits *u, int cycle)
+{
+	u->cycle = cycle;
+	u->issued = u->nalu = u->nalu0 = u->nmem = u->nmul = 0;
+}
+
+static bool UnitFree(SchedUnits *u, int i)
+{
+	if (u->issued >= SCHED_WIDTH)
+		return (false);
+	switch(insns[i]->insn->unit) {
+	case fu_alu:	return (u->nalu < SCHED_NALU);
+	case fu_alu0:	return (u->nalu < SCHED_NALU && u->nalu0==0);
+	case fu_mem:	return (u->nmem==0);
+	case fu_mul:	return (u->nmul==0);
+	case fu_div:	return (u->cycle >= u->divBusy);
+	}
+	return (true);
+}
+
+static void TakeUnit(SchedUnits *u, int i)
+{
+	u->issued++;
+	switch(insns[i]->insn->unit) {
+	case fu_alu:	u->nalu++; break;
+	case fu_alu0:	u->nalu++; u->nalu0++; break;
+	case fu_mem:	u->nmem++; break;
+	case fu_mul:	u->nmul++; break;
+	case fu_div:	u->divBusy = u->cycle + Latency(i); break;
+	}
+}
+
+// Estimate the number of cycles the instructions take in the given order,
+// issuing them in order as soon as their operands and a unit are ready.
+
+static int CountCycles(int n, int *ord)
+{
+	SchedUnits u;
+	int issue[SCHED_MAX];
+	int k, m, i, t, total;
+
+	StartCycle(&u, 0);
+	u.divBusy = 0;
+	total = 0;
+	for (k = 0; k < n; k++) {
+		i = ord[k];
+		t = u.cycle;
+		for (m = 0; m < k; m++)
+			if (ord[m] < i && dep[ord[m]][i] >= 0 && issue[ord[m]] + dep[ord[m]][i] > t)
+				t = issue[ord[m]] + dep[ord[m]][i];
+		if (t > u.cycle)
+			StartCycle(&u, t);
+		while (!UnitFree(&u, i))
+			StartCycle(&u, u.cycle + 1);
+		TakeUnit(&u, i);
+		issue[i] = u.cycle;
+		if (issue[i] + Latency(i) > total)
+			total = issue[i] + Latency(i);
+	}
+	return (total);
+}
+
+static void ListSchedule(int n)
+{
+	SchedUnits u;
+	int nsched, best, i, j;
+
+	for (i = 0; i < n; i++) {
+		done[i] = false;
+		earliest[i] = 0;
+	}
+	nsched = 0;
+	StartCycle(&u, 0);
+	u.divBusy = 0;
+	while (nsched < n) {
+		for (;;) {
+			best = -1;
+			for (i = 0; i < n; i++) {
+				if (done[i] || npreds[i] > 0 || earliest[i] > u.cycle || !UnitFree(&u, i))
+					continue;
+				if (best < 0 || height[i] > height[best])
+					best = i;
+			}
+			if (best < 0)
+				break;
+			TakeUnit(&u, best);
+			done[best] = true;
+			order[nsched++] = best;
+			for (j = best + 1; j < n; j++) {
+				if (dep[best][j] < 0)
+					continue;
+				npreds[j]--;
+				if (u.cycle + dep[best][j] > earliest[j])
+					earliest[j] = u.cycle + dep[best][j];
+			}
+		}
+		StartCycle(&u, u.cycle + 1);
+	}
+}
+
+// Schedule the region starting at the given instruction. Returns the
+// instruction following the region.
+
+OCODE *Scheduler::ScheduleRegion(OCODE *first)
+{
+	OCODE *ip, *before, *after;
+	int n, k;
+	int ident[SCHED_MAX];
+	int oldCycles, newCycles;
+
+	n = 0;
+	for (ip = first; ip && n < SCHED_MAX && ip->bb==first->bb && IsSchedulable(ip); ip = ip->fwd)
+		insns[n++] = ip;
+	after = ip;
+	if (n < 2)
+		return (after);
+	before = first->back;
+	BuildDependences(n);
+	ListSchedule(n);
+	for (k = 0; k < n; k++) {
+		ident[k] = k;
+		comments[k] = insns[k]->comment;
+	}
+	nRegions++;
+	oldCycles = CountCycles(n, ident);
+	newCycles = CountCycles(n, order);
+	nCyclesBefore += oldCycles;
+	// The list is greedy and may do worse than the order the code was
+	// generated in.
+	if (newCycles >= oldCycles) {
+		nCyclesAfter += oldCycles;
+		return (after);
+	}
+	nCyclesAfter += newCycles;
+	// Relink the instructions in the new order. The comments stay where
+	// they were in the listing.
+	for (k = 0; k < n; k++) {
+		ip = insns[order[k]];
+		if (order[k] != k)
+			nMoved++;
+		ip->comment = comments[k];
+		ip->back = k > 0 ? insns[order[k-1]] : before;
+		ip->fwd = k < n - 1 ? insns[order[k+1]] : after;
+	}
+	if (before)
+		before->fwd = insns[order[0]];
+	else
+		peep_head = insns[order[0]];
+	if (after)
+		after->back = insns[order[n-1]];
+	else
+		peep_tail = insns[order[n-1]];
+	return (after);
+}
+
+void Scheduler::Run()
+{
+	OCODE *ip;
+
+	nRegions = nMoved = nCyclesBefore = nCyclesAfter = 0;
+	for (ip = peep_head; ip; ) {
+		if (IsSchedulable(ip))
+			ip = ScheduleRegion(ip);
+		else
+			ip = ip->fwd;
+	}
+	DTRACE(TRC_SCHED).printf("<Schedule>%s", (char *)currentFn->name->c_str());
+	DTRACE(TRC_SCHED).printf(" regions=%d moved=%d", nRegions, nMoved);
+	DTRACE(TRC_SCHED).printf(" cycles=%d->%d</Schedule>\n", nCyclesBefore, nCyclesAfter);
+}
@@ -16,208 +16,149 @@
 #endif
 
 
-void CSet::allocBitStorage()
+CSet *CSet::MakeNew()
 {
-	if (size <= SET_DEFAULT_SIZE)
-	{
- 		size = SET_DEFAULT_SIZE;
-		map = dmap;
-	}
-	else {
-		map = (unsigned int *)allocx(sizeof(unsigned int)*size);
-//		map = new unsigned int[size];
-	}
+	CSet *p;
 
+	p = (CSet *)allocx(sizeof(CSet), MEM_OPT);
+	p->Create();
+	return (p);
 }
 
 
-void CSet::copy(const CSet &s)
-{
-//	if (map != dmap)	// get rid of an old map
-//		delete[] map;
-	compl = s.compl;
-	size = s.size;
-	nbits = s.nbits;
-	MemberPtr = s.MemberPtr;
-
-	// Either assign default map or allocate memory.
-	allocBitStorage();
-	memcpy(map, s.map, s.size * sizeof(int));
-}
-
+// The map is only made larger, never smaller, so a set that is reused keeps
+// its storage.
 
-// Assignment (copy) operator
-// --------------------------
-CSet& CSet::operator=(CSet &s)
+void CSet::copy(const CSet &s)
 {
-	if (map != dmap)
-		delete[] map;
-	compl = s.compl;
-	size = s.size;
-	nbits = s.nbits;
-	MemberPtr = s.MemberPtr;
-
-	// Either assign default map or allocate memory.
-	allocBitStorage();
-	memcpy(map, s.map, s.size * sizeof(int));
-	return *this;
+	if (size < s.size)
+		enlarge(s.size);
+	memcpy(map, s.map, s.size * sizeof(uint64_t));
+	if (size > s.size)
+		memset(&map[s.size], 0, (size - s.size) * sizeof(uint64_t));
 }
 
 
 // Union of two sets.
 // ------------------
-CSet CSet::operator|(CSet s)
+CSet CSet::operator|(const CSet &s) const
 {
-	CSet o;
-	int ii, NumWords;
+	CSet o(*this);
 
-	// Set the size of the bitmap to the greater of the two sizes.
-	if (size >= s.size)
-	{
-		o.size = size;
-		o.nbits = nbits;
-	}
-	else
-	{
-		o.size = s.size;
-		o.nbits = s.nbits;
-	}
-	o.allocBitStorage();
-
-	NumWords = min(size, s.size);
-	// Set bits in output according to union of two sets.
-	for (ii = NumWords - 1; --ii >= 0;)
-		o.map[ii] = map[ii] | s.map[ii];
-	// Copy remaining words to output bitset
-	if (s.size > size)
-		memcpy(&o.map[size], &s.map[size],
-            (s.size - size) * sizeof(int));
-	else
-		memcpy(&o.map[s.size], &map[s.size],
-            (size - s.size) * sizeof(int));
+	o.add(s);
 	return o;
 }
 
 
-// Union to same set.
+// Union to same set. Returns true if any members were added.
 // ------------------
-CSet& CSet::operator|=(CSet s)
+bool CSet::add(const CSet &s)
 {
 	int ii;
+	uint64_t chg;
 
-	// Set the size of the bitmap to the greater of the two sizes.
 	if (size < s.size)
 		enlarge(s.size);
-	for (ii = min(size,s.size); --ii >= 0;)
+	chg = 0;
+	for (ii = 0; ii < s.size; ii++) {
+		chg |= s.map[ii] & ~map[ii];
 		map[ii] |= s.map[ii];
-	return *this;
+	}
+	return (chg != 0);
 }
 
 
-void CSet::add(CSet &s)
+/*	-------------------------------------------------------------------
+ 		Intersection of two sets.
+-------------------------------------------------------------------- */	
+
+CSet CSet::operator&(const CSet &s) const
 {
-	int ii;
+	CSet o(*this);
 
-	// Set the size of the bitmap to the greater of the two sizes.
-	if (size < s.size)
-		enlarge(s.size);
-	for (ii = min(size,s.size); --ii >= 0;)
-		map[ii] |= s.map[ii];
+	o.intersect(s);
+	return o;
 }
 
 
-void CSet::add(CSet *s)
+/* --------------------------------------------------------------------
+	Intersection to same set.
+-------------------------------------------------------------------- */
+
+void CSet::intersect(const CSet &s)
 {
-	int ii;
+	int ii, n;
 
-	// Set the size of the bitmap to the greater of the two sizes.
-	if (size < s->size)
-		enlarge(s->size);
-	for (ii = min(size,s->size); --ii >= 0;)
-		map[ii] |= s->map[ii];
+	n = min(size, s.size);
+	for (ii = 0; ii < n; ii++)
+		map[ii] &= s.map[ii];
+	for (; ii < size; ii++)
+		map[ii] = 0;
 }
 
 
-/*	-------------------------------------------------------------------
- 		Intersection of two sets. If the two sets are not the same
-    size then smaller set is used as the size of the output.
--------------------------------------------------------------------- */	
+/* --------------------------------------------------------------------
+	Difference to same set - removes all the members of s.
+-------------------------------------------------------------------- */
 
-CSet CSet::operator&(CSet s)
+void CSet::remove(const CSet &s)
 {
-	CSet o;
-	int ii;
-
-	// Set the size of the bitmap to the smaller of the two sizes.
-	if (size <= s.size)
-	{
-		o.size = size;
-		o.nbits = nbits;
-	}
-	else
-	{
-		o.size = s.size;
-		o.nbits = s.nbits;
-	}
+	int ii, n;
 
-	o.allocBitStorage();
-
-	// Set bits in output according to union of two sets.
-	for (ii = o.size; --ii >= 0;)
-		o.map[ii] = map[ii] & s.map[ii];
-	return o;
+	n = min(size, s.size);
+	for (ii = 0; ii < n; ii++)
+		map[ii] &= ~s.map[ii];
 }
 
 
 /* --------------------------------------------------------------------
-	Intersection to same set.
+	Sets the set to a | (b - c), the dataflow equation for live
+	variables, without building any intermediate sets.
+	Returns true if the set changed.
 -------------------------------------------------------------------- */
 
-CSet& CSet::operator&=(CSet s)
+bool CSet::unionDiff(const CSet &a, const CSet &b, const CSet &c)
 {
-	int ii;
-
-	// Set the size of the bitmap to the smaller of the two sizes.
-	if (size > s.size)
-	{
-		memset(&map[size], 0, (size - s.size)*sizeof(int));
-		size = s.size;
-		nbits = s.nbits;
+	int ii, n;
+	uint64_t w, chg;
+
+	n = max(a.size, b.size);
+	if (size < n)
+		enlarge(n);
+	chg = 0;
+	for (ii = 0; ii < size; ii++) {
+		w = (ii < b.size ? b.map[ii] : 0) & ~(ii < c.size ? c.map[ii] : 0);
+		w |= ii < a.size ? a.map[ii] : 0;
+		chg |= w ^ map[ii];
+		map[ii] = w;
 	}
-	
-	for (ii = size; --ii >= 0;)
-		map[ii] &= s.map[ii];
-	return *this;
+	return (chg != 0);
 }
 
 
 /* --------------------------------------------------------------------
-	Enlarge set to 'n'. Enlarge works in chunk sizes.
+	Enlarge set to 'n' words. Enlarge works in chunk sizes.
 -------------------------------------------------------------------- */
 
 void CSet::enlarge(int n)
 {
-	unsigned int *p;
+	uint64_t *p;
 
-	if (n < size)
+	if (n <= size)
 		return;
-	n = (n + 4) & ~3;
-	//p = new unsigned int[n];
-	p = (unsigned int *)allocx(sizeof(int) * n);
+	n = (n + 3) & ~3;
+	p = (uint64_t *)allocx(sizeof(uint64_t) * n, MEM_OPT);
 	if (p == NULL)
 	{
 		fprintf(stderr, "Can't get memory to expand set.\n");
 		exit(1);
 	}
-	memcpy(p, map, size * sizeof(int));
-	if (memcmp(p,map,size*sizeof(int)) != 0)
-		printf("hi");
-//	memset(p+size, 0, (n-size) * sizeof(int)); <- allocx zeros memory
-//	if (map != dmap)
-//		delete[] map;
+	memcpy(p, map, size * sizeof(uint64_t));
+	// The old map can be reused by the next set that grows to this size.
+	if (map != dmap)
+		Arena::func.free(map, size * sizeof(uint64_t));
 	map = p;
 	size = n;
-	nbits = n * sizeof(int) << 3;
 }
 
 
@@ -225,13 +166,11 @@ void CSet::enlarge(int n)
     member.
 		(s =) s1 + 100;
 */
-CSet CSet::operator+(int bit)
+CSet CSet::operator+(int bit) const
 {
-	CSet s = *this;
+	CSet s(*this);
 
-	if (bit > s.nbits)
-		s.enlarge((bit >> SET_NBIT) + 8);
-	s.map[bit >> SET_NBIT] |= (1 << (bit & SET_BMASK));
+	s.add(bit);
 	return s;
 }
 
@@ -239,205 +178,63 @@ CSet CSet::operator+(int bit)
 /* Create a new set which contains all members of a set except member.
 		(s =) s1 - 100;
 */
-CSet CSet::operator-(int bit)
+CSet CSet::operator-(int bit) const
 {
-	CSet s = *this;
+	CSet s(*this);
 
-	if (bit < s.nbits)
-		s.map[bit >> SET_NBIT] &= ~(1 << (bit & SET_BMASK));
+	s.remove(bit);
 	return s;
 }
 
 
 /* Figure out the (symettric)difference between two sets.
 */
-CSet CSet::operator-(CSet s)
+CSet CSet::operator-(const CSet &s) const
 {
-	CSet o;
+	CSet o(*this);
 	int ii;
 
-	o.size = max(size, s.size);
-	o.nbits = max(nbits, s.nbits);
-	o.allocBitStorage();
-
-	// Set difference of elements common in both sets.
-	for (ii = min(size, s.size); --ii >= 0;)
-		o.map[ii] = map[ii] ^ s.map[ii];
-	// Set remaining elements equal to elements remaining in larger set.
-	if (size < s.size)
-		for (ii = s.size; --ii >= size;)
-			o.map[ii] = s.map[ii];
-	else if (size > s.size)
-		for (ii = size; --ii >= s.size;)
-    		o.map[ii] = map[ii];
+	if (o.size < s.size)
+		o.enlarge(s.size);
+	for (ii = 0; ii < s.size; ii++)
+		o.map[ii] ^= s.map[ii];
 	return o;
 }
 
 
-// Flip all bits in set.
-CSet CSet::operator!()
-{
-	int ii;
-	CSet o;
-
-	o = *this;
-	for (ii = size; --ii >= 0;)
-		o.map[ii] = ~map[ii];
-	return o;
-}
-
-/*
-CSet &CSet::operator!()
-{
-	int ii;
-
-	for (ii = size; --ii >= 0;)
-		map[ii] = ~map[ii];
-	return *this;
-}
-*/
-
 /* --------------------------------------------------------------------
    Get the number of elements in the set.
 -------------------------------------------------------------------- */
 
 int CSet::NumMember() const
 {
-	// Stores the number of set bits in each value 0-255
-	static unsigned char numbits[] =
-	{
-		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
-		1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-		1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-		2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-		1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-		2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-		2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-		3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-		1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-		2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-		2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-		3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-		2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-		3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-		3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-		4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
-	};
-
 	int tot = 0, ii;
-	unsigned __int8 *pm = (unsigned __int8 *)map;
 
-	for (ii = size * sizeof(int); --ii >= 0;)
-		tot += numbits[pm[ii]];
+	for (ii = 0; ii < size; ii++)
+		tot += SetPopcnt(map[ii]);
 	return (tot);
 }
 
 
-inline void CSet::clear()   // Zero all bits
-    { memset((char *)map, 0, size * sizeof(int)); };
-inline void CSet::fill()    // Set all bits
-    { memset((char *)map, ~0, size * sizeof(int)); };
-inline void CSet::complement() { compl = ~compl; };
-
-/* --------------------------------------------------------------------
-	Remove member - clears bit in map
--------------------------------------------------------------------- */
-
-void CSet::remove(int x)
+int CSet::isEmpty() const
 {
-   if (x < nbits)
-      map[x >> SET_NBIT] &= ~(1 << (x & SET_BMASK));
-}
-
-
-/* --------------------------------------------------------------------
-	Determines if set is a subset of another.
--------------------------------------------------------------------- */
-
-int CSet::subset(CSet &poss) const
-{
-	unsigned int *subsetp, *setp;
-	int common, tail;
-
-	if(poss.size > size)
-	{
-		common = size;
-		tail = poss.size - size;
-	}
-	else
-	{
-		common = poss.size;
-		tail = 0;
-	}
-	subsetp = poss.map;
-	setp = map;
-
-	for (; --common >= 0; subsetp++, setp++)
-		if ((*subsetp & *setp) != *subsetp)
-			return 0;
-	while(--tail >= 0)
-		if (*subsetp++)
-			return 0;
-	return 1;
-}
-
-
-/* --------------------------------------------------------------------
-	Set set back to default size and clear.
--------------------------------------------------------------------- */
-
-void CSet::truncate()
-{
-	if (map != dmap)
-	{
-		delete[] map;
-		map = dmap;
-	}
-	size = SET_DEFAULT_SIZE;
-	nbits = SET_DEFAULT_SIZE * sizeof(int) * 8;
-	memset(dmap, 0, size * sizeof(int));
-}
-
-
-/* --------------------------------------------------------------------
-	Hash the set.
--------------------------------------------------------------------- */
-
-unsigned CSet::hash() const
-{
-	unsigned int *p;
-	unsigned total;
-	int j;
-
-	total = 0;
-	j = size;
-	p = map;
-
-	while(--j >= 0)
-		total += *p++;
+	int ii;
+	uint64_t w = 0;
 
-	return total;
+	for (ii = 0; ii < size; ii++)
+		w |= map[ii];
+	return (w == 0);
 }
 
 
 /* --------------------------------------------------------------------
-		Print the contents of a set bitmap.
+	Remove member - clears bit in map
 -------------------------------------------------------------------- */
 
-int CSet::print(int (*OutRout)(void *a, ...), void *param)
+void CSet::remove(int x)
 {
-	int i,DidSomething = 0;
-
-	resetPtr();
-	while((i = nextMember()) >= 0)
-	{
-		DidSomething++;
-		(*OutRout)(param, "%d", i);
-	}
-	resetPtr();
-	if (!DidSomething)
-		(*OutRout)(param, "empty", -2);
-	return (DidSomething);
+	if (x >= 0 && (x >> SET_NBIT) < size)
+		map[x >> SET_NBIT] &= ~(1ULL << (x & SET_BMASK));
 }
 
 
@@ -454,9 +251,8 @@ int CSet::sprint(char *buf, int bufsz)
 	int i;
 	int nn;
 
-	resetPtr();
 	nn = sprintf_s(buf, bufsz, "{ ");
-	while((i = nextMember()) >= 0)
+	for (i = firstMember(); i >= 0; i = nextMember(i))
 	{
 		_itoa_s(i, &buf[nn], bufsz-nn, 10);
 		while(buf[nn]) ++nn;
@@ -470,7 +266,6 @@ int CSet::sprint(char *buf, int bufsz)
 	}
 	buf[nn] = '}';	nn++;
 	buf[nn] = '\0';
-	resetPtr();
 	return (nn);
 }
 
@@ -486,162 +281,106 @@ int CSet::sprint(char *buf, int bufsz)
     considered to be larger.
 -------------------------------------------------------------------- */
 
-int CSet::cmp(CSet& s) const
+int CSet::cmp(const CSet& s) const
 {
-	int j;
-	unsigned int *m1, *m2;
+	int j, n;
 
-	j = min(size, s.size);
-
-	for (m1 = map, m2 = s.map; --j >= 0; m1++, m2++)
-		if (*m1 != *m2)
-			return (*m1 - *m2);
+	n = min(size, s.size);
+	for (j = 0; j < n; j++)
+		if (map[j] != s.map[j])
+			return (map[j] > s.map[j] ? 1 : -1);
 	// If all words in both sets are the same then check the tail of
     // the larger set and make sure all elements are not set.
-	if (size == s.size)
-		return 0;
-	if (size > s.size)
-	{
-		for (j = size - s.size; --j >= 0;)
-			if (*m1++)
-				return 1;
-	}
-	else
-	{
-		for (j = s.size - size; --j >= 0;)
-			if (*m2++)
-         		return -1;
-	}
+	for (; j < size; j++)
+		if (map[j])
+			return 1;
+	for (; j < s.size; j++)
+		if (s.map[j])
+			return -1;
 	return 0;
 }
 
 
 /* --------------------------------------------------------------------
-		Get the next member in the set.
+		Get the next member in the set after n. Whole words of
+	non-members are skipped.
 -------------------------------------------------------------------- */
 
-int CSet::nextMember()
+int CSet::nextMember(int n) const
 {
-	while(MemberPtr < nbits)
-	{
-		if (test(MemberPtr))
-		{
-			MemberPtr++;
-			return (MemberPtr-1);
-		}
-		MemberPtr++;
+	int ii;
+	uint64_t w;
+
+	n++;
+	ii = n >> SET_NBIT;
+	if (ii >= size)
+		return (-1);
+	w = map[ii] & (~0ULL << (n & SET_BMASK));
+	while (w == 0) {
+		if (++ii >= size)
+			return (-1);
+		w = map[ii];
 	}
-	return (-1);
+	return ((ii << SET_NBIT) + SetCtz(w));
 }
 
-int CSet::prevMember()
+int CSet::prevMember(int n) const
 {
-	while(MemberPtr > 0)
-	{
-		if (test(MemberPtr-1))
-		{
-			MemberPtr--;
-			return (MemberPtr);
-		}
-		MemberPtr--;
+	int ii;
+	uint64_t w;
+
+	if (n <= 0)
+		return (-1);
+	n--;
+	ii = n >> SET_NBIT;
+	if (ii >= size) {
+		ii = size - 1;
+		w = map[ii];
 	}
-	return (-1);
+	else
+		w = map[ii] & (~0ULL >> (63 - (n & SET_BMASK)));
+	while (w == 0) {
+		if (--ii < 0)
+			return (-1);
+		w = map[ii];
+	}
+	return ((ii << SET_NBIT) + 63 - SetClz(w));
 }
 
-int CSet::lastMember()
+int CSet::lastMember() const
 {
-	int nn = nbits-1;
-	while(!test(nn) && nn > 0) nn--;
-	return(nn);
-}
+	int ii;
 
-int CSet::Member(int n)
-{
-	resetPtr();
-	while(MemberPtr < nbits && n > -1)
-	{
-		if (test(MemberPtr))
-		{
-			n--;
-			MemberPtr++;
-			if (n < 0)
-			return (MemberPtr-1);
-		}
-		MemberPtr++;
-	}
+	for (ii = size - 1; ii >= 0; ii--)
+		if (map[ii])
+			return ((ii << SET_NBIT) + 63 - SetClz(map[ii]));
 	return (-1);
 }
 
 
 /* --------------------------------------------------------------------
+	True if the sets have no members in common.
 -------------------------------------------------------------------- */
 
-int CSet::SetTest(CSet &s)
+int CSet::isDisjoint(const CSet &s) const
 {
-	int i, rval = SET_EQUIV;
-	unsigned int *p1, *p2;
-
-	i = max(size, s.size);
-
-	// Make the sets the same size.
-	if (s.size > size)
-		enlarge(i);
-	else
-		s.enlarge(i);
-
-	p1 = map;
-	p2 = s.map;
+	int ii, n;
+	uint64_t w = 0;
 
-	for (; --i >=0; p1++, p2++)
-	{
-		if (*p1 != *p2)
-		{
-			if (*p1 & *p2)
-				return (SET_INTER);
-			else
-				rval = SET_DISJ;
-		}
-	}
-	return rval;
+	n = min(size, s.size);
+	for (ii = 0; ii < n; ii++)
+		w |= map[ii] & s.map[ii];
+	return (w == 0);
 }
 
-int CSet::isSubset(CSet &s)
-{
-	int i;
-	unsigned int *p1, *p2;
-
-	if (s.size > size)
-		return (false);
-	p1 = map;
-	p2 = s.map;
-	for (i = s.size; --i >= 0; p1++, p2++) {
-		if ((*p1 & *p2) != *p2)
-			return (false);
-	}
-	return (true);
-}
+// True if s is a subset of this set.
 
-/*
-void CSet::Serialize(CArchive& ar)
+int CSet::isSubset(const CSet &s) const
 {
-	int nn;
+	int ii;
+	uint64_t w = 0;
 
-	if (ar.IsStoring()) {
-		ar << MemberPtr;
-		ar << nbits;
-		ar << size;
-		ar << compl;
-		for (nn = 0; nn < size; nn++)
-			ar << map[nn];
-	}
-	else {
-		ar >> MemberPtr;
-		ar >> nbits;
-		ar >> size;
-		ar >> compl;
-		enlarge(size);
-		for (nn = 0; nn < size; nn++)
-			ar >> map[nn];
-	}
+	for (ii = 0; ii < s.size; ii++)
+		w |= s.map[ii] & ~(ii < size ? map[ii] : 0);
+	return (w == 0);
 }
-*/
\ No newline at end of file
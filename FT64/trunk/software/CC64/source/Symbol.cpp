@@ -116,6 +116,25 @@ TypeArray *SYM::GetProtoTypes()
 	return i16;
 }
 
+// Get the prototype types into an array supplied by the caller. Used when
+// searching for a matching prototype so that an array isn't allocated for
+// every candidate.
+
+void SYM::GetProtoTypes(TypeArray *ta)
+{
+	SYM *sp;
+
+	ta->Clear();
+	sp = GetPtr(proto.GetHead());
+	if (sp==nullptr)
+		sp = GetPtr(params.GetHead());
+	for (; sp; sp = sp->GetNextPtr())
+		ta->Add(sp->tp,(__int16)(sp->IsRegister ? sp->reg : 0));
+}
+
+// Spreads symbols across the gsyms lists for listing. Lookups go through
+// SymbolIndex.
+
 uint8_t hashadd(char *nm)
 {
 	uint8_t hsh;
@@ -180,94 +199,94 @@ SYM *gsearch2(std::string na, __int16 rettype, TypeArray *typearray, bool exact)
 	Statement *st;
 	SYM *p;
 
-	dfs.printf("\n<gsearch2> for: |%s|\n", (char *)na.c_str());
+	DTRACE(TRC_SYM).printf("\n<gsearch2> for: |%s|\n", (char *)na.c_str());
 	prefix = nullptr;
 	sp = nullptr;
 	// There might not be a current statement if global declarations are
 	// being processed.
 	if (currentStmt==NULL) {
-	  dfs.printf("Stmt=null, looking in global table\n");
+	  DTRACE(TRC_SYM).printf("Stmt=null, looking in global table\n");
 		if (gsyms[0].Find(na,rettype,typearray,exact)) {
 			sp = TABLE::match[TABLE::matchno-1];
-			dfs.printf("Found in global symbol table\n");
-			dfs.puts("</gsearch2>\n");
+			DTRACE(TRC_SYM).printf("Found in global symbol table\n");
+			DTRACE(TRC_SYM).puts("</gsearch2>\n");
 			return sp;
 		}
-		dfs.puts("</gsearch2>\n");
+		DTRACE(TRC_SYM).puts("</gsearch2>\n");
 		return nullptr;
 	}
 	else {
-    dfs.printf("Looking in statement table\n");
+    DTRACE(TRC_SYM).printf("Looking in statement table\n");
 		if (currentStmt->ssyms.Find(na,rettype,typearray,exact)) {
 			sp = TABLE::match[TABLE::matchno-1];
-     	dfs.printf("Found as an auto var\n");
-			dfs.puts("</gsearch2>\n");
+     	DTRACE(TRC_SYM).printf("Found as an auto var\n");
+			DTRACE(TRC_SYM).puts("</gsearch2>\n");
 			return sp;
 		}
 		st = currentStmt->outer;
 		while (st) {
-    dfs.printf("Looking in outer statement table\n");
+    DTRACE(TRC_SYM).printf("Looking in outer statement table\n");
 			if (st->ssyms.Find(na,rettype,typearray,exact)) {
 				sp = TABLE::match[TABLE::matchno-1];
-       	dfs.printf("Found as an auto var\n");
-  			dfs.puts("</gsearch2>\n");
+       	DTRACE(TRC_SYM).printf("Found as an auto var\n");
+  			DTRACE(TRC_SYM).puts("</gsearch2>\n");
 				return sp;
 			}
 			st = st->outer;
 		}
 		p = currentFn;
 		if (p) {
-      dfs.printf("Looking in function's symbol table\n");
+      DTRACE(TRC_SYM).printf("Looking in function's symbol table\n");
   		if (currentFn->lsyms.Find(na,rettype,typearray,exact)) {
   			sp = TABLE::match[TABLE::matchno-1];
-       	dfs.printf("Found in function symbol table (a label)\n");
-  			dfs.puts("</gsearch2>\n");
+       	DTRACE(TRC_SYM).printf("Found in function symbol table (a label)\n");
+  			DTRACE(TRC_SYM).puts("</gsearch2>\n");
   			return sp;
   		}
   		while(p) {
-  			dfs.printf("Searching method/class:%s|%p\n",(char *)p->name->c_str(),(char *)p);
+  			DTRACE(TRC_SYM).printf("Searching method/class:%s|%p\n",(char *)p->name->c_str(),(char *)p);
   			if (p->tp) {
     			if (p->tp->type != bt_class) {
-      			dfs.printf("Looking at params %p\n",(char *)&p->params);
+      			DTRACE(TRC_SYM).printf("Looking at params %p\n",(char *)&p->params);
       			if (p->params.Find(na,rettype,typearray,exact)) {
       				sp = TABLE::match[TABLE::matchno-1];
-             	dfs.printf("Found as parameter\n");
-        			dfs.puts("</gsearch2>\n");
+             	DTRACE(TRC_SYM).printf("Found as parameter\n");
+        			DTRACE(TRC_SYM).puts("</gsearch2>\n");
       				return sp;
       			}
     		  }
     			// Search for class member
-    			dfs.printf("Looking at class members %p\n",(char *)&p->tp->lst);
+    			DTRACE(TRC_SYM).printf("Looking at class members %p\n",(char *)&p->tp->lst);
     			if (p->tp->type == bt_class) {
     			  SYM *tab;
     			  int nn;
     				if (p->tp->lst.Find(na,rettype,typearray,exact)) {
     					sp = TABLE::match[TABLE::matchno-1];
-             	dfs.printf("Found in class\n");
-        			dfs.puts("</gsearch2>\n");
+             	DTRACE(TRC_SYM).printf("Found in class\n");
+        			DTRACE(TRC_SYM).puts("</gsearch2>\n");
     					return sp;
     				}
-    				dfs.printf("Base=%d",p->tp->lst.base);
+    				DTRACE(TRC_SYM).printf("Base=%d",p->tp->lst.base);
     				tab = p->GetPtr(p->tp->lst.base);
-    				dfs.printf("Base=%p",(char *)tab);
+    				DTRACE(TRC_SYM).printf("Base=%p",(char *)tab);
     				if (tab) {
-    				  dfs.puts("Has a base class");
+    				  DTRACE(TRC_SYM).puts("Has a base class");
     				  if (tab->tp) {
-           			dfs.printf("Looking at base class members:%p\n",(char *)tab);
+           			DTRACE(TRC_SYM).printf("Looking at base class members:%p\n",(char *)tab);
         				nn = tab->tp->lst.FindRising(na);
         				if (nn > 0) {
-                 	dfs.printf("Found in base class\n");
+                 	DTRACE(TRC_SYM).printf("Found in base class\n");
         				  if (exact) {
            				  //sp = sp->FindRisingMatch();
         				    sp = SYM::FindExactMatch(TABLE::matchno, na, bt_long, typearray);
         				    if (sp) {
-                			dfs.puts("</gsearch2>\n");
+                			DTRACE(TRC_SYM).puts("</gsearch2>\n");
         				      return sp;
       				      }
         				  }
         				  else {
     				        sp = TABLE::match[0];
-                		dfs.puts("</gsearch2>\n");
+                		DTRACE(TRC_SYM).puts("</gsearch2>\n");
     				        return sp;
     				      }
     				    }
@@ -279,16 +298,16 @@ SYM *gsearch2(std::string na, __int16 rettype, TypeArray *typearray, bool exact)
   		}
   	}
 		// Finally, look in the global symbol table
-		dfs.printf("Looking at global symbols\n");
+		DTRACE(TRC_SYM).printf("Looking at global symbols\n");
 		if (gsyms[0].Find(na,rettype,typearray,exact)) {
 			sp = TABLE::match[TABLE::matchno-1];
-			dfs.printf("Found in global symbol table\n");
-			dfs.puts("</gsearch2>\n");
+			DTRACE(TRC_SYM).printf("Found in global symbol table\n");
+			DTRACE(TRC_SYM).puts("</gsearch2>\n");
 			return sp;
 		}
 	}
 
-	dfs.puts("</gsearch2>\n");
+	DTRACE(TRC_SYM).puts("</gsearch2>\n");
   return sp;
 }
 
@@ -302,13 +321,17 @@ SYM *gsearch(std::string name)
 
 void SYM::PrintParameterTypes()
 {
-	TypeArray *ta = GetParameterTypes();
-	dfs.printf("Parameter types(%s)\n",(char *)name->c_str());
+	TypeArray *ta;
+
+	if (!DTRACE_ON(TRC_SYM))
+		return;
+	ta = GetParameterTypes();
+	DTRACE(TRC_SYM).printf("Parameter types(%s)\n",(char *)name->c_str());
 	ta->Print();
 	if (ta)
 		delete[] ta;
   ta = GetProtoTypes();
-	dfs.printf("Proto types(%s)\n",(char *)name->c_str());
+	DTRACE(TRC_SYM).printf("Proto types(%s)\n",(char *)name->c_str());
 	ta->Print();
 	if (ta)
 		delete ta;
@@ -322,17 +345,17 @@ SYM *SYM::Copy(SYM *src)
 {
 	SYM *dst = nullptr;
 
-  dfs.printf("Enter SYM::Copy\n");
+  DTRACE(TRC_SYM).printf("Enter SYM::Copy\n");
 	if (src) {
 		dst = allocSYM();
-		dfs.printf("A");
+		DTRACE(TRC_SYM).printf("A");
 		memcpy(dst, src, sizeof(SYM));
 //		dst->tp = TYP::Copy(src->tp);
 //		dst->name = src->name;
 //		dst->shortname = src->shortname;
 		dst->SetNext(0);
   }
-  dfs.printf("Leave SYM::Copy\n");
+  DTRACE(TRC_SYM).printf("Leave SYM::Copy\n");
 	return dst;
 }
 
@@ -378,23 +401,23 @@ std::string *TypenoToChars(int typeno)
 	char c[8];
 	std::string *str;
 
-  dfs.puts("<TypenoToChars>");
+  DTRACE(TRC_SYM).puts("<TypenoToChars>");
   str = new std::string();
-  dfs.putch('A');
+  DTRACE(TRC_SYM).putch('A');
 	c[0] = alphabet[typeno & 31];
-  dfs.putch('B');
+  DTRACE(TRC_SYM).putch('B');
 	c[1] = alphabet[(typeno>>5) & 31];
-  dfs.putch('C');
+  DTRACE(TRC_SYM).putch('C');
 	c[2] = alphabet[(typeno>>10) & 31];
   c[3] = alphabet[(typeno>>15) & 31];
   c[4] = '\0';
   c[5] = '\0';
   c[6] = '\0';
   c[7] = '\0';
-  dfs.puts("D:");
+  DTRACE(TRC_SYM).puts("D:");
 	str->append(c);
-	dfs.printf("%s",(char *)str->c_str());
-  dfs.puts("</TypenoToChars>");
+	DTRACE(TRC_SYM).printf("%s",(char *)str->c_str());
+  DTRACE(TRC_SYM).puts("</TypenoToChars>");
 	return str;
 }
 
@@ -406,21 +429,21 @@ std::string *SYM::GetNameHash()
   SYM *sp;
   int nn;
 
-  dfs.puts("<GetNameHash>");
-  dfs.printf("tp:%p",(char *)tp);
+  DTRACE(TRC_SYM).puts("<GetNameHash>");
+  DTRACE(TRC_SYM).printf("tp:%p",(char *)tp);
 //  if (tp==(TYP *)0x500000005LL) {
 //    nh = new std::string("TAA");
 //    return nh;
 //  }
 	nh = TypenoToChars(tp->typeno);
-  dfs.putch('A');
+  DTRACE(TRC_SYM).putch('A');
   sp = GetParentPtr();
   if (sp) {
      nh->append(*sp->GetNameHash());
 	   sp = GetPtr(sp->tp->lst.base);
-     dfs.putch('B');
+     DTRACE(TRC_SYM).putch('B');
    	 for (nn = 0; sp && nn < 200; nn++) {
-  	   dfs.putch('.');
+  	   DTRACE(TRC_SYM).putch('.');
   	   nh->append(*sp->GetNameHash());
        sp = GetPtr(sp->tp->lst.base);
   	 }
@@ -434,7 +457,7 @@ std::string *SYM::GetNameHash()
 		nh += sp->GetNameHash();
 	}
 */
-  dfs.puts("</GetNameHash>\n");
+  DTRACE(TRC_SYM).puts("</GetNameHash>\n");
 	return nh;
 }
 
@@ -446,24 +469,24 @@ std::string *SYM::BuildSignature(int opt)
 	std::string *str;
   std::string *nh;
 
-  dfs.printf("<BuildSignature>");
+  DTRACE(TRC_SYM).printf("<BuildSignature>");
   if (mangledNames) {
   	str = new std::string("_Z");		// 'C' likes this
-  	dfs.printf("A");
+  	DTRACE(TRC_SYM).printf("A");
   	nh = GetNameHash();
-  	dfs.printf("B");
+  	DTRACE(TRC_SYM).printf("B");
   	str->append(*nh);
-  	dfs.printf("C");
+  	DTRACE(TRC_SYM).printf("C");
   	delete nh;
-  	dfs.printf("D");
+  	DTRACE(TRC_SYM).printf("D");
   	if (name > (std::string *)0x15)
   	   str->append(*name);
   	if (opt) {
-      dfs.printf("E");
+      DTRACE(TRC_SYM).printf("E");
   	  str->append(*GetParameterTypes()->BuildSignature());
     }
   	else {
-  	  dfs.printf("F");
+  	  DTRACE(TRC_SYM).printf("F");
   	  str->append(*GetProtoTypes()->BuildSignature());
     }
   }
@@ -471,7 +494,7 @@ std::string *SYM::BuildSignature(int opt)
   	str = new std::string("");
     str->append(*name);
   }
-  dfs.printf(":%s</BuildSignature>",(char *)str->c_str());
+  DTRACE(TRC_SYM).printf(":%s</BuildSignature>",(char *)str->c_str());
 	return str;
 }
 
@@ -547,7 +570,7 @@ SYM *SYM::FindExactMatch(int mm)
  
 	sp1 = nullptr;
 	for (nn = 0; nn < mm; nn++) {
-	  dfs.printf("%d",nn);
+	  DTRACE(TRC_SYM).printf("%d",nn);
 		sp1 = TABLE::match[nn];
 		// Matches sp1 prototype list against this's parameter list
 		ta = sp1->GetProtoTypes();
@@ -613,7 +636,7 @@ SYM *SYM::FindRisingMatch(bool ignore)
   nme = *name;
   sym = nullptr;
   ta = GetProtoTypes();
-  dfs.printf("<FindRisingMatch>%s type %d ", (char *)name->c_str(), tp->type);
+  DTRACE(TRC_SYM).printf("<FindRisingMatch>%s type %d ", (char *)name->c_str(), tp->type);
   if (GetParentPtr()!=nullptr)
      nn = GetParentPtr()->tp->lst.FindRising(nme);
   else
@@ -621,14 +644,14 @@ SYM *SYM::FindRisingMatch(bool ignore)
 //  nn = tp->lst.FindRising(nme);
   iter = 0;
   if (nn) {
-    dfs.puts("Found method:");
+    DTRACE(TRC_SYM).puts("Found method:");
     for (iter = 0; true; iter = em + 1) {
       em = FindNextExactMatch(iter,ta);
       if (em < 0)
         break;
       sym = TABLE::match[em];
       if (!ignore || sym->GetParentPtr() != GetParentPtr()) { // ignore entry here
-        dfs.puts("Found in a base class:");
+        DTRACE(TRC_SYM).puts("Found in a base class:");
         break;
       }
       sym = nullptr;
@@ -636,7 +659,7 @@ SYM *SYM::FindRisingMatch(bool ignore)
   }
   if (ta)
     delete ta;
-  dfs.printf("</FindRisingMatch>\n");
+  DTRACE(TRC_SYM).printf("</FindRisingMatch>\n");
   return sym;
 }
 
@@ -649,7 +672,7 @@ void SYM::BuildParameterList(int *num, int *numa)
 	int np;
 	bool noParmOffset = false;
 
-	dfs.printf("<BuildParameterList\n>");
+	DTRACE(TRC_SYM).printf("<BuildParameterList\n>");
 	poffset = 0;//GetReturnBlockSize();
 //	sp->parms = (SYM *)NULL;
 	onp = nparms;
@@ -661,11 +684,11 @@ void SYM::BuildParameterList(int *num, int *numa)
 	np = ParameterDeclaration::Parse(1);
 	*num += np;
 	*numa = 0;
-  dfs.printf("B");
+  DTRACE(TRC_SYM).printf("B");
 	nparms = onp;
 	for(i = 0;i < np && i < 20;++i) {
 		if( (sp1 = currentFn->params.Find(names[i].str,false)) == NULL) {
-      dfs.printf("C");
+      DTRACE(TRC_SYM).printf("C");
 			sp1 = makeint2(names[i].str);
 //			lsyms.insert(sp1);
 		}
@@ -748,7 +771,7 @@ void SYM::BuildParameterList(int *num, int *numa)
 			}
 		}
 	}
-	dfs.printf("</BuildParameterList>\n");
+	DTRACE(TRC_SYM).printf("</BuildParameterList>\n");
 }
 
 void SYM::AddParameters(SYM *list)
@@ -796,24 +819,24 @@ void SYM::AddDerived(SYM *sp)
 {
   DerivedMethod *mthd;
  
-  dfs.puts("<AddDerived>"); 
-  mthd = (DerivedMethod *)allocx(sizeof(DerivedMethod));
-  dfs.printf("A");
+  DTRACE(TRC_SYM).puts("<AddDerived>"); 
+  mthd = (DerivedMethod *)allocx(sizeof(DerivedMethod), MEM_SYM);
+  DTRACE(TRC_SYM).printf("A");
   if (sp->tp==nullptr)
-    dfs.printf("Nullptr");
+    DTRACE(TRC_SYM).printf("Nullptr");
   if (sp->GetParentPtr()==nullptr)
      throw C64PException(ERR_NULLPOINTER,10);
   mthd->typeno = sp->GetParentPtr()->tp->typeno;
-  dfs.printf("B");
+  DTRACE(TRC_SYM).printf("B");
   mthd->name = sp->BuildSignature();
 
-  dfs.printf("C");
+  DTRACE(TRC_SYM).printf("C");
   if (derivitives) {
-    dfs.printf("D");
+    DTRACE(TRC_SYM).printf("D");
      mthd->next = derivitives;
   }
   derivitives = mthd;
-  dfs.puts("</AddDerived>"); 
+  DTRACE(TRC_SYM).puts("</AddDerived>"); 
 }
 
 bool SYM::HasRegisterParameters()
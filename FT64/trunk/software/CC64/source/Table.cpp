@@ -36,6 +36,138 @@ int min (int a, int b) { return a < b ? a : b; }
 SYM *TABLE::match[100];
 int TABLE::matchno;
 
+SymbolIndex::Key *SymbolIndex::keys = nullptr;
+int SymbolIndex::size = 0;
+int SymbolIndex::count = 0;
+int *SymbolIndex::entsym = nullptr;
+int *SymbolIndex::entnext = nullptr;
+int SymbolIndex::nent = 1;
+int SymbolIndex::maxent = 0;
+
+// 64 bit FNV-1a hash.
+
+uint64_t SymbolIndex::Hash(const std::string& na)
+{
+	uint64_t hsh;
+	size_t nn;
+
+	hsh = 0xcbf29ce484222325ULL;
+	for (nn = 0; nn < na.length(); nn++) {
+		hsh ^= (uint8_t)na[nn];
+		hsh *= 0x100000001b3ULL;
+	}
+	return (hsh);
+}
+
+// Returns the slot holding the name, or the empty slot where it would go.
+
+int SymbolIndex::Slot(const std::string& na, uint64_t hash)
+{
+	int ndx;
+
+	for (ndx = (int)(hash & (size - 1)); keys[ndx].name; ndx = (ndx + 1) & (size - 1)) {
+		if (keys[ndx].hash==hash && *keys[ndx].name==na)
+			break;
+	}
+	return (ndx);
+}
+
+void SymbolIndex::Grow()
+{
+	Key *old;
+	int oldsize;
+	int nn, ndx;
+
+	old = keys;
+	oldsize = size;
+	size = size ? size * 2 : 1024;
+	keys = new Key[size];
+	ZeroMemory(keys, size * sizeof(Key));
+	for (nn = 0; nn < oldsize; nn++) {
+		if (old[nn].name) {
+			for (ndx = (int)(old[nn].hash & (size - 1)); keys[ndx].name; ndx = (ndx + 1) & (size - 1))
+				;
+			keys[ndx] = old[nn];
+		}
+	}
+	delete[] old;
+}
+
+void SymbolIndex::Clear()
+{
+	if (keys)
+		ZeroMemory(keys, size * sizeof(Key));
+	count = 0;
+	nent = 1;
+}
+
+void SymbolIndex::Add(std::string *na, int sym)
+{
+	uint64_t hash;
+	int ndx;
+	int *p;
+
+	if (na==nullptr || na->length()==0)
+		return;
+	if (count * 2 >= size)
+		Grow();
+	if (nent >= maxent) {
+		maxent = maxent ? maxent * 2 : 4096;
+		p = new int[maxent];
+		if (entsym) {
+			memcpy(p, entsym, nent * sizeof(int));
+			delete[] entsym;
+		}
+		entsym = p;
+		p = new int[maxent];
+		if (entnext) {
+			memcpy(p, entnext, nent * sizeof(int));
+			delete[] entnext;
+		}
+		entnext = p;
+	}
+	entsym[nent] = sym;
+	entnext[nent] = 0;
+	hash = Hash(*na);
+	ndx = Slot(*na, hash);
+	if (keys[ndx].name==nullptr) {
+		keys[ndx].hash = hash;
+		keys[ndx].name = na;
+		keys[ndx].head = nent;
+		count++;
+	}
+	else
+		entnext[keys[ndx].tail] = nent;
+	keys[ndx].tail = nent;
+	nent++;
+}
+
+void SymbolIndex::Insert(SYM *sp)
+{
+	Add(sp->name, sp->GetIndex());
+	if (*sp->name2 != *sp->name)
+		Add(sp->name2, sp->GetIndex());
+	if (*sp->name3 != *sp->name && *sp->name3 != *sp->name2)
+		Add(sp->name3, sp->GetIndex());
+}
+
+// Returns the first entry for the name.
+
+int SymbolIndex::Find(const std::string& na)
+{
+	int ndx;
+
+	if (count==0)
+		return (0);
+	ndx = Slot(na, Hash(na));
+	return (keys[ndx].name ? keys[ndx].head : 0);
+}
+
+SYM *SymbolIndex::GetSym(int ent)
+{
+	return (ent ? SYM::GetPtr(entsym[ent]) : nullptr);
+}
+
 TABLE::TABLE()
 {
   base = 0;
@@ -49,20 +181,20 @@ TABLE::TABLE()
 void TABLE::CopySymbolTable(TABLE *dst, TABLE *src)
 {
 	SYM *sp, *newsym;
-	dfs.puts("<CopySymbolTable>\n");
+	DTRACE(TRC_SYM).puts("<CopySymbolTable>\n");
 	if (src) {
-	  dfs.printf("A");
+	  DTRACE(TRC_SYM).printf("A");
 		sp = sp->GetPtr(src->GetHead());
 		while (sp) {
-  	  dfs.printf("B");
+  	  DTRACE(TRC_SYM).printf("B");
 			newsym = SYM::Copy(sp);
-  	  dfs.printf("C");
+  	  DTRACE(TRC_SYM).printf("C");
 			dst->insert(newsym);
-  	  dfs.printf("D");
+  	  DTRACE(TRC_SYM).printf("D");
 			sp = sp->GetNextPtr();
 		}
 	}
-	dfs.puts("</CopySymbolTable>\n");
+	DTRACE(TRC_SYM).puts("</CopySymbolTable>\n");
 }
 
 //Generic table insert routine, used for all inserts.
@@ -72,28 +204,25 @@ void TABLE::insert(SYM *sp)
 	int nn;
 	TypeArray *ta = sp->GetProtoTypes();
 	TABLE *tab = this;
-	int s1,s2,s3;
+	int s1;
 	std::string nm;
 //  std::string sig;
 
 	if (sp == nullptr || this == nullptr ) {
-	  dfs.printf("Null pointer at insert\n");
+	  DTRACE(TRC_SYM).printf("Null pointer at insert\n");
 		throw new C64PException(ERR_NULLPOINTER,1);
   }
 
   if (this==&tagtable) {
-    dfs.printf("Insert into tagtable:%s|\n",(char *)sp->name->c_str());
+    DTRACE(TRC_SYM).printf("Insert into tagtable:%s|\n",(char *)sp->name->c_str());
   }
   else
-    dfs.printf("Insert %s into %p", (char *)sp->name->c_str(), (char *)this);
-    dfs.printf("(%s)\n",owner ? (char *)SYM::GetPtr(owner)->name->c_str(): (char *)"");
+    DTRACE(TRC_SYM).printf("Insert %s into %p", (char *)sp->name->c_str(), (char *)this);
+    DTRACE(TRC_SYM).printf("(%s)\n",owner ? (char *)SYM::GetPtr(owner)->name->c_str(): (char *)"");
 //  sig = sp->BuildSignature();
 	if (tab==&gsyms[0]) {
-	  dfs.printf("Insert into global table\n");
+	  DTRACE(TRC_SYM).printf("Insert into global table\n");
 		s1 = hashadd((char *)sp->name->c_str());
-		s2 = hashadd((char *)sp->name2->c_str());
-		s3 = hashadd((char *)sp->name3->c_str());
-//		tab = &gsyms[(s1&s2)|(s1&s3)|(s2&s3)];
 		tab = &gsyms[s1];
 	}
 
@@ -101,7 +230,8 @@ void TABLE::insert(SYM *sp)
   // The symbol may not have a type if it's just a label. Find doens't
   // look at the return type parameter anyway, so we just set it to bt_long
   // if tp isn't set.
-  nn = tab->Find(nm,sp->tp ? sp->tp->typeno : bt_long,ta,true); 
+  // For the global table this searches the index rather than the list.
+  nn = Find(nm,sp->tp ? sp->tp->typeno : bt_long,ta,true); 
 	if(nn == 0) {
     if( tab->head == 0) {
       tab->SetHead(sp->GetIndex());
@@ -112,8 +242,11 @@ void TABLE::insert(SYM *sp)
       tab->SetTail(sp->GetIndex());
     }
     sp->SetNext(0);
-    dfs.printf("At insert:\n");
-    sp->GetProtoTypes()->Print();
+    if (this==&gsyms[0])
+      SymbolIndex::Insert(sp);
+    DTRACE(TRC_SYM).printf("At insert:\n");
+    if (DTRACE_ON(TRC_SYM))
+      ta->Print();
   }
   else
     error(ERR_DUPSYM);
@@ -133,24 +266,29 @@ void TABLE::insert(SYM *sp)
 int TABLE::Find(std::string na,__int16 rettype, TypeArray *typearray, bool exact)
 {
 	SYM *thead, *first;
-	TypeArray *ta;
+	TypeArray ta;
 	int s1,s2,s3;
-	std::string name;
+	int ent;
+	bool global;
 
-  dfs.puts("</Find>\n");
-  dfs.puts((char *)na.c_str());
+  DTRACE(TRC_SYM).puts("</Find>\n");
+  DTRACE(TRC_SYM).puts((char *)na.c_str());
   if (this==nullptr) {
     matchno = 0;
     return 0;
   }
 	if (na.length()==0) {
-	  dfs.printf("name is empty string\n");
+	  DTRACE(TRC_SYM).printf("name is empty string\n");
 		throw new C64PException(ERR_NULLPOINTER,1);
   }
 
 	matchno = 0;
-	if (this==&gsyms[0])
-		thead = SYM::GetPtr(gsyms[hashadd((char *)na.c_str())].GetHead());
+	global = this==&gsyms[0];
+	ent = 0;
+	if (global) {
+		ent = SymbolIndex::Find(na);
+		thead = SymbolIndex::GetSym(ent);
+	}
 	else
 		thead = SYM::GetPtr(head);
 	first = thead;
@@ -162,7 +300,6 @@ int TABLE::Find(std::string na,__int16 rettype, TypeArray *typearray, bool exact
 	while( thead != NULL) {
 //		dfs.printf((char *)"|%s|,|%s|\n",(char *)thead->name->c_str(),(char *)na.c_str());
 		if (thead->name) {	// ???
-    name = *thead->name;
 		s1 = thead->name->compare(na);
 		s2 = thead->name2->compare(na);
 		s3 = thead->name3->compare(na);
@@ -170,33 +307,39 @@ int TABLE::Find(std::string na,__int16 rettype, TypeArray *typearray, bool exact
 //		dfs.printf("s2:%d ",s2);
 //		dfs.printf("s3:%d\n",s3);
 		if(((s1&s2)|(s1&s3)|(s2&s3))==0) {
-		  dfs.printf("Match\n");
+		  DTRACE(TRC_SYM).printf("Match\n");
 			match[matchno] = thead;
 			matchno++;
 			if (matchno > 98)
 				break;
 		
 			if (exact) {
-				ta = thead->GetProtoTypes();
-				if (ta->IsEqual(typearray)) {
-				  dfs.printf("Exact match");
-				  ta->Print();
-				  typearray->Print();
-				  delete ta;
+				thead->GetProtoTypes(&ta);
+				if (ta.IsEqual(typearray)) {
+				  DTRACE(TRC_SYM).printf("Exact match");
+				  if (DTRACE_ON(TRC_SYM)) {
+				    ta.Print();
+				    typearray->Print();
+				  }
 				  return 1;
 				}
-				ta->Print();
-				delete ta;
+				if (DTRACE_ON(TRC_SYM))
+					ta.Print();
 			}
 		}
 		}
+		if (global) {
+			ent = SymbolIndex::Next(ent);
+			thead = SymbolIndex::GetSym(ent);
+			continue;
+		}
     thead = thead->GetNextPtr();
     if (thead==first) {
-      dfs.printf("Circular list.\n");
+      DTRACE(TRC_SYM).printf("Circular list.\n");
       throw new C64PException(ERR_CIRCULAR_LIST,1);
     }
   }
-  dfs.puts("</Find>\n");
+  DTRACE(TRC_SYM).puts("</Find>\n");
   return exact ? 0 : matchno;
 }
 
@@ -223,7 +366,7 @@ int TABLE::FindRising(std::string na)
   TypeArray *ta;
 
   ndx = 0;
-  dfs.printf("<FindRising>%s \n",(char *)na.c_str());
+  DTRACE(TRC_SYM).printf("<FindRising>%s \n",(char *)na.c_str());
   if (this==nullptr)
     return 0;
 	sp = Find(na);
@@ -233,14 +376,14 @@ int TABLE::FindRising(std::string na)
 	bse = base;
 	while (bse) {
 	  sym = SYM::GetPtr(bse);
-	  dfs.printf("Searching class:%s \n",(char *)sym->name->c_str());
+	  DTRACE(TRC_SYM).printf("Searching class:%s \n",(char *)sym->name->c_str());
 		sp = sym->tp->lst.Find(na);
   	nn = min(100,ndx+TABLE::matchno);
   	memcpy(&mt[ndx],TABLE::match,nn*sizeof(SYM *));
   	ndx += nn;
 		bse = sym->tp->lst.base;
 	}
-	dfs.puts("</FindRising>");
+	DTRACE(TRC_SYM).puts("</FindRising>");
 
   memcpy(TABLE::match,mt,ndx*sizeof(SYM *));
   TABLE::matchno = ndx;
@@ -248,16 +391,16 @@ int TABLE::FindRising(std::string na)
     sym = TABLE::match[nn];
     if (sym) {
       if (sym->name)
-         dfs.printf("Sym:%s Types: (", (char *)sym->name->c_str());
+         DTRACE(TRC_SYM).printf("Sym:%s Types: (", (char *)sym->name->c_str());
       else
-         dfs.printf("Sym:%s Types: (", (char *)"<no name>");
+         DTRACE(TRC_SYM).printf("Sym:%s Types: (", (char *)"<no name>");
       ta = sym->GetProtoTypes();
       if (ta) {
         for (ii = 0; ii < 20; ii++) {
-          dfs.printf("%03d, ", ta->types[ii]);
+          DTRACE(TRC_SYM).printf("%03d, ", ta->types[ii]);
         }
       }
-      dfs.puts(")\n");
+      DTRACE(TRC_SYM).puts(")\n");
     }
   }
   return ndx;
@@ -4,7 +4,7 @@ int Tree::treecount;
 
 Tree *Tree::MakeNew() {
 	Tree *t;
-	t = (Tree*)allocx(sizeof(Tree));
+	t = (Tree*)allocx(sizeof(Tree), MEM_OPT);
 	t->tree = CSet::MakeNew();
 	alltrees[treecount] = t;
 	treecount++;
@@ -41,33 +41,33 @@ TYP *TYP::Copy(TYP *src)
 {
 	TYP *dst = nullptr;
  
-  dfs.printf("<TYP__Copy>\n");
+  DTRACE(TRC_SYM).printf("<TYP__Copy>\n");
 	if (src) {
 		dst = allocTYP();
 //		if (dst==nullptr)
 //			throw gcnew C64::C64Exception();
 		memcpy(dst,src,sizeof(TYP));
-		dfs.printf("A");
+		DTRACE(TRC_SYM).printf("A");
 		if (src->btp && src->GetBtp()) {
-  		dfs.printf("B");
+  		DTRACE(TRC_SYM).printf("B");
 			dst->btp = Copy(src->GetBtp())->GetIndex();
 		}
-		dfs.printf("C");
+		DTRACE(TRC_SYM).printf("C");
 		// We want to keep any base type indicator so Clear() isn't called.
 		dst->lst.head = 0;
 		dst->lst.tail = 0;
 		dst->sname = new std::string(*src->sname);
-		dfs.printf("D");
+		DTRACE(TRC_SYM).printf("D");
 		TABLE::CopySymbolTable(&dst->lst,&src->lst);
 	}
-  dfs.printf("</TYP__Copy>\n");
+  DTRACE(TRC_SYM).printf("</TYP__Copy>\n");
 	return dst;
 }
 
 TYP *TYP::Make(int bt, int siz)
 {
 	TYP *tp;
-	dfs.puts("<TYP__Make>\n");
+	DTRACE(TRC_SYM).puts("<TYP__Make>\n");
 	tp = allocTYP();
 	if (tp == nullptr)
 		return nullptr;
@@ -77,7 +77,7 @@ TYP *TYP::Make(int bt, int siz)
 	tp->type = (e_bt)bt;
 	tp->typeno = bt;
 	tp->precision = siz * 8;
-	dfs.puts("</TYP__Make>\n");
+	DTRACE(TRC_SYM).puts("</TYP__Make>\n");
 	return tp;
 }
 
@@ -95,23 +95,23 @@ bool TypeArray::IsEqual(TypeArray *ta)
   int nn;
   int t,tat;
   
-  dfs.printf("IsEqual:");
+  DTRACE(TRC_SYM).printf("IsEqual:");
   if (this==ta) {
-    dfs.printf("T1");
+    DTRACE(TRC_SYM).printf("T1");
     return true;
   }
   if (ta==nullptr && IsEmpty()) {
-    dfs.printf("T2");
+    DTRACE(TRC_SYM).printf("T2");
     return true;
   }
   if (this==nullptr || ta==nullptr) {
-    dfs.printf("F1");
+    DTRACE(TRC_SYM).printf("F1");
     return false;
  }
   m = (length > ta->length) ? length : ta->length;
   for (nn = 0; nn < m; nn++) {
     if (types[nn]==bt_ellipsis) {
-      dfs.printf("T3");
+      DTRACE(TRC_SYM).printf("T3");
       return true;
     }
 	t = types[nn];
@@ -132,17 +132,17 @@ bool TypeArray::IsEqual(TypeArray *ta)
 	  // Loose type matching
 	  if (IsInt(t) && IsInt(tat))
 		  continue;
-      dfs.printf("F2");
+      DTRACE(TRC_SYM).printf("F2");
       return false;
     }
   }
-  dfs.printf("T3");
+  DTRACE(TRC_SYM).printf("T3");
   return true;
 }
 
 TypeArray *TypeArray::Alloc()
 {
-  TypeArray *tp = (TypeArray *)allocx(sizeof(TypeArray)); 
+  TypeArray *tp = (TypeArray *)allocx(sizeof(TypeArray), MEM_SYM);
   return tp;
 }
 
@@ -36,7 +36,7 @@ Var *Var::MakeNew()
 {
 	Var *p;
 
-	p = (Var *)allocx(sizeof(Var));
+	p = (Var *)allocx(sizeof(Var), MEM_OPT);
 	p->forest = CSet::MakeNew();
 	p->visited = CSet::MakeNew();
 	return (p);
@@ -281,10 +281,12 @@ void Var::CreateForest()
 			}
 		}
 	}
-	dfs.printf("Visited r%d: ", num);
-	visited->sprint(buf, sizeof(buf));
-	dfs.printf(buf);
-	dfs.printf("\n");
+	if (DTRACE_ON(TRC_REGALLOC)) {
+		dfs.printf("Visited r%d: ", num);
+		visited->sprint(buf, sizeof(buf));
+		dfs.printf(buf);
+		dfs.printf("\n");
+	}
 }
 
 void Var::CreateForests()
@@ -336,6 +338,8 @@ void Var::DumpForests()
 	Tree *rg;
 	char buf[2000];
 
+	if (!DTRACE_ON(TRC_REGALLOC))
+		return;
 	dfs.printf("<VarForests>\n");
 	for (vp = varlist; vp; vp = vp->next) {
 		dfs.printf("Var%d:", vp->num);
@@ -0,0 +1,722 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2017-2018  Robert Finch, Waterloo
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// CC64 - 'C' derived language compiler
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This source file is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================================
+//
+#include "stdafx.h"
+
+// A for loop that steps a variable by one up to a limit, and whose body is
+// nothing but word sized array element assignments indexed by the variable,
+// is done with vector instructions. For example
+//		for (i = 0; i < n; i++)
+//			y[i] = k * x[i] + y[i];
+// Elements are worked on in strips of up to maxVL at a time. Before each
+// strip the vector length register is set to the number of elements left
+// (at most maxVL), so the last strip only loads and stores the remaining
+// elements. Arithmetic is done under mask register vm0, which is set to
+// all elements. The body may also add elements to a local variable, which
+// is summed in a vector register and added up once the loop is done.
+//
+// The vector unit only loads and stores words, so arrays of smaller items
+// are left to the scalar loop.
+//
+// The vector code does all the elements of a strip at once, so if two of
+// the arrays might be the same memory shifted by less than a strip the
+// results could be different. When that can't be ruled out at compile time
+// a check is made before the loop that falls back to the scalar loop.
+
+#define VEC_MAXSTMTS	4		// assignments in the loop body
+#define VEC_MAXBASES	8		// different arrays referred to
+#define VEC_MAXINV		8		// values computed before the loop
+#define VEC_MAXVREGS	8		// vector registers in use at once
+#define VEC_MAXTEMPS	8		// scalar registers in use at once
+
+// Kinds of assignment in the loop body
+#define VEC_STORE		1		// a[i] = e
+#define VEC_UPDATE		2		// a[i] += e, a[i] -= e
+#define VEC_REDUCE		3		// s += e
+
+extern AMODE *makevmreg(int r);
+extern AMODE *copy_addr(AMODE *ap);
+
+static ENODE *vecVar;					// the variable stepped by the loop
+static ENODE *bases[VEC_MAXBASES];		// addresses of the arrays
+static int baseStored[VEC_MAXBASES];
+static int nbases;
+static ENODE *invNode[VEC_MAXINV];		// values computed before the loop
+static AMODE *invAmode[VEC_MAXINV];
+static int ninv;
+static ENODE *stmtExp[VEC_MAXSTMTS];
+static int stmtKind[VEC_MAXSTMTS];
+static int stmtNodes[VEC_MAXSTMTS];
+static AMODE *stmtVreg[VEC_MAXSTMTS];	// accumulator or stored value
+static int nstmts;
+static AMODE *vecMask;
+
+// A word sized local variable, in a register or in the stack frame.
+
+static int IsLocalVar(ENODE *node)
+{
+	if (node==nullptr || node->isVolatile)
+		return (FALSE);
+	if (node->nodetype==en_regvar)
+		return (node->p[0]==nullptr || node->p[0]->esize==sizeOfWord);
+	return ((node->nodetype==en_w_ref || node->nodetype==en_uw_ref)
+		&& node->p[0] && node->p[0]->nodetype==en_autocon);
+}
+
+// Does the expression refer to the variable ? Taking the address of a
+// variable kept in the stack frame counts as a reference.
+
+static int UsesVar(ENODE *node, ENODE *var)
+{
+	if (node==nullptr)
+		return (FALSE);
+	if (equalnode(node, var))
+		return (TRUE);
+	if (node->nodetype==en_autocon && var->nodetype!=en_regvar && var->p[0]->i==node->i)
+		return (TRUE);
+	return (UsesVar(node->p[0], var) || UsesVar(node->p[1], var) || UsesVar(node->p[2], var));
+}
+
+static int UsesReduction(ENODE *node)
+{
+	int nn;
+
+	for (nn = 0; nn < nstmts; nn++) {
+		if (stmtKind[nn]==VEC_REDUCE && UsesVar(node, stmtExp[nn]->p[0]))
+			return (TRUE);
+	}
+	return (FALSE);
+}
+
+// An address that is known when the program is linked. Different ones
+// refer to different objects.
+
+static int IsAddressConstant(ENODE *node)
+{
+	switch(node->nodetype) {
+	case en_nacon:
+	case en_labcon:
+	case en_cnacon:
+	case en_clabcon:
+		return (TRUE);
+	}
+	return (FALSE);
+}
+
+static int IsObjectAddress(ENODE *node)
+{
+	return (IsAddressConstant(node) || node->nodetype==en_autocon);
+}
+
+// An expression that gives the same value on every trip around the loop.
+// Only local variables are allowed; a global could be changed by a store
+// to one of the arrays.
+
+static int IsInvariantNode(ENODE *node)
+{
+	if (node==nullptr || node->isVolatile)
+		return (FALSE);
+	switch(node->nodetype) {
+	case en_icon:
+	case en_nacon:
+	case en_labcon:
+	case en_cnacon:
+	case en_clabcon:
+	case en_autocon:
+	case en_regvar:
+		return (TRUE);
+	case en_w_ref: case en_uw_ref:
+		return (node->p[0] && node->p[0]->nodetype==en_autocon);
+	case en_uminus: case en_compl:
+		return (IsInvariantNode(node->p[0]));
+	case en_add: case en_sub:
+	case en_mul: case en_mulu:
+	case en_and: case en_or: case en_xor:
+	case en_shl: case en_shlu: case en_asl:
+	case en_shr: case en_shru: case en_asr:
+		return (IsInvariantNode(node->p[0]) && IsInvariantNode(node->p[1]));
+	}
+	return (FALSE);
+}
+
+static int IsInvariant(ENODE *node)
+{
+	return (IsInvariantNode(node) && !UsesVar(node, vecVar) && !UsesReduction(node));
+}
+
+// The loop variable scaled to a word index.
+
+static int IsIndex(ENODE *node)
+{
+	if (node==nullptr || node->p[1]==nullptr || node->p[1]->nodetype!=en_icon)
+		return (FALSE);
+	switch(node->nodetype) {
+	case en_shl: case en_shlu: case en_asl:
+		return (node->p[1]->i==3 && equalnode(node->p[0], vecVar));
+	case en_mul: case en_mulu:
+		return (node->p[1]->i==sizeOfWord && equalnode(node->p[0], vecVar));
+	}
+	return (FALSE);
+}
+
+// The address of the array if the node refers to the element the loop
+// variable indexes.
+
+static ENODE *ElementBase(ENODE *node)
+{
+	ENODE *ep, *base;
+
+	if (node==nullptr || node->isVolatile)
+		return (nullptr);
+	if (node->nodetype!=en_w_ref && node->nodetype!=en_uw_ref)
+		return (nullptr);
+	ep = node->p[0];
+	if (ep==nullptr || ep->nodetype!=en_add)
+		return (nullptr);
+	if (IsIndex(ep->p[0]))
+		base = ep->p[1];
+	else if (IsIndex(ep->p[1]))
+		base = ep->p[0];
+	else
+		return (nullptr);
+	return (IsInvariant(base) ? base : nullptr);
+}
+
+static int AddBase(ENODE *base, int stored)
+{
+	int nn;
+
+	for (nn = 0; nn < nbases; nn++) {
+		if (equalnode(bases[nn], base)) {
+			baseStored[nn] |= stored;
+			return (TRUE);
+		}
+	}
+	if (nbases >= VEC_MAXBASES)
+		return (FALSE);
+	bases[nbases] = base;
+	baseStored[nbases] = stored;
+	nbases++;
+	return (TRUE);
+}
+
+// Count the vector registers needed to evaluate an expression. Returns 0
+// for a value that doesn't change in the loop and -1 if the expression
+// can't be done with vector instructions.
+
+static int CountVectorNodes(ENODE *node)
+{
+	ENODE *base;
+	int n0, n1;
+
+	if (IsInvariant(node))
+		return (0);
+	if ((base = ElementBase(node)) != nullptr)
+		return (AddBase(base, FALSE) ? 1 : -1);
+	if (node==nullptr || node->isVolatile)
+		return (-1);
+	switch(node->nodetype) {
+	case en_add:
+	case en_sub:
+	case en_mul: case en_mulu:
+		n0 = CountVectorNodes(node->p[0]);
+		n1 = CountVectorNodes(node->p[1]);
+		if (n0 < 0 || n1 < 0)
+			return (-1);
+		// There's no instruction for subtracting a vector from a scalar.
+		if (node->nodetype==en_sub && n0==0)
+			return (-1);
+		return (n0 + n1 + 1);
+	}
+	return (-1);
+}
+
+static AMODE *FindInvariant(ENODE *node)
+{
+	int nn;
+
+	for (nn = 0; nn < ninv; nn++) {
+		if (invNode[nn]==node || equalnode(invNode[nn], node))
+			return (invAmode[nn]);
+	}
+	return (nullptr);
+}
+
+static int AddInvariant(ENODE *node)
+{
+	int nn;
+
+	for (nn = 0; nn < ninv; nn++) {
+		if (invNode[nn]==node || equalnode(invNode[nn], node))
+			return (TRUE);
+	}
+	if (ninv >= VEC_MAXINV)
+		return (FALSE);
+	invNode[ninv++] = node;
+	return (TRUE);
+}
+
+// Find the values that must be in registers before the loop starts: the
+// scalar operands of vector instructions and the array addresses that
+// aren't constants.
+
+static int CollectInvariants(ENODE *node)
+{
+	ENODE *base;
+
+	if ((base = ElementBase(node)) != nullptr)
+		return (IsAddressConstant(base) || AddInvariant(base));
+	if (IsInvariant(node))
+		return (AddInvariant(node));
+	return (CollectInvariants(node->p[0]) && CollectInvariants(node->p[1]));
+}
+
+// Scalar registers needed for the values computed before the loop. A
+// register variable is used where it is.
+
+static int CountInvariantTemps()
+{
+	int nn, count;
+
+	count = 0;
+	for (nn = 0; nn < ninv; nn++) {
+		if (invNode[nn]->nodetype!=en_regvar)
+			count++;
+	}
+	return (count);
+}
+
+// Check the loop has the right form and record what's in its body.
+
+static int AnalyzeLoop(Statement *stmt)
+{
+	Statement *body;
+	ENODE *ep;
+	int nn, vregs, maxnodes, temps;
+
+	if (stmt->exp==nullptr || stmt->incrExpr==nullptr || stmt->s1==nullptr)
+		return (FALSE);
+	ep = stmt->exp;
+	if (ep->nodetype!=en_lt && ep->nodetype!=en_ult)
+		return (FALSE);
+	vecVar = ep->p[0];
+	if (!IsLocalVar(vecVar))
+		return (FALSE);
+	ep = stmt->incrExpr;
+	if (ep->nodetype!=en_asadd || !equalnode(ep->p[0], vecVar)
+		|| ep->p[1]==nullptr || ep->p[1]->nodetype!=en_icon || ep->p[1]->i!=1)
+		return (FALSE);
+
+	body = stmt->s1;
+	if (body->stype==st_compound) {
+		if (body->prolog || body->epilog || body->ssyms.GetHead())
+			return (FALSE);
+		body = body->s1;
+	}
+	nstmts = 0;
+	for (; body; body = body->next) {
+		if (body->stype!=st_expr || body->exp==nullptr || nstmts >= VEC_MAXSTMTS)
+			return (FALSE);
+		ep = body->exp;
+		stmtExp[nstmts] = ep;
+		switch(ep->nodetype) {
+		case en_assign:
+			stmtKind[nstmts] = VEC_STORE;
+			break;
+		case en_asadd:
+		case en_assub:
+			if (ep->nodetype==en_asadd && IsLocalVar(ep->p[0]) && !equalnode(ep->p[0], vecVar))
+				stmtKind[nstmts] = VEC_REDUCE;
+			else
+				stmtKind[nstmts] = VEC_UPDATE;
+			break;
+		default:
+			return (FALSE);
+		}
+		nstmts++;
+	}
+	if (nstmts==0)
+		return (FALSE);
+
+	// Everything else can be checked once all the sums are known.
+	nbases = 0;
+	ninv = 0;
+	vregs = 0;
+	maxnodes = 0;
+	temps = 3;
+	if (!IsInvariant(stmt->exp->p[1]))
+		return (FALSE);
+	if (stmt->exp->p[1]->nodetype!=en_regvar)
+		temps++;
+	if (vecVar->nodetype!=en_regvar)
+		temps++;
+	for (nn = 0; nn < nstmts; nn++) {
+		ep = stmtExp[nn];
+		if (stmtKind[nn]==VEC_REDUCE) {
+			if (UsesVar(ep->p[1], ep->p[0]))
+				return (FALSE);
+			if ((stmtNodes[nn] = CountVectorNodes(ep->p[1])) <= 0)
+				return (FALSE);
+			if (ep->p[0]->nodetype!=en_regvar)
+				temps++;
+			vregs++;
+			continue;
+		}
+		if (ElementBase(ep->p[0])==nullptr || !AddBase(ElementBase(ep->p[0]), TRUE))
+			return (FALSE);
+		if ((stmtNodes[nn] = CountVectorNodes(ep->p[1])) < 0)
+			return (FALSE);
+		if (stmtKind[nn]==VEC_UPDATE)
+			stmtNodes[nn] += 2;
+		else if (stmtNodes[nn]==0)
+			vregs++;		// the value is kept in a vector register
+		maxnodes = max(maxnodes, stmtNodes[nn]);
+		if (!CollectInvariants(ep->p[0]))
+			return (FALSE);
+	}
+	for (nn = 0; nn < nstmts; nn++) {
+		if (!CollectInvariants(stmtExp[nn]->p[1]))
+			return (FALSE);
+	}
+	// A sum is counted in a register of its own.
+	for (nn = 0; nn < nstmts; nn++) {
+		if (stmtKind[nn]==VEC_REDUCE) {
+			temps++;
+			break;
+		}
+	}
+	if (vregs + maxnodes > VEC_MAXVREGS || temps + CountInvariantTemps() > VEC_MAXTEMPS)
+		return (FALSE);
+	return (TRUE);
+}
+
+// The address of the element of an array for the current strip. Either
+// the array is at a constant address and the strip's offset is used as an
+// index register, or the address is added into a temporary register.
+
+static AMODE *ElementAddress(ENODE *base, AMODE *off)
+{
+	AMODE *ap;
+
+	if (IsAddressConstant(base)) {
+		ap = allocAmode();
+		ap->mode = am_indx;
+		ap->preg = off->preg;
+		ap->offset = base;
+		return (ap);
+	}
+	ap = GetTempRegister();
+	GenerateTriadic(op_add,0,ap,FindInvariant(base),off);
+	ap->mode = am_ind;
+	return (ap);
+}
+
+static void ReleaseElementAddress(AMODE *ap)
+{
+	if (ap->mode==am_ind)
+		ReleaseTempRegister(ap);
+}
+
+static AMODE *GenerateVectorExpression(ENODE *node, AMODE *off)
+{
+	ENODE *base, *p0, *p1;
+	AMODE *ap1, *ap2, *ap3;
+	int op, ops;
+
+	if ((base = ElementBase(node)) != nullptr) {
+		ap1 = GetTempVectorRegister();
+		ap2 = ElementAddress(base, off);
+		GenerateDiadic(op_lv,0,ap1,ap2);
+		ReleaseElementAddress(ap2);
+		return (ap1);
+	}
+	switch(node->nodetype) {
+	case en_add:	op = op_vadd; ops = op_vadds; break;
+	case en_sub:	op = op_vsub; ops = op_vsubs; break;
+	default:		op = op_vmul; ops = op_vmuls; break;
+	}
+	p0 = node->p[0];
+	p1 = node->p[1];
+	if (IsInvariant(p0)) {
+		p0 = node->p[1];
+		p1 = node->p[0];
+	}
+	ap3 = GetTempVectorRegister();
+	ap1 = GenerateVectorExpression(p0, off);
+	if (IsInvariant(p1))
+		Generate4adic(ops,0,ap3,ap1,FindInvariant(p1),vecMask);
+	else {
+		ap2 = GenerateVectorExpression(p1, off);
+		Generate4adic(op,0,ap3,ap1,ap2,vecMask);
+		ReleaseTempRegister(ap2);
+	}
+	ReleaseTempRegister(ap1);
+	return (ap3);
+}
+
+static void GenerateVectorStatement(int nn, AMODE *off)
+{
+	ENODE *ep;
+	AMODE *ap1, *ap2, *ap3;
+
+	ep = stmtExp[nn];
+	switch(stmtKind[nn]) {
+	case VEC_STORE:
+		if (stmtVreg[nn])
+			ap1 = stmtVreg[nn];
+		else
+			ap1 = GenerateVectorExpression(ep->p[1], off);
+		ap2 = ElementAddress(ElementBase(ep->p[0]), off);
+		GenerateDiadicNT(op_sv,0,ap1,ap2);
+		ReleaseElementAddress(ap2);
+		if (stmtVreg[nn]==nullptr)
+			ReleaseTempRegister(ap1);
+		break;
+	case VEC_UPDATE:
+		ap3 = GetTempVectorRegister();
+		ap1 = GenerateVectorExpression(ep->p[0], off);
+		if (IsInvariant(ep->p[1]))
+			Generate4adic(ep->nodetype==en_asadd ? op_vadds : op_vsubs,0,ap3,ap1,FindInvariant(ep->p[1]),vecMask);
+		else {
+			ap2 = GenerateVectorExpression(ep->p[1], off);
+			Generate4adic(ep->nodetype==en_asadd ? op_vadd : op_vsub,0,ap3,ap1,ap2,vecMask);
+			ReleaseTempRegister(ap2);
+		}
+		ReleaseTempRegister(ap1);
+		ap2 = ElementAddress(ElementBase(ep->p[0]), off);
+		GenerateDiadicNT(op_sv,0,ap3,ap2);
+		ReleaseElementAddress(ap2);
+		ReleaseTempRegister(ap3);
+		break;
+	case VEC_REDUCE:
+		ap1 = GenerateVectorExpression(ep->p[1], off);
+		Generate4adic(op_vadd,0,stmtVreg[nn],stmtVreg[nn],ap1,vecMask);
+		ReleaseTempRegister(ap1);
+		break;
+	}
+}
+
+static void SetVectorLength(AMODE *ap)
+{
+	GenerateDiadicNT(op_vmov,0,make_string("vl"),ap);
+}
+
+static void SetFullVectorLength()
+{
+	AMODE *ap;
+
+	ap = GetTempRegister();
+	GenerateDiadic(op_ldi,0,ap,make_immed(maxVL));
+	SetVectorLength(ap);
+	ReleaseTempRegister(ap);
+}
+
+// Before the loop make sure no array that is stored to overlaps another
+// array by less than a strip. The addresses may be the same.
+
+static int GenerateOverlapChecks(int scalar_label)
+{
+	AMODE *ap1, *ap2, *ap3, *ap4;
+	int nn, mm, lab, checks;
+
+	checks = 0;
+	for (nn = 0; nn < nbases; nn++) {
+		if (!baseStored[nn])
+			continue;
+		for (mm = 0; mm < nbases; mm++) {
+			if (mm==nn || (baseStored[mm] && mm < nn))
+				continue;
+			if (IsObjectAddress(bases[nn]) && IsObjectAddress(bases[mm]))
+				continue;
+			lab = nextlabel++;
+			ap1 = GenerateExpression(bases[nn],F_REG,sizeOfWord);
+			ap2 = GenerateExpression(bases[mm],F_REG,sizeOfWord);
+			ap3 = GetTempRegister();
+			GenerateTriadic(op_sub,0,ap3,ap1,ap2);
+			GenerateTriadicNT(op_beq,0,ap3,makereg(0),make_clabel(lab));
+			GenerateTriadic(op_add,0,ap3,ap3,make_immed(maxVL*sizeOfWord-1));
+			ap4 = GetTempRegister();
+			GenerateDiadic(op_ldi,0,ap4,make_immed(2*maxVL*sizeOfWord-1));
+			GenerateTriadicNT(op_bltu,0,ap3,ap4,make_clabel(scalar_label));
+			ReleaseTempRegister(ap4);
+			ReleaseTempRegister(ap3);
+			ReleaseTempRegister(ap2);
+			ReleaseTempRegister(ap1);
+			GenerateLabel(lab);
+			checks++;
+		}
+	}
+	return (checks);
+}
+
+// Add up the elements of a sum's vector register. The register is stored
+// on the stack and the first count elements are added to the variable.
+
+static void GenerateReduction(AMODE *vreg, AMODE *sum, AMODE *count)
+{
+	AMODE *ap1, *ap2, *ap3, *ap4;
+	int lab1, lab2;
+
+	lab1 = nextlabel++;
+	lab2 = nextlabel++;
+	GenerateTriadic(op_sub,0,makereg(regSP),makereg(regSP),make_immed(maxVL*sizeOfWord));
+	ap1 = GetTempRegister();
+	GenerateDiadic(op_mov,0,ap1,makereg(regSP));
+	ap2 = GetTempRegister();
+	GenerateTriadic(op_shl,0,ap2,count,make_immed(3));
+	GenerateTriadic(op_add,0,ap2,ap2,ap1);
+	ap4 = copy_addr(ap1);
+	ap4->mode = am_ind;
+	GenerateDiadicNT(op_sv,0,vreg,ap4);
+	GenerateLabel(lab1);
+	Generate4adicNT(op_bge,0,ap1,ap2,make_clabel(lab2),make_immed(2));
+	ap3 = GetTempRegister();
+	GenLoad(ap3,ap4,sizeOfWord,sizeOfWord);
+	GenerateTriadic(op_add,0,sum,sum,ap3);
+	ReleaseTempRegister(ap3);
+	GenerateTriadic(op_add,0,ap1,ap1,make_immed(sizeOfWord));
+	GenerateMonadicNT(op_bra,0,make_clabel(lab1));
+	GenerateLabel(lab2);
+	ReleaseTempRegister(ap2);
+	ReleaseTempRegister(ap1);
+	GenerateTriadic(op_add,0,makereg(regSP),makereg(regSP),make_immed(maxVL*sizeOfWord));
+}
+
+// A local variable kept in the stack frame is loaded into a register for
+// the loop and stored back afterwards.
+
+static AMODE *LoadVar(ENODE *var)
+{
+	if (var->nodetype==en_regvar)
+		return (makereg((int)var->i));
+	return (GenerateExpression(var,F_REG,sizeOfWord));
+}
+
+static void StoreVar(ENODE *var, AMODE *ap)
+{
+	if (var->nodetype!=en_regvar)
+		GenStore(ap,GenerateExpression(var,F_MEM,sizeOfWord),sizeOfWord);
+}
+
+// Generate a vector version of the loop. The loop's initialization has
+// already been done. If the arrays might overlap, the code branches to
+// the scalar loop at scalar_label before anything is changed, and fallback
+// is set; the vector loop then leaves the loop variable at the limit so
+// the scalar loop falls straight out. Returns false if the loop can't be
+// done with vector instructions.
+
+bool Statement::GenerateVectorFor(int scalar_label, bool *fallback)
+{
+	AMODE *ap, *limit, *var, *count, *len, *off;
+	int nn, loop_label, exit_label, lab;
+	bool reduce;
+
+	*fallback = false;
+	if (opt_novector || !AnalyzeLoop(this))
+		return (false);
+	DTRACE(TRC_VECTOR).printf("<Vectorize>%s", (char *)currentFn->name->c_str());
+	DTRACE(TRC_VECTOR).printf(" statements=%d arrays=%d</Vectorize>\n", nstmts, nbases);
+	initstack();
+	limit = GenerateExpression(exp->p[1],F_REG,sizeOfWord);
+	for (nn = 0; nn < ninv; nn++)
+		invAmode[nn] = GenerateExpression(invNode[nn],F_REG,sizeOfWord);
+	*fallback = GenerateOverlapChecks(scalar_label) > 0;
+
+	var = LoadVar(vecVar);
+	vecMask = makevmreg(0);
+	ap = GetTempRegister();
+	GenerateDiadic(op_ldi,0,ap,make_immed(-1));
+	GenerateDiadicNT(op_vmov,0,vecMask,ap);
+	ReleaseTempRegister(ap);
+	SetFullVectorLength();
+
+	// Sums start at zero and stored values that don't change are spread
+	// across a register.
+	reduce = false;
+	count = nullptr;
+	for (nn = 0; nn < nstmts; nn++) {
+		stmtVreg[nn] = nullptr;
+		if (stmtKind[nn]==VEC_REDUCE || (stmtKind[nn]==VEC_STORE && stmtNodes[nn]==0)) {
+			stmtVreg[nn] = GetTempVectorRegister();
+			Generate4adic(op_vsub,0,stmtVreg[nn],stmtVreg[nn],stmtVreg[nn],vecMask);
+			if (stmtKind[nn]==VEC_REDUCE)
+				reduce = true;
+			else if (!(stmtExp[nn]->p[1]->nodetype==en_icon && stmtExp[nn]->p[1]->i==0))
+				Generate4adic(op_vadds,0,stmtVreg[nn],stmtVreg[nn],FindInvariant(stmtExp[nn]->p[1]),vecMask);
+		}
+	}
+	// The sums only have as many elements as the first strip.
+	if (reduce) {
+		lab = nextlabel++;
+		count = GetTempRegister();
+		GenerateTriadic(op_sub,0,count,limit,var);
+		ap = GetTempRegister();
+		GenerateDiadic(op_ldi,0,ap,make_immed(maxVL));
+		Generate4adicNT(op_blt,0,count,ap,make_clabel(lab),make_immed(2));
+		GenerateDiadic(op_mov,0,count,ap);
+		ReleaseTempRegister(ap);
+		GenerateLabel(lab);
+	}
+
+	loop_label = nextlabel++;
+	exit_label = nextlabel++;
+	GenerateLabel(loop_label);
+	if (exp->nodetype==en_ult)
+		GenerateTriadicNT(op_bgeu,0,var,limit,make_clabel(exit_label));
+	else
+		Generate4adicNT(op_bge,0,var,limit,make_clabel(exit_label),make_immed(2));
+	lab = nextlabel++;
+	len = GetTempRegister();
+	GenerateTriadic(op_sub,0,len,limit,var);
+	ap = GetTempRegister();
+	GenerateDiadic(op_ldi,0,ap,make_immed(maxVL));
+	Generate4adicNT(op_blt,0,len,ap,make_clabel(lab),make_immed(2));
+	GenerateDiadic(op_mov,0,len,ap);
+	ReleaseTempRegister(ap);
+	GenerateLabel(lab);
+	SetVectorLength(len);
+	off = GetTempRegister();
+	GenerateTriadic(op_shl,0,off,var,make_immed(3));
+	for (nn = 0; nn < nstmts; nn++)
+		GenerateVectorStatement(nn, off);
+	ReleaseTempRegister(off);
+	GenerateTriadic(op_add,0,var,var,len);
+	ReleaseTempRegister(len);
+	GenerateMonadicNT(op_bra,0,make_clabel(loop_label));
+	GenerateLabel(exit_label);
+
+	SetFullVectorLength();
+	for (nn = 0; nn < nstmts; nn++) {
+		if (stmtKind[nn]==VEC_REDUCE) {
+			ap = LoadVar(stmtExp[nn]->p[0]);
+			GenerateReduction(stmtVreg[nn], ap, count);
+			StoreVar(stmtExp[nn]->p[0], ap);
+			ReleaseTempRegister(ap);
+		}
+	}
+	StoreVar(vecVar, var);
+	initstack();
+	return (true);
+}
@@ -141,7 +141,7 @@ enum e_op {
 		op_vadds, op_vsubs, op_vmuls, op_vdivs,
 		op_vseq, op_vsne,
 		op_vslt, op_vsge, op_vsle, op_vsgt,
-		op_vex, op_veins,
+		op_vex, op_veins, op_vmov,
 		// DSD9
 		op_ldd, op_ldb, op_ldp, op_ldw, op_ldbu, op_ldwu, op_ldpu, op_ldt, op_ldtu,
 		op_std, op_stb, op_stp, op_stw, op_stt, op_calltgt,
@@ -157,4 +157,10 @@ enum e_op {
 		op_phi,
         op_empty };
 
+// Functional units for the scheduler. Shifts and bit fields execute on
+// only one of the two ALUs.
+enum e_fu {
+		fu_none, fu_alu, fu_alu0, fu_mem, fu_mul, fu_div
+	};
+
 #endif
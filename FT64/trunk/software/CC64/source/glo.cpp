@@ -27,7 +27,6 @@
 /*      global definitions      */
 
 CPU cpu;
-int pass;
 int maxPn = 15;
 int gCpu = 7;
 int regPC = 254;
@@ -47,6 +46,11 @@ int regFirstArg = 18;//35;
 int regLastArg = 22;//47;
 int farcode = 0;
 int wcharSupport = 1;
+#ifdef FPP_LIB
+int extfpp = 0;			// run fpp as a separate process
+#else
+int extfpp = 1;			// fpp isn't built in
+#endif
 int verbose = 0;
 int use_gp = 0;
 int address_bits = 32;
@@ -112,6 +116,11 @@ int opt_noregs = FALSE;
 int opt_nopeep;
 int opt_noexpr = FALSE;
 int opt_nocgo = FALSE;
+int opt_noinline = FALSE;
+int opt_noloop = FALSE;
+int opt_novector = FALSE;
+int opt_nossa = FALSE;
+int opt_nosched = FALSE;
 int exceptions = FALSE;
 int mixedSource = FALSE;
 SYM *currentFn = (SYM *)NULL;
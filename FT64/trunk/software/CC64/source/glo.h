@@ -47,7 +47,6 @@
 #endif
 
 extern CPU cpu;
-extern int pass;
 extern int maxPn;
 extern int hook_predreg;
 extern int gCpu;
@@ -68,6 +67,7 @@ extern int regFirstArg;
 extern int regLastArg;
 extern int farcode;
 extern int wcharSupport;
+extern int extfpp;
 extern int verbose;
 extern int use_gp;
 extern int address_bits;
@@ -136,6 +136,11 @@ extern int opt_noregs;
 extern int opt_nopeep;
 extern int opt_noexpr;
 extern int opt_nocgo;
+extern int opt_noinline;
+extern int opt_noloop;
+extern int opt_novector;
+extern int opt_nossa;
+extern int opt_nosched;
 extern int exceptions;
 extern int mixedSource;
 extern SYM *currentFn;
@@ -187,7 +192,7 @@ extern void closefiles();
 extern void error(int n);
 extern void needpunc(enum e_sym p,int);
 // Memmgt.c
-extern void *allocx(int);
+extern void *allocx(int, int);
 extern char *xalloc(int);
 extern SYM *allocSYM();
 extern TYP *allocTYP();
@@ -239,7 +244,7 @@ extern void doinit(SYM *sp);
 // Func.c
 extern SYM *makeint(char *);
 extern void funcbody(SYM *sp);
-extern int TempBot();
+extern void AddFrameFixup(ENODE *ep, int kind);
 // Intexpr.c
 extern int64_t GetIntegerExpression(ENODE **p);
 extern Float128 *GetFloatExpression(ENODE **pnode);
@@ -258,6 +263,8 @@ extern TYP *asnop(ENODE **node);
 extern TYP *NonCommaExpression(ENODE **);
 // Optimize.c
 extern void opt_const(ENODE **node);
+// Inline.c
+extern void InlineCalls(SYM *sp);
 // GenerateStatement.c
 //extern void GenerateFunction(Statement *stmt);
 extern void GenerateIntoff(Statement *stmt);
@@ -352,7 +359,6 @@ extern void ReleaseTempRegister(AMODE *ap);
 extern void ReleaseTempReg(AMODE *ap);
 extern int TempInvalidate(int *);
 extern void TempRevalidate(int sp, int fsp);
-extern int GetTempMemSpace();
 extern bool IsArgumentReg(int);
 // Table888.c
 extern void GenerateTable888Function(SYM *sym, Statement *stmt);
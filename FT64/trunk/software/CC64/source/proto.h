@@ -5,4 +5,14 @@
 bool IsArgumentReg(int regno);
 bool IsCalleeSave(int regno);
 
+// fpp, built in with FPP_LIB defined. The FPP sources must then be built
+// with FPP_LIB defined too and linked in. Otherwise fpp is run as a
+// separate process.
+extern "C" {
+int fppOpen(char *);
+int fppGetLine(char *, int);
+void fppClose(void);
+void fppMarkInclude(char *);
+}
+
 #endif
@@ -6,131 +6,115 @@
 /*      Header file for set routines.
 */
 
-#define SET_DEFAULT_SIZE     (128 / (sizeof(int) << 3))
-#define SET_DIV_WSIZE(bit)   (bit) / (sizeof(int) << 3)
-#define SET_ROUND(bit)       (((SET_DIV_WSIZE(bit) + 8) >> 3) << 3)
-#define SET_GBIT(s,bit,op) \
-    (((s).map)[SET_DIV_WSIZE(bit)] (op) (1 << (bit) & 15))
-#define SET_BPW              (sizeof(int) << 3)
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define SET_DEFAULT_SIZE     2		// words in the default map - 128 bits
+#define SET_BPW              64
 #define SET_BMASK            (SET_BPW - 1)
-#define SET_NBIT             ((SET_BPW & 32) ? 5 : 4)
+#define SET_NBIT             6
 
-#define SET_EQUIV   0
-#define SET_DISJ    1
-#define SET_INTER   2
+// Number of bits set, trailing and leading zero counts of a map word.
+#ifdef _MSC_VER
+static inline int SetPopcnt(uint64_t w) { return ((int)__popcnt64(w)); }
+static inline int SetCtz(uint64_t w) { unsigned long n; _BitScanForward64(&n, w); return ((int)n); }
+static inline int SetClz(uint64_t w) { unsigned long n; _BitScanReverse64(&n, w); return (63 - (int)n); }
+#else
+static inline int SetPopcnt(uint64_t w) { return (__builtin_popcountll(w)); }
+static inline int SetCtz(uint64_t w) { return (__builtin_ctzll(w)); }
+static inline int SetClz(uint64_t w) { return (__builtin_clzll(w)); }
+#endif
 
-extern void *allocx(int);
+// A dense set of small non-negative integers. The map grows as needed;
+// words past the end of the map are taken as zero, so sets of different
+// sizes can be combined. Members are visited with
+//		for (n = s->firstMember(); n >= 0; n = s->nextMember(n))
 
 class CSet //: public CObject
 {
-   unsigned int dmap[SET_DEFAULT_SIZE];  // Default bitmap - 128 bits
-   unsigned int *map;				// Pointer to bit map of elements
-   unsigned __int16 MemberPtr;    // for NextMember
-   unsigned __int16 nbits;        // Number of bits in map.
-   unsigned __int8 size;          // number of int's of bitmap.
-   unsigned __int8 compl;         // Negative true set if compl is true
+   uint64_t dmap[SET_DEFAULT_SIZE];  // Default bitmap - 128 bits
+   uint64_t *map;				// Pointer to bit map of elements
+   int size;						// number of words in the map
 
    void enlarge(int);            // increase size of set
-   int cmp(CSet&) const;
-   int SetTest(CSet &);
-   void allocBitStorage();
+   int cmp(const CSet&) const;
 public:
 	void Create() {
 		map = dmap;
 		size = SET_DEFAULT_SIZE;
-		nbits = SET_DEFAULT_SIZE * sizeof(int) << 3;
-		MemberPtr = 0;
-		compl = 0;
-		clear(); 
-	};
-	static CSet *MakeNew() {
-		CSet *p;
-
-		p = (CSet *)allocx(sizeof(CSet));
-		p->Create();
-		return (p);
+		clear();
 	};
+	static CSet *MakeNew();
 	CSet() {
 		Create();
 	};
-	CSet(const CSet &s) { copy(s); };
+	CSet(const CSet &s) { Create(); copy(s); };
+	CSet(CSet &&s) {
+		if (s.map == s.dmap) {
+			Create();
+			copy(s);
+		}
+		else {
+			map = s.map;
+			size = s.size;
+			s.Create();
+		}
+	};
 	~CSet() {
-		//if (map != dmap)
-		//	delete[] map;
 	};
 
    // Assignment other operators
    //---------------------------
 	void copy(const CSet &s);
 
-    CSet& operator=(CSet&);     			// Assignment (copy)
-	CSet operator!();           			// s = not s1
-	CSet operator|(CSet);      			// s = s1 union s2
-	CSet& operator|=(CSet);    			// s1 = s1 union s2
-	CSet operator&(CSet);      			// s = s1 intersection s2
-	CSet& operator&=(CSet);   			// s1 = s1 intersection s2
-	int operator&(int bit)
+    CSet& operator=(const CSet &s) { if (this != &s) copy(s); return *this; };
+	CSet operator|(const CSet &) const;	// s = s1 union s2
+	CSet& operator|=(const CSet &s) { add(s); return *this; };
+	CSet operator&(const CSet &) const;	// s = s1 intersection s2
+	CSet& operator&=(const CSet &s) { intersect(s); return *this; };
+	int operator&(int bit) const
         { return isMember(bit); };  // is n a member of s ?
-	CSet operator+(int);        // s = s1 plus element
-	CSet operator-(int);        // s = s1 minus element
-	CSet operator-(CSet);     // s = (symmetric) difference bewteen s1, s2
+	CSet operator+(int) const;        // s = s1 plus element
+	CSet operator-(int) const;        // s = s1 minus element
+	CSet operator-(const CSet &) const;	// s = (symmetric) difference bewteen s1, s2
 
 	// Relational operators
     //---------------------
-	int operator==(CSet &s) const { return cmp(s) ? 0 : 1; };
-	int operator!=(CSet &s) const { return cmp(s) ? 1 : 0; };
-	int operator>(CSet &s) const { return (cmp(s) > 0) ? 1 : 0; };
-	int operator<(CSet &s) const { return (cmp(s) < 0) ? 1 : 0; };
-	int operator>=(CSet &s) const { return (cmp(s) >= 0) ? 1 : 0; };
-	int operator<=(CSet &s) const { return (cmp(s) <= 0) ? 1 : 0; };
+	int operator==(const CSet &s) const { return cmp(s) ? 0 : 1; };
+	int operator!=(const CSet &s) const { return cmp(s) ? 1 : 0; };
+	int operator>(const CSet &s) const { return (cmp(s) > 0) ? 1 : 0; };
+	int operator<(const CSet &s) const { return (cmp(s) < 0) ? 1 : 0; };
+	int operator>=(const CSet &s) const { return (cmp(s) >= 0) ? 1 : 0; };
+	int operator<=(const CSet &s) const { return (cmp(s) <= 0) ? 1 : 0; };
 
    // Functions
    //----------
 	// Add a new element to the set.
 	inline void add(int bit)
 	{
-		if (bit > nbits)
-			enlarge(bit >> SET_NBIT);
-		map[bit >> SET_NBIT] |= (1 << (bit & SET_BMASK));
+		if ((bit >> SET_NBIT) >= size)
+			enlarge((bit >> SET_NBIT) + 1);
+		map[bit >> SET_NBIT] |= (1ULL << (bit & SET_BMASK));
 	};
-	void add(CSet &s);
-	void add(CSet *s);
-//	inline void add(int);       // add member to set
+	bool add(const CSet &s);		// union, true if the set changed
+	bool add(const CSet *s) { return (add(*s)); };
 	void remove(int);    // Remove member - clears bit in map
-	inline void remove(CSet &s)
-	{
-		for (int ii = size; --ii >= 0;)
-			map[ii] &= ~s.map[ii];
-	}
-	int resetPtr() {
-      int i = MemberPtr;
-      MemberPtr = 0;
-      return i; };
-	int SetPtr(int n) {
-      int i = MemberPtr;
-      MemberPtr = (unsigned __int16)n;
-      return i; };
-	  int Member(int n);
-	int nextMember();
-	int prevMember();
-	int lastMember();
-	int length() const { return sizeof(int) * size << 3; };
+	void remove(const CSet &s);		// difference
+	void intersect(const CSet &s);
+	bool unionDiff(const CSet &a, const CSet &b, const CSet &c);
+	int firstMember() const { return (nextMember(-1)); };
+	int nextMember(int n) const;	// next member after n, -1 if none
+	int prevMember(int n) const;	// member before n, -1 if none
+	int lastMember() const;
+	int length() const { return size * SET_BPW; };
 	int NumMember() const;  // Number of 'ON' elements in set
-	int print(int (*)(void *,...), void*);
 	int sprint(char *, int);
-	unsigned hash() const;
-	int subset(CSet &) const;
-	void truncate();
-	void clear();					// Zero all bits
-	void fill();					// Set all bits
-	void complement();
-	int isDisjoint(CSet &s) { return (SetTest(s) == SET_DISJ); };
-	int isIntersecting(CSet &s) { return (SetTest(s) == SET_INTER); };
-	int isEmpty() { return NumMember() == 0; };
-	int isMember(int bit) { return ((bit >= nbits)||bit < 0 ? 0 : (map[bit >> SET_NBIT] & (1 << (bit & SET_BMASK)))) != 0; }; // is n a member of s ?
-	int test(int x) { return (isMember(x)) ? !compl : compl; };
-	int isSubset(CSet &);
-
-//	void Serialize(CArchive& ar);
+	void clear() { memset(map, 0, size * sizeof(uint64_t)); };	// Zero all bits
+	int isDisjoint(const CSet &s) const;
+	int isIntersecting(const CSet &s) const { return (!isDisjoint(s)); };
+	int isEmpty() const;
+	int isMember(int bit) const { return (bit < 0 || (bit >> SET_NBIT) >= size) ? 0 : ((map[bit >> SET_NBIT] >> (bit & SET_BMASK)) & 1); }; // is n a member of s ?
+	int isSubset(const CSet &) const;
 };
 #endif
@@ -6,73 +6,116 @@ void txtoStream::printf(char *fmt, char *str)
 {
   if (level==0)
     return;
-  snprintf(buf, sizeof(buf), fmt, str);
-	write(buf);
+	Formatted(snprintf(Reserve(TXTO_LINE), TXTO_LINE, fmt, str));
 }
 
 void txtoStream::printf(char *fmt, char *str, int n)
 {
   if (level==0)
     return;
- snprintf(buf, sizeof(buf), fmt, str, n);
- write(buf);
+	Formatted(snprintf(Reserve(TXTO_LINE), TXTO_LINE, fmt, str, n));
 }
 
 void txtoStream::printf(char *fmt, char *str, char *str2)
 {
   if (level==0)
     return;
- snprintf(buf, sizeof(buf), fmt, str, str2);
- write(buf);
+	Formatted(snprintf(Reserve(TXTO_LINE), TXTO_LINE, fmt, str, str2));
 }
 
 void txtoStream::printf(char *fmt, char *str, char *str2, int n)
 {
   if (level==0)
     return;
-	snprintf(buf, sizeof(buf), fmt, str, str2, n);
-	write(buf);
+	Formatted(snprintf(Reserve(TXTO_LINE), TXTO_LINE, fmt, str, str2, n));
 }
 
 void txtoStream::printf(char *fmt, int n)
 {
   if (level==0)
     return;
-	snprintf(buf, sizeof(buf), fmt, n);
-	write(buf);
+	Formatted(snprintf(Reserve(TXTO_LINE), TXTO_LINE, fmt, n));
 }
 
 void txtoStream::printf(char *fmt, __int64 n)
 {
   if (level==0)
     return;
-	snprintf(buf, sizeof(buf), fmt, n);
-	write(buf);
+	Formatted(snprintf(Reserve(TXTO_LINE), TXTO_LINE, fmt, n));
 }
 
 void txtoStream::printf(char *fmt, int n, int m)
 {
   if (level==0)
     return;
-	snprintf(buf, sizeof(buf), fmt, n, m);
-	write(buf);
+	Formatted(snprintf(Reserve(TXTO_LINE), TXTO_LINE, fmt, n, m));
 }
 
 void txtoStream::printf(char *fmt, int n, char *str)
 {
   if (level==0)
     return;
-	snprintf(buf, sizeof(buf), fmt, n, str);
-	write(buf);
+	Formatted(snprintf(Reserve(TXTO_LINE), TXTO_LINE, fmt, n, str));
 }
 
 void txtoStream::puts(const char *str)
 {
   if (level==0)
     return;
-  while(*str) {
-    putch(*str);
-    str++;
-  }
+	append(str, strlen(str));
+}
+
+void txtoStream::append(const char *str, size_t n)
+{
+	if (ocnt + n > TXTO_BUFSIZE) {
+		Drain();
+		if (n > TXTO_BUFSIZE) {
+			std::ofstream::write(str, n);
+			return;
+		}
+	}
+	memcpy(&obuf[ocnt], str, n);
+	ocnt += n;
+}
+
+void txtoStream::Drain()
+{
+	if (ocnt > 0)
+		std::ofstream::write(obuf, ocnt);
+	drained += ocnt;
+	ocnt = 0;
+}
+
+// Returns the text output since the position given by Tell(), or nullptr
+// if part of it has already been written to the file.
+
+const char *txtoStream::Since(int64_t pos, int *n)
+{
+	if (pos < drained || pos > drained + ocnt)
+		return (nullptr);
+	*n = (int)(drained + ocnt - pos);
+	return (&obuf[pos - drained]);
+}
+
+// The file is written unbuffered as the output is already collected in
+// obuf. The buffer of a file can only be set after it's opened, before that
+// some libraries ignore the call.
+
+void txtoStream::open(const char *name, std::ios_base::openmode mode)
+{
+	std::ofstream::open(name, mode);
+	rdbuf()->pubsetbuf(nullptr, 0);
+}
+
+void txtoStream::flush()
+{
+	Drain();
+	std::ofstream::flush();
+}
+
+void txtoStream::close()
+{
+	Drain();
+	std::ofstream::close();
 }
 
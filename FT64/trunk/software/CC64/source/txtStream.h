@@ -4,16 +4,57 @@
 #include <fstream>
 #include <iomanip>
 
+// Trace categories for the debug stream. A category is traced only if it
+// is in both the compile time TRACE_MASK and the stream's runtime mask.
+
+enum e_trc {
+	TRC_SYM = 1,		// symbol table
+	TRC_PARSE = 2,
+	TRC_CSE = 4,
+	TRC_REGALLOC = 8,
+	TRC_PEEP = 16,
+	TRC_INLINE = 32,
+	TRC_LOOP = 64,
+	TRC_VECTOR = 128,
+	TRC_SSA = 256,
+	TRC_SCHED = 512,
+	TRC_ALL = 1023
+};
+
+#ifndef TRACE_MASK
+#define TRACE_MASK	TRC_ALL
+#endif
+
+// Tracing statements are written as DTRACE(cat).printf(...). When the
+// category is off the arguments are not evaluated.
+#define DTRACE_ON(cat)	((TRACE_MASK & (cat)) && (dfs.mask & (cat)))
+#define DTRACE(cat)		if (!DTRACE_ON(cat)) ; else dfs
+
+// Output is collected in a large buffer and written to the file in big
+// chunks, when the buffer fills or when flush() or close() is called. The
+// compiler flushes at the end of each function. The printf functions format
+// straight into the buffer.
+
+#define TXTO_BUFSIZE	262144
+#define TXTO_LINE		500		// longest piece a printf produces
+
 class txtoStream : public std::ofstream
 {
-	char buf[500];
+	char obuf[TXTO_BUFSIZE];
+	int ocnt;
+	int64_t drained;		// bytes written to the file so far
+	char *Reserve(int n) { if (ocnt + n > TXTO_BUFSIZE) Drain(); return (&obuf[ocnt]); };
+	void Formatted(int n) { ocnt += n < 0 ? 0 : n < TXTO_LINE ? n : TXTO_LINE - 1; };
+	void Drain();
 public:
 	int level;
+	int mask;
 public:
-  txtoStream() : std::ofstream() {};
-	void write(char *buf) { if (level) {
-	   std::ofstream::write(buf, strlen(buf));
-       flush(); }};
+  txtoStream() : std::ofstream() { ocnt = 0; drained = 0; mask = TRC_ALL; };
+  ~txtoStream() { Drain(); };
+	void open(const char *name, std::ios_base::openmode mode);
+	void write(char *str) { if (level) append(str, strlen(str)); };
+	void append(const char *str, size_t n);
 	void printf(char *str) { if (level) write(str); };
 	void printf(const char *str) { if (level) write((char *)str); };
 	void printf(char *fmt, char *str);
@@ -26,13 +67,15 @@ public:
 	void printf(char *fmt, __int64 n);
 	void putch(char ch) { 
 	    if (level) {
-	     buf[0] = ch;
-	     buf[1] = '\0';
-	     buf[2] = '\0';
-	     buf[3] = '\0';
-       std::ofstream::write(buf, 1);
-       }};
+			if (ocnt >= TXTO_BUFSIZE)
+				Drain();
+			obuf[ocnt++] = ch;
+		}};
 	void puts(const char *);
+	int64_t Tell() { return (drained + ocnt); };
+	const char *Since(int64_t pos, int *n);
+	void flush();
+	void close();
 };
 
 // Make it easy to disable debugging output
@@ -42,6 +85,7 @@ class txtoStreamNull
 {
 public:
   int level;
+  int mask;
   void open(...);
   void close();
   void write(char *) { };
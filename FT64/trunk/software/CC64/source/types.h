@@ -73,21 +73,59 @@ enum e_sc {
         sc_static, sc_auto, sc_global, sc_thread, sc_external, sc_type, sc_const,
         sc_member, sc_label, sc_ulabel, sc_typedef, sc_register };
 
+// What allocated memory is used for. Code and optimizer data only live until
+// the function's code has been output, everything else lives until the end
+// of the source file.
+enum e_mem {
+		MEM_MISC, MEM_PARSE, MEM_SYM, MEM_LIT, MEM_CODE, MEM_OPT,
+		MEM_LAST };
+
+// Frame dependent operands patched once a function's frame size is known.
+enum e_ff {
+		FF_STKSPACE, FF_TEMPBOT };
+
 class CompilerType
 {
 public:
 	static CompilerType *alloc();
 };
 
-class MBlk
+// Memory is handed out from large chunks by bumping a pointer. Chunks double
+// in size as the arena grows. A mark records the position in the arena;
+// releasing back to a mark makes everything allocated since then available
+// again. Memory handed out is always zeroed, but only memory that has been
+// used before needs to be cleared.
+
+struct ArenaChunk;
+
+class ArenaMark
 {
-	static MBlk *first;
 public:
-	MBlk *next;
-	static void ReleaseAll();
-	static void *alloc(int sz);
+	ArenaChunk *chunk;
+	int used;
 };
 
+class Arena
+{
+	ArenaChunk *head;			// chunk being allocated from, older ones follow
+	ArenaChunk *spare;			// chunks given back by Release()
+	void *freelist[64];			// freed small blocks by size / 8
+	int chunksize;				// size of the next chunk
+	int64_t nbytes;				// total size of the chunks
+	void NewChunk(int sz);
+public:
+	int64_t peak;
+	static Arena file;			// kept until the end of the source file
+	static Arena func;			// released after each function
+	void *alloc(int sz);
+	void free(void *p, int sz);
+	ArenaMark Mark();
+	void Release(ArenaMark mk);
+	void ReleaseAll();
+};
+
+extern void *allocx(int sz, int kind = MEM_MISC);
+
 struct slit {
     struct slit     *next;
     int             label;
@@ -165,6 +203,39 @@ public:
 	void SetBase(int b) { base = b; };
 };
 
+// Index of the global symbols by name. Each distinct name has a list of
+// the symbols entered under it in the order they were inserted. A symbol
+// is entered under each of its three names. Lists are walked with an
+// entry number; zero ends the list.
+
+class SymbolIndex
+{
+	struct Key {
+		uint64_t hash;
+		std::string *name;
+		int head, tail;
+	};
+	static Key *keys;
+	static int size;		// always a power of two
+	static int count;
+	static int *entsym;
+	static int *entnext;
+	static int nent;
+	static int maxent;
+	static uint64_t Hash(const std::string& na);
+	static int Slot(const std::string& na, uint64_t hash);
+	static void Grow();
+	static void Add(std::string *na, int sym);
+	friend class Pch;
+	friend class Profile;
+public:
+	static void Clear();
+	static void Insert(SYM *sp);
+	static int Find(const std::string& na);
+	static int Next(int ent) { return (entnext[ent]); };
+	static SYM *GetSym(int ent);
+};
+
 class SYM {
 public:
 	int id;
@@ -233,9 +304,12 @@ public:
     unsigned int stksize;
 	CSE *csetbl;
 	int csendx;
+	ENODE *inlinexp;				// body expression for inline expansion
+	int inlineDepth;				// levels of calls expanded into inlinexp
 
 	TypeArray *GetParameterTypes();
 	TypeArray *GetProtoTypes();
+	void GetProtoTypes(TypeArray *ta);
 	void PrintParameterTypes();
 	bool HasRegisterParameters();
 	static SYM *Copy(SYM *src);
@@ -384,7 +458,7 @@ public:
 	unsigned int segment : 4;
 	unsigned int defseg : 1;
 	unsigned int tempflag : 1;
-	unsigned int type : 16;
+	int type;					// type index, the std types lie outside the table
 	char FloatSize;
 	unsigned int isUnsigned : 1;
 	unsigned int lowhigh : 2;
@@ -410,15 +484,19 @@ public:
 	short opcode;
 	short length;
 	unsigned int isVolatile : 1;
-	unsigned int isReferenced : 1;	// label is referenced by code
 	unsigned int remove : 1;
 	unsigned int remove2 : 1;
 	unsigned int leader : 1;
+	unsigned int inWork : 1;	// on the peephole work list
 	short pregreg;
 	short predop;
 	int loop_depth;
+	int refcount;		// number of references to a label
+	OCODE *wnext;		// next on the peephole work list
 	AMODE *oper1, *oper2, *oper3, *oper4;
 	__int16 phiops[100];
+	int ssaValue;		// first SSA value the instruction defines
+	char *profile;		// label of the branch for profiling
 public:
 	static OCODE *MakeNew();
 	bool HasTargetReg() const;
@@ -434,6 +512,8 @@ class CFG
 {
 public:
 	static void Create();
+	static void ComputeOrder();
+	static void IterateDataflow(bool backward, bool (*transfer)(BasicBlock *));
 	static void CalcDominatorTree();
 	static void CalcDominanceFrontiers();
 	static void InsertPhiInsns();
@@ -443,6 +523,94 @@ public:
 	static int WhichPred(BasicBlock *x, int y);
 };
 
+// A natural loop: the header and the blocks that can reach the source of a
+// back edge to the header without going through it.
+class Loop : public CompilerType
+{
+public:
+	BasicBlock *head;
+	CSet *blocks;		// numbers of the blocks in the loop, header included
+	OCODE *entry;		// code run once before the loop goes in front of this
+	Loop *next;
+public:
+	static Loop *MakeNew(BasicBlock *head);
+	static void FindLoops();
+	static void Optimize();
+	bool Contains(BasicBlock *b);
+	bool IsSafe();
+	int CountDefs(int regno);
+	bool IsLiveOut(int regno);
+	bool Hoist();
+	bool StrengthReduce();
+	bool Unroll();
+};
+
+// Precompiled header. The declarations of a header are parsed once and the
+// resulting symbol and type tables are saved to a file. Later compiles that
+// see the same header text load the tables instead of parsing it again.
+class Pch
+{
+	static bool Load(FILE *fp);
+	static void Save();
+public:
+	static void SetHeader(char *nm);
+	static void AddOption(char *opt);
+	static void Start();
+	static int Directive();
+	static bool Replaying();
+	static int GetLine(char *buf, int len);
+	static void Boundary();
+};
+
+// Profile guided optimization. A compile with -fprofile-generate puts a
+// label on each conditional branch. The emulator counts the branches by
+// address, and a compile with -fprofile-use joins the counts with the
+// assembler's symbol table to find how often each branch ran.
+class Profile
+{
+	static bool Read(char *nm);
+	static char *Key(Statement *stmt, char *sub);
+	static bool Find(char *key, int64_t *count, int64_t *taken);
+public:
+	static void SetGenerate();
+	static void SetUse(char *nm);
+	static void Start();
+	static void BeginFunction();
+	static void Number(Statement *stmt);
+	static Statement *Enter(Statement *stmt);
+	static char *Branch(unsigned int *prediction);
+	static char *Case(char kind, int first, int64_t *freq);
+	static void Attach(char *key, int label);
+	static void PutLabel(OCODE *ip);
+	static bool Measured();
+	static int Weight(Statement *stmt, int part);
+	static bool ElseHotter(Statement *stmt);
+};
+
+// Reorders the instructions in each basic block to hide latencies.
+class Scheduler
+{
+public:
+	static void Run();
+	static OCODE *ScheduleRegion(OCODE *first);
+};
+
+// Global optimizations on the static single assignment form of the code.
+// Everything is static, like the control flow graph.
+class SSA
+{
+public:
+	static void Optimize();
+	static void Build();
+	static void InsertPhis();
+	static void Rename(BasicBlock *b);
+	static void Propagate();
+	static void ApplyConstants();
+	static void Number(BasicBlock *b);
+	static void Sweep();
+	static void RemovePhis();
+};
+
 
 /*      output code structure   */
 /*
@@ -468,8 +636,8 @@ public:
 public:
 	static IntStack *MakeNew() {
 		IntStack *s;
-		s = (IntStack *)allocx(sizeof(IntStack));
-		s->stk = (int *)allocx(1000 * sizeof(int));
+		s = (IntStack *)allocx(sizeof(IntStack), MEM_OPT);
+		s->stk = (int *)allocx(1000 * sizeof(int), MEM_OPT);
 		s->sp = 1000;
 		return (s);
 	}
@@ -496,6 +664,7 @@ class Edge : public CompilerType
 {
 public:
 	bool backedge;
+	bool executable;	// may be taken, for constant propagation
 	Edge *next;
 	Edge *prev;
 	BasicBlock *src;
@@ -525,7 +694,8 @@ public:
 	CSet *DF;		// dominance frontier
 	int HasAlready;
 	int Work;
-	static CSet *livo;
+	int order;		// position in reverse postorder, -1 if not ordered
+	BasicBlock *idom;	// immediate dominator
 	BasicBlock *next;
 	BasicBlock *prev;
 	OCODE *code;
@@ -536,8 +706,8 @@ public:
 	Edge *MakeOutputEdge(BasicBlock *dst);
 	Edge *MakeInputEdge(BasicBlock *src);
 	Edge *MakeDomEdge(BasicBlock *dst);
-	void ComputeLiveVars();
-	void AddLiveOut(BasicBlock *ip);
+	void ComputeGenKill();
+	bool ComputeLiveVars();
 	bool IsIdom(BasicBlock *b);
 };
 
@@ -591,6 +761,8 @@ public:
 	short extime;	// execution time, divide may take hundreds of cycles
 	bool HasTarget;	// has a target register
 	bool memacc;	// instruction accesses memory
+	short latency;	// cycles before the result can be used, 0 if not scheduled
+	char unit;		// functional unit the instruction issues to
 };
 
 class CSE {
@@ -602,6 +774,11 @@ public:
     short int       reg;            /* AllocateRegisterVarsd register */
     unsigned int    voidf : 1;      /* cannot optimize flag */
     unsigned int    isfp : 1;
+	int first;			// live range, as statement numbers
+	int last;
+	int loop;			// outermost loop the expression was last used in
+	ENODE *copy;		// expression this one starts as a copy of
+	int copyAt;			// statement making the copy
 public:
 	int OptimizationDesireability();
 };
@@ -613,6 +790,25 @@ public:
 	static void InsertAfter(OCODE *an, OCODE *cd);
 };
 
+// Index from a label number to the label's OCODE in the peep list, for the
+// function currently being compiled. It is maintained as labels are
+// generated, inserted and removed so that branch targets can be found
+// without walking the peep list.
+class LabelIndex
+{
+	static OCODE **tbl;
+	static int size;		// always a power of two
+	static int count;
+	static int Slot(int64_t lab);
+	static void Grow();
+public:
+	static void Clear();
+	static void Insert(OCODE *ip);
+	static void Remove(OCODE *ip);
+	static OCODE *Find(int64_t lab);
+	static void RemoveFrom(OCODE *ip);
+};
+
 class Statement {
 public:
 	__int8 stype;
@@ -633,7 +829,10 @@ public:
 	char *fcname;       // firstcall block var name
 	char *lptr;
 	unsigned int prediction : 2;	// static prediction for if statements
+	unsigned int swapped : 1;		// else part placed first
 	int depth;
+	int pid;			// number within the function, for profiling
+	int nbranch;		// branches generated for the statement
 	
 	static Statement *ParseStop();
 	static Statement *ParseCompound();
@@ -666,6 +865,7 @@ public:
 	void GenerateWhile();
 	void GenerateUntil();
 	void GenerateFor();
+	bool GenerateVectorFor(int scalar_label, bool *fallback);
 	void GenerateForever();
 	void GenerateIf();
 	void GenerateDo();
@@ -677,8 +877,6 @@ public:
 	void GenerateCheck();
 	void GenerateFuncBody();
 	void GenerateSwitch();
-	void GenerateLinearSwitch();
-	void GenerateTabularSwitch();
 	void Generate();
 };
 
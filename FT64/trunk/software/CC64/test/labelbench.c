@@ -0,0 +1,51 @@
+// Writes a large generated state machine function, for timing how long the
+// compiler takes over a function with a great many labels and branches.
+// Each state is a label reached by goto, followed by some filler
+// statements. Build it with the host's C compiler and time compiling its
+// output:
+//
+//	labelbench > bench.c
+//	cc64 bench.c
+//
+// The number of states and of filler statements in each can be given on
+// the command line. The default of 450 states of 36 filler statements
+// makes a function of about 19.5k lines.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv)
+{
+	int n, fill, i, k;
+
+	n = argc > 1 ? atoi(argv[1]) : 450;
+	fill = argc > 2 ? atoi(argv[2]) : 36;
+	if (n < 1)
+		n = 1;
+	printf("int g[64];\n");
+	printf("int sm(int x)\n");
+	printf("{\n");
+	printf("  int a, b, c;\n");
+	printf("  a = 0; b = 1; c = 2;\n");
+	for (i = 0; i < n; i++) {
+		printf("s%d:\n", i);
+		printf("  x = x - 1;\n");
+		printf("  if (x > %d) {\n", i % 97);
+		printf("    a = a + %d * b;\n", i);
+		printf("    goto s%d;\n", (i * 7 + 3) % n);
+		printf("  }\n");
+		printf("  b = b ^ c + %d;\n", i);
+		if (i % 3 == 0)
+			printf("  g[a & 63] = b;\n");
+		for (k = 0; k < fill; k++)
+			printf("  c = c + (a >> %d) - g[%d];\n", k % 7, (i + k) % 64);
+		if (i % 100 == 99) {
+			printf("  if (x < 0)\n");
+			printf("    goto done;\n");
+		}
+	}
+	printf("done:\n");
+	printf("  return a + b + c;\n");
+	printf("}\n");
+	return (0);
+}
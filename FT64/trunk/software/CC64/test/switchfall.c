@@ -0,0 +1,48 @@
+// A switch dense enough for a jump table, whose cases fall through into
+// one another. The optimizer must see every case as reached by the jump,
+// not only by falling through from the case before it, or the earlier
+// cases get folded into a constant.
+// main() returns the number of values that came out wrong.
+
+static int fall(int x)
+{
+	int a;
+
+	a = 1;
+	switch(x) {
+	case 0:	a = a + 2;
+	case 1:	a = a * 3;
+	case 2:	a = a + 5;
+	case 3:	a = a - 7;
+	case 4:
+	case 5:	a = a + 11;
+	case 6:	a = a << 1;
+	case 7:	a = a + x;
+	case 8:	a = a ^ 13;
+	case 9:	a = a + 17;
+	case 10: a = a * 19;
+	case 11: a = a + 23;
+	case 12: a = a | 29;
+	case 13: a = a + 31;
+	case 14: return (a);
+	default: a = 0;
+	}
+	return (a + x);
+}
+
+static int expected[17] = {
+	-1, 1180, 766, 894, 382, 700, 702, 476, 476,
+	606, 412, 94, 60, 60, 32, 1, 15
+};
+
+int main()
+{
+	int x, errs;
+
+	errs = 0;
+	for (x = -1; x <= 15; x++) {
+		if (fall(x) != expected[x+1])
+			errs++;
+	}
+	return (errs);
+}
@@ -99,6 +99,8 @@
 #define IBBc1	0x27
 #define IBcc0   0x30
 #define IBcc1	0x31
+#define IBEQI0	0x32
+#define IBEQI1	0x33
 #define IBEQ         0x0
 #define IBNE         0x1
 #define IBLT         0x2
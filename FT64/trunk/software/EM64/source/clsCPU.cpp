@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include <stdio.h>
+#include <string.h>
 
 void clsCPU::Reset()
 	{
@@ -16,6 +17,65 @@ void clsCPU::Reset()
 		tick = 0;
 		rvecno = 0;
 		regLR = 29;
+		ClearProfile();
+	};
+	void clsCPU::ClearProfile() {
+		delete[] brprof;
+		brprof = nullptr;
+		brprofSize = 0;
+		brprofCount = 0;
+	};
+	void clsCPU::CountBranch(unsigned int ad, bool taken) {
+		BranchCount *old;
+		int nn, oldSize;
+		unsigned int h;
+
+		// Keep the table no more than half full.
+		if (brprofCount * 2 >= brprofSize) {
+			old = brprof;
+			oldSize = brprofSize;
+			brprofSize = brprofSize ? brprofSize * 2 : 1024;
+			brprof = new BranchCount[brprofSize];
+			memset(brprof, 0, brprofSize * sizeof(BranchCount));
+			brprofCount = 0;
+			for (nn = 0; nn < oldSize; nn++) {
+				if (old[nn].count) {
+					h = (old[nn].ad >> 2) & (brprofSize - 1);
+					while (brprof[h].count)
+						h = (h + 1) & (brprofSize - 1);
+					brprof[h] = old[nn];
+					brprofCount++;
+				}
+			}
+			delete[] old;
+		}
+		h = (ad >> 2) & (brprofSize - 1);
+		while (brprof[h].count && brprof[h].ad != ad)
+			h = (h + 1) & (brprofSize - 1);
+		if (brprof[h].count==0) {
+			brprof[h].ad = ad;
+			brprofCount++;
+		}
+		brprof[h].count++;
+		if (taken)
+			brprof[h].taken++;
+	};
+	// One line per branch executed: the address, the number of times it
+	// was executed and the number of times it was taken.
+	void clsCPU::WriteProfile() {
+		FILE *fp;
+		int nn;
+
+		if (profileName[0]=='\0' || brprofCount==0)
+			return;
+		fp = fopen(profileName, "w");
+		if (fp==NULL)
+			return;
+		for (nn = 0; nn < brprofSize; nn++) {
+			if (brprof[nn].count)
+				fprintf(fp, "%08X %I64u %I64u\n", brprof[nn].ad, brprof[nn].count, brprof[nn].taken);
+		}
+		fclose(fp);
 	};
 	void clsCPU::BuildConstant() {
 		sir = ir;
@@ -706,6 +766,16 @@ dc:
 				if ((a & (1LL << ((ir >> 16) & 0x3f)))!=0)
 					pc = pc + brdisp;
 			}
+			CountBranch(opc, pc != opc + 4);
+			break;
+		// Branch if equal to a nine bit immediate
+		case IBEQI0:
+		case IBEQI1:
+			Rt = 0;
+			brdisp = (((sir >> 22) << 3) | ((ir & 1) << 2));
+			if (a == (((int)(ir << 12)) >> 23))
+				pc = pc + brdisp;
+			CountBranch(opc, pc != opc + 4);
 			break;
 		case IBcc0:
 		case IBcc1:
@@ -739,6 +809,7 @@ dc:
 			default:
 				break;
 			}
+			CountBranch(opc, pc != opc + 4);
 			break;
 		case INOP:	Rt = 0; immcnt = 0; break;
 		default: break;
@@ -37,6 +37,17 @@ class clsCPU
 	unsigned int bmask;
 	int brdisp;
 	int r1,r2,r3;
+	// Execution counts for the conditional branches, by address. They are
+	// written to the profile file for the compiler to read.
+	struct BranchCount {
+		unsigned int ad;
+		unsigned __int64 count;
+		unsigned __int64 taken;
+	};
+	BranchCount *brprof;
+	int brprofSize;				// always a power of two
+	int brprofCount;
+	void CountBranch(unsigned int ad, bool taken);
 public:
 	char isRunning;
 	char brk;
@@ -69,8 +80,11 @@ public:
 	short int rvecno;			// registered vector number
 	unsigned __int64 cr0;
 	clsSystem *system1;
+	char profileName[260];
 
 	void Reset();
+	void ClearProfile();
+	void WriteProfile();
 	void BuildConstant();
 	void Step();
 };
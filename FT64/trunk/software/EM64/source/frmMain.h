@@ -2501,7 +2501,16 @@ private: void LoadIntelHexFile() {
 			 int lineno;	// 16531
 
 			char* str = (char*)(void*)Marshal::StringToHGlobalAnsi(this->openFileDialog1->FileName);
+			char *p;
 			System::Windows::Forms::Cursor::Current = System::Windows::Forms::Cursors::WaitCursor; 
+			// Branch counts go to a .prof file named after the hex file.
+			strncpy(cpu1.profileName, str, sizeof(cpu1.profileName) - 6);
+			cpu1.profileName[sizeof(cpu1.profileName) - 6] = '\0';
+			p = strrchr(cpu1.profileName, '.');
+			if (p && !strpbrk(p, "\\/"))
+				*p = '\0';
+			strcat(cpu1.profileName, ".prof");
+			cpu1.ClearProfile();
 			std::ifstream fp_in;
 			fp_in.open(str,std::ios::in);
 			firstAdr = 0;
@@ -2592,6 +2601,7 @@ private: void DoStopButton() {
 			 animate = false;
 			 isRunning = false;
 			 cpu1.brk = true;
+			 cpu1.WriteProfile();
 			 fullspeed = false;
 			 asmDisplay->animate = false;
 			 this->fullSpeedToolStripMenuItem->Checked = false;
@@ -0,0 +1,65 @@
+// ============================================================================
+//        __
+//   \\__/ o\    (C) 2014  Robert Finch, Stratford
+//    \  __ /    All rights reserved.
+//     \/_//     robfinch<remove>@finitron.ca
+//       ||
+//
+// L64 - Linker
+//  - 64 bit CPU
+//
+// This source file is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU Lesser General Public License as published 
+// by the Free Software Foundation, either version 3 of the License, or     
+// (at your option) any later version.                                      
+//                                                                          
+// This source file is distributed in the hope that it will be useful,      
+// but WITHOUT ANY WARRANTY; without even the implied warranty of           
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            
+// GNU General Public License for more details.                             
+//                                                                          
+// You should have received a copy of the GNU General Public License        
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.    
+//                                                                          
+// ============================================================================
+//
+// Stress check for the name table. Adds 200k names, more than fit in the
+// old fixed text, then finds each one again and checks its handle didn't
+// move as the table grew. Exits non-zero if anything is wrong.
+//
+#include <stdio.h>
+#include <time.h>
+#include "../source/NameTable.hpp"
+
+#define NNAMES  200000
+
+static NameTable nmTable;
+static int handles[NNAMES];
+
+int main()
+{
+    char nm[40];
+    int nn, bad;
+    clock_t t0;
+
+    bad = 0;
+    t0 = clock();
+    for (nn = 0; nn < NNAMES; nn++) {
+        sprintf(nm, "sym_%d_x", nn);
+        handles[nn] = nmTable.AddName(nm);
+    }
+    for (nn = 0; nn < NNAMES; nn++) {
+        sprintf(nm, "sym_%d_x", nn);
+        if (nmTable.FindName(nm) != handles[nn] || nmTable.AddName(nm) != handles[nn])
+            bad++;
+        else if (strcmp(nmTable.GetName(handles[nn]), nm) != 0)
+            bad++;
+    }
+    // A prefix of a name in the table isn't in the table.
+    strcpy(nm, "sym_1");
+    if (nmTable.FindName(nm) != -1)
+        bad++;
+    printf("%d names, %d bytes of text, %.3f s, %d bad\r\n", NNAMES,
+        nmTable.GetLength(), (double)(clock() - t0) / CLOCKS_PER_SEC, bad);
+    return bad ? 1 : 0;
+}